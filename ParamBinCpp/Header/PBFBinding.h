@@ -0,0 +1,90 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include "Pbf.h"
+
+namespace PBF
+{
+    /**
+     * @struct FieldBinding
+     * @brief Binds a parameter name below a table to a member of a struct.
+     */
+    template<typename S, typename T>
+    struct FieldBinding
+    {
+        using ValueType = T;
+
+        std::string_view name; /**< Name of the parameter relative to the table, without the leading dot. */
+        T S::* member = nullptr;
+    };
+
+    template<typename S, typename T>
+    constexpr FieldBinding<S, T> bindField(std::string_view name, T S::* member) noexcept
+    {
+        return FieldBinding<S, T>{ name, member };
+    }
+
+    /**
+     * @struct Binding
+     * @brief Describes the fields of a struct for PBFReader::bind.
+     *
+     * Specialize it with a constexpr tuple of FieldBinding named fields, most easily with
+     * the PBF_BINDING and PBF_FIELD macros at namespace scope:
+     *
+     *  PBF_BINDING(MotorParams, PBF_FIELD(MotorParams, Rs), PBF_FIELD(MotorParams, Lq), PBF_FIELD(MotorParams, Ld))
+     *
+     * Fields can have all types supported by PBFReader::getParam.
+     */
+    template<typename S>
+    struct Binding;
+
+    /*true if one of the fields of S is a std::string, which allocates when it is set*/
+    template<typename S>
+    constexpr bool isBindingAllocating()
+    {
+        return std::apply([](const auto&... field)
+        {
+            return (std::is_same<typename std::decay_t<decltype(field)>::ValueType, std::string>::value || ...);
+        }, Binding<S>::fields);
+    }
+}
+
+/*Field of Struct named like the parameter*/
+#define PBF_FIELD(Struct, member) PBF::bindField(#member, &Struct::member)
+
+/*Specializes PBF::Binding for Struct with the given fields*/
+#define PBF_BINDING(Struct, ...) \
+    template<> struct PBF::Binding<Struct> \
+    { \
+        static constexpr auto fields = std::make_tuple(__VA_ARGS__); \
+    };
@@ -0,0 +1,601 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <string>
+#include <string_view>
+#include <span>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <initializer_list>
+#include <type_traits>
+#include <bit>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include "Pbf.h"
+#include "PBFValue.h"
+#include "PBFChecksum.h"
+#include "ParamBinFileWriter.h"
+
+namespace PBF
+{
+    /**
+     * @class PbfSink
+     * @brief Destination of the bytes of a PbfBuilder.
+     */
+    class PbfSink
+    {
+    public:
+
+        virtual ~PbfSink() = default;
+
+        /*Appends size bytes, false on an error*/
+        virtual bool write(const void* data, std::size_t size) = 0;
+
+        /*Overwrites size bytes that were already written, offset from the start of the image*/
+        virtual bool writeAt(std::uint64_t offset, const void* data, std::size_t size) = 0;
+
+        /*Passes buffered bytes on, false on an error*/
+        virtual bool flush()
+        {
+            return true;
+        }
+    };
+
+    /**
+     * @class PbfBufferSink
+     * @brief PbfSink into a growable buffer in memory.
+     */
+    class PbfBufferSink : public PbfSink
+    {
+    public:
+
+        /*reserve: expected size of the image, saves the reallocations while the buffer grows*/
+        explicit PbfBufferSink(std::size_t reserve = 0U)
+        {
+            _buffer.reserve(reserve);
+        }
+
+        bool write(const void* data, std::size_t size) override
+        {
+            const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+            _buffer.insert(_buffer.end(), bytes, bytes + size);
+            return true;
+        }
+
+        bool writeAt(std::uint64_t offset, const void* data, std::size_t size) override
+        {
+            if ((offset > _buffer.size()) || (size > _buffer.size() - offset))
+            {
+                return false;
+            }
+            std::memcpy(_buffer.data() + offset, data, size);
+            return true;
+        }
+
+        const std::vector<std::uint8_t>& buffer() const noexcept
+        {
+            return _buffer;
+        }
+
+        /*Moves the buffer out, the sink is empty afterwards*/
+        std::vector<std::uint8_t> release() noexcept
+        {
+            return std::move(_buffer);
+        }
+
+    private:
+
+        std::vector<std::uint8_t> _buffer;
+    };
+
+    const std::size_t PBF_FILE_SINK_BUFFER_SIZE = 64U * 1024U;
+
+    /**
+     * @class PbfFileSink
+     * @brief PbfSink into a file descriptor, e.g. of a file opened with open().
+     *
+     * Small writes are collected in a buffer of PBF_FILE_SINK_BUFFER_SIZE bytes, larger ones go
+     * directly to the file. The image starts at the position of the descriptor when the sink is
+     * created. PbfBuilder::finish writes the header last, so the descriptor must be seekable
+     * (not a pipe or socket). The descriptor is not closed.
+     */
+    class PbfFileSink : public PbfSink
+    {
+    public:
+
+        explicit PbfFileSink(int fd) : _fd(fd), _start(seek(fd, 0, SEEK_CUR))
+        {
+            _buffer.reserve(PBF_FILE_SINK_BUFFER_SIZE);
+        }
+
+        ~PbfFileSink() override
+        {
+            flush();
+        }
+
+        PbfFileSink(const PbfFileSink&) = delete;
+        PbfFileSink& operator=(const PbfFileSink&) = delete;
+
+        bool write(const void* data, std::size_t size) override
+        {
+            if (_buffer.size() + size > PBF_FILE_SINK_BUFFER_SIZE)
+            {
+                if (!flush())
+                {
+                    return false;
+                }
+                if (size >= PBF_FILE_SINK_BUFFER_SIZE)
+                {
+                    return writeAll(data, size);
+                }
+            }
+            const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+            _buffer.insert(_buffer.end(), bytes, bytes + size);
+            return true;
+        }
+
+        bool writeAt(std::uint64_t offset, const void* data, std::size_t size) override
+        {
+            if ((_start < 0) || !flush())
+            {
+                return false;
+            }
+            long long position = seek(_fd, 0, SEEK_CUR);
+            if ((position < 0) || (seek(_fd, _start + static_cast<long long>(offset), SEEK_SET) < 0))
+            {
+                return false;
+            }
+            bool written = writeAll(data, size);
+            return (seek(_fd, position, SEEK_SET) >= 0) && written;
+        }
+
+        bool flush() override
+        {
+            bool written = _buffer.empty() || writeAll(_buffer.data(), _buffer.size());
+            _buffer.clear();
+            return written;
+        }
+
+    private:
+
+        bool writeAll(const void* data, std::size_t size)
+        {
+            const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+            while (size > 0U)
+            {
+#if defined(_WIN32)
+                long long written = _write(_fd, bytes, static_cast<unsigned int>(std::min<std::size_t>(size, 0x40000000U)));
+#else
+                long long written = ::write(_fd, bytes, size);
+#endif
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    return false;
+                }
+                bytes += written;
+                size -= static_cast<std::size_t>(written);
+            }
+            return true;
+        }
+
+        static long long seek(int fd, long long offset, int origin)
+        {
+#if defined(_WIN32)
+            return _lseeki64(fd, offset, origin);
+#else
+            return static_cast<long long>(::lseek(fd, static_cast<off_t>(offset), origin));
+#endif
+        }
+
+        int _fd = -1;
+        long long _start = -1; /*position of the image in the file, -1 if the descriptor can not seek*/
+        std::vector<std::uint8_t> _buffer;
+    };
+
+    /*Type of the records PbfBuilder::add writes for values of type T, None for all other types*/
+    template<typename T>
+    constexpr DataTypes getBuilderType()
+    {
+        if constexpr (std::is_same<T, bool>::value)
+        {
+            return DataTypes::Boolean;
+        }
+        else if constexpr (std::is_same<T, Date>::value)
+        {
+            return DataTypes::Date;
+        }
+        else if constexpr (std::is_same<T, Time>::value)
+        {
+            return DataTypes::Time;
+        }
+        else if constexpr (std::is_same<T, DateTime>::value)
+        {
+            return DataTypes::DateTime;
+        }
+        else
+        {
+            /*integers and floating-point values have the types of array elements*/
+            return getArrayElementType<T>();
+        }
+    }
+
+    /**
+     * @class PbfBuilder
+     * @brief Writes an image from parameters added by code, in one pass into a PbfSink.
+     *
+     * Every add call writes its record directly to the sink, in the order of the calls. The
+     * builder only keeps the hash and offset of each record (and the distinct strings with the
+     * StringPool section) until finish writes the sections and the header. No size has to be
+     * calculated up front, e.g.
+     *
+     *     PBF::PbfBufferSink sink;
+     *     PBF::PbfBuilder builder(sink, { PBF::SectionTypes::PerfectHash, PBF::SectionTypes::Checksum });
+     *     builder.add("Motor.Speed", 1500U);
+     *     builder.add("Motor.Name", "Main");
+     *     builder.finish();
+     *
+     * Keys must be unique, finish fails if a key was added twice. Errors (a failing sink, too
+     * large records, an image over 4 GB) are sticky: every later call returns false and the
+     * image is not valid.
+     */
+    class PbfBuilder
+    {
+    public:
+
+        PbfBuilder() = delete;
+
+        /**
+         * @param sections Sections finish writes: HashIndex, PerfectHash, StringPool (strings are
+         *        then stored once in the pool) and Checksum. The Checksum section is always written last.
+         * @param seed Hash seed of the image (pbfHashSeeded, at most PBF_MAX_HASH_SEED), the keys
+         *        must then be created with key() or pbfKey(key, seed).
+         */
+        explicit PbfBuilder(PbfSink& sink, std::initializer_list<SectionTypes> sections = {}, std::uint16_t seed = 0U) :
+            _sink(sink), _seed(seed)
+        {
+            for (SectionTypes type : sections)
+            {
+                if (type == SectionTypes::Checksum)
+                {
+                    _checksum = true;
+                }
+                else if ((type == SectionTypes::HashIndex) || (type == SectionTypes::PerfectHash) || (type == SectionTypes::StringPool))
+                {
+                    _stringPool = _stringPool || (type == SectionTypes::StringPool);
+                    _sectionTypes.push_back(type);
+                }
+                else
+                {
+                    _failed = true;
+                }
+            }
+            _failed = _failed || (seed > PBF_MAX_HASH_SEED);
+
+            /*the header is written again by finish*/
+            std::uint8_t header[PBF_FILE_HEADER_SIZE] = {};
+            _failed = _failed || !_sink.write(header, sizeof(header));
+            _offset = PBF_FILE_HEADER_SIZE;
+        }
+
+        PbfBuilder(const PbfBuilder&) = delete;
+        PbfBuilder& operator=(const PbfBuilder&) = delete;
+
+        /*KeyHash of a key in this image, hashed with its seed*/
+        KeyHash key(std::string_view text) const noexcept
+        {
+            return pbfKey(text, _seed);
+        }
+
+        /**
+         * @brief Adds a parameter of a scalar type (bool, integers, float, double, Date, Time, DateTime).
+         */
+        template<typename T>
+        bool add(KeyHash key, const T& value)
+        {
+            constexpr DataTypes type = getBuilderType<T>();
+            static_assert(type != DataTypes::None, "Unsupported parameter type for PbfBuilder::add");
+            constexpr std::uint32_t dataSize = getRecordDataSize(type, 0U);
+
+            std::uint32_t words[2U + dataSize / sizeof(std::uint32_t)] = {};
+            words[0] = beginRecord(key);
+            words[1] = (static_cast<std::uint32_t>(type) << 24U) | static_cast<std::uint32_t>(sizeof(T));
+            if constexpr (std::is_same<T, Date>::value)
+            {
+                words[2] = encodeDate(value);
+            }
+            else if constexpr (std::is_same<T, Time>::value)
+            {
+                std::uint64_t time = encodeTime(value);
+                std::memcpy(&words[2], &time, sizeof(time));
+            }
+            else if constexpr (std::is_same<T, DateTime>::value)
+            {
+                std::uint64_t time = encodeTime(value.time);
+                words[2] = encodeDate(value.date);
+                std::memcpy(&words[3], &time, sizeof(time));
+            }
+            else if constexpr (sizeof(T) < sizeof(std::uint32_t))
+            {
+                /*bytes and 16-bit values are stored as a zero extended 32-bit word*/
+                using Unsigned = std::conditional_t<sizeof(T) == 1U, std::uint8_t, std::uint16_t>;
+                Unsigned bits(0U);
+                std::memcpy(&bits, &value, sizeof(T));
+                words[2] = bits;
+            }
+            else
+            {
+                std::memcpy(&words[2], &value, sizeof(T));
+            }
+            return emit(words, sizeof(words));
+        }
+
+        /**
+         * @brief Adds a string parameter, stored in the StringPool section if the builder has one.
+         */
+        bool add(KeyHash key, std::string_view value)
+        {
+            if (value.size() >= 0x00FFFFFF - sizeof(std::uint32_t))
+            {
+                _failed = true;
+                return false;
+            }
+            std::uint32_t words[3] = { beginRecord(key), 0U, 0U };
+            if (_stringPool)
+            {
+                auto pooled = _stringPoolOffsets.find(value);
+                if (pooled == _stringPoolOffsets.end())
+                {
+                    pooled = _stringPoolOffsets.emplace(std::string(value), static_cast<std::uint32_t>(_stringPoolData.size())).first;
+                    _stringPoolData.insert(_stringPoolData.end(), value.begin(), value.end());
+                    _stringPoolData.push_back('\0');
+                }
+                words[1] = (static_cast<std::uint32_t>(DataTypes::PooledString) << 24U) | static_cast<std::uint32_t>(value.size());
+                words[2] = pooled->second;
+                return emit(words, sizeof(words));
+            }
+
+            /*always add \0 at the end of the string, the size field holds the padded size*/
+            std::uint32_t paddedSize = ((static_cast<std::uint32_t>(value.size()) + 1U + sizeof(std::uint32_t) - 1U) / sizeof(std::uint32_t)) * sizeof(std::uint32_t);
+            words[1] = (static_cast<std::uint32_t>(DataTypes::String) << 24U) | paddedSize;
+            return emit(words, 2U * sizeof(std::uint32_t)) && emit(value.data(), value.size()) &&
+                emit(PADDING, paddedSize - static_cast<std::uint32_t>(value.size()));
+        }
+
+        bool add(KeyHash key, const char* value)
+        {
+            return add(key, std::string_view(value));
+        }
+
+        bool add(KeyHash key, const std::string& value)
+        {
+            return add(key, std::string_view(value));
+        }
+
+        /**
+         * @brief Adds an array of integers or floating-point values, see getArrayRecordDataSize.
+         */
+        template<typename T>
+        bool addArray(KeyHash key, std::span<const T> elements)
+        {
+            constexpr DataTypes elementType = getArrayElementType<T>();
+            static_assert(elementType != DataTypes::None, "Unsupported element type for PbfBuilder::addArray");
+            constexpr std::uint32_t elementSize = static_cast<std::uint32_t>(sizeof(T));
+            if (elements.size() > (0x00FFFFFF - PBF_ARRAY_HEADER_SIZE - sizeof(std::uint32_t)) / elementSize)
+            {
+                _failed = true;
+                return false;
+            }
+            std::uint32_t count = static_cast<std::uint32_t>(elements.size());
+            std::uint32_t dataSize = getArrayRecordDataSize(elementType, count);
+
+            /*records start on 32-bit boundaries, 64-bit elements may need 4 bytes in front*/
+            std::uint32_t elementsOffset = PBF_ARRAY_HEADER_SIZE;
+            if (((_offset + PBF_FILE_RECORD_HEADER_SIZE + elementsOffset) % elementSize) != 0U)
+            {
+                elementsOffset += sizeof(std::uint32_t);
+            }
+            std::uint32_t words[4] = { beginRecord(key), (static_cast<std::uint32_t>(DataTypes::Array) << 24U) | dataSize,
+                (static_cast<std::uint32_t>(elementType) << 24U) | elementsOffset, count };
+            std::uint32_t elementBytes = count * elementSize;
+            return emit(words, sizeof(words)) && emit(PADDING, elementsOffset - PBF_ARRAY_HEADER_SIZE) &&
+                emit(elements.data(), elementBytes) && emit(PADDING, dataSize - elementsOffset - elementBytes);
+        }
+
+        /**
+         * @brief Writes the sections and the header, must be called once after the last parameter.
+         * @param extraSections More sections, e.g. from ParamBinFileWriter::makeFixedLayoutSection, written in front of the Checksum section.
+         * @return false if an earlier call failed, a key was added twice or the sink fails.
+         */
+        bool finish(const std::vector<PbfSection>& extraSections = {})
+        {
+            if (_finished || _failed)
+            {
+                _failed = true;
+                return false;
+            }
+
+            /*readers reject images with a key twice, the sorted records are also the HashIndex*/
+            std::vector<std::pair<std::uint32_t, std::uint32_t>> sorted(_records);
+            ParamBinFileWriter::sortByHash(sorted);
+            _failed = std::adjacent_find(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.first == b.first; }) != sorted.end();
+
+            std::vector<PbfSection> sections;
+            for (SectionTypes type : _sectionTypes)
+            {
+                if (type == SectionTypes::HashIndex)
+                {
+                    sections.push_back(ParamBinFileWriter::makeSortedHashIndexSection(sorted));
+                }
+                else if (type == SectionTypes::PerfectHash)
+                {
+                    sections.push_back(ParamBinFileWriter::makePerfectHashSection(_records));
+                    _failed = _failed || (sections.back().type == SectionTypes::None);
+                }
+                else
+                {
+                    sections.push_back(ParamBinFileWriter::makeStringPoolSection(_stringPoolData));
+                }
+            }
+            sections.insert(sections.end(), extraSections.begin(), extraSections.end());
+            if (_checksum)
+            {
+                sections.push_back(ParamBinFileWriter::makeChecksumSection());
+            }
+
+            std::uint64_t directory = sections.empty() ? 0U : _offset;
+            std::uint64_t size = _offset;
+            std::vector<std::uint32_t> directoryWords;
+            if (!sections.empty())
+            {
+                std::uint32_t count = static_cast<std::uint32_t>(sections.size());
+                size += ParamBinFileWriter::getSectionDirectorySize(count);
+                directoryWords.push_back(count);
+                for (const PbfSection& section : sections)
+                {
+                    std::uint64_t sectionSize = section.data.size() * sizeof(std::uint32_t);
+                    directoryWords.insert(directoryWords.end(), { static_cast<std::uint32_t>(section.type), static_cast<std::uint32_t>(size), static_cast<std::uint32_t>(sectionSize) });
+                    size += sectionSize;
+                }
+            }
+            if (_failed || (size > 0xFFFFFFFFU))
+            {
+                _failed = true;
+                _finished = true;
+                return false;
+            }
+
+            std::uint16_t version = (_seed != 0U) ? PBF_FILE_VERSION_SEEDED : (sections.empty() ? PBF_FILE_VERSION : PBF_FILE_VERSION_SECTIONS);
+            std::uint32_t header[3] = { static_cast<std::uint32_t>(size),
+                (static_cast<std::uint32_t>(version) << 16U) | _seed | ((std::endian::native == std::endian::big) ? PBF_HEADER_BIG_ENDIAN : 0U),
+                static_cast<std::uint32_t>(directory) };
+
+            bool written = directoryWords.empty() || emit(directoryWords.data(), directoryWords.size() * sizeof(std::uint32_t));
+            for (std::size_t i = 0U; written && (i < sections.size()); i++)
+            {
+                std::vector<std::uint32_t> data = sections[i].data;
+                if (_checksum && (i + 1U == sections.size()))
+                {
+                    /*the CRC of the records, directory and sections so far was updated by emit, the header comes in front*/
+                    data[0] = crc32cCombine(crc32c(header, sizeof(header)), _crc, static_cast<std::size_t>(_offset - PBF_FILE_HEADER_SIZE));
+                }
+                written = data.empty() || emit(data.data(), data.size() * sizeof(std::uint32_t));
+            }
+            written = written && _sink.writeAt(0U, header, sizeof(header)) && _sink.flush();
+            _failed = !written;
+            _finished = true;
+            return written;
+        }
+
+        /*Number of bytes written so far*/
+        std::uint64_t size() const noexcept
+        {
+            return _offset;
+        }
+
+        /*Number of parameters added so far*/
+        std::uint32_t count() const noexcept
+        {
+            return static_cast<std::uint32_t>(_records.size());
+        }
+
+        /*true if a call failed, the image is then not valid*/
+        bool failed() const noexcept
+        {
+            return _failed;
+        }
+
+    private:
+
+        /*Hash of key in the image, the record starts at the current offset*/
+        std::uint32_t beginRecord(KeyHash key)
+        {
+            std::uint32_t hash = key.value;
+            _records.push_back(std::make_pair(hash, static_cast<std::uint32_t>(_offset)));
+            return hash;
+        }
+
+        bool emit(const void* data, std::size_t size)
+        {
+            if (_failed || _finished || (_offset + size > 0xFFFFFFFFU))
+            {
+                _failed = true;
+                return false;
+            }
+            if (size == 0U)
+            {
+                return true;
+            }
+            if (_checksum)
+            {
+                _crc = crc32c(data, size, _crc);
+            }
+            _offset += size;
+            _failed = !_sink.write(data, size);
+            return !_failed;
+        }
+
+        /*Hash and equality of the pooled strings, so they can be found with a std::string_view*/
+        struct StringHash
+        {
+            using is_transparent = void;
+
+            std::size_t operator()(std::string_view text) const noexcept
+            {
+                return std::hash<std::string_view>{}(text);
+            }
+        };
+
+        static constexpr std::uint8_t PADDING[8] = {};
+
+        PbfSink& _sink;
+        std::uint16_t _seed = 0U;
+        bool _checksum = false;
+        bool _stringPool = false;
+        bool _finished = false;
+        bool _failed = false;
+        std::uint64_t _offset = 0U; /*bytes written*/
+        std::uint32_t _crc = 0U; /*CRC32C of the bytes after the header*/
+        std::vector<SectionTypes> _sectionTypes;
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> _records; /*hash and offset of every record*/
+        std::vector<char> _stringPoolData; /*strings of the pooled string records*/
+        std::unordered_map<std::string, std::uint32_t, StringHash, std::equal_to<>> _stringPoolOffsets; /*string -> offset in the pool*/
+    };
+}
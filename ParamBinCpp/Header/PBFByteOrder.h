@@ -0,0 +1,385 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <bit>
+#include <optional>
+#include <algorithm>
+#include "Pbf.h"
+#include "PBFValue.h"
+#include "PBFChecksum.h"
+
+#if defined(__SSSE3__) || (defined(_MSC_VER) && defined(__AVX__))
+#include <tmmintrin.h>
+#define PBF_SWAP_SSSE3
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define PBF_SWAP_NEON
+#endif
+
+namespace PBF
+{
+    /*
+     * Images are written in the byte order of the converter (--big-endian for the other one)
+     * and the version word of the header tells which one it is. PBFReader::read swaps an image
+     * of the other byte order once, in a copy, so its lookups cost the same as on a native
+     * image. PBFView, PBFStorageView and readLazy use the image as it is and do not open
+     * images of the other byte order; swapByteOrder converts such an image in place.
+     *
+     * Values smaller than 32 bits (Boolean, Int8, UInt8, Int16, UInt16) stay in the first
+     * bytes of their word. The data of the FixedLayout section and unknown sections are not
+     * swapped, the converter writes the FixedLayout data in the byte order of the image.
+     */
+
+    inline std::uint16_t pbfByteSwap16(std::uint16_t value) noexcept
+    {
+        return static_cast<std::uint16_t>((value >> 8U) | (value << 8U));
+    }
+
+    inline std::uint32_t pbfByteSwap32(std::uint32_t value) noexcept
+    {
+        return ((value & 0x000000FFU) << 24U) | ((value & 0x0000FF00U) << 8U) | ((value & 0x00FF0000U) >> 8U) | (value >> 24U);
+    }
+
+    inline std::uint64_t pbfByteSwap64(std::uint64_t value) noexcept
+    {
+        return (static_cast<std::uint64_t>(pbfByteSwap32(static_cast<std::uint32_t>(value))) << 32U) | pbfByteSwap32(static_cast<std::uint32_t>(value >> 32U));
+    }
+
+    /**
+     * @brief Reverses the bytes of count elements of elementSize (1, 2, 4 or 8) bytes in place.
+     *
+     * 16 bytes per instruction with SSSE3 or NEON, the data does not need any alignment.
+     */
+    inline void swapColumn(std::uint8_t* data, std::size_t count, std::uint32_t elementSize) noexcept
+    {
+        if (elementSize <= 1U)
+        {
+            return;
+        }
+        std::size_t bytes = count * elementSize;
+        std::size_t i(0U);
+#if defined(PBF_SWAP_SSSE3)
+        const __m128i mask = (elementSize == 2U) ? _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14) :
+            (elementSize == 4U) ? _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12) :
+            _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+        for (; i + 16U <= bytes; i += 16U)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_shuffle_epi8(block, mask));
+        }
+#elif defined(PBF_SWAP_NEON)
+        for (; i + 16U <= bytes; i += 16U)
+        {
+            uint8x16_t block = vld1q_u8(data + i);
+            block = (elementSize == 2U) ? vrev16q_u8(block) : (elementSize == 4U) ? vrev32q_u8(block) : vrev64q_u8(block);
+            vst1q_u8(data + i, block);
+        }
+#endif
+        for (; i < bytes; i += elementSize)
+        {
+            if (elementSize == 2U)
+            {
+                std::uint16_t value(0U);
+                std::memcpy(&value, data + i, sizeof(value));
+                value = pbfByteSwap16(value);
+                std::memcpy(data + i, &value, sizeof(value));
+            }
+            else if (elementSize == 4U)
+            {
+                std::uint32_t value = pbfByteSwap32(loadU32(data + i));
+                std::memcpy(data + i, &value, sizeof(value));
+            }
+            else
+            {
+                std::uint64_t value = pbfByteSwap64(loadU64(data + i));
+                std::memcpy(data + i, &value, sizeof(value));
+            }
+        }
+    }
+
+    /**
+     * @brief Byte order of an image, from the version word of its header.
+     *
+     * The version (at most 0x7F) and the big-endian flag only fit together in one of the
+     * two byte orders.
+     * @return std::nullopt if the header fits neither byte order.
+     */
+    inline std::optional<std::endian> getImageByteOrder(const void* memory, std::size_t size) noexcept
+    {
+        if ((memory == nullptr) || (size < PBF_FILE_HEADER_SIZE))
+        {
+            return std::nullopt;
+        }
+        const std::uint32_t stored = loadU32(static_cast<const std::uint8_t*>(memory) + sizeof(std::uint32_t));
+        const std::endian other = (std::endian::native == std::endian::little) ? std::endian::big : std::endian::little;
+        for (std::endian order : { std::endian::native, other })
+        {
+            std::uint32_t vr = (order == std::endian::native) ? stored : pbfByteSwap32(stored);
+            std::uint32_t version = vr >> 16U;
+            bool bigEndian = (vr & PBF_HEADER_BIG_ENDIAN) != 0U;
+            if ((version >= PBF_FILE_VERSION) && (version <= 0x7FU) && (bigEndian == (order == std::endian::big)))
+            {
+                return order;
+            }
+        }
+        return std::nullopt;
+    }
+
+    namespace detail
+    {
+        /*Swaps the data of a record, values are read in the byte order of the image before they are swapped*/
+        inline bool swapRecordData(DataTypes type, std::uint8_t* data, std::uint32_t size, bool native) noexcept
+        {
+            switch (type)
+            {
+#ifdef ENABLE_PBF_16BIT_TYPES
+            case DataTypes::Int16:
+            case DataTypes::UInt16:
+                swapColumn(data, 1U, 2U);
+                return true;
+#endif
+            case DataTypes::Int32:
+            case DataTypes::UInt32:
+            case DataTypes::Float32:
+            case DataTypes::Date:
+            case DataTypes::PooledString:
+                swapColumn(data, 1U, 4U);
+                return true;
+            case DataTypes::Int64:
+            case DataTypes::UInt64:
+            case DataTypes::Float64:
+            case DataTypes::Time:
+                swapColumn(data, 1U, 8U);
+                return true;
+            case DataTypes::DateTime:
+                swapColumn(data, 1U, 4U);
+                swapColumn(data + sizeof(std::uint32_t), 1U, 8U);
+                return true;
+            case DataTypes::Array:
+            {
+                std::uint32_t descriptor = native ? loadU32(data) : pbfByteSwap32(loadU32(data));
+                std::uint32_t count = native ? loadU32(data + sizeof(std::uint32_t)) : pbfByteSwap32(loadU32(data + sizeof(std::uint32_t)));
+                std::uint32_t elementSize = getArrayElementSize(static_cast<DataTypes>(descriptor >> 24U));
+                std::uint32_t elementsOffset = descriptor & 0x00FFFFFF;
+                if ((size < PBF_ARRAY_HEADER_SIZE) || (elementSize == 0U) || (elementsOffset < PBF_ARRAY_HEADER_SIZE) ||
+                    (elementsOffset > size) || (count > (size - elementsOffset) / elementSize))
+                {
+                    return false;
+                }
+                swapColumn(data, 2U, 4U);
+                swapColumn(data + elementsOffset, count, elementSize);
+                return true;
+            }
+            default:
+                /*strings and values of one byte*/
+                return true;
+            }
+        }
+
+        /*Swaps the words of a section that are not bytes*/
+        inline bool swapSection(SectionTypes type, std::uint8_t* data, std::uint32_t size, bool native) noexcept
+        {
+            const std::uint32_t words = size / sizeof(std::uint32_t);
+            auto load = [native, data](std::uint32_t word) { return native ? loadU32(data + word * sizeof(std::uint32_t)) : pbfByteSwap32(loadU32(data + word * sizeof(std::uint32_t))); };
+            switch (type)
+            {
+            case SectionTypes::HashIndex:
+            case SectionTypes::Hierarchy:
+            case SectionTypes::Checksum:
+                swapColumn(data, words, 4U);
+                return true;
+            case SectionTypes::FixedLayout:
+                swapColumn(data, std::min(words, 2U), 4U);
+                return true;
+            case SectionTypes::KeyNames:
+            {
+                /*header, hashes, name numbers and block offsets, the names are bytes*/
+                if (words < 3U)
+                {
+                    return false;
+                }
+                std::uint32_t count = load(0U);
+                std::uint32_t block = load(1U);
+                if ((block == 0U) || (count > words / 2U))
+                {
+                    return false;
+                }
+                std::uint32_t tableWords = 3U + 2U * count + count / block + (((count % block) != 0U) ? 1U : 0U);
+                if (tableWords > words)
+                {
+                    return false;
+                }
+                swapColumn(data, tableWords, 4U);
+                return true;
+            }
+            case SectionTypes::PerfectHash:
+            {
+                /*header, 16-bit pilots, remapping and slots*/
+                if (words < 4U)
+                {
+                    return false;
+                }
+                std::uint32_t buckets = load(1U);
+                if (buckets > (words - 4U) * 2U)
+                {
+                    return false;
+                }
+                std::uint32_t pilotWords = (buckets + 1U) / 2U;
+                swapColumn(data, 4U, 4U);
+                swapColumn(data + 4U * sizeof(std::uint32_t), buckets, 2U);
+                swapColumn(data + (4U + pilotWords) * sizeof(std::uint32_t), words - 4U - pilotWords, 4U);
+                return true;
+            }
+            case SectionTypes::StringPool:
+                /*bytes*/
+                return true;
+            default:
+                return true;
+            }
+        }
+    }
+
+    /**
+     * @brief Converts an image to the other byte order in place.
+     *
+     * One pass over the records and the sections, long columns (arrays, index sections) are
+     * swapped 16 bytes at a time. A Checksum section is verified before and written again
+     * for the swapped image.
+     * @param memory Start of the image, it must be writable.
+     * @param size Size of the buffer, the image may be smaller.
+     * @return false if the image is malformed or its checksum does not match. The image may
+     *         then be partly swapped.
+     */
+    inline bool swapByteOrder(void* memory, std::size_t size) noexcept
+    {
+        std::optional<std::endian> order = getImageByteOrder(memory, size);
+        if (!order)
+        {
+            return false;
+        }
+        const bool native = (order.value() == std::endian::native);
+        std::uint8_t* base = static_cast<std::uint8_t*>(memory);
+        auto load = [native](const std::uint8_t* p) { return native ? loadU32(p) : pbfByteSwap32(loadU32(p)); };
+
+        const std::uint32_t imageSize = load(base);
+        const std::uint32_t vr = load(base + sizeof(std::uint32_t));
+        const std::uint32_t directory = load(base + 2U * sizeof(std::uint32_t));
+        if ((imageSize < PBF_FILE_HEADER_SIZE) || (imageSize > size))
+        {
+            return false;
+        }
+        std::uint32_t count(0U);
+        std::uint32_t entries(0U);
+        if (directory != 0U)
+        {
+            if ((directory < PBF_FILE_HEADER_SIZE) || ((directory % sizeof(std::uint32_t)) != 0U) || (directory > imageSize - sizeof(std::uint32_t)))
+            {
+                return false;
+            }
+            count = load(base + directory);
+            entries = directory + sizeof(std::uint32_t);
+            if (count > (imageSize - entries) / PBF_SECTION_ENTRY_SIZE)
+            {
+                return false;
+            }
+        }
+
+        /*sections, checked before anything is swapped*/
+        std::uint32_t checksum(0U);
+        for (std::uint32_t i = 0U; i < count; i++)
+        {
+            const std::uint8_t* entry = base + entries + i * PBF_SECTION_ENTRY_SIZE;
+            std::uint32_t offset = load(entry + sizeof(std::uint32_t));
+            std::uint32_t sectionSize = load(entry + 2U * sizeof(std::uint32_t));
+            if ((offset < directory) || (offset > imageSize) || (sectionSize > imageSize - offset))
+            {
+                return false;
+            }
+            if (static_cast<SectionTypes>(load(entry)) == SectionTypes::Checksum)
+            {
+                if ((sectionSize < PBF_CHECKSUM_SECTION_SIZE) || (crc32c(base, offset) != load(base + offset)))
+                {
+                    return false;
+                }
+                checksum = offset;
+            }
+        }
+
+        /*records*/
+        const std::uint32_t recordsEnd = (directory != 0U) ? directory : imageSize;
+        std::uint32_t offset(PBF_FILE_HEADER_SIZE);
+        while (offset < recordsEnd)
+        {
+            if (PBF_FILE_RECORD_HEADER_SIZE > recordsEnd - offset)
+            {
+                return false;
+            }
+            std::uint32_t reg1 = load(base + offset + sizeof(std::uint32_t));
+            DataTypes type = static_cast<DataTypes>(reg1 >> 24U);
+            std::uint32_t dataSize = getRecordDataSize(type, reg1 & 0x00FFFFFF);
+            if ((dataSize == 0U) || (dataSize > recordsEnd - offset - PBF_FILE_RECORD_HEADER_SIZE) ||
+                !detail::swapRecordData(type, base + offset + PBF_FILE_RECORD_HEADER_SIZE, dataSize, native))
+            {
+                return false;
+            }
+            swapColumn(base + offset, 2U, 4U);
+            offset += PBF_FILE_RECORD_HEADER_SIZE + dataSize;
+        }
+
+        for (std::uint32_t i = 0U; i < count; i++)
+        {
+            const std::uint8_t* entry = base + entries + i * PBF_SECTION_ENTRY_SIZE;
+            std::uint32_t sectionOffset = load(entry + sizeof(std::uint32_t));
+            if (!detail::swapSection(static_cast<SectionTypes>(load(entry)), base + sectionOffset, load(entry + 2U * sizeof(std::uint32_t)), native))
+            {
+                return false;
+            }
+        }
+        if (directory != 0U)
+        {
+            swapColumn(base + directory, 1U + 3U * count, 4U);
+        }
+
+        /*header, with the flag of the new byte order*/
+        swapColumn(base, 3U, 4U);
+        std::uint32_t swapped = vr ^ PBF_HEADER_BIG_ENDIAN;
+        swapped = native ? pbfByteSwap32(swapped) : swapped;
+        std::memcpy(base + sizeof(std::uint32_t), &swapped, sizeof(std::uint32_t));
+
+        if (checksum != 0U)
+        {
+            std::uint32_t crc = crc32c(base, checksum);
+            crc = native ? pbfByteSwap32(crc) : crc;
+            std::memcpy(base + checksum, &crc, sizeof(std::uint32_t));
+        }
+        return true;
+    }
+}
@@ -0,0 +1,249 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <array>
+
+/*_mm_crc32_u64 only exists on x64. MSVC has no /arch switch for SSE4.2, without /arch:AVX the CPU is checked at run time*/
+#if (defined(_M_X64) || defined(__x86_64__)) && (defined(__SSE4_2__) || (defined(_MSC_VER) && !defined(__clang__)))
+#include <nmmintrin.h>
+#define PBF_CRC_SSE42
+#if !defined(__SSE4_2__) && !defined(__AVX__)
+#include <intrin.h>
+#define PBF_CRC_SSE42_CPUID
+#endif
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define PBF_CRC_ARM
+#endif
+
+namespace PBF
+{
+    // Checksum section
+    //  4 bytes (UInt32)  CRC32C of all bytes of the image in front of the section data
+    //                    (header, records, section directory and the sections before it)
+
+    const std::uint32_t PBF_CHECKSUM_SECTION_SIZE = sizeof(std::uint32_t);
+
+    /*CRC32C (Castagnoli) polynomial, bit reflected*/
+    const std::uint32_t PBF_CRC32C_POLYNOMIAL = 0x82F63B78U;
+
+    /*Tables for slice-by-8, table k holds the CRC of a byte followed by k zero bytes*/
+    constexpr std::array<std::array<std::uint32_t, 256>, 8> makeCrc32cTables() noexcept
+    {
+        std::array<std::array<std::uint32_t, 256>, 8> tables{};
+        for (std::uint32_t i = 0U; i < 256U; i++)
+        {
+            std::uint32_t crc = i;
+            for (std::uint32_t bit = 0U; bit < 8U; bit++)
+            {
+                crc = (crc >> 1U) ^ (PBF_CRC32C_POLYNOMIAL & (0U - (crc & 1U)));
+            }
+            tables[0][i] = crc;
+        }
+        for (std::uint32_t k = 1U; k < 8U; k++)
+        {
+            for (std::uint32_t i = 0U; i < 256U; i++)
+            {
+                tables[k][i] = (tables[k - 1U][i] >> 8U) ^ tables[0][tables[k - 1U][i] & 0xFFU];
+            }
+        }
+        return tables;
+    }
+
+    inline constexpr std::array<std::array<std::uint32_t, 256>, 8> PBF_CRC32C_TABLES = makeCrc32cTables();
+
+    /*Slice-by-8 update of a CRC32C register (without the inversions)*/
+    inline std::uint32_t crc32cUpdateSoftware(std::uint32_t crc, const std::uint8_t* data, std::size_t size) noexcept
+    {
+        const auto& t = PBF_CRC32C_TABLES;
+        while (size >= 8U)
+        {
+            std::uint32_t low(0U);
+            std::uint32_t high(0U);
+            std::memcpy(&low, data, sizeof(low));
+            std::memcpy(&high, data + sizeof(low), sizeof(high));
+            low ^= crc;
+            crc = t[7][low & 0xFFU] ^ t[6][(low >> 8U) & 0xFFU] ^ t[5][(low >> 16U) & 0xFFU] ^ t[4][low >> 24U] ^
+                t[3][high & 0xFFU] ^ t[2][(high >> 8U) & 0xFFU] ^ t[1][(high >> 16U) & 0xFFU] ^ t[0][high >> 24U];
+            data += 8U;
+            size -= 8U;
+        }
+        while (size > 0U)
+        {
+            crc = (crc >> 8U) ^ t[0][(crc ^ *data) & 0xFFU];
+            data++;
+            size--;
+        }
+        return crc;
+    }
+
+    /*CRC32C of data with slice-by-8 on every target, continue a CRC by passing it as crc*/
+    inline std::uint32_t crc32cSoftware(const void* data, std::size_t size, std::uint32_t crc = 0U) noexcept
+    {
+        return ~crc32cUpdateSoftware(~crc, static_cast<const std::uint8_t*>(data), size);
+    }
+
+    /*Product of two polynomials modulo the CRC32C polynomial (bit reflected, x^0 is the top bit)*/
+    constexpr std::uint32_t crc32cMultiply(std::uint32_t a, std::uint32_t b) noexcept
+    {
+        std::uint32_t product(0U);
+        for (std::uint32_t m = 0x80000000U; m != 0U; m >>= 1U)
+        {
+            product ^= b & (0U - static_cast<std::uint32_t>((a & m) != 0U));
+            b = (b >> 1U) ^ (PBF_CRC32C_POLYNOMIAL & (0U - (b & 1U)));
+        }
+        return product;
+    }
+
+    /*x^(8 * bytes) modulo the CRC32C polynomial, multiplying a CRC register by it appends that many zero bytes*/
+    constexpr std::uint32_t crc32cZeroBytesOperator(std::size_t bytes) noexcept
+    {
+        std::uint32_t result = 0x80000000U;
+        std::uint32_t square = 0x00800000U; /*x^8*/
+        while (bytes != 0U)
+        {
+            if ((bytes & 1U) != 0U)
+            {
+                result = crc32cMultiply(result, square);
+            }
+            square = crc32cMultiply(square, square);
+            bytes >>= 1U;
+        }
+        return result;
+    }
+
+    /*CRC32C of A followed by B from the CRC32C of both parts, sizeB: number of bytes of B*/
+    constexpr std::uint32_t crc32cCombine(std::uint32_t crcA, std::uint32_t crcB, std::size_t sizeB) noexcept
+    {
+        return crc32cMultiply(crcA, crc32cZeroBytesOperator(sizeB)) ^ crcB;
+    }
+
+#if defined(PBF_CRC_SSE42) || defined(PBF_CRC_ARM)
+
+    /*true if the CPU has the CRC instructions the build uses, checked once*/
+    inline bool crc32cHardwareAvailable() noexcept
+    {
+#if defined(PBF_CRC_SSE42_CPUID)
+        static const bool available = []()
+        {
+            int info[4] = {};
+            __cpuid(info, 1);
+            return (info[2] & (1 << 20)) != 0; /*ECX bit 20: SSE4.2*/
+        }();
+        return available;
+#else
+        return true;
+#endif
+    }
+
+    /*Update with the CRC instructions of the CPU, one 8 byte word per instruction*/
+    inline std::uint32_t crc32cUpdateHardware(std::uint32_t crc, const std::uint8_t* data, std::size_t size) noexcept
+    {
+        while (size >= 8U)
+        {
+            std::uint64_t word(0U);
+            std::memcpy(&word, data, sizeof(word));
+#if defined(PBF_CRC_SSE42)
+            crc = static_cast<std::uint32_t>(_mm_crc32_u64(crc, word));
+#else
+            crc = __crc32cd(crc, word);
+#endif
+            data += 8U;
+            size -= 8U;
+        }
+        while (size > 0U)
+        {
+#if defined(PBF_CRC_SSE42)
+            crc = _mm_crc32_u8(crc, *data);
+#else
+            crc = __crc32cb(crc, *data);
+#endif
+            data++;
+            size--;
+        }
+        return crc;
+    }
+
+    /*
+     * Bytes per stream of the interleaved update. The CRC instruction has a latency of about three
+     * cycles but accepts a new word every cycle, so three independent streams keep it busy.
+     */
+    const std::size_t PBF_CRC32C_STREAM_SIZE = 8192U;
+
+    /*CRC32C of data with the CRC instructions of the CPU (slice-by-8 if it has none), continue a CRC by passing it as crc*/
+    inline std::uint32_t crc32c(const void* data, std::size_t size, std::uint32_t crc = 0U) noexcept
+    {
+        if (!crc32cHardwareAvailable())
+        {
+            return crc32cSoftware(data, size, crc);
+        }
+        constexpr std::uint32_t shift = crc32cZeroBytesOperator(PBF_CRC32C_STREAM_SIZE);
+        const std::uint8_t* p = static_cast<const std::uint8_t*>(data);
+        crc = ~crc;
+        while (size >= 3U * PBF_CRC32C_STREAM_SIZE)
+        {
+            std::uint32_t crc0 = crc;
+            std::uint32_t crc1(0U);
+            std::uint32_t crc2(0U);
+            for (std::size_t i = 0U; i < PBF_CRC32C_STREAM_SIZE; i += 8U)
+            {
+                std::uint64_t words[3];
+                std::memcpy(&words[0], p + i, sizeof(std::uint64_t));
+                std::memcpy(&words[1], p + PBF_CRC32C_STREAM_SIZE + i, sizeof(std::uint64_t));
+                std::memcpy(&words[2], p + 2U * PBF_CRC32C_STREAM_SIZE + i, sizeof(std::uint64_t));
+#if defined(PBF_CRC_SSE42)
+                crc0 = static_cast<std::uint32_t>(_mm_crc32_u64(crc0, words[0]));
+                crc1 = static_cast<std::uint32_t>(_mm_crc32_u64(crc1, words[1]));
+                crc2 = static_cast<std::uint32_t>(_mm_crc32_u64(crc2, words[2]));
+#else
+                crc0 = __crc32cd(crc0, words[0]);
+                crc1 = __crc32cd(crc1, words[1]);
+                crc2 = __crc32cd(crc2, words[2]);
+#endif
+            }
+            /*the register is linear: crc(A B) = crc(A) * x^(8 |B|) + crc(B) with crc(B) started at 0*/
+            crc = crc32cMultiply(crc32cMultiply(crc0, shift) ^ crc1, shift) ^ crc2;
+            p += 3U * PBF_CRC32C_STREAM_SIZE;
+            size -= 3U * PBF_CRC32C_STREAM_SIZE;
+        }
+        return ~crc32cUpdateHardware(crc, p, size);
+    }
+
+#else
+
+    /*CRC32C of data (slice-by-8, the target has no CRC instructions), continue a CRC by passing it as crc*/
+    inline std::uint32_t crc32c(const void* data, std::size_t size, std::uint32_t crc = 0U) noexcept
+    {
+        return crc32cSoftware(data, size, crc);
+    }
+
+#endif
+}
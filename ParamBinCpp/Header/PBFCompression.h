@@ -0,0 +1,531 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <bit>
+#include <algorithm>
+#include "PBFValue.h"
+#include "PBFStorage.h"
+#include "PBFByteOrder.h"
+
+namespace PBF
+{
+    // Compressed image (a container around a whole image, e.g. for OTA updates)
+    //  4 bytes (UInt32)  Magic PBF_COMPRESSED_MAGIC
+    //  4 bytes (UInt32)  Size of the image
+    //  4 bytes (UInt32)  Block size S, every block but the last holds S bytes of the image
+    //  4 bytes (UInt32)  Number of blocks N
+    //  N * 8 bytes       Offset of the compressed block in the container, size of the compressed
+    //                    block (bit 31 set if the block is stored uncompressed)
+    //  Blocks            Each one decodable on its own in LZ4 block format
+    // The words are stored in the byte order of the image.
+
+    const std::uint32_t PBF_COMPRESSED_MAGIC = 0x5A464250U; /*"PBFZ"*/
+    const std::uint32_t PBF_COMPRESSED_HEADER_SIZE = sizeof(std::uint32_t) * 4U;
+    const std::uint32_t PBF_COMPRESSED_BLOCK_ENTRY_SIZE = sizeof(std::uint32_t) * 2U;
+    const std::uint32_t PBF_COMPRESSED_STORED = 0x80000000U;
+    const std::uint32_t PBF_COMPRESSED_DEFAULT_BLOCK_SIZE = 16384U;
+    const std::uint32_t PBF_COMPRESSED_MAX_BLOCK_SIZE = 1U << 24U;
+
+    /*LZ4 block format: matches of at least 4 bytes at most 65535 bytes back, the last 5 bytes are literals*/
+    const std::uint32_t PBF_LZ4_MIN_MATCH = 4U;
+    const std::uint32_t PBF_LZ4_LAST_LITERALS = 5U;
+    const std::uint32_t PBF_LZ4_MATCH_LIMIT = 12U; /*no match starts in the last 12 bytes*/
+    const std::uint32_t PBF_LZ4_MAX_OFFSET = 65535U;
+    const std::uint32_t PBF_LZ4_HASH_BITS = 12U;
+
+    /*Size of the buffer lz4Compress needs for any input of size bytes*/
+    inline std::size_t lz4CompressBound(std::size_t size) noexcept
+    {
+        return size + size / 255U + 16U;
+    }
+
+    namespace detail
+    {
+        inline std::uint32_t lz4Hash(std::uint32_t sequence) noexcept
+        {
+            return (sequence * 2654435761U) >> (32U - PBF_LZ4_HASH_BITS);
+        }
+
+        /*Number of equal bytes at a and b, at most limit - a*/
+        inline std::size_t lz4MatchLength(const std::uint8_t* a, const std::uint8_t* b, const std::uint8_t* limit) noexcept
+        {
+            const std::uint8_t* start = a;
+            while (a + sizeof(std::uint64_t) <= limit)
+            {
+                std::uint64_t diff = loadU64(a) ^ loadU64(b);
+                if (diff != 0U)
+                {
+                    std::size_t bits = (std::endian::native == std::endian::little) ? std::countr_zero(diff) : std::countl_zero(diff);
+                    return static_cast<std::size_t>(a - start) + bits / 8U;
+                }
+                a += sizeof(std::uint64_t);
+                b += sizeof(std::uint64_t);
+            }
+            while ((a < limit) && (*a == *b))
+            {
+                a++;
+                b++;
+            }
+            return static_cast<std::size_t>(a - start);
+        }
+
+        /*Writes length - 15 (or more) as a run of 255 and a rest, returns nullptr if it does not fit*/
+        inline std::uint8_t* lz4WriteLength(std::uint8_t* op, const std::uint8_t* end, std::size_t length) noexcept
+        {
+            for (; length >= 255U; length -= 255U)
+            {
+                if (op >= end)
+                {
+                    return nullptr;
+                }
+                *op++ = 255U;
+            }
+            if (op >= end)
+            {
+                return nullptr;
+            }
+            *op++ = static_cast<std::uint8_t>(length);
+            return op;
+        }
+
+        /*Writes one sequence, offset 0 for the last one that has only literals*/
+        inline std::uint8_t* lz4WriteSequence(std::uint8_t* op, const std::uint8_t* end, const std::uint8_t* literals, std::size_t literalLength,
+            std::size_t offset, std::size_t matchLength) noexcept
+        {
+            if (op >= end)
+            {
+                return nullptr;
+            }
+            std::uint8_t* token = op++;
+            std::uint8_t value = static_cast<std::uint8_t>(std::min<std::size_t>(literalLength, 15U) << 4U);
+            if ((literalLength >= 15U) && ((op = lz4WriteLength(op, end, literalLength - 15U)) == nullptr))
+            {
+                return nullptr;
+            }
+            if (literalLength > static_cast<std::size_t>(end - op))
+            {
+                return nullptr;
+            }
+            std::memcpy(op, literals, literalLength);
+            op += literalLength;
+            if (offset != 0U)
+            {
+                if (static_cast<std::size_t>(end - op) < sizeof(std::uint16_t))
+                {
+                    return nullptr;
+                }
+                *op++ = static_cast<std::uint8_t>(offset);
+                *op++ = static_cast<std::uint8_t>(offset >> 8U);
+                std::size_t extra = matchLength - PBF_LZ4_MIN_MATCH;
+                value |= static_cast<std::uint8_t>(std::min<std::size_t>(extra, 15U));
+                if ((extra >= 15U) && ((op = lz4WriteLength(op, end, extra - 15U)) == nullptr))
+                {
+                    return nullptr;
+                }
+            }
+            *token = value;
+            return op;
+        }
+    }
+
+    /**
+     * @brief Compresses size bytes into the LZ4 block format.
+     *
+     * Greedy parsing with a hash table of 4-byte sequences, like the fast mode of LZ4. Runs
+     * on the host, the table takes 16 KB of stack.
+     * @return Size of the compressed data or 0 if it does not fit into capacity bytes.
+     */
+    inline std::size_t lz4Compress(const void* source, std::size_t size, void* destination, std::size_t capacity) noexcept
+    {
+        const std::uint8_t* src = static_cast<const std::uint8_t*>(source);
+        std::uint8_t* op = static_cast<std::uint8_t*>(destination);
+        const std::uint8_t* const opEnd = op + capacity;
+        const std::uint8_t* ip = src;
+        const std::uint8_t* anchor = src;
+        const std::uint8_t* const end = src + size;
+
+        if (size > PBF_LZ4_MATCH_LIMIT)
+        {
+            const std::uint8_t* const matchLimit = end - PBF_LZ4_MATCH_LIMIT;
+            const std::uint8_t* const matchEnd = end - PBF_LZ4_LAST_LITERALS;
+            std::uint32_t table[1U << PBF_LZ4_HASH_BITS] = {};
+            ip++;
+            while (ip < matchLimit)
+            {
+                std::uint32_t sequence = loadU32(ip);
+                std::uint32_t& entry = table[detail::lz4Hash(sequence)];
+                const std::uint8_t* candidate = src + entry;
+                entry = static_cast<std::uint32_t>(ip - src);
+                if ((candidate >= ip) || (static_cast<std::size_t>(ip - candidate) > PBF_LZ4_MAX_OFFSET) || (loadU32(candidate) != sequence))
+                {
+                    /*skip faster through data that does not compress*/
+                    ip += 1U + (static_cast<std::size_t>(ip - anchor) >> 6U);
+                    continue;
+                }
+                while ((ip > anchor) && (candidate > src) && (ip[-1] == candidate[-1]))
+                {
+                    ip--;
+                    candidate--;
+                }
+                std::size_t length = PBF_LZ4_MIN_MATCH + detail::lz4MatchLength(ip + PBF_LZ4_MIN_MATCH, candidate + PBF_LZ4_MIN_MATCH, matchEnd);
+                op = detail::lz4WriteSequence(op, opEnd, anchor, static_cast<std::size_t>(ip - anchor), static_cast<std::size_t>(ip - candidate), length);
+                if (op == nullptr)
+                {
+                    return 0U;
+                }
+                ip += length;
+                anchor = ip;
+                if (ip < matchLimit)
+                {
+                    table[detail::lz4Hash(loadU32(ip - 2))] = static_cast<std::uint32_t>(ip - 2 - src);
+                }
+            }
+        }
+        op = detail::lz4WriteSequence(op, opEnd, anchor, static_cast<std::size_t>(end - anchor), 0U, 0U);
+        return (op == nullptr) ? 0U : static_cast<std::size_t>(op - static_cast<std::uint8_t*>(destination));
+    }
+
+    /**
+     * @brief Decompresses LZ4 block data that must decode to exactly size bytes.
+     *
+     * All lengths and offsets are checked, corrupted data can not make it read or write
+     * outside the buffers. Long literals and matches are copied 8 bytes at a time.
+     * @return false if the data is corrupted or does not decode to size bytes.
+     */
+    inline bool lz4Decompress(const void* source, std::size_t compressedSize, void* destination, std::size_t size) noexcept
+    {
+        const std::uint8_t* ip = static_cast<const std::uint8_t*>(source);
+        const std::uint8_t* const ipEnd = ip + compressedSize;
+        std::uint8_t* const dst = static_cast<std::uint8_t*>(destination);
+        std::uint8_t* op = dst;
+        std::uint8_t* const opEnd = dst + size;
+
+        auto readLength = [&ip, ipEnd](std::size_t& length) noexcept
+        {
+            std::uint8_t byte(255U);
+            while (byte == 255U)
+            {
+                if (ip >= ipEnd)
+                {
+                    return false;
+                }
+                byte = *ip++;
+                length += byte;
+            }
+            return true;
+        };
+
+        while (ip < ipEnd)
+        {
+            std::uint8_t token = *ip++;
+            std::size_t literalLength = token >> 4U;
+            if ((literalLength == 15U) && !readLength(literalLength))
+            {
+                return false;
+            }
+            if ((literalLength > static_cast<std::size_t>(ipEnd - ip)) || (literalLength > static_cast<std::size_t>(opEnd - op)))
+            {
+                return false;
+            }
+            if ((literalLength <= 16U) && (static_cast<std::size_t>(ipEnd - ip) >= 16U) && (static_cast<std::size_t>(opEnd - op) >= 16U))
+            {
+                /*short literals with a fixed size copy, the bytes behind are overwritten later*/
+                std::memcpy(op, ip, 16U);
+            }
+            else
+            {
+                std::memcpy(op, ip, literalLength);
+            }
+            ip += literalLength;
+            op += literalLength;
+            if (ip == ipEnd)
+            {
+                /*the last sequence has no match*/
+                break;
+            }
+
+            if (static_cast<std::size_t>(ipEnd - ip) < sizeof(std::uint16_t))
+            {
+                return false;
+            }
+            std::size_t offset = static_cast<std::size_t>(ip[0]) | (static_cast<std::size_t>(ip[1]) << 8U);
+            ip += sizeof(std::uint16_t);
+            std::size_t matchLength = token & 0x0FU;
+            if ((matchLength == 15U) && !readLength(matchLength))
+            {
+                return false;
+            }
+            matchLength += PBF_LZ4_MIN_MATCH;
+            if ((offset == 0U) || (offset > static_cast<std::size_t>(op - dst)) || (matchLength > static_cast<std::size_t>(opEnd - op)))
+            {
+                return false;
+            }
+            const std::uint8_t* match = op - offset;
+            if (static_cast<std::size_t>(opEnd - op) >= matchLength + 2U * sizeof(std::uint64_t))
+            {
+                /*8-byte chunks that never overlap and may write up to 15 bytes past the match inside the buffer.
+                  A match closer than 8 bytes repeats with its offset, so after the first period of at least
+                  8 bytes the output is copied from itself*/
+                std::size_t step(offset);
+                if (offset < sizeof(std::uint64_t))
+                {
+                    step = offset * ((sizeof(std::uint64_t) + offset - 1U) / offset);
+                    for (std::size_t i = 0U; i < step; i++)
+                    {
+                        op[i] = match[i];
+                    }
+                }
+                for (std::size_t i = (step == offset) ? 0U : step; i < matchLength; i += sizeof(std::uint64_t))
+                {
+                    std::memcpy(op + i, op + i - step, sizeof(std::uint64_t));
+                }
+            }
+            else
+            {
+                for (std::size_t i = 0U; i < matchLength; i++)
+                {
+                    op[i] = match[i];
+                }
+            }
+            op += matchLength;
+        }
+        return op == opEnd;
+    }
+
+    /**
+     * @brief Compresses an image into independently decodable blocks.
+     * @param blockSize Bytes of the image per block, at most PBF_COMPRESSED_MAX_BLOCK_SIZE.
+     *                  Smaller blocks need less RAM to decode and less work per random
+     *                  access, larger blocks compress better.
+     * @param order Byte order of the image, the words of the container are written in it.
+     * @return The container, empty if blockSize is 0 or too large.
+     */
+    inline std::vector<std::uint8_t> compressImage(const void* image, std::uint32_t size, std::uint32_t blockSize = PBF_COMPRESSED_DEFAULT_BLOCK_SIZE,
+        std::endian order = std::endian::native)
+    {
+        std::vector<std::uint8_t> container;
+        if ((blockSize == 0U) || (blockSize > PBF_COMPRESSED_MAX_BLOCK_SIZE))
+        {
+            return container;
+        }
+        const std::uint8_t* src = static_cast<const std::uint8_t*>(image);
+        std::uint32_t blocks = size / blockSize + (((size % blockSize) != 0U) ? 1U : 0U);
+        std::vector<std::uint32_t> words = { PBF_COMPRESSED_MAGIC, size, blockSize, blocks };
+        words.resize(words.size() + 2U * static_cast<std::size_t>(blocks), 0U);
+        container.resize(words.size() * sizeof(std::uint32_t));
+
+        std::vector<std::uint8_t> buffer(lz4CompressBound(blockSize));
+        for (std::uint32_t b = 0U; b < blocks; b++)
+        {
+            std::uint32_t offset = b * blockSize;
+            std::uint32_t length = std::min(blockSize, size - offset);
+            std::size_t compressed = lz4Compress(src + offset, length, buffer.data(), buffer.size());
+            std::uint32_t entry = static_cast<std::uint32_t>(compressed);
+            const std::uint8_t* data = buffer.data();
+            if ((compressed == 0U) || (compressed >= length))
+            {
+                /*incompressible, a block never grows*/
+                entry = length | PBF_COMPRESSED_STORED;
+                compressed = length;
+                data = src + offset;
+            }
+            words[4U + 2U * b] = static_cast<std::uint32_t>(container.size());
+            words[5U + 2U * b] = entry;
+            container.insert(container.end(), data, data + compressed);
+        }
+
+        std::memcpy(container.data(), words.data(), words.size() * sizeof(std::uint32_t));
+        if (order != std::endian::native)
+        {
+            swapColumn(container.data(), words.size(), sizeof(std::uint32_t));
+        }
+        return container;
+    }
+
+    /**
+     * @class CompressedStorage
+     * @brief PBFStorage over a compressed image in another PBFStorage.
+     *
+     * Reads decode only the blocks they touch, so a PBFStorageView over it decompresses the
+     * blocks of the index entries and records it needs. The last decoded block is kept.
+     * decompress() streams all blocks into a buffer in RAM for PBFView or PBFReader.
+     * Both buffers of MaxBlockSize bytes are inside the object, it never allocates.
+     */
+    template<std::uint32_t MaxBlockSize = PBF_COMPRESSED_DEFAULT_BLOCK_SIZE>
+    class CompressedStorage : public PBFStorage
+    {
+    public:
+
+        explicit CompressedStorage(PBFStorage& container) noexcept : _container(&container)
+        {
+        }
+
+        /**
+         * @brief Validates the header and the block directory of the container.
+         * @return false if the container is malformed, in the other byte order or its blocks are larger than MaxBlockSize.
+         */
+        bool open() noexcept
+        {
+            _open = false;
+            _block = INVALID_BLOCK;
+            std::uint32_t header[4] = { 0U, 0U, 0U, 0U };
+            if ((_container->size() < PBF_COMPRESSED_HEADER_SIZE) || !_container->read(0U, header, sizeof(header)))
+            {
+                return false;
+            }
+            if ((header[0] != PBF_COMPRESSED_MAGIC) || (header[2] == 0U) || (header[2] > MaxBlockSize))
+            {
+                return false;
+            }
+            std::uint32_t blocks = header[1] / header[2] + (((header[1] % header[2]) != 0U) ? 1U : 0U);
+            if ((header[3] != blocks) || (blocks > (_container->size() - PBF_COMPRESSED_HEADER_SIZE) / PBF_COMPRESSED_BLOCK_ENTRY_SIZE))
+            {
+                return false;
+            }
+            _size = header[1];
+            _blockSize = header[2];
+            _blocks = blocks;
+            _open = true;
+            return true;
+        }
+
+        bool isOpen() const noexcept
+        {
+            return _open;
+        }
+
+        /*Size of the decompressed image*/
+        std::uint32_t size() const noexcept override
+        {
+            return _open ? _size : 0U;
+        }
+
+        std::uint32_t blockSize() const noexcept
+        {
+            return _blockSize;
+        }
+
+        std::uint32_t blockCount() const noexcept
+        {
+            return _blocks;
+        }
+
+        bool read(std::uint32_t offset, void* buffer, std::uint32_t length) noexcept override
+        {
+            if (!_open || (offset > _size) || (length > _size - offset))
+            {
+                return false;
+            }
+            std::uint8_t* out = static_cast<std::uint8_t*>(buffer);
+            while (length > 0U)
+            {
+                std::uint32_t block = offset / _blockSize;
+                if ((block != _block) && !decodeBlock(block, _raw))
+                {
+                    _block = INVALID_BLOCK;
+                    return false;
+                }
+                _block = block;
+                std::uint32_t inBlock = offset % _blockSize;
+                std::uint32_t chunk = std::min(length, getBlockLength(block) - inBlock);
+                std::memcpy(out, _raw + inBlock, chunk);
+                out += chunk;
+                offset += chunk;
+                length -= chunk;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Decompresses the whole image block by block into image.
+         * @param capacity Size of image in bytes, at least size().
+         * @return false if the container is corrupted or the buffer too small.
+         */
+        bool decompress(void* image, std::size_t capacity) noexcept
+        {
+            if (!_open || (capacity < _size))
+            {
+                return false;
+            }
+            for (std::uint32_t b = 0U; b < _blocks; b++)
+            {
+                if (!decodeBlock(b, static_cast<std::uint8_t*>(image) + static_cast<std::size_t>(b) * _blockSize))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /*Number of blocks decoded so far, for measurements*/
+        std::uint64_t blocksDecoded() const noexcept
+        {
+            return _decoded;
+        }
+
+    private:
+
+        static constexpr std::uint32_t INVALID_BLOCK = 0xFFFFFFFFU;
+
+        std::uint32_t getBlockLength(std::uint32_t block) const noexcept
+        {
+            return std::min(_blockSize, _size - block * _blockSize);
+        }
+
+        bool decodeBlock(std::uint32_t block, std::uint8_t* out) noexcept
+        {
+            std::uint32_t entry[2] = { 0U, 0U };
+            if (!_container->read(PBF_COMPRESSED_HEADER_SIZE + block * PBF_COMPRESSED_BLOCK_ENTRY_SIZE, entry, sizeof(entry)))
+            {
+                return false;
+            }
+            std::uint32_t length = getBlockLength(block);
+            std::uint32_t compressed = entry[1] & ~PBF_COMPRESSED_STORED;
+            _decoded++;
+            if ((entry[1] & PBF_COMPRESSED_STORED) != 0U)
+            {
+                return (compressed == length) && _container->read(entry[0], out, length);
+            }
+            return (compressed < length) && _container->read(entry[0], _compressed, compressed) && lz4Decompress(_compressed, compressed, out, length);
+        }
+
+        PBFStorage* _container = nullptr;
+        bool _open = false;
+        std::uint32_t _size = 0U;
+        std::uint32_t _blockSize = 0U;
+        std::uint32_t _blocks = 0U;
+        std::uint32_t _block = INVALID_BLOCK; /*block in _raw*/
+        std::uint64_t _decoded = 0U;
+        std::uint8_t _compressed[MaxBlockSize];
+        std::uint8_t _raw[MaxBlockSize];
+    };
+}
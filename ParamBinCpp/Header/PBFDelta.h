@@ -0,0 +1,746 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <bit>
+#include "Pbf.h"
+#include "PBFValue.h"
+#include "PBFChecksum.h"
+#include "PBFByteOrder.h"
+
+namespace PBF
+{
+    // Delta (the changes from a source to a target image, e.g. for updating devices)
+    //  4 bytes (UInt32)  Magic PBF_DELTA_MAGIC
+    //  4 bytes (UInt32)  CRC32C of the delta after this word
+    //  4 bytes (UInt32)  Size of the source image
+    //  4 bytes (UInt32)  CRC32C of the source image
+    //  4 bytes (UInt32)  Size of the target image
+    //  4 bytes (UInt32)  CRC32C of the target image
+    //  4 bytes (UInt32)  Shift: bytes the source image is moved towards the end of the buffer when the delta is applied in place
+    //  4 bytes (UInt32)  Number of removed records R
+    //  4 bytes (UInt32)  Size of the added and changed records in bytes
+    //  12 bytes          Header of the target image
+    //  R * 4 bytes       Hashes of the removed records, ascending
+    //  Records           The added and changed records as in the target image, ascending hashes.
+    //                    A record with the hash of a source record replaces it.
+    // If the target image has a section directory:
+    //  Section directory of the target image
+    //  N * 8 bytes       For every section of the directory: PBF_DELTA_SECTION_*, offset in the source image
+    //  Section data      Of the sections with PBF_DELTA_SECTION_DATA, in the order of the directory
+    // Records of both images are sorted by hash, as the converter writes them. The records of
+    // the target are merged from the source records and the delta in one pass. The words are
+    // stored in the byte order of the images.
+
+    const std::uint32_t PBF_DELTA_MAGIC = 0x44464250U; /*"PBFD"*/
+    const std::uint32_t PBF_DELTA_HEADER_SIZE = sizeof(std::uint32_t) * 9U + PBF_FILE_HEADER_SIZE;
+    const std::uint32_t PBF_DELTA_SECTION_ENTRY_SIZE = sizeof(std::uint32_t) * 2U;
+
+    const std::uint32_t PBF_DELTA_SECTION_DATA = 0U; /*data is in the delta*/
+    const std::uint32_t PBF_DELTA_SECTION_SOURCE = 1U; /*same data as the section at the offset in the source image*/
+    const std::uint32_t PBF_DELTA_SECTION_REBUILD = 2U; /*HashIndex or Checksum, computed from the target image*/
+
+    /**
+     * @struct DeltaInfo
+     * @brief Sizes a device needs before it applies a delta.
+     */
+    struct DeltaInfo
+    {
+        std::uint32_t sourceSize = 0U;
+        std::uint32_t targetSize = 0U;
+        std::uint32_t inPlaceCapacity = 0U; /**< Size of the buffer applyDeltaInPlace needs. */
+    };
+
+    /**
+     * @struct DeltaSummary
+     * @brief What createDelta found, for reports.
+     */
+    struct DeltaSummary
+    {
+        std::uint32_t added = 0U;
+        std::uint32_t removed = 0U;
+        std::uint32_t changed = 0U;
+        std::uint32_t unchanged = 0U;
+        std::uint32_t sectionsFromSource = 0U; /**< Sections copied from the source or rebuilt on the device. */
+    };
+
+    namespace detail
+    {
+        inline std::uint32_t loadWord(const std::uint8_t* p, bool swap) noexcept
+        {
+            std::uint32_t value = loadU32(p);
+            return swap ? pbfByteSwap32(value) : value;
+        }
+
+        inline void storeWord(std::uint8_t* p, std::uint32_t value, bool swap) noexcept
+        {
+            value = swap ? pbfByteSwap32(value) : value;
+            memcpy(p, &value, sizeof(value));
+        }
+
+        /*
+         * Data size of every record type without a switch: (size field & mask) | size. The records
+         * are walked one after another, so the size decides where the next load goes.
+         */
+        struct RecordSizeRule
+        {
+            std::uint32_t mask = 0U;
+            std::uint32_t size = 0U;
+        };
+
+        constexpr std::array<RecordSizeRule, 256> makeRecordSizeRules() noexcept
+        {
+            std::array<RecordSizeRule, 256> rules{};
+            for (std::uint32_t type = 0U; type < 256U; type++)
+            {
+                const bool fromSizeField = getRecordDataSize(static_cast<DataTypes>(type), 0xFFFFFFU) == 0xFFFFFFU;
+                rules[type].mask = fromSizeField ? 0xFFFFFFU : 0U;
+                rules[type].size = fromSizeField ? 0U : getRecordDataSize(static_cast<DataTypes>(type), 0U);
+            }
+            return rules;
+        }
+
+        inline constexpr std::array<RecordSizeRule, 256> PBF_RECORD_SIZE_RULES = makeRecordSizeRules();
+
+        /*Size of the record at p with its header, 0 if it does not end before end*/
+        inline std::uint32_t deltaRecordSize(const std::uint8_t* p, const std::uint8_t* end, bool swap) noexcept
+        {
+            if (end - p < static_cast<std::ptrdiff_t>(PBF_FILE_RECORD_HEADER_SIZE))
+            {
+                return 0U;
+            }
+            const std::uint32_t typeSize = loadWord(p + sizeof(std::uint32_t), swap);
+            const RecordSizeRule& rule = PBF_RECORD_SIZE_RULES[typeSize >> 24U];
+            const std::uint32_t size = PBF_FILE_RECORD_HEADER_SIZE + ((typeSize & rule.mask) | rule.size);
+            return (size <= static_cast<std::size_t>(end - p)) ? size : 0U;
+        }
+
+        /*Writes the HashIndex section of the records in front of recordsEnd, false if it does not have size bytes*/
+        inline bool writeHashIndex(const std::uint8_t* image, std::uint32_t recordsEnd, std::uint8_t* section, std::uint32_t size, bool swap) noexcept
+        {
+            if ((size < sizeof(std::uint32_t)) || (((size - sizeof(std::uint32_t)) % (2U * sizeof(std::uint32_t))) != 0U))
+            {
+                return false;
+            }
+            const std::uint32_t count = (size - sizeof(std::uint32_t)) / (2U * sizeof(std::uint32_t));
+            std::uint8_t* hashes = section + sizeof(std::uint32_t);
+            std::uint8_t* offsets = hashes + count * sizeof(std::uint32_t);
+            std::uint32_t n(0U);
+            for (std::uint32_t offset = PBF_FILE_HEADER_SIZE; offset < recordsEnd; n++)
+            {
+                std::uint32_t length = deltaRecordSize(image + offset, image + recordsEnd, swap);
+                if ((length == 0U) || (n == count))
+                {
+                    return false;
+                }
+                memcpy(hashes + n * sizeof(std::uint32_t), image + offset, sizeof(std::uint32_t));
+                storeWord(offsets + n * sizeof(std::uint32_t), offset, swap);
+                offset += length;
+            }
+            storeWord(section, count, swap);
+            return n == count;
+        }
+
+        /**
+         * @struct DeltaLayout
+         * @brief Parts of a checked delta.
+         */
+        struct DeltaLayout
+        {
+            bool swap = false;
+            std::uint32_t sourceSize = 0U;
+            std::uint32_t sourceCrc = 0U;
+            std::uint32_t targetSize = 0U;
+            std::uint32_t targetCrc = 0U;
+            std::uint32_t shift = 0U;
+            std::uint32_t removedCount = 0U;
+            std::uint32_t recordBytes = 0U;
+            std::uint32_t sectionCount = 0U;
+            const std::uint8_t* header = nullptr;
+            const std::uint8_t* removed = nullptr;
+            const std::uint8_t* records = nullptr;
+            const std::uint8_t* directory = nullptr; /*nullptr if the target has no sections*/
+            const std::uint8_t* sources = nullptr;
+            const std::uint8_t* data = nullptr;
+            const std::uint8_t* end = nullptr;
+        };
+
+        /*Checks the CRC and the bounds of a delta of either byte order*/
+        inline bool parseDelta(const void* delta, std::uint32_t size, DeltaLayout& layout) noexcept
+        {
+            const std::uint8_t* p = static_cast<const std::uint8_t*>(delta);
+            if ((p == nullptr) || (size < PBF_DELTA_HEADER_SIZE))
+            {
+                return false;
+            }
+            const std::uint32_t magic = loadU32(p);
+            if ((magic != PBF_DELTA_MAGIC) && (magic != pbfByteSwap32(PBF_DELTA_MAGIC)))
+            {
+                return false;
+            }
+            layout.swap = (magic != PBF_DELTA_MAGIC);
+            const bool swap = layout.swap;
+            if (loadWord(p + 4U, swap) != crc32c(p + 8U, size - 8U))
+            {
+                return false;
+            }
+            layout.sourceSize = loadWord(p + 8U, swap);
+            layout.sourceCrc = loadWord(p + 12U, swap);
+            layout.targetSize = loadWord(p + 16U, swap);
+            layout.targetCrc = loadWord(p + 20U, swap);
+            layout.shift = loadWord(p + 24U, swap);
+            layout.removedCount = loadWord(p + 28U, swap);
+            layout.recordBytes = loadWord(p + 32U, swap);
+            layout.header = p + 36U;
+            layout.end = p + size;
+            if ((layout.sourceSize < PBF_FILE_HEADER_SIZE) || (layout.targetSize < PBF_FILE_HEADER_SIZE))
+            {
+                return false;
+            }
+
+            std::size_t offset = PBF_DELTA_HEADER_SIZE;
+            layout.removed = p + offset;
+            offset += static_cast<std::size_t>(layout.removedCount) * sizeof(std::uint32_t);
+            layout.records = p + offset;
+            offset += layout.recordBytes;
+            if (offset > size)
+            {
+                return false;
+            }
+            layout.directory = nullptr;
+            layout.sectionCount = 0U;
+            if (loadWord(layout.header + 8U, swap) != 0U)
+            {
+                if (size - offset < sizeof(std::uint32_t))
+                {
+                    return false;
+                }
+                layout.directory = p + offset;
+                layout.sectionCount = loadWord(layout.directory, swap);
+                std::size_t entries = static_cast<std::size_t>(layout.sectionCount) * (PBF_SECTION_ENTRY_SIZE + PBF_DELTA_SECTION_ENTRY_SIZE);
+                if (entries > size - offset - sizeof(std::uint32_t))
+                {
+                    return false;
+                }
+                offset += sizeof(std::uint32_t) + static_cast<std::size_t>(layout.sectionCount) * PBF_SECTION_ENTRY_SIZE;
+                layout.sources = p + offset;
+                offset += static_cast<std::size_t>(layout.sectionCount) * PBF_DELTA_SECTION_ENTRY_SIZE;
+            }
+            layout.data = p + offset;
+            return true;
+        }
+
+        /**
+         * @brief Writes the target image of a parsed delta.
+         *
+         * Writes the records, the directory, the sections, the header and then the checksums,
+         * in this order, so the target may start in front of the source in the same buffer
+         * (see DeltaLayout::shift).
+         */
+        inline bool patchImage(const std::uint8_t* source, const DeltaLayout& delta, std::uint8_t* target, std::uint32_t capacity) noexcept
+        {
+            const bool swap = delta.swap;
+            const std::uint32_t targetSize = delta.targetSize;
+            std::uint32_t sourceEnd = loadWord(source + 8U, swap);
+            std::uint32_t targetEnd = loadWord(delta.header + 8U, swap);
+            sourceEnd = (sourceEnd == 0U) ? delta.sourceSize : sourceEnd;
+            targetEnd = (targetEnd == 0U) ? targetSize : targetEnd;
+            if ((targetSize > capacity) || (sourceEnd < PBF_FILE_HEADER_SIZE) || (sourceEnd > delta.sourceSize) || (targetEnd < PBF_FILE_HEADER_SIZE) || (targetEnd > targetSize))
+            {
+                return false;
+            }
+
+            /*merge the source records with the delta records, both ascending. Unchanged records are copied in runs*/
+            const std::uint8_t* records = delta.records;
+            std::uint32_t s = PBF_FILE_HEADER_SIZE;
+            std::uint32_t w = PBF_FILE_HEADER_SIZE;
+            std::uint32_t p(0U);
+            std::uint32_t r(0U);
+            std::uint32_t run = s;
+            auto copy = [&](const std::uint8_t* from, std::uint32_t length)
+            {
+                if (length > targetEnd - w)
+                {
+                    return false;
+                }
+                memmove(target + w, from, length);
+                w += length;
+                return true;
+            };
+            while ((s < sourceEnd) || (p < delta.recordBytes))
+            {
+                std::uint32_t sourceLength = (s < sourceEnd) ? deltaRecordSize(source + s, source + sourceEnd, swap) : 0U;
+                std::uint32_t deltaLength = (p < delta.recordBytes) ? deltaRecordSize(records + p, records + delta.recordBytes, swap) : 0U;
+                if (((s < sourceEnd) && (sourceLength == 0U)) || ((p < delta.recordBytes) && (deltaLength == 0U)))
+                {
+                    return false;
+                }
+                std::uint32_t sourceHash = (sourceLength != 0U) ? loadWord(source + s, swap) : 0U;
+                std::uint32_t deltaHash = (deltaLength != 0U) ? loadWord(records + p, swap) : 0U;
+
+                if ((deltaLength == 0U) || ((sourceLength != 0U) && (sourceHash < deltaHash)))
+                {
+                    if ((r < delta.removedCount) && (loadWord(delta.removed + r * sizeof(std::uint32_t), swap) == sourceHash))
+                    {
+                        if (!copy(source + run, s - run))
+                        {
+                            return false;
+                        }
+                        r++;
+                        run = s + sourceLength;
+                    }
+                    s += sourceLength;
+                    continue;
+                }
+                if (!copy(source + run, s - run))
+                {
+                    return false;
+                }
+                if ((sourceLength != 0U) && (sourceHash == deltaHash))
+                {
+                    s += sourceLength; /*changed*/
+                }
+                run = s;
+                if (!copy(records + p, deltaLength))
+                {
+                    return false;
+                }
+                p += deltaLength;
+            }
+            if (!copy(source + run, s - run))
+            {
+                return false;
+            }
+            if ((r != delta.removedCount) || (w != targetEnd))
+            {
+                return false;
+            }
+
+            if (delta.directory != nullptr)
+            {
+                const std::uint32_t directorySize = sizeof(std::uint32_t) + delta.sectionCount * PBF_SECTION_ENTRY_SIZE;
+                if (directorySize > targetSize - w)
+                {
+                    return false;
+                }
+                memcpy(target + w, delta.directory, directorySize);
+                std::uint32_t offset = w + directorySize;
+                const std::uint8_t* data = delta.data;
+                for (std::uint32_t i = 0U; i < delta.sectionCount; i++)
+                {
+                    const std::uint8_t* entry = delta.directory + sizeof(std::uint32_t) + i * PBF_SECTION_ENTRY_SIZE;
+                    const SectionTypes type = static_cast<SectionTypes>(loadWord(entry, swap));
+                    const std::uint32_t size = loadWord(entry + 8U, swap);
+                    const std::uint32_t mode = loadWord(delta.sources + i * PBF_DELTA_SECTION_ENTRY_SIZE, swap);
+                    const std::uint32_t from = loadWord(delta.sources + i * PBF_DELTA_SECTION_ENTRY_SIZE + 4U, swap);
+                    if ((loadWord(entry + 4U, swap) != offset) || (size > targetSize - offset))
+                    {
+                        return false;
+                    }
+                    if (mode == PBF_DELTA_SECTION_DATA)
+                    {
+                        if (size > static_cast<std::size_t>(delta.end - data))
+                        {
+                            return false;
+                        }
+                        memcpy(target + offset, data, size);
+                        data += size;
+                    }
+                    else if (mode == PBF_DELTA_SECTION_SOURCE)
+                    {
+                        if ((from > delta.sourceSize) || (size > delta.sourceSize - from))
+                        {
+                            return false;
+                        }
+                        memmove(target + offset, source + from, size);
+                    }
+                    else if ((mode == PBF_DELTA_SECTION_REBUILD) && (type == SectionTypes::HashIndex))
+                    {
+                        if (!writeHashIndex(target, targetEnd, target + offset, size, swap))
+                        {
+                            return false;
+                        }
+                    }
+                    else if ((mode == PBF_DELTA_SECTION_REBUILD) && (type == SectionTypes::Checksum) && (size >= PBF_CHECKSUM_SECTION_SIZE))
+                    {
+                        memset(target + offset, 0, size); /*written after the header*/
+                    }
+                    else
+                    {
+                        return false;
+                    }
+                    offset += size;
+                }
+                if (offset != targetSize)
+                {
+                    return false;
+                }
+            }
+            memcpy(target, delta.header, PBF_FILE_HEADER_SIZE);
+
+            for (std::uint32_t i = 0U; i < delta.sectionCount; i++)
+            {
+                const std::uint8_t* entry = delta.directory + sizeof(std::uint32_t) + i * PBF_SECTION_ENTRY_SIZE;
+                if ((static_cast<SectionTypes>(loadWord(entry, swap)) == SectionTypes::Checksum) &&
+                    (loadWord(delta.sources + i * PBF_DELTA_SECTION_ENTRY_SIZE, swap) == PBF_DELTA_SECTION_REBUILD))
+                {
+                    const std::uint32_t offset = loadWord(entry + 4U, swap);
+                    storeWord(target + offset, crc32c(target, offset), swap);
+                }
+            }
+            return crc32c(target, targetSize) == delta.targetCrc;
+        }
+
+        /**
+         * @struct DeltaImage
+         * @brief Record area and section directory of an image createDelta compares.
+         */
+        struct DeltaImage
+        {
+            const std::uint8_t* bytes = nullptr;
+            std::uint32_t size = 0U;
+            std::uint32_t recordsEnd = 0U;
+            std::uint32_t sectionCount = 0U;
+        };
+
+        inline bool openDeltaImage(const void* image, std::uint32_t size, bool swap, DeltaImage& out) noexcept
+        {
+            out.bytes = static_cast<const std::uint8_t*>(image);
+            out.size = size;
+            if ((size < PBF_FILE_HEADER_SIZE) || (loadWord(out.bytes, swap) != size))
+            {
+                return false;
+            }
+            const std::uint32_t directory = loadWord(out.bytes + 8U, swap);
+            out.recordsEnd = (directory == 0U) ? size : directory;
+            out.sectionCount = 0U;
+            if (directory == 0U)
+            {
+                return true;
+            }
+            if ((directory < PBF_FILE_HEADER_SIZE) || (directory > size - sizeof(std::uint32_t)))
+            {
+                return false;
+            }
+            out.sectionCount = loadWord(out.bytes + directory, swap);
+            if (out.sectionCount > (size - directory - sizeof(std::uint32_t)) / PBF_SECTION_ENTRY_SIZE)
+            {
+                return false;
+            }
+            /*the sections follow the directory without gaps, as the writer places them*/
+            std::uint32_t offset = directory + sizeof(std::uint32_t) + out.sectionCount * PBF_SECTION_ENTRY_SIZE;
+            for (std::uint32_t i = 0U; i < out.sectionCount; i++)
+            {
+                const std::uint8_t* entry = out.bytes + directory + sizeof(std::uint32_t) + i * PBF_SECTION_ENTRY_SIZE;
+                std::uint32_t sectionSize = loadWord(entry + 8U, swap);
+                if ((loadWord(entry + 4U, swap) != offset) || (sectionSize > size - offset))
+                {
+                    return false;
+                }
+                offset += sectionSize;
+            }
+            return offset == size;
+        }
+
+        inline const std::uint8_t* getDeltaImageSection(const DeltaImage& image, std::uint32_t i) noexcept
+        {
+            return image.bytes + image.recordsEnd + sizeof(std::uint32_t) + i * PBF_SECTION_ENTRY_SIZE;
+        }
+    }
+
+    /**
+     * @brief Returns the sizes of a delta, std::nullopt if it is corrupted.
+     */
+    inline std::optional<DeltaInfo> getDeltaInfo(const void* delta, std::uint32_t deltaSize) noexcept
+    {
+        detail::DeltaLayout layout;
+        if (!detail::parseDelta(delta, deltaSize, layout))
+        {
+            return std::nullopt;
+        }
+        DeltaInfo info;
+        info.sourceSize = layout.sourceSize;
+        info.targetSize = layout.targetSize;
+        info.inPlaceCapacity = std::max(layout.targetSize, (layout.shift > std::numeric_limits<std::uint32_t>::max() - layout.sourceSize) ?
+            std::numeric_limits<std::uint32_t>::max() : layout.sourceSize + layout.shift);
+        return info;
+    }
+
+    /**
+     * @brief Writes the target image of a delta into a second buffer.
+     *
+     * Linear in the size of the images, does not allocate. The source must be the image the
+     * delta was created from (its CRC is checked) and must not overlap the target.
+     * @param capacity Size of the target buffer, at least DeltaInfo::targetSize.
+     * @return false if the delta or the source do not match or the result has a wrong CRC.
+     */
+    inline bool applyDelta(const void* source, std::uint32_t sourceSize, const void* delta, std::uint32_t deltaSize, void* target, std::uint32_t capacity) noexcept
+    {
+        detail::DeltaLayout layout;
+        if ((source == nullptr) || (target == nullptr) || !detail::parseDelta(delta, deltaSize, layout) ||
+            (sourceSize != layout.sourceSize) || (crc32c(source, sourceSize) != layout.sourceCrc))
+        {
+            return false;
+        }
+        return detail::patchImage(static_cast<const std::uint8_t*>(source), layout, static_cast<std::uint8_t*>(target), capacity);
+    }
+
+    /**
+     * @brief Replaces the image in a buffer by the target image of a delta.
+     *
+     * The delta and the image are checked before the buffer is changed. The image is moved by
+     * the shift of the delta towards the end of the buffer and the target is merged in front of
+     * it, so the buffer only needs DeltaInfo::inPlaceCapacity bytes.
+     * @return false if the delta or the image do not match, the buffer is unchanged then. It only
+     * holds neither image if the result has a wrong CRC, which a checked delta does not produce.
+     */
+    inline bool applyDeltaInPlace(void* image, std::uint32_t capacity, const void* delta, std::uint32_t deltaSize) noexcept
+    {
+        detail::DeltaLayout layout;
+        if ((image == nullptr) || !detail::parseDelta(delta, deltaSize, layout) || (layout.sourceSize > capacity) ||
+            (layout.shift > capacity - layout.sourceSize) || (layout.targetSize > capacity) || (crc32c(image, layout.sourceSize) != layout.sourceCrc))
+        {
+            return false;
+        }
+        std::uint8_t* bytes = static_cast<std::uint8_t*>(image);
+        memmove(bytes + layout.shift, bytes, layout.sourceSize);
+        return detail::patchImage(bytes + layout.shift, layout, bytes, capacity);
+    }
+
+    /**
+     * @brief Creates the delta from source to target.
+     *
+     * Both images must have the same byte order and records sorted by hash, as the converter
+     * writes them. HashIndex and Checksum sections are rebuilt by the device, sections that are
+     * equal in both images are copied from the source, the others are part of the delta.
+     * The delta is applied once on both ways before it is returned.
+     * @return The delta or an empty vector if the images can not be compared.
+     */
+    inline std::vector<std::uint8_t> createDelta(const void* source, std::uint32_t sourceSize, const void* target, std::uint32_t targetSize, DeltaSummary* summary = nullptr)
+    {
+        std::vector<std::uint8_t> delta;
+        std::optional<std::endian> order = getImageByteOrder(source, sourceSize);
+        if (!order || (order != getImageByteOrder(target, targetSize)))
+        {
+            return delta;
+        }
+        const bool swap = (order.value() != std::endian::native);
+        detail::DeltaImage from;
+        detail::DeltaImage to;
+        if (!detail::openDeltaImage(source, sourceSize, swap, from) || !detail::openDeltaImage(target, targetSize, swap, to))
+        {
+            return delta;
+        }
+        DeltaSummary counts;
+
+        /*how the device gets every section of the target*/
+        std::vector<std::uint32_t> modes(to.sectionCount, PBF_DELTA_SECTION_DATA);
+        std::vector<std::uint32_t> sourceOffsets(to.sectionCount, 0U);
+        for (std::uint32_t i = 0U; i < to.sectionCount; i++)
+        {
+            const std::uint8_t* entry = detail::getDeltaImageSection(to, i);
+            const std::uint32_t type = detail::loadWord(entry, swap);
+            const std::uint32_t offset = detail::loadWord(entry + 4U, swap);
+            const std::uint32_t size = detail::loadWord(entry + 8U, swap);
+            if (static_cast<SectionTypes>(type) == SectionTypes::HashIndex)
+            {
+                std::vector<std::uint8_t> index(size);
+                if (detail::writeHashIndex(to.bytes, to.recordsEnd, index.data(), size, swap) && (memcmp(index.data(), to.bytes + offset, size) == 0))
+                {
+                    modes[i] = PBF_DELTA_SECTION_REBUILD;
+                }
+            }
+            else if ((static_cast<SectionTypes>(type) == SectionTypes::Checksum) && (size >= PBF_CHECKSUM_SECTION_SIZE) &&
+                (detail::loadWord(to.bytes + offset, swap) == crc32c(to.bytes, offset)) &&
+                std::all_of(to.bytes + offset + PBF_CHECKSUM_SECTION_SIZE, to.bytes + offset + size, [](std::uint8_t b) { return b == 0U; }))
+            {
+                modes[i] = PBF_DELTA_SECTION_REBUILD;
+            }
+            for (std::uint32_t j = 0U; (j < from.sectionCount) && (modes[i] == PBF_DELTA_SECTION_DATA); j++)
+            {
+                const std::uint8_t* other = detail::getDeltaImageSection(from, j);
+                if ((detail::loadWord(other, swap) == type) && (detail::loadWord(other + 8U, swap) == size) &&
+                    (memcmp(from.bytes + detail::loadWord(other + 4U, swap), to.bytes + offset, size) == 0))
+                {
+                    modes[i] = PBF_DELTA_SECTION_SOURCE;
+                    sourceOffsets[i] = detail::loadWord(other + 4U, swap);
+                }
+            }
+            counts.sectionsFromSource += (modes[i] != PBF_DELTA_SECTION_DATA) ? 1U : 0U;
+        }
+
+        /*
+         * In place the target is written from the start of the buffer while the source is read
+         * behind it. shift is the largest distance a write gets ahead of the source data that
+         * is still needed: the next unread record and the sections copied from the source.
+         */
+        std::vector<std::uint32_t> neededSections(to.sectionCount + 1U, std::numeric_limits<std::uint32_t>::max());
+        for (std::uint32_t i = to.sectionCount; i > 0U; i--)
+        {
+            neededSections[i - 1U] = (modes[i - 1U] == PBF_DELTA_SECTION_SOURCE) ? std::min(neededSections[i], sourceOffsets[i - 1U]) : neededSections[i];
+        }
+        std::uint64_t lead(0U);
+        auto write = [&lead](std::uint64_t end, std::uint64_t needed) { lead = (end > needed) ? std::max(lead, end - needed) : lead; };
+
+        /*one merge over both record lists, ascending hashes*/
+        std::vector<std::uint32_t> removed;
+        std::vector<std::uint8_t> records;
+        std::uint32_t s = PBF_FILE_HEADER_SIZE;
+        std::uint32_t t = PBF_FILE_HEADER_SIZE;
+        std::uint64_t lastSource(0U);
+        std::uint64_t lastTarget(0U);
+        while ((s < from.recordsEnd) || (t < to.recordsEnd))
+        {
+            std::uint32_t sourceLength = (s < from.recordsEnd) ? detail::deltaRecordSize(from.bytes + s, from.bytes + from.recordsEnd, swap) : 0U;
+            std::uint32_t targetLength = (t < to.recordsEnd) ? detail::deltaRecordSize(to.bytes + t, to.bytes + to.recordsEnd, swap) : 0U;
+            if (((s < from.recordsEnd) && (sourceLength == 0U)) || ((t < to.recordsEnd) && (targetLength == 0U)))
+            {
+                return delta;
+            }
+            std::uint64_t sourceHash = (sourceLength != 0U) ? detail::loadWord(from.bytes + s, swap) + 1ULL : 0U;
+            std::uint64_t targetHash = (targetLength != 0U) ? detail::loadWord(to.bytes + t, swap) + 1ULL : 0U;
+            if (((sourceHash != 0U) && (sourceHash <= lastSource)) || ((targetHash != 0U) && (targetHash <= lastTarget)))
+            {
+                return delta; /*not sorted by hash*/
+            }
+
+            if ((targetHash == 0U) || ((sourceHash != 0U) && (sourceHash < targetHash)))
+            {
+                removed.push_back(static_cast<std::uint32_t>(sourceHash - 1U));
+                counts.removed++;
+                lastSource = sourceHash;
+                s += sourceLength;
+                continue;
+            }
+            if (sourceHash == targetHash)
+            {
+                bool equal = (sourceLength == targetLength) && (memcmp(from.bytes + s, to.bytes + t, targetLength) == 0);
+                counts.unchanged += equal ? 1U : 0U;
+                counts.changed += equal ? 0U : 1U;
+                if (!equal)
+                {
+                    records.insert(records.end(), to.bytes + t, to.bytes + t + targetLength);
+                }
+                lastSource = sourceHash;
+                s += sourceLength;
+            }
+            else
+            {
+                records.insert(records.end(), to.bytes + t, to.bytes + t + targetLength);
+                counts.added++;
+            }
+            lastTarget = targetHash;
+            t += targetLength;
+            write(t, (s < from.recordsEnd) ? std::min(s, neededSections[0]) : neededSections[0]);
+        }
+
+        /*directory and sections, the header is written last*/
+        std::uint32_t offset = to.recordsEnd;
+        if (to.recordsEnd != to.size)
+        {
+            offset += sizeof(std::uint32_t) + to.sectionCount * PBF_SECTION_ENTRY_SIZE;
+            write(offset, neededSections[0]);
+        }
+        for (std::uint32_t i = 0U; i < to.sectionCount; i++)
+        {
+            offset += detail::loadWord(detail::getDeltaImageSection(to, i) + 8U, swap);
+            write(offset, neededSections[i + 1U]);
+        }
+        const std::uint64_t shift = (lead + sizeof(std::uint32_t) - 1U) & ~static_cast<std::uint64_t>(sizeof(std::uint32_t) - 1U);
+        if (shift > std::numeric_limits<std::uint32_t>::max())
+        {
+            return delta;
+        }
+
+        std::vector<std::uint8_t> bytes(PBF_DELTA_HEADER_SIZE + removed.size() * sizeof(std::uint32_t));
+        std::uint32_t words[9] = { PBF_DELTA_MAGIC, 0U, sourceSize, crc32c(source, sourceSize), targetSize, crc32c(target, targetSize),
+            static_cast<std::uint32_t>(shift), static_cast<std::uint32_t>(removed.size()), static_cast<std::uint32_t>(records.size()) };
+        for (std::uint32_t i = 0U; i < 9U; i++)
+        {
+            detail::storeWord(bytes.data() + i * sizeof(std::uint32_t), words[i], swap);
+        }
+        memcpy(bytes.data() + sizeof(words), to.bytes, PBF_FILE_HEADER_SIZE);
+        for (std::size_t i = 0U; i < removed.size(); i++)
+        {
+            detail::storeWord(bytes.data() + PBF_DELTA_HEADER_SIZE + i * sizeof(std::uint32_t), removed[i], swap);
+        }
+        bytes.insert(bytes.end(), records.begin(), records.end());
+        if (to.recordsEnd != to.size)
+        {
+            bytes.insert(bytes.end(), to.bytes + to.recordsEnd, to.bytes + to.recordsEnd + sizeof(std::uint32_t) + to.sectionCount * PBF_SECTION_ENTRY_SIZE);
+            for (std::uint32_t i = 0U; i < to.sectionCount; i++)
+            {
+                std::uint8_t entry[PBF_DELTA_SECTION_ENTRY_SIZE];
+                detail::storeWord(entry, modes[i], swap);
+                detail::storeWord(entry + 4U, sourceOffsets[i], swap);
+                bytes.insert(bytes.end(), entry, entry + sizeof(entry));
+            }
+            for (std::uint32_t i = 0U; i < to.sectionCount; i++)
+            {
+                const std::uint8_t* entry = detail::getDeltaImageSection(to, i);
+                if (modes[i] == PBF_DELTA_SECTION_DATA)
+                {
+                    const std::uint8_t* data = to.bytes + detail::loadWord(entry + 4U, swap);
+                    bytes.insert(bytes.end(), data, data + detail::loadWord(entry + 8U, swap));
+                }
+            }
+        }
+        if (bytes.size() > std::numeric_limits<std::uint32_t>::max())
+        {
+            return delta;
+        }
+        detail::storeWord(bytes.data() + 4U, crc32c(bytes.data() + 8U, bytes.size() - 8U), swap);
+
+        /*both ways of applying it must give the target*/
+        const std::uint32_t deltaSize = static_cast<std::uint32_t>(bytes.size());
+        std::optional<DeltaInfo> info = getDeltaInfo(bytes.data(), deltaSize);
+        std::vector<std::uint8_t> check(info ? info->inPlaceCapacity : 0U);
+        if (!info || !applyDelta(source, sourceSize, bytes.data(), deltaSize, check.data(), targetSize) || (memcmp(check.data(), target, targetSize) != 0))
+        {
+            return delta;
+        }
+        memcpy(check.data(), source, sourceSize);
+        if (!applyDeltaInPlace(check.data(), info->inPlaceCapacity, bytes.data(), deltaSize) || (memcmp(check.data(), target, targetSize) != 0))
+        {
+            return delta;
+        }
+        if (summary != nullptr)
+        {
+            *summary = counts;
+        }
+        delta.swap(bytes);
+        return delta;
+    }
+}
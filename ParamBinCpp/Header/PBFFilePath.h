@@ -0,0 +1,51 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <string>
+
+namespace PBF
+{
+    /*Replaces the extension of a file name (from the last dot) or appends newExtension if it has none*/
+    inline std::string changeFileExtension(const std::string& filename, const std::string& newExtension)
+    {
+        std::size_t lastDotIndex = filename.find_last_of(".");
+        if (lastDotIndex != std::string::npos) {
+            return filename.substr(0, lastDotIndex) + newExtension;
+        }
+        return filename + newExtension;
+    }
+
+    /*File name without directory and extension*/
+    inline std::string getFileStem(const std::string& filename)
+    {
+        std::size_t lastSlashIndex = filename.find_last_of("/\\");
+        std::string name = (lastSlashIndex != std::string::npos) ? filename.substr(lastSlashIndex + 1U) : filename;
+        std::size_t lastDotIndex = name.find_last_of(".");
+        return (lastDotIndex != std::string::npos) ? name.substr(0, lastDotIndex) : name;
+    }
+}
@@ -0,0 +1,214 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace PBF
+{
+    /**
+     * @class FlatHashIndex
+     * @brief Open addressing map from key hashes to slot numbers (Robin Hood, linear probing).
+     *
+     * All entries are kept in one contiguous array of 8-byte entries with a power of two
+     * capacity. Robin Hood insertion keeps the probe sequences short and lets an unsuccessful
+     * lookup stop as soon as it meets an entry that is closer to its home position.
+     * The longest probe sequence is recorded on insertion, so a lookup never inspects more
+     * than maxProbeLength() entries.
+     */
+    class FlatHashIndex
+    {
+    public:
+
+        static constexpr std::uint32_t NPOS = 0xFFFFFFFFU;
+
+        FlatHashIndex() = default;
+
+        void clear()
+        {
+            _entries.clear();
+            _mask = 0U;
+            _shift = 32U;
+            _count = 0U;
+            _maxDistance = 0U;
+        }
+
+        /*Prepares the table for count entries so that no rehash is needed*/
+        void reserve(std::uint32_t count)
+        {
+            std::uint32_t capacity = 8U;
+            while (capacity - capacity / 8U < count)
+            {
+                capacity *= 2U;
+            }
+            if (capacity > _entries.size())
+            {
+                rehash(capacity);
+            }
+        }
+
+        std::uint32_t size() const noexcept
+        {
+            return _count;
+        }
+
+        std::uint32_t capacity() const noexcept
+        {
+            return static_cast<std::uint32_t>(_entries.size());
+        }
+
+        /*Upper bound of the entries a find() inspects*/
+        std::uint32_t maxProbeLength() const noexcept
+        {
+            return (_count == 0U) ? 0U : _maxDistance + 1U;
+        }
+
+        /**
+         * @brief Inserts a new entry.
+         * @return false if the hash is already in the table.
+         */
+        bool insert(std::uint32_t hash, std::uint32_t slot)
+        {
+            if (find(hash) != NPOS)
+            {
+                return false;
+            }
+            if (_count + 1U > capacity() - capacity() / 8U)
+            {
+                rehash((capacity() == 0U) ? 8U : capacity() * 2U);
+            }
+            place(Entry{ hash, slot });
+            _count++;
+            return true;
+        }
+
+        /*Slot of the hash or NPOS*/
+        std::uint32_t find(std::uint32_t hash) const noexcept
+        {
+            if (_count == 0U)
+            {
+                return NPOS;
+            }
+            std::uint32_t pos = home(hash);
+            for (std::uint32_t distance = 0U; distance <= _maxDistance; distance++)
+            {
+                const Entry& entry = _entries[pos];
+                if ((entry.slot == NPOS) || (probeDistance(entry.hash, pos) < distance))
+                {
+                    return NPOS;
+                }
+                if (entry.hash == hash)
+                {
+                    return entry.slot;
+                }
+                pos = (pos + 1U) & _mask;
+            }
+            return NPOS;
+        }
+
+        /*Address of the home bucket, e.g. for prefetching*/
+        const void* homeAddress(std::uint32_t hash) const noexcept
+        {
+            return _entries.empty() ? nullptr : static_cast<const void*>(&_entries[home(hash)]);
+        }
+
+    private:
+
+        struct Entry
+        {
+            std::uint32_t hash;
+            std::uint32_t slot;
+        };
+
+        /*key hashes are FNV-1a, spread them with a Fibonacci multiply and use the top bits*/
+        std::uint32_t home(std::uint32_t hash) const noexcept
+        {
+            return static_cast<std::uint32_t>((static_cast<std::uint64_t>(hash * 0x9E3779B9U) >> _shift)) & _mask;
+        }
+
+        std::uint32_t probeDistance(std::uint32_t hash, std::uint32_t pos) const noexcept
+        {
+            return (pos - home(hash)) & _mask;
+        }
+
+        void place(Entry entry)
+        {
+            std::uint32_t pos = home(entry.hash);
+            std::uint32_t distance(0U);
+            while (true)
+            {
+                Entry& current = _entries[pos];
+                if (current.slot == NPOS)
+                {
+                    current = entry;
+                    _maxDistance = std::max(_maxDistance, distance);
+                    return;
+                }
+                std::uint32_t currentDistance = probeDistance(current.hash, pos);
+                if (currentDistance < distance)
+                {
+                    /*take from the rich, give to the poor*/
+                    std::swap(current, entry);
+                    _maxDistance = std::max(_maxDistance, distance);
+                    distance = currentDistance;
+                }
+                pos = (pos + 1U) & _mask;
+                distance++;
+            }
+        }
+
+        void rehash(std::uint32_t capacity)
+        {
+            std::vector<Entry> old;
+            old.swap(_entries);
+            _entries.assign(capacity, Entry{ 0U, NPOS });
+            _maxDistance = 0U;
+            _mask = capacity - 1U;
+            _shift = 32U;
+            for (std::uint32_t c = capacity; c > 1U; c >>= 1U)
+            {
+                _shift--;
+            }
+            for (const Entry& entry : old)
+            {
+                if (entry.slot != NPOS)
+                {
+                    place(entry);
+                }
+            }
+        }
+
+        std::vector<Entry> _entries;
+        std::uint32_t _mask = 0U;
+        std::uint32_t _shift = 32U;
+        std::uint32_t _count = 0U;
+        std::uint32_t _maxDistance = 0U; /*longest probe distance of all entries*/
+    };
+}
@@ -0,0 +1,132 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <bit>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PBF_SCAN_AVX2
+#elif defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define PBF_SCAN_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define PBF_SCAN_NEON
+#endif
+
+namespace PBF
+{
+    /*
+     * Up to this number of records a scan over the hash column is faster than the flat hash
+     * index, measured with the "scan" benchmark of TOML2Pbf-Bench (ns per lookup, scan against
+     * flat index). The limit is the same for all SIMD targets:
+     * SSE2 (x64 default): 8 records 2.6-3.0 vs 3.9-4.4, 16 records 3.9-4.2 vs 3.9-4.2, 32 records 6.6-10.5 vs 3.4-4.0.
+     * AVX2: 16 records 3.5-6.0 vs 6.1-6.6, 32 records 6.2-9.6 vs 5.2-5.9.
+     * NEON uses the SSE2 limit, it has the same width and was not measured.
+     */
+#if defined(PBF_SCAN_AVX2) || defined(PBF_SCAN_SSE2) || defined(PBF_SCAN_NEON)
+    const std::uint32_t PBF_SCAN_MAX_RECORDS = 16U;
+#else
+    const std::uint32_t PBF_SCAN_MAX_RECORDS = 4U;
+#endif
+
+    /*Branchless scalar scan, hashes must be unique*/
+    inline std::uint32_t findHashScalar(const std::uint32_t* hashes, std::uint32_t first, std::uint32_t count, std::uint32_t hash) noexcept
+    {
+        std::uint32_t found(0U);
+        for (std::uint32_t i = first; i < count; i++)
+        {
+            found += (i + 1U) & (0U - static_cast<std::uint32_t>(hashes[i] == hash));
+        }
+        return (found == 0U) ? count : (found - 1U);
+    }
+
+    /**
+     * @brief Finds a hash in a contiguous, unsorted column of unique hashes.
+     *
+     * The whole column is compared without branches, 8 hashes per instruction with AVX2 and 4
+     * with SSE2 or NEON. Every lane adds its position + 1 to an accumulator if it
+     * matches, so with unique hashes the sum is the position of the match. Random keys
+     * therefore cause no branch mispredictions. Other targets and the tail use a scalar loop.
+     * The column does not need any alignment.
+     * @return Index of the match or count if the hash is not in the column.
+     */
+    inline std::uint32_t findHash(const std::uint32_t* hashes, std::uint32_t count, std::uint32_t hash) noexcept
+    {
+        std::uint32_t i(0U);
+        std::uint32_t found(0U);
+#if defined(PBF_SCAN_AVX2)
+        const __m256i needle = _mm256_set1_epi32(static_cast<int>(hash));
+        const __m256i step = _mm256_set1_epi32(8);
+        __m256i position = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 8);
+        __m256i sum = _mm256_setzero_si256();
+        for (; i + 8U <= count; i += 8U)
+        {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hashes + i));
+            sum = _mm256_add_epi32(sum, _mm256_and_si256(_mm256_cmpeq_epi32(block, needle), position));
+            position = _mm256_add_epi32(position, step);
+        }
+        __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0x4E));
+        sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0xB1));
+        found = static_cast<std::uint32_t>(_mm_cvtsi128_si32(sum128));
+#elif defined(PBF_SCAN_SSE2)
+        const __m128i needle = _mm_set1_epi32(static_cast<int>(hash));
+        const __m128i step = _mm_set1_epi32(4);
+        __m128i position = _mm_setr_epi32(1, 2, 3, 4);
+        __m128i sum = _mm_setzero_si128();
+        for (; i + 4U <= count; i += 4U)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hashes + i));
+            sum = _mm_add_epi32(sum, _mm_and_si128(_mm_cmpeq_epi32(block, needle), position));
+            position = _mm_add_epi32(position, step);
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        found = static_cast<std::uint32_t>(_mm_cvtsi128_si32(sum));
+#elif defined(PBF_SCAN_NEON)
+        const uint32x4_t needle = vdupq_n_u32(hash);
+        const uint32x4_t step = vdupq_n_u32(4U);
+        const std::uint32_t first[4] = { 1U, 2U, 3U, 4U };
+        uint32x4_t position = vld1q_u32(first);
+        uint32x4_t sum = vdupq_n_u32(0U);
+        for (; i + 4U <= count; i += 4U)
+        {
+            sum = vaddq_u32(sum, vandq_u32(vceqq_u32(vld1q_u32(hashes + i), needle), position));
+            position = vaddq_u32(position, step);
+        }
+        found = vaddvq_u32(sum);
+#endif
+        if (found != 0U)
+        {
+            return found - 1U;
+        }
+        return findHashScalar(hashes, i, count, hash);
+    }
+}
@@ -0,0 +1,325 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "Pbf.h"
+#include "PBFValue.h"
+#include "PBFSections.h"
+
+namespace PBF
+{
+    // Hierarchy section (tables and parameters as a tree, the children of a node are contiguous)
+    //  4 bytes (UInt32)  Number of nodes N, node 0 is the root (the table with the empty key)
+    //  N * 16 bytes      Nodes in breadth first order: Hash of the key, Parent node, First child node,
+    //                    1 bit Parameter + 31 bits Number of children
+    //  N * 4 bytes       Hashes of the nodes sorted in ascending order
+    //  N * 4 bytes       Node numbers in the order of the sorted hashes
+
+    const std::uint32_t PBF_HIERARCHY_NODE_SIZE = sizeof(std::uint32_t) * 4U;
+    const std::uint32_t PBF_HIERARCHY_PARAMETER = 0x80000000U;
+
+    inline std::uint32_t getHierarchySectionSize(std::uint32_t numberOfNodes) noexcept
+    {
+        return sizeof(std::uint32_t) + numberOfNodes * (PBF_HIERARCHY_NODE_SIZE + 2U * sizeof(std::uint32_t));
+    }
+
+    /**
+     * @class HierarchyBuilder
+     * @brief Collects the tree of tables and parameters while the converter walks the TOML tables.
+     *
+     * Nodes are identified by the hash of their key. Arrays are tables with the elements
+     * "key[i]" as children. Children keep the order in which they were added.
+     */
+    class HierarchyBuilder
+    {
+    public:
+
+        /*seed: hash seed of the keys, see pbfHashSeeded*/
+        explicit HierarchyBuilder(std::uint32_t seed = 0U) : _root(pbfHashSeeded(seed, ""))
+        {
+            _nodes[_root] = Node();
+        }
+
+        /**
+         * @brief Adds a table or parameter below an already added table.
+         * @return false if the parent is unknown or the node was already added.
+         */
+        bool add(std::uint32_t parent, std::uint32_t hash, bool isParameter)
+        {
+            auto found = _nodes.find(parent);
+            if ((found == _nodes.end()) || found->second.isParameter || (_nodes.count(hash) != 0U))
+            {
+                return false;
+            }
+            found->second.children.push_back(hash);
+            Node node;
+            node.isParameter = isParameter;
+            _nodes[hash] = node;
+            return true;
+        }
+
+        /*Number of nodes including the root*/
+        std::uint32_t size() const
+        {
+            return static_cast<std::uint32_t>(_nodes.size());
+        }
+
+        std::vector<std::uint32_t> makeSection() const
+        {
+            struct Entry
+            {
+                std::uint32_t hash;
+                std::uint32_t parent;
+            };
+
+            /*breadth first, so the children of every node follow each other*/
+            std::vector<Entry> order;
+            order.reserve(_nodes.size());
+            order.push_back(Entry{ _root, 0U });
+            std::vector<std::uint32_t> data(1U, size());
+            for (std::uint32_t n = 0U; n < order.size(); n++)
+            {
+                const Node& node = _nodes.at(order[n].hash);
+                std::uint32_t firstChild = static_cast<std::uint32_t>(order.size());
+                for (std::uint32_t child : node.children)
+                {
+                    order.push_back(Entry{ child, n });
+                }
+                std::uint32_t count = static_cast<std::uint32_t>(node.children.size()) | (node.isParameter ? PBF_HIERARCHY_PARAMETER : 0U);
+                data.insert(data.end(), { order[n].hash, order[n].parent, firstChild, count });
+            }
+
+            std::vector<std::pair<std::uint32_t, std::uint32_t>> sorted;
+            for (std::uint32_t n = 0U; n < order.size(); n++)
+            {
+                sorted.push_back(std::make_pair(order[n].hash, n));
+            }
+            std::sort(sorted.begin(), sorted.end());
+            for (const auto& [hash, n] : sorted)
+            {
+                data.push_back(hash);
+            }
+            for (const auto& [hash, n] : sorted)
+            {
+                data.push_back(n);
+            }
+            return data;
+        }
+
+    private:
+
+        struct Node
+        {
+            std::vector<std::uint32_t> children;
+            bool isParameter = false;
+        };
+
+        std::uint32_t _root;
+        std::map<std::uint32_t, Node> _nodes;
+    };
+
+    /**
+     * @class HierarchyIndex
+     * @brief Walks the Hierarchy section, used straight from the image.
+     *
+     * A node is found with a branchless binary search over the sorted hash column. Walking a
+     * subtree visits each of its nodes once and needs no memory besides the section.
+     */
+    class HierarchyIndex
+    {
+    public:
+
+        HierarchyIndex() = default;
+
+        bool open(const SectionRef& section) noexcept
+        {
+            *this = HierarchyIndex();
+
+            if ((section.type != SectionTypes::Hierarchy) || (section.size < sizeof(std::uint32_t)))
+            {
+                return false;
+            }
+            std::uint32_t count = loadU32(section.data);
+            if ((count == 0U) || (count > section.size / (PBF_HIERARCHY_NODE_SIZE + 2U * sizeof(std::uint32_t))) ||
+                (section.size < getHierarchySectionSize(count)))
+            {
+                return false;
+            }
+            _section = section;
+            _count = count;
+            _nodes = section.data + sizeof(std::uint32_t);
+            _hashes = _nodes + count * PBF_HIERARCHY_NODE_SIZE;
+            _numbers = _hashes + count * sizeof(std::uint32_t);
+            return true;
+        }
+
+        bool isOpen() const noexcept
+        {
+            return (_nodes != nullptr);
+        }
+
+        /*Number of nodes*/
+        std::uint32_t size() const noexcept
+        {
+            return _count;
+        }
+
+        const SectionRef& section() const noexcept
+        {
+            return _section;
+        }
+
+        /*Node number of a table or parameter*/
+        std::optional<std::uint32_t> find(std::uint32_t hash) const noexcept
+        {
+            if (_count == 0U)
+            {
+                return std::nullopt;
+            }
+            std::uint32_t first(0U);
+            std::uint32_t n(_count);
+            while (n > 1U)
+            {
+                std::uint32_t half = n / 2U;
+                first = (loadU32(_hashes + (first + half) * sizeof(std::uint32_t)) <= hash) ? (first + half) : first;
+                n -= half;
+            }
+            std::uint32_t node = loadU32(_numbers + first * sizeof(std::uint32_t));
+            if ((loadU32(_hashes + first * sizeof(std::uint32_t)) != hash) || (node >= _count))
+            {
+                return std::nullopt;
+            }
+            return node;
+        }
+
+        /*Number of direct children of a table, 0 for parameters and unknown keys*/
+        std::uint32_t childCount(std::uint32_t hash) const noexcept
+        {
+            std::optional<std::uint32_t> node = find(hash);
+            return node ? getChildCount(node.value()) : 0U;
+        }
+
+        /**
+         * @brief Calls visitor(hash) for every parameter below a table, depth first.
+         *
+         * The work is proportional to the number of nodes in the subtree. The walk stops after
+         * size() steps, so a malformed section can not make it run forever.
+         * @return Number of parameters visited.
+         */
+        template<typename Visitor>
+        std::uint32_t forEachParameterUnder(std::uint32_t hash, Visitor&& visitor) const
+        {
+            std::optional<std::uint32_t> found = find(hash);
+            if (!found || isParameter(found.value()))
+            {
+                return 0U;
+            }
+            const std::uint32_t root = found.value();
+            std::uint32_t node = root;
+            std::uint32_t visited(0U);
+            for (std::uint32_t steps = 0U; steps < _count; steps++)
+            {
+                if (getChildCount(node) > 0U)
+                {
+                    node = getFirstChild(node);
+                }
+                else
+                {
+                    /*next sibling, or the next sibling of the closest ancestor that has one*/
+                    while ((node != root) && (node != 0U))
+                    {
+                        std::uint32_t parent = getParent(node);
+                        if (node + 1U < getFirstChild(parent) + getChildCount(parent))
+                        {
+                            node++;
+                            break;
+                        }
+                        node = parent;
+                    }
+                    if ((node == root) || (node == 0U))
+                    {
+                        break;
+                    }
+                }
+                if (isParameter(node))
+                {
+                    visitor(getHash(node));
+                    visited++;
+                }
+            }
+            return visited;
+        }
+
+    private:
+
+        std::uint32_t getField(std::uint32_t node, std::uint32_t field) const noexcept
+        {
+            return loadU32(_nodes + node * PBF_HIERARCHY_NODE_SIZE + field * sizeof(std::uint32_t));
+        }
+
+        std::uint32_t getHash(std::uint32_t node) const noexcept
+        {
+            return getField(node, 0U);
+        }
+
+        /*parents come before their children, anything else ends the walk at node 0*/
+        std::uint32_t getParent(std::uint32_t node) const noexcept
+        {
+            std::uint32_t parent = getField(node, 1U);
+            return (parent < node) ? parent : 0U;
+        }
+
+        std::uint32_t getFirstChild(std::uint32_t node) const noexcept
+        {
+            return getField(node, 2U);
+        }
+
+        /*0 if the children are not behind the node and inside the section*/
+        std::uint32_t getChildCount(std::uint32_t node) const noexcept
+        {
+            std::uint32_t count = getField(node, 3U) & ~PBF_HIERARCHY_PARAMETER;
+            std::uint32_t first = getFirstChild(node);
+            return ((first > node) && (first <= _count) && (count <= _count - first)) ? count : 0U;
+        }
+
+        bool isParameter(std::uint32_t node) const noexcept
+        {
+            return (getField(node, 3U) & PBF_HIERARCHY_PARAMETER) != 0U;
+        }
+
+        SectionRef _section;
+        std::uint32_t _count = 0U;
+        const std::uint8_t* _nodes = nullptr;
+        const std::uint8_t* _hashes = nullptr;
+        const std::uint8_t* _numbers = nullptr;
+    };
+}
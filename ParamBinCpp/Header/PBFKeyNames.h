@@ -0,0 +1,283 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "Pbf.h"
+#include "PBFValue.h"
+#include "PBFSections.h"
+
+namespace PBF
+{
+    // KeyNames section (the key names front coded in the order of the names, for reverse lookups)
+    //  4 bytes (UInt32)  Number of names N
+    //  4 bytes (UInt32)  Names per block B, the first name of every block is stored in full
+    //  4 bytes (UInt32)  Size of the name data D in bytes
+    //  N * 4 bytes       Hashes of the keys sorted in ascending order
+    //  N * 4 bytes       Name numbers in the order of the sorted hashes
+    //  (N + B - 1) / B * 4 bytes  Offsets of the blocks in the name data
+    //  D bytes           Names, padded to 4 bytes: length of the prefix shared with the previous name,
+    //                    length of the rest (both as LEB128) and the rest
+
+    const std::uint32_t PBF_KEY_NAMES_HEADER_SIZE = sizeof(std::uint32_t) * 3U;
+    const std::uint32_t PBF_KEY_NAMES_BLOCK_SIZE = 16U;
+
+    /**
+     * @class KeyNameBuilder
+     * @brief Collects the key names of the records for the KeyNames section.
+     */
+    class KeyNameBuilder
+    {
+    public:
+
+        KeyNameBuilder() = default;
+
+        /*false if the hash was already added*/
+        bool add(std::uint32_t hash, const std::string& name)
+        {
+            return _names.emplace(hash, name).second;
+        }
+
+        std::uint32_t size() const
+        {
+            return static_cast<std::uint32_t>(_names.size());
+        }
+
+        std::vector<std::uint32_t> makeSection() const
+        {
+            std::vector<std::pair<std::string, std::uint32_t>> sorted;
+            for (const auto& [hash, name] : _names)
+            {
+                sorted.push_back(std::make_pair(name, hash));
+            }
+            std::sort(sorted.begin(), sorted.end());
+
+            const std::uint32_t count = size();
+            std::vector<std::uint32_t> blocks;
+            std::vector<std::uint8_t> names;
+            for (std::uint32_t n = 0U; n < count; n++)
+            {
+                const std::string& name = sorted[n].first;
+                std::size_t shared(0U);
+                if ((n % PBF_KEY_NAMES_BLOCK_SIZE) == 0U)
+                {
+                    blocks.push_back(static_cast<std::uint32_t>(names.size()));
+                }
+                else
+                {
+                    const std::string& previous = sorted[n - 1U].first;
+                    while ((shared < name.size()) && (shared < previous.size()) && (name[shared] == previous[shared]))
+                    {
+                        shared++;
+                    }
+                }
+                appendLength(names, static_cast<std::uint32_t>(shared));
+                appendLength(names, static_cast<std::uint32_t>(name.size() - shared));
+                names.insert(names.end(), name.begin() + shared, name.end());
+            }
+            const std::uint32_t dataSize = static_cast<std::uint32_t>(names.size());
+            names.resize((names.size() + sizeof(std::uint32_t) - 1U) / sizeof(std::uint32_t) * sizeof(std::uint32_t), 0U);
+
+            std::vector<std::uint32_t> data = { count, PBF_KEY_NAMES_BLOCK_SIZE, dataSize };
+            for (const auto& [hash, name] : _names)
+            {
+                data.push_back(hash);
+            }
+            for (const auto& [hash, name] : _names)
+            {
+                auto found = std::lower_bound(sorted.begin(), sorted.end(), std::make_pair(name, hash));
+                data.push_back(static_cast<std::uint32_t>(found - sorted.begin()));
+            }
+            data.insert(data.end(), blocks.begin(), blocks.end());
+
+            std::size_t pos = data.size();
+            data.resize(pos + names.size() / sizeof(std::uint32_t));
+            memcpy(&data[pos], names.data(), names.size());
+            return data;
+        }
+
+    private:
+
+        static void appendLength(std::vector<std::uint8_t>& data, std::uint32_t length)
+        {
+            while (length >= 0x80U)
+            {
+                data.push_back(static_cast<std::uint8_t>(length | 0x80U));
+                length >>= 7U;
+            }
+            data.push_back(static_cast<std::uint8_t>(length));
+        }
+
+        std::map<std::uint32_t, std::string> _names; /*ordered by hash*/
+    };
+
+    /**
+     * @class KeyNameIndex
+     * @brief Maps key hashes back to their names with the KeyNames section, used straight from the image.
+     *
+     * Only meant for diagnostics: opening reads the three header words, the names are only
+     * touched by getName. A lookup is a branchless binary search over the hashes followed by
+     * decoding at most one block of names.
+     */
+    class KeyNameIndex
+    {
+    public:
+
+        KeyNameIndex() = default;
+
+        bool open(const SectionRef& section) noexcept
+        {
+            *this = KeyNameIndex();
+
+            if ((section.type != SectionTypes::KeyNames) || (section.size < PBF_KEY_NAMES_HEADER_SIZE))
+            {
+                return false;
+            }
+            std::uint32_t count = loadU32(section.data);
+            std::uint32_t block = loadU32(section.data + sizeof(std::uint32_t));
+            std::uint32_t dataSize = loadU32(section.data + 2U * sizeof(std::uint32_t));
+            std::uint32_t available = section.size - PBF_KEY_NAMES_HEADER_SIZE;
+            if ((block == 0U) || (count > available / (2U * sizeof(std::uint32_t))))
+            {
+                return false;
+            }
+            std::uint32_t blocks = count / block + ((count % block) != 0U ? 1U : 0U);
+            available -= count * 2U * sizeof(std::uint32_t);
+            if ((blocks > available / sizeof(std::uint32_t)) || (dataSize > available - blocks * sizeof(std::uint32_t)))
+            {
+                return false;
+            }
+            _section = section;
+            _count = count;
+            _block = block;
+            _dataSize = dataSize;
+            _hashes = section.data + PBF_KEY_NAMES_HEADER_SIZE;
+            _numbers = _hashes + count * sizeof(std::uint32_t);
+            _offsets = _numbers + count * sizeof(std::uint32_t);
+            _names = _offsets + blocks * sizeof(std::uint32_t);
+            return true;
+        }
+
+        bool isOpen() const noexcept
+        {
+            return (_hashes != nullptr);
+        }
+
+        /*Number of names*/
+        std::uint32_t size() const noexcept
+        {
+            return _count;
+        }
+
+        const SectionRef& section() const noexcept
+        {
+            return _section;
+        }
+
+        /**
+         * @brief Decodes the name of a key into buffer.
+         * @return The name (not terminated) in buffer, std::nullopt if the hash is unknown or the name does not fit.
+         */
+        std::optional<std::string_view> getName(std::uint32_t hash, std::span<char> buffer) const noexcept
+        {
+            if (_count == 0U)
+            {
+                return std::nullopt;
+            }
+            std::uint32_t first(0U);
+            std::uint32_t n(_count);
+            while (n > 1U)
+            {
+                std::uint32_t half = n / 2U;
+                first = (loadU32(_hashes + (first + half) * sizeof(std::uint32_t)) <= hash) ? (first + half) : first;
+                n -= half;
+            }
+            std::uint32_t number = loadU32(_numbers + first * sizeof(std::uint32_t));
+            if ((loadU32(_hashes + first * sizeof(std::uint32_t)) != hash) || (number >= _count))
+            {
+                return std::nullopt;
+            }
+
+            /*decode from the start of the block up to the name*/
+            std::uint32_t offset = loadU32(_offsets + (number / _block) * sizeof(std::uint32_t));
+            std::size_t length(0U);
+            for (std::uint32_t i = 0U; i <= number % _block; i++)
+            {
+                std::uint32_t shared(0U);
+                std::uint32_t rest(0U);
+                if (!readLength(offset, shared) || !readLength(offset, rest) || (shared > length) ||
+                    (rest > _dataSize - offset) || (rest > buffer.size() - shared))
+                {
+                    return std::nullopt;
+                }
+                std::memcpy(buffer.data() + shared, _names + offset, rest);
+                offset += rest;
+                length = shared + rest;
+            }
+            return std::string_view(buffer.data(), length);
+        }
+
+    private:
+
+        /*LEB128 length at offset, at most 5 bytes*/
+        bool readLength(std::uint32_t& offset, std::uint32_t& value) const noexcept
+        {
+            value = 0U;
+            for (std::uint32_t shift = 0U; shift < 35U; shift += 7U)
+            {
+                if (offset >= _dataSize)
+                {
+                    return false;
+                }
+                std::uint8_t byte = _names[offset++];
+                value |= static_cast<std::uint32_t>(byte & 0x7FU) << shift;
+                if ((byte & 0x80U) == 0U)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        SectionRef _section;
+        std::uint32_t _count = 0U;
+        std::uint32_t _block = 0U;
+        std::uint32_t _dataSize = 0U;
+        const std::uint8_t* _hashes = nullptr;
+        const std::uint8_t* _numbers = nullptr;
+        const std::uint8_t* _offsets = nullptr;
+        const std::uint8_t* _names = nullptr;
+    };
+}
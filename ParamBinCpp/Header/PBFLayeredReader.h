@@ -0,0 +1,74 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstddef>
+#include <span>
+#include "PBFReader.h"
+
+namespace PBF
+{
+    /**
+     * @class LayeredReader
+     * @brief Reads a base image and override images as one parameter set.
+     *
+     * The layers are read in order into the slots and the index of PBFReader. A record of a
+     * later layer replaces the value of the same key of an earlier layer, keys of only one layer
+     * are added. The layers are combined once at load, so a lookup is one probe of one index
+     * and costs the same as with a single image. The images are not needed after read().
+     *
+     * All layers must have the same hash seed (see --seed of the converter). forEachUnder and
+     * childCount walk the hierarchy of the first layer. Arrays written per element are
+     * overridden per element, packed arrays as a whole.
+     */
+    class LayeredReader : public PBFReader
+    {
+    public:
+
+        using PBFReader::read;
+
+        /**
+         * @brief Reads the layers, replacing the parameters read before.
+         * @param layers Images in the order base, overrides. Later layers shadow earlier ones.
+         * @return false if there is no layer or a layer is malformed, contains a key twice, its
+         * checksum does not match or its seed is not the seed of the first layer.
+         */
+        bool read(std::span<const std::span<const std::byte>> layers)
+        {
+            clear();
+            for (std::span<const std::byte> layer : layers)
+            {
+                if (!readLayer(layer.data(), layer.size()))
+                {
+                    clear();
+                    return false;
+                }
+            }
+            return !layers.empty();
+        }
+    };
+}
@@ -0,0 +1,386 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "Pbf.h"
+#include "PBFValue.h"
+#include "PBFSections.h"
+
+namespace PBF
+{
+    // PerfectHash section (minimal perfect hash over the record hashes, hash and displace)
+    //  4 bytes (UInt32)  Number of records N
+    //  4 bytes (UInt32)  Number of buckets B
+    //  4 bytes (UInt32)  Number of positions M (M >= N)
+    //  4 bytes (UInt32)  Seed
+    //  B * 2 bytes       Pilot of every bucket (padded to the next 32-bit boundary)
+    //  (M - N) * 4 bytes Remapping of the positions >= N to the free positions < N
+    //  N * 8 bytes       Slots: Hash, Offset of the record (from the start of the file)
+
+    const std::uint32_t PBF_MPH_KEYS_PER_BUCKET = 3U;
+
+    inline std::uint64_t mphMix(std::uint64_t x) noexcept
+    {
+        x ^= x >> 33U;
+        x *= 0xFF51AFD7ED558CCDULL;
+        x ^= x >> 33U;
+        x *= 0xC4CEB9FE1A85EC53ULL;
+        x ^= x >> 33U;
+        return x;
+    }
+
+    /*maps x uniformly to [0, n) without a division*/
+    inline std::uint32_t mphReduce(std::uint32_t x, std::uint32_t n) noexcept
+    {
+        return static_cast<std::uint32_t>((static_cast<std::uint64_t>(x) * n) >> 32U);
+    }
+
+    inline std::uint64_t mphKey(std::uint32_t hash, std::uint32_t seed) noexcept
+    {
+        return mphMix((static_cast<std::uint64_t>(seed) << 32U) | hash);
+    }
+
+    inline std::uint32_t mphPosition(std::uint64_t key, std::uint32_t pilot, std::uint32_t positions) noexcept
+    {
+        return mphReduce(static_cast<std::uint32_t>(mphMix(key ^ (pilot * 0x9E3779B97F4A7C15ULL))), positions);
+    }
+
+    inline std::uint32_t getPerfectHashBucketCount(std::uint32_t numberOfRecords) noexcept
+    {
+        return (numberOfRecords + PBF_MPH_KEYS_PER_BUCKET - 1U) / PBF_MPH_KEYS_PER_BUCKET;
+    }
+
+    /*about 6% more positions than keys keeps the search for the last buckets short*/
+    inline std::uint32_t getPerfectHashPositionCount(std::uint32_t numberOfRecords) noexcept
+    {
+        return (numberOfRecords == 0U) ? 0U : (numberOfRecords + numberOfRecords / 16U + 1U);
+    }
+
+    inline std::uint32_t getPerfectHashSectionSize(std::uint32_t numberOfRecords) noexcept
+    {
+        std::uint32_t buckets = getPerfectHashBucketCount(numberOfRecords);
+        std::uint32_t positions = getPerfectHashPositionCount(numberOfRecords);
+        std::uint32_t pilots = ((buckets * sizeof(std::uint16_t)) + sizeof(std::uint32_t) - 1U) / sizeof(std::uint32_t);
+        return (4U + pilots + (positions - numberOfRecords)) * sizeof(std::uint32_t) + numberOfRecords * 2U * sizeof(std::uint32_t);
+    }
+
+    /**
+     * @class PerfectHashBuilder
+     * @brief Builds a minimal perfect hash function over a set of unique 32-bit hashes.
+     *
+     * The keys are distributed into buckets of about 3 keys. Starting with the largest bucket,
+     * for every bucket the first pilot value is searched that moves all its keys to free
+     * positions. Positions beyond the number of keys are remapped to the free positions below,
+     * which makes the function minimal. The build runs in expected linear time.
+     */
+    class PerfectHashBuilder
+    {
+    public:
+
+        /**
+         * @brief Builds the function.
+         * @param hashes Unique keys.
+         * @return false if the keys are not unique.
+         */
+        bool build(const std::vector<std::uint32_t>& hashes)
+        {
+            std::vector<std::uint32_t> sorted(hashes);
+            std::sort(sorted.begin(), sorted.end());
+            if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+            {
+                return false;
+            }
+
+            _count = static_cast<std::uint32_t>(hashes.size());
+            _buckets = getPerfectHashBucketCount(_count);
+            _positions = getPerfectHashPositionCount(_count);
+
+            for (std::uint32_t seed = 0U; seed < 64U; seed++)
+            {
+                if (tryBuild(hashes, seed))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        std::uint32_t seed() const
+        {
+            return _seed;
+        }
+
+        /*Final position of the key (valid for the keys the function was built for)*/
+        std::uint32_t lookup(std::uint32_t hash) const
+        {
+            std::uint64_t key = mphKey(hash, _seed);
+            std::uint32_t bucket = mphReduce(static_cast<std::uint32_t>(key >> 32U), _buckets);
+            std::uint32_t position = mphPosition(key, _pilots[bucket], _positions);
+            return (position < _count) ? position : _remap[position - _count];
+        }
+
+        /**
+         * @brief Writes the section.
+         * @param records Hash and record offset of every key, in any order.
+         */
+        std::vector<std::uint32_t> makeSection(const std::vector<std::pair<std::uint32_t, std::uint32_t>>& records) const
+        {
+            std::vector<std::uint32_t> data;
+            data.reserve(getPerfectHashSectionSize(_count) / sizeof(std::uint32_t));
+            data.push_back(_count);
+            data.push_back(_buckets);
+            data.push_back(_positions);
+            data.push_back(_seed);
+
+            /*the pilots are an array of 16-bit values in the byte order of the image*/
+            std::size_t pilots = data.size();
+            data.resize(pilots + (_buckets + 1U) / 2U, 0U);
+            std::memcpy(data.data() + pilots, _pilots.data(), _pilots.size() * sizeof(std::uint16_t));
+            data.insert(data.end(), _remap.begin(), _remap.end());
+
+            std::size_t slots = data.size();
+            data.resize(slots + 2U * static_cast<std::size_t>(_count), 0U);
+            for (const auto& [hash, offset] : records)
+            {
+                std::size_t slot = slots + 2U * static_cast<std::size_t>(lookup(hash));
+                data[slot] = hash;
+                data[slot + 1U] = offset;
+            }
+            return data;
+        }
+
+    private:
+
+        bool tryBuild(const std::vector<std::uint32_t>& hashes, std::uint32_t seed)
+        {
+            _seed = seed;
+            _pilots.assign(_buckets, 0U);
+            _remap.assign(_positions - _count, 0U);
+
+            std::vector<std::uint64_t> keys(_count);
+            std::vector<std::uint32_t> start(static_cast<std::size_t>(_buckets) + 1U, 0U);
+            for (std::uint32_t i = 0U; i < _count; i++)
+            {
+                keys[i] = mphKey(hashes[i], seed);
+                start[mphReduce(static_cast<std::uint32_t>(keys[i] >> 32U), _buckets) + 1U]++;
+            }
+
+            std::uint32_t largest(0U);
+            for (std::uint32_t b = 0U; b < _buckets; b++)
+            {
+                largest = std::max(largest, start[b + 1U]);
+                start[b + 1U] += start[b];
+            }
+
+            /*keys grouped by bucket*/
+            std::vector<std::uint64_t> grouped(_count);
+            {
+                std::vector<std::uint32_t> fill(start.begin(), start.end() - 1);
+                for (std::uint32_t i = 0U; i < _count; i++)
+                {
+                    grouped[fill[mphReduce(static_cast<std::uint32_t>(keys[i] >> 32U), _buckets)]++] = keys[i];
+                }
+            }
+
+            /*buckets ordered by size, largest first (counting sort)*/
+            std::vector<std::uint32_t> bySize(static_cast<std::size_t>(largest) + 2U, 0U);
+            for (std::uint32_t b = 0U; b < _buckets; b++)
+            {
+                bySize[largest - (start[b + 1U] - start[b]) + 1U]++;
+            }
+            for (std::uint32_t s = 0U; s <= largest; s++)
+            {
+                bySize[s + 1U] += bySize[s];
+            }
+            std::vector<std::uint32_t> order(_buckets);
+            for (std::uint32_t b = 0U; b < _buckets; b++)
+            {
+                order[bySize[largest - (start[b + 1U] - start[b])]++] = b;
+            }
+
+            std::vector<std::uint64_t> taken((static_cast<std::size_t>(_positions) + 63U) / 64U, 0U);
+            std::vector<std::uint32_t> placed;
+            placed.reserve(largest);
+
+            for (std::uint32_t b : order)
+            {
+                if (start[b + 1U] == start[b])
+                {
+                    break;
+                }
+
+                bool done = false;
+                for (std::uint32_t pilot = 0U; (pilot <= 0xFFFFU) && !done; pilot++)
+                {
+                    placed.clear();
+                    done = true;
+                    for (std::uint32_t k = start[b]; k < start[b + 1U]; k++)
+                    {
+                        std::uint32_t position = mphPosition(grouped[k], pilot, _positions);
+                        if (((taken[position >> 6U] >> (position & 63U)) & 1U) != 0U ||
+                            (std::find(placed.begin(), placed.end(), position) != placed.end()))
+                        {
+                            done = false;
+                            break;
+                        }
+                        placed.push_back(position);
+                    }
+                    if (done)
+                    {
+                        for (std::uint32_t position : placed)
+                        {
+                            taken[position >> 6U] |= (1ULL << (position & 63U));
+                        }
+                        _pilots[b] = static_cast<std::uint16_t>(pilot);
+                    }
+                }
+                if (!done)
+                {
+                    return false;
+                }
+            }
+
+            /*make it minimal: every used position >= N gets one of the free positions < N*/
+            std::uint32_t free(0U);
+            for (std::uint32_t position = _count; position < _positions; position++)
+            {
+                if (((taken[position >> 6U] >> (position & 63U)) & 1U) != 0U)
+                {
+                    while (((taken[free >> 6U] >> (free & 63U)) & 1U) != 0U)
+                    {
+                        free++;
+                    }
+                    _remap[position - _count] = free;
+                    free++;
+                }
+            }
+            return true;
+        }
+
+        std::uint32_t _count = 0U;
+        std::uint32_t _buckets = 0U;
+        std::uint32_t _positions = 0U;
+        std::uint32_t _seed = 0U;
+        std::vector<std::uint16_t> _pilots;
+        std::vector<std::uint32_t> _remap;
+    };
+
+    /**
+     * @class PerfectHashIndex
+     * @brief Lookup in the PerfectHash section, used straight from the image.
+     *
+     * Every lookup reads one pilot, at most one remap entry and one slot, independent
+     * of the number of records and of the key.
+     */
+    class PerfectHashIndex
+    {
+    public:
+
+        PerfectHashIndex() = default;
+
+        bool open(const SectionRef& section) noexcept
+        {
+            *this = PerfectHashIndex();
+
+            if ((section.type != SectionTypes::PerfectHash) || (section.size < 4U * sizeof(std::uint32_t)))
+            {
+                return false;
+            }
+            std::uint32_t count = loadU32(section.data);
+            std::uint32_t buckets = loadU32(section.data + 4U);
+            std::uint32_t positions = loadU32(section.data + 8U);
+            if ((count > section.size / 8U) || (buckets != getPerfectHashBucketCount(count)) || (positions != getPerfectHashPositionCount(count)) ||
+                (section.size < getPerfectHashSectionSize(count)))
+            {
+                return false;
+            }
+            _count = count;
+            _buckets = buckets;
+            _positions = positions;
+            _seed = loadU32(section.data + 12U);
+            _pilots = section.data + 16U;
+            _remap = _pilots + ((buckets * sizeof(std::uint16_t) + sizeof(std::uint32_t) - 1U) / sizeof(std::uint32_t)) * sizeof(std::uint32_t);
+            _slots = _remap + (positions - count) * sizeof(std::uint32_t);
+            return true;
+        }
+
+        bool isOpen() const noexcept
+        {
+            return (_slots != nullptr);
+        }
+
+        std::uint32_t size() const noexcept
+        {
+            return _count;
+        }
+
+        /*Offset of the record with the given hash*/
+        std::optional<std::uint32_t> find(std::uint32_t hash) const noexcept
+        {
+            if (_count == 0U)
+            {
+                return std::nullopt;
+            }
+            std::uint64_t key = mphKey(hash, _seed);
+            std::uint32_t bucket = mphReduce(static_cast<std::uint32_t>(key >> 32U), _buckets);
+
+            std::uint16_t pilot(0U);
+            std::memcpy(&pilot, _pilots + bucket * sizeof(std::uint16_t), sizeof(std::uint16_t));
+
+            std::uint32_t position = mphPosition(key, pilot, _positions);
+            if (position >= _count)
+            {
+                position = loadU32(_remap + (position - _count) * sizeof(std::uint32_t));
+                if (position >= _count)
+                {
+                    return std::nullopt;
+                }
+            }
+            const std::uint8_t* slot = _slots + position * 2U * sizeof(std::uint32_t);
+            if (loadU32(slot) != hash)
+            {
+                return std::nullopt;
+            }
+            return loadU32(slot + sizeof(std::uint32_t));
+        }
+
+    private:
+        std::uint32_t _count = 0U;
+        std::uint32_t _buckets = 0U;
+        std::uint32_t _positions = 0U;
+        std::uint32_t _seed = 0U;
+        const std::uint8_t* _pilots = nullptr;
+        const std::uint8_t* _remap = nullptr;
+        const std::uint8_t* _slots = nullptr;
+    };
+}
@@ -27,11 +27,26 @@ SOFTWARE.
 
 #pragma once
 #include <cstdint>
-#include <variant>
+#include <cstring>
+#include <algorithm>
 #include <string>
+#include <string_view>
+#include <optional>
+#include <vector>
+#include <type_traits>
 #include <chrono>
 #include <memory>
+#include <span>
+#include <array>
+#include <tuple>
 #include "Pbf.h"
+#include "PBFPlatform.h"
+#include "PBFValue.h"
+#include "PBFView.h"
+#include "PBFByteOrder.h"
+#include "PBFFlatIndex.h"
+#include "PBFHashScan.h"
+#include "PBFBinding.h"
 
 
 
@@ -40,40 +55,66 @@ namespace PBF
 {
     #define PBF_MEM_ALIGMENT	4U
 
-    using DataVariant = std::variant <
-        std::string,     // String
+    /*Number of keys getParams resolves together*/
+    const std::size_t PBF_BATCH_BLOCK_SIZE = 32U;
+
+    /*Records a lazily opened reader caches at most, further records are decoded on every lookup*/
+    const std::uint32_t PBF_LAZY_CACHE_SLOTS = 1024U;
+
+    /**
+     * @class ParamHandle
+     * @brief Pre-resolved parameter of type T.
+     *
+     * A handle is created by PBFReader::resolve, which checks once that the parameter exists
+     * and can be converted to T. The converted value is kept in the handle, so get() is a
+     * single load without hashing, lookup or type checks. Handles are small and trivially
+     * copyable and can be stored in per-module structures.
+     * Strings are resolved as std::string_view into the reader, such a handle is valid as
+     * long as the reader is.
+     */
+    template<typename T>
+    class ParamHandle
+    {
+    public:
 
-#ifdef ENABLE_PBF_8BIT_TYPES
-        int8_t,          // Int8
-        uint8_t,         // UInt8
-#endif
+        ParamHandle() = default;
 
-#ifdef ENABLE_PBF_16BIT_TYPES
-        int16_t,         // Int16
-        uint16_t,        // UInt16
-#endif
+        explicit ParamHandle(const T& value) noexcept : _value(value), _valid(true)
+        {
+        }
 
-        int32_t,         // Int32
-        uint32_t,        // UInt32
-        int64_t,         // Int64
-        uint64_t,        // UInt64
-        float,           // Float32
-        double,          // Float64
-        bool,            // Boolean
-        Date,            // Date
-        Time,            // Time
-        DateTime         // DateTime
-    > ;
-
-    struct VariantBinRecord
-    {
-        VariantBinRecord()
+        bool isValid() const noexcept
+        {
+            return _valid;
+        }
+
+        explicit operator bool() const noexcept
         {
+            return _valid;
         }
-        DataVariant data;
-        DataTypes   type = DataTypes::None; //It field simplifies the code and is used for quick type checks
+
+        const T& get() const noexcept
+        {
+            return _value;
+        }
+
+    private:
+        T _value{};
+        bool _valid = false;
     };
 
+    /**
+     * @class PBFReader
+     * @brief Reads a PBF image into its own memory.
+     *
+     * After read() the image is not needed any more. The decoded values are kept in one
+     * contiguous array of 16-byte slots, the bytes of all strings and arrays in a single arena and the
+     * key hashes in a flat open addressing index that maps them to the slots.
+     * Images with at most PBF_SCAN_MAX_RECORDS records are searched with a SIMD scan over the
+     * hash column of the slots instead.
+     *
+     * With readLazy() the same containers are used as a cache that is filled on demand.
+     */
     class PBFReader
     {
     public:
@@ -82,797 +123,710 @@ namespace PBF
         {
         }
 
+        /**
+         * @brief Reads all records of an image, replacing the parameters read before.
+         * @param memory Start of the image, the size is taken from the header.
+         * @return false if the image is malformed, contains a key twice or its checksum does not match.
+         */
         bool read(void* memory)
         {
-            VariantBinRecord rec;
-            std::uint32_t hashKey(0U);
-            std::uint32_t done(PBF_FILE_HEADER_SIZE);
-            std::uint32_t reg1(0U);
-            std::uint32_t data32(0U);
-
-            /*Read size*/
-            uint32_t* pMem = static_cast<uint32_t*>(memory);
-            _size = *pMem;
-            pMem++;
-
-            if (_size == 0U)
+            if (memory == nullptr)
             {
+                clear();
                 return false;
             }
+            std::uint32_t size = loadU32(memory);
+            if (getImageByteOrder(memory, PBF_FILE_HEADER_SIZE) == std::endian::native)
+            {
+                return read(memory, size);
+            }
+            return read(memory, pbfByteSwap32(size));
+        }
 
-            std::uint32_t vr = *pMem;
-            pMem++;
-
-            _version = vr >> 16U;
-
-            uint32_t reserved = *pMem;;
-            pMem++;
-
-            while (done < _size)
+        /**
+         * @brief Reads all records of an image of at most size bytes, replacing the parameters read before.
+         *
+         * A corrupted size in the header can not make the reader leave the buffer. If the image
+         * has a Checksum section its CRC32C is verified first. An image of the other byte order
+         * is swapped once in a temporary copy, the lookups then cost the same as on a native image.
+         * @return false if the image is malformed, contains a key twice or its checksum does not match.
+         */
+        bool read(const void* memory, std::size_t size)
+        {
+            clear();
+            if (!readLayer(memory, size))
             {
-                // read the hash
-                hashKey = *pMem;
-                pMem++;
+                clear();
+                return false;
+            }
+            return true;
+        }
 
-                reg1 = *pMem;
-                std::uint8_t utype = static_cast<std::uint8_t>(reg1 >> 24U);
-                rec.type = static_cast<DataTypes>(utype);
-                std::uint16_t data_size = static_cast<std::uint16_t>(reg1 & 0x0000FFFF);
-                pMem++;
-                done += 8U;
-                switch (rec.type)
-                {
-                case DataTypes::String:
-                {                    
+        /**
+         * @brief Opens an image for lazy decoding, replacing the parameters read before.
+         *
+         * Only the header and the section directory are validated. A record is decoded and
+         * cached the first time it is requested, strings are not copied but returned from the
+         * image. The image must stay valid and unchanged as long as the reader uses it.
+         * The time to the first parameter is only independent of the image size if the image has
+         * a PerfectHash or HashIndex section, otherwise a lookup scans the records up to the key.
+         *
+         * Lookups fill the cache, so a lazily opened reader must not be shared between threads
+         * (PBFReaderHandle::publish rejects it). The cache holds at most PBF_LAZY_CACHE_SLOTS
+         * records and is allocated here, without reading the records, so opening does not depend
+         * on the image size and the noexcept lookups never allocate. When it is full, the
+         * records that are not cached are decoded again on every lookup.
+         * The checksum is not verified, as that reads the whole image; call
+         * PBFView::verifyChecksum before if needed.
+         * @return false if the header or the section directory is malformed.
+         */
+        bool readLazy(const void* memory, std::size_t size)
+        {
+            clear();
 
-                    const char* charData = static_cast<const char*>(static_cast<void*>(pMem));
-                    std::size_t str_size = strlen(charData);
-                    if (data_size < str_size)
-                    {
-                        return false;
-                    }
-                    std::string str(charData, str_size);
-                    rec.data = str;
+            if (!_image.open(memory, size))
+            {
+                return false;
+            }
+            _size = _image.size();
+            _version = _image.version();
+            _seed = _image.seed();
 
-                    std::uint16_t size_32 = data_size / (sizeof(std::uint32_t));
-                    pMem += size_32;
+            _cacheSlots = std::min(PBF_LAZY_CACHE_SLOTS, _image.recordCount().value_or(PBF_LAZY_CACHE_SLOTS));
+            _slots.reserve(_cacheSlots + PBF_BATCH_BLOCK_SIZE);
+            _hashes.reserve(_cacheSlots);
+            _index.reserve(_cacheSlots);
+            return true;
+        }
 
-                    done += data_size;
-                    break;
-                }
-#ifdef ENABLE_PBF_8BIT_TYPES
-                case DataTypes::Int8:
-                {
-                    rec.data = readData32<int8_t>(pMem, done);
-                    break;
-                }
-                case DataTypes::UInt8:
-                {
-                    rec.data = readData32<uint8_t>(pMem, done);
-                    break;
-                }
-#endif
+        bool isLazy() const noexcept
+        {
+            return _image.isOpen();
+        }
 
-#ifdef ENABLE_PBF_16BIT_TYPES
-                case DataTypes::Int16:
-                {
-                    rec.data = readData32<int16_t>(pMem, done);
-                    break;
-                }
-                case DataTypes::UInt16:
-                {
-                    rec.data = readData32<uint16_t>(pMem, done);
-                    break;
-                }
-#endif
-                case DataTypes::Int32:
-                {
-                    rec.data = readData32<int32_t>(pMem, done);
-                    break;
-                }
-                case DataTypes::UInt32:
-                {
-                    rec.data = readData32<uint32_t>(pMem, done);
-                    break;
-                }
-                case DataTypes::Int64:
-                {
-                    data32 = *pMem;
-                    pMem++;
-
-                    uint64_t data64 = data32;
-                    data64 = data64 << 32;
-                    data64 = data64 | *pMem;
-                    rec.data = static_cast<int64_t>(data64);
-                    pMem++;
-                    done += 8U;
-                    break;
-                }
-                case DataTypes::UInt64:
-                {
-                    data32 = *pMem;
-                    pMem++;
-
-                    uint64_t data64 = data32;
-                    data64 = data64 << 32;
-                    data64 = data64 | *pMem;
-                    rec.data = data64;
-                    pMem++;
-                    done += 8U;
-                    break;
-                }
-                case DataTypes::Float32:
-                {
-                    rec.data = readData32<float>(pMem, done);
-                    break;
-                }
-                case DataTypes::Float64:
-                {
-                    rec.data = readData64<double>(pMem, done);
-                    break;
-                }
-                case DataTypes::Boolean:
-                {
-                    rec.data = readData32<bool>(pMem, done);
-                    break;
-                }
-                case DataTypes::Date:
-                {                   
-                    data32 = readData32<std::uint32_t>(pMem, done);
-                    
-                    Date date;
-                    date.year = static_cast<std::uint16_t>((data32 & 0xFFFF0000) >> 16U);
-                    date.month = static_cast<std::uint8_t>((data32 & 0xFF00) >> 8U);
-                    date.day = static_cast<std::uint8_t>(data32 & 0xFF);
-                    rec.data = date;
-                    break;
-                }
-                case DataTypes::Time:
-                {
-                    std::uint64_t data64 = readData64<std::uint64_t>(pMem, done);
-                    Time time;
-                    time.hour = static_cast<std::uint8_t>((data64 & 0xFF000000000000) >> 48U);
-                    time.minute = static_cast<std::uint8_t>((data64 & 0x00FF0000000000) >> 40U);
-                    time.second = static_cast<std::uint8_t>((data64 & 0x0000FF00000000) >> 32U);
-                    time.nanosecond = static_cast<std::uint32_t>((data64 & 0xFFFFFFFF));
-                    rec.data = time;
-                    break;
-                }
-                case DataTypes::DateTime:
-                {
-                    DateTime date_time;
-
-                    data32 = readData32<std::uint32_t>(pMem, done);
-                    date_time.date.year = static_cast<std::uint16_t>((data32 & 0xFFFF0000) >> 16U);
-                    date_time.date.month = static_cast<std::uint8_t>((data32 & 0xFF00) >> 8U);
-                    date_time.date.day = static_cast<std::uint8_t>(data32 & 0xFF);
-
-                    std::uint64_t data64 = readData64<std::uint64_t>(pMem, done);                   
-                    date_time.time.hour = static_cast<std::uint8_t>((data64 & 0xFF000000000000) >> 48U);
-                    date_time.time.minute = static_cast<std::uint8_t>((data64 & 0x00FF0000000000) >> 40U);
-                    date_time.time.second = static_cast<std::uint8_t>((data64 & 0x0000FF00000000) >> 32U);
-                    date_time.time.nanosecond = static_cast<std::uint32_t>((data64 & 0xFFFFFFFF));
-
-                    rec.data = date_time;
-                   
-                    break;
-                }
-                default:
+        /*Number of parameters*/
+        std::uint32_t count() const noexcept
+        {
+            if (isLazy() && (_count == 0U))
+            {
+                std::optional<std::uint32_t> records = _image.recordCount();
+                if (records)
                 {
-                    return false;
-                }
+                    _count = records.value();
                 }
-                auto result = _pairs.insert(std::make_pair(hashKey, rec));
-                if (!result.second)
+                else
                 {
-                    return false;
+                    _image.forEachRecord([this](const RecordRef&) { _count++; });
                 }
             }
-            return true;
+            return _count;
         }
 
-
-        PBF::DataTypes getType(const std::string& str_key)
+        /*Hash seed of the keys, 0 if they are hashed with pbfHash*/
+        std::uint16_t seed() const noexcept
         {
-            auto rec = getRecord(str_key);
-            if (!rec)
-            {
-                return DataTypes::None;
-            }
-            VariantBinRecord vr;
-            vr = rec.value();
-            return vr.type;
-        }
-
-        /*template specialization*/
-        template<typename T>
-        std::optional<T> getParam(const std::string& str_key)
-        {
-            // General template, might use static_assert to generate a compile-time error for unsupported types
-            static_assert(std::is_same<T, double>::value ||
-                std::is_same<T, std::string>::value ||
-#ifdef ENABLE_PBF_8BIT_TYPES
-                std::is_same<T, std::uint8_t>::value ||
-                std::is_same<T, std::int8_t>::value ||
-#endif
-#ifdef ENABLE_PBF_16BIT_TYPES
-                std::is_same<T, std::uint16_t>::value ||
-                std::is_same<T, std::int16_t>::value ||
-#endif
-                std::is_same<T, std::int32_t>::value ||
-                std::is_same<T, std::uint32_t>::value ||
-                std::is_same<T, std::uint64_t>::value ||
-                std::is_same<T, std::int64_t>::value ||
-                std::is_same<T, float>::value ||
-                std::is_same<T, bool>::value ||
-                std::is_same<T, PBF::Date>::value ||
-                std::is_same<T, PBF::Time>::value ||
-                std::is_same<T, PBF::DateTime>::value ||
-                std::is_same<T, std::string>::value, "Unsupported type for getParam");
-            return std::nullopt;
-        }
-              
-        // Specialization for std::string
-        template<>
-        std::optional<std::string> getParam<std::string>(const std::string& str_key)
-        {
-            auto rec = getRecord(str_key);
-            if (!rec)
-            {
-                return std::nullopt;
-            }
-            VariantBinRecord vr;
-            vr = rec.value();
-            if (vr.type != DataTypes::String)
-            {
-                return std::nullopt;
-            }
-            return convertVariantToType<std::string>(rec->data);
+            return _seed;
         }
 
-        // Specialization for bool
-        template<>
-        std::optional<bool> getParam<bool>(const std::string& str_key)
+        /*KeyHash of a key in the image that was read, hashed with its seed*/
+        KeyHash key(std::string_view text) const noexcept
         {
-            auto rec = getRecord(str_key);
-            if (!rec)
-            {
-                return std::nullopt;
-            }
-            VariantBinRecord vr;
-            vr = rec.value();
-            if (vr.type != DataTypes::Boolean)
-            {
-                return std::nullopt;
-            }
-            return convertVariantToType<bool>(rec->data);
+            return pbfKey(text, _seed);
         }
 
-        // Specialization for PBF::Date
-        template<>
-        std::optional<PBF::Date> getParam<PBF::Date>(const std::string& str_key)
+        PBF::DataTypes getType(KeyHash key) const noexcept
         {
-            auto rec = getRecord(str_key);
-            if (!rec)
+            const ValueSlot* slot = findSlot(key.value);
+            if (slot == nullptr)
             {
-                return std::nullopt;
-            }
-            VariantBinRecord vr;
-            vr = rec.value();
-            if (vr.type != DataTypes::Date)
-            {
-                return std::nullopt;
+                return DataTypes::None;
             }
-            return convertVariantToType<PBF::Date>(rec->data);
+            return slot->getType();
         }
 
-        // Specialization for PBF::Time
-        template<>
-        std::optional<PBF::Time> getParam<PBF::Time>(const std::string& str_key)
+        /**
+         * @brief Returns the value of a parameter converted to T.
+         *
+         * Integers are converted between all integer types if the value fits, floats and
+         * doubles are converted into each other (range checked) and all other types must match
+         * exactly. Strings can be read as std::string or, without a copy, as std::string_view
+         * into the reader. Only the std::string copy allocates, it is not available with PBF_RT.
+         */
+        template<typename T>
+        std::optional<T> getParam(KeyHash key) const noexcept(!std::is_same<T, std::string>::value)
         {
-            auto rec = getRecord(str_key);
-            if (!rec)
+            const ValueSlot* slot = findSlot(key.value);
+            if (slot == nullptr)
             {
                 return std::nullopt;
             }
-            VariantBinRecord vr;
-            vr = rec.value();
-            if (vr.type != DataTypes::Time)
-            {
-                return std::nullopt;
-            }
-            return convertVariantToType<PBF::Time>(rec->data);
+            return getValue<T>(*slot);
         }
 
-        // Specialization for PBF::DateTime
-        template<>
-        std::optional<PBF::DateTime> getParam<PBF::DateTime>(const std::string& str_key)
+        /**
+         * @brief Returns the elements of an array parameter without copying them.
+         *
+         * The elements are not converted, T must be the element type the array was written
+         * with (see decodeArray). The span points into the reader, or into the image in lazy
+         * mode, and is valid as long as the reader is.
+         */
+        template<typename T>
+        std::optional<std::span<const T>> getArray(KeyHash key) const noexcept
         {
-            auto rec = getRecord(str_key);
-            if (!rec)
+            const ValueSlot* slot = findSlot(key.value);
+            if (slot == nullptr)
             {
                 return std::nullopt;
             }
-            VariantBinRecord vr;
-            vr = rec.value();
-            if (vr.type != DataTypes::DateTime)
-            {
-                return std::nullopt;
-            }
-            return convertVariantToType<PBF::DateTime>(rec->data);
+            return decodeArray<T>(getSlotRecord(*slot, getStringBase()));
         }
 
-
-        // Specialization for float
-        template<>
-        std::optional<float> getParam<float>(const std::string& str_key)
+        /**
+         * @brief Looks up many parameters at once.
+         *
+         * The lookups are done in blocks. For a block the index buckets of all keys are
+         * prefetched first, then the slots they point to, and only then the slots are copied,
+         * so the cache misses of the keys overlap instead of following each other.
+         * @param keys Keys to look up.
+         * @param values Receives the slot of keys[i] at index i, a slot of type None if the key does not exist. Use getValue to read the values.
+         * @return Number of keys found.
+         */
+        std::size_t getParams(std::span<const KeyHash> keys, std::span<ValueSlot> values) const noexcept
         {
-            auto rec = getRecord(str_key);
-            if (!rec)
-            {
-                return std::nullopt;
-            }
-            VariantBinRecord vr;
-            vr = rec.value();
-            if ((vr.type != DataTypes::Float32) && (vr.type != DataTypes::Float64))
-            {
-                return std::nullopt;
-            }
+            const std::size_t count = std::min(keys.size(), values.size());
+            std::uint32_t slotNumbers[PBF_BATCH_BLOCK_SIZE];
+            std::size_t found(0U);
 
-            if (vr.type == DataTypes::Float32)
+            for (std::size_t first = 0U; first < count; first += PBF_BATCH_BLOCK_SIZE)
             {
-                return convertVariantToType<float>(rec->data);
-            }
-            else
-            {
-                const double* dPtr = std::get_if<double>(&vr.data);
-                if (!dPtr)
+                const std::size_t blockSize = std::min<std::size_t>(PBF_BATCH_BLOCK_SIZE, count - first);
+
+                for (std::size_t i = 0U; (i < blockSize) && (_hashes.size() > PBF_SCAN_MAX_RECORDS); i++)
                 {
-                    return std::nullopt;
+                    const void* bucket = _index.homeAddress(keys[first + i].value);
+                    if (bucket != nullptr)
+                    {
+                        pbfPrefetch(bucket);
+                    }
                 }
-                //check range
-
-                double dbl = *dPtr;
-
-                if (dbl == 0.00)
+                for (std::size_t i = 0U; i < blockSize; i++)
                 {
-                    return 0.0f;
+                    slotNumbers[i] = lookupSlotNumber(keys[first + i].value);
+                    if (slotNumbers[i] != FlatHashIndex::NPOS)
+                    {
+                        pbfPrefetch(&_slots[slotNumbers[i]]);
+                    }
                 }
-                // Check if the value is within the range of float
-                if (dbl > static_cast<double>(std::numeric_limits<float>::max()) ||
-                    dbl < static_cast<double>(std::numeric_limits<float>::lowest()))
+                for (std::size_t i = 0U; i < blockSize; i++)
                 {
-                    return std::nullopt; // Out of range for float
+                    if (slotNumbers[i] != FlatHashIndex::NPOS)
+                    {
+                        values[first + i] = _slots[slotNumbers[i]];
+                        found++;
+                    }
+                    else
+                    {
+                        values[first + i] = ValueSlot();
+                    }
                 }
-
-                return static_cast<float>(dbl);
             }
-            return std::nullopt;
+            return found;
         }
 
-        // Specialization for double
-        template<>
-        std::optional<double> getParam<double>(const std::string& str_key)
+        /**
+         * @brief Returns the value of a slot filled by getParams converted to T.
+         *
+         * Conversions are the same as for getParam. String slots refer to the string arena of
+         * this reader.
+         */
+        template<typename T>
+        std::optional<T> getValue(const ValueSlot& slot) const noexcept(!std::is_same<T, std::string>::value)
         {
-            auto rec = getRecord(str_key);
-            if (!rec)
-            {
-                return std::nullopt;
-            }
-            VariantBinRecord vr;
-            vr = rec.value();
-            if ((vr.type != DataTypes::Float32) && (vr.type != DataTypes::Float64))
+            static_assert(std::is_same<T, std::string>::value || isSupportedValueType<T>(), "Unsupported type for getParam");
+#ifdef PBF_RT
+            static_assert(!std::is_same<T, std::string>::value, "getParam<std::string> allocates, use std::string_view with PBF_RT");
+#endif
+            if (slot.getType() == DataTypes::None)
             {
                 return std::nullopt;
             }
 
-            if (vr.type == DataTypes::Float32)
+            if constexpr (std::is_same<T, std::string>::value)
             {
-                std::optional<float> optf = convertVariantToType<float>(rec->data);
-                if (optf == std::nullopt)
+                std::optional<std::string_view> str = decodeValue<std::string_view>(getSlotRecord(slot, getStringBase()));
+                if (!str)
                 {
                     return std::nullopt;
                 }
-                return static_cast<double>(optf.value());
+                return std::string(str.value());
             }
             else
             {
-                return convertVariantToType<double>(rec->data);
+                return decodeValue<T>(getSlotRecord(slot, getStringBase()));
             }
-
-            return std::nullopt;
         }
 
-        // Specialization for std::int32_t
-        template<>
-        std::optional<std::int32_t> getParam<std::int32_t>(const std::string& str_key)
+        /**
+         * @brief Calls visitor(KeyHash key, const ValueSlot& value) for every parameter below a table.
+         *
+         * Needs the Hierarchy section (converter option --hierarchy). The work is proportional
+         * to the size of the subtree, not to the number of parameters. Use getValue to read the
+         * values.
+         * @param prefix Key of the table, e.g. "Plant.Motors[0]", or "" for all parameters.
+         * @return Number of parameters visited.
+         */
+        template<typename Visitor>
+        std::uint32_t forEachUnder(KeyHash prefix, Visitor&& visitor) const
         {
-            auto rec = getRecord(str_key);
-            if (!rec)
+            std::uint32_t visited(0U);
+            getHierarchy().forEachParameterUnder(prefix.value, [this, &visitor, &visited](std::uint32_t hash)
             {
-                return std::nullopt;
-            }
-            VariantBinRecord vr;
-            vr = rec.value();
-
-            switch (vr.type)
-            {
-            case DataTypes::Int32:
-            {
-                return convertVariantToType<std::int32_t>(rec->data);
-            }
-            case DataTypes::UInt32:
-            {
-                const std::uint32_t* ui32Ptr = std::get_if<std::uint32_t>(&vr.data);
-                std::uint32_t val = *ui32Ptr;
-
-                if (abs((long)val) > static_cast<int32_t>(INT32_MAX))
+                const ValueSlot* slot = findSlot(hash);
+                if (slot != nullptr)
                 {
-                    return std::nullopt;
+                    visitor(KeyHash(hash), *slot);
+                    visited++;
                 }
-                return static_cast<int32_t>(val);
-            }
-            case DataTypes::UInt64:
-            {
-                const std::uint64_t* ui64Ptr = std::get_if<std::uint64_t>(&vr.data);
-                std::uint64_t val = *ui64Ptr;
+            });
+            return visited;
+        }
 
-                if (abs((long)val) > static_cast<int32_t>(INT32_MAX))
-                {
-                    return std::nullopt;
-                }
-                return static_cast<int32_t>(val);
-            }
-            case DataTypes::Int64:
-            {
-                const std::int64_t* ui64Ptr = std::get_if<std::int64_t>(&vr.data);
-                std::int64_t val = *ui64Ptr;
+        /*Number of direct children (tables and parameters) of a table, needs the Hierarchy section*/
+        std::uint32_t childCount(KeyHash prefix) const noexcept
+        {
+            return getHierarchy().childCount(prefix.value);
+        }
 
-                if (abs((long)val) > static_cast<int32_t>(INT32_MAX))
-                {
-                    return std::nullopt;
-                }
-                return static_cast<int32_t>(val);
-            }
-#ifdef ENABLE_PBF_8BIT_TYPES
-            case DataTypes::Int8:
-            {
-                const std::int8_t* i8Ptr = std::get_if<std::int8_t>(&vr.data);
-                return static_cast<int32_t>(*i8Ptr);
-            }
-            case DataTypes::UInt8:
+        bool hasHierarchy() const noexcept
+        {
+            return getHierarchy().isOpen();
+        }
+
+        /**
+         * @brief Loads the KeyNames section of an image for getKeyName.
+         *
+         * read() does not keep the names, so they take no memory unless they are needed, e.g.
+         * when an error is reported. In lazy mode the names are used from the image and this
+         * is not needed. The image should be the one the parameters were read from.
+         * @return false if the image is malformed or has no KeyNames section.
+         */
+        bool readKeyNames(const void* memory)
+        {
+            _keyNameData.clear();
+            if (memory == nullptr)
             {
-                const std::uint8_t* ui8Ptr = std::get_if<std::uint8_t>(&vr.data);
-                return static_cast<int32_t>(*ui8Ptr);
+                return false;
             }
-#endif
-#ifdef ENABLE_PBF_16BIT_TYPES
-            case DataTypes::int16:
+            std::size_t size = loadU32(memory);
+            std::vector<std::uint32_t> swapped;
+            if (getImageByteOrder(memory, PBF_FILE_HEADER_SIZE) != std::endian::native)
             {
-                const std::int16_t* i16Ptr = std::get_if<std::int16_t>(&vr.data);
-                return static_cast<int32_t>(*i16Ptr);
+                size = pbfByteSwap32(static_cast<std::uint32_t>(size));
             }
-            case DataTypes::Uint16:
+            if (!toNativeByteOrder(memory, size, swapped))
             {
-                const std::uint16_t* ui16Ptr = std::get_if<std::uint16_t>(&vr.data);
-                return static_cast<int32_t>(*ui16Ptr);
+                return false;
             }
-#endif
-            default:
+            PBFView view(memory, size);
+            if (!view.getKeyNames().isOpen())
             {
-                return std::nullopt;
-            }
+                return false;
             }
-            return std::nullopt;
+            const SectionRef& section = view.getKeyNames().section();
+            _keyNameData.resize((section.size + sizeof(std::uint32_t) - 1U) / sizeof(std::uint32_t));
+            std::memcpy(_keyNameData.data(), section.data, section.size);
+            return true;
         }
 
-        // Specialization for std::int64_t
-        template<>
-        std::optional<std::int64_t> getParam<std::int64_t>(const std::string& str_key)
+        /**
+         * @brief Maps a key hash back to the name of the key, for diagnostics.
+         *
+         * Needs the KeyNames section (converter option --key-names), see readKeyNames.
+         * @return The name in buffer (not terminated), std::nullopt if it is unknown or does not fit.
+         */
+        std::optional<std::string_view> getKeyName(KeyHash key, std::span<char> buffer) const noexcept
         {
-            auto rec = getRecord(str_key);
-            if (!rec)
-            {
-                return std::nullopt;
-            }
-            VariantBinRecord vr;
-            vr = rec.value();
+            return getKeyNames().getName(key.value, buffer);
+        }
 
-            switch (vr.type)
-            {
-            case DataTypes::Int32:
-            {
-                const std::int32_t* i32Ptr = std::get_if<std::int32_t>(&vr.data);
-                return static_cast<int64_t>(*i32Ptr);
-            }
-            case DataTypes::UInt32:
-            {
-                const std::uint32_t* ui32Ptr = std::get_if<std::uint32_t>(&vr.data);
-                std::uint32_t val = *ui32Ptr;
-                return static_cast<int64_t>(val);
-            }
-            case DataTypes::UInt64:
-            {
-                const std::uint64_t* ui64Ptr = std::get_if<std::uint64_t>(&vr.data);
-                std::uint64_t val = *ui64Ptr;
+        /**
+         * @brief Fills a struct from the parameters of a table.
+         *
+         * The fields of S are described by a specialization of Binding<S>; the key of a field
+         * is prefix + "." + its name. The hash of the prefix is only continued with the field
+         * names, so the keys are never built as strings, and all fields are looked up together
+         * with getParams. Fields that do not exist or can not be converted keep their value.
+         * @param prefix Key of the table, e.g. "Plant.Motors[0]".
+         * @return Number of fields set.
+         */
+        template<typename S>
+        std::size_t bind(KeyHash prefix, S& object) const noexcept(!isBindingAllocating<S>())
+        {
+            constexpr std::size_t count = std::tuple_size<std::decay_t<decltype(Binding<S>::fields)>>::value;
+            std::array<KeyHash, count> keys;
+            std::array<ValueSlot, count> values;
 
-                if (abs((long)val) > static_cast<int64_t>(INT64_MAX))
-                {
-                    return std::nullopt;
-                }
-                return static_cast<int64_t>(val);
-            }
-            case DataTypes::Int64:
+            const std::uint32_t table = pbfHashContinue(prefix.value, ".");
+            std::size_t i(0U);
+            std::apply([&keys, &i, table](const auto&... field)
             {
-                const std::int64_t* i64Ptr = std::get_if<std::int64_t>(&vr.data);
-                return static_cast<int64_t>(*i64Ptr);
-            }
-#ifdef ENABLE_PBF_8BIT_TYPES
-            case DataTypes::Int8:
-            {
-                const std::int8_t* i8Ptr = std::get_if<std::int8_t>(&vr.data);
-                return static_cast<int64_t>(*i8Ptr);
-            }
-            case DataTypes::UInt8:
-            {
-                const std::uint8_t* ui8Ptr = std::get_if<std::uint8_t>(&vr.data);
-                return static_cast<int64_t>(*ui8Ptr);
-            }
-#endif
-#ifdef ENABLE_PBF_16BIT_TYPES
-            case DataTypes::int16:
-            {
-                const std::int16_t* i16Ptr = std::get_if<std::int16_t>(&vr.data);
-                return static_cast<int64_t>(*i16Ptr);
-            }
-            case DataTypes::Uint16:
-            {
-                const std::uint16_t* ui16Ptr = std::get_if<std::uint16_t>(&vr.data);
-                return static_cast<int64_t>(*ui16Ptr);
-            }
-#endif
-            default:
+                ((keys[i++] = KeyHash(pbfHashContinue(table, field.name))), ...);
+            }, Binding<S>::fields);
+
+            getParams(keys, values);
+
+            std::size_t bound(0U);
+            i = 0U;
+            std::apply([this, &object, &values, &i, &bound](const auto&... field)
             {
-                return std::nullopt;
-            }
-            }
-            return std::nullopt;
+                (setField(object, field, values[i++], bound), ...);
+            }, Binding<S>::fields);
+            return bound;
         }
 
-        // Specialization for std::uint32_t
-        template<>
-        std::optional<std::uint32_t> getParam<std::uint32_t>(const std::string& str_key)
+        /**
+         * @brief Resolves a parameter once for repeated access.
+         *
+         * Supports the same types as getParam, strings are resolved as std::string_view.
+         * @return Invalid handle if the parameter does not exist or can not be converted to T.
+         */
+        template<typename T>
+        ParamHandle<T> resolve(KeyHash key) const noexcept
         {
-            auto rec = getRecord(str_key);
-            if (!rec)
+            static_assert(!std::is_same<T, std::string>::value, "Resolve strings as std::string_view");
+
+            std::optional<T> value = getParam<T>(key);
+            if (!value)
             {
-                return std::nullopt;
+                return ParamHandle<T>();
             }
-            VariantBinRecord vr;
-            vr = rec.value();
+            return ParamHandle<T>(value.value());
+        }
 
-            switch (vr.type)
-            {
-            case DataTypes::UInt32:
+    protected:
+
+        void clear()
+        {
+            _size = 0U;
+            _version = 0U;
+            _seed = 0U;
+            _count = 0U;
+            _hashes.clear();
+            _slots.clear();
+            _strings.clear();
+            _index.clear();
+            _cacheSlots = 0U;
+            _uncached = 0U;
+            _image.close();
+            _hierarchyData.clear();
+            _keyNameData.clear();
+        }
+
+        /**
+         * @brief Reads the records of an image on top of the parameters read before.
+         *
+         * A record of a key that an earlier image has replaces its value, the image shadows the
+         * earlier ones. The seed and the hierarchy are those of the first image, later images
+         * must have the same seed.
+         * @return false if the image is malformed, contains a key twice, its checksum does not
+         * match or it has another seed. The parameters are incomplete then.
+         */
+        bool readLayer(const void* memory, std::size_t size)
+        {
+            std::vector<std::uint32_t> swapped;
+            if (!toNativeByteOrder(memory, size, swapped))
             {
-                return convertVariantToType<std::uint32_t>(rec->data);
+                return false;
             }
-            case DataTypes::Int32:
+            PBFView view(memory, size);
+            const bool first = (_size == 0U);
+            if (!view.isOpen() || (view.hasChecksum() && !view.verifyChecksum()) || (!first && (view.seed() != _seed)))
             {
-                const std::int32_t* i32Ptr = std::get_if<std::int32_t>(&vr.data);
-                std::int32_t val = *i32Ptr;
+                return false;
+            }
 
-                if (val < 0)
+            /*first pass only counts the records and the string sizes to allocate everything once*/
+            const SectionRef& pool = view.getStringPool();
+            std::size_t stringBytes(pool.size);
+            std::size_t records(0U);
+            bool valid = view.forEachRecord([&records, &stringBytes, &pool](const RecordRef& rec)
+            {
+                records++;
+                if ((rec.type == DataTypes::String) && !isPooled(rec, pool))
                 {
-                    return std::nullopt;
+                    stringBytes += rec.data_size;
                 }
-                return static_cast<uint32_t>(val);
-            }
-            case DataTypes::UInt64:
-            {
-                const std::uint64_t* ui64Ptr = std::get_if<std::uint64_t>(&vr.data);
-                std::uint64_t val = *ui64Ptr;
-
-                if (abs((long)val) > static_cast<uint32_t>(UINT32_MAX))
+                else if (rec.type == DataTypes::Array)
                 {
-                    return std::nullopt;
+                    stringBytes += rec.data_size + sizeof(std::uint64_t); /*alignment of the elements*/
                 }
-                return static_cast<uint32_t>(val);
+            });
+            if (!valid)
+            {
+                return false;
             }
-            case DataTypes::Int64:
+
+            _slots.reserve(_slots.size() + records);
+            _hashes.reserve(_hashes.size() + records);
+            _strings.reserve(_strings.size() + stringBytes);
+            _index.reserve(static_cast<std::uint32_t>(_slots.size() + records));
+
+            /*pooled strings are kept once, in front of the other strings of the image*/
+            const std::uint32_t poolOffset = static_cast<std::uint32_t>(_strings.size());
+            _strings.insert(_strings.end(), pool.data, pool.data + pool.size);
+
+            /*slots of earlier images that this one has replaced, to find keys it has twice*/
+            const std::uint32_t firstSlot = static_cast<std::uint32_t>(_slots.size());
+            std::vector<bool> shadowed(firstSlot, false);
+            view.forEachRecord([this, &valid, &pool, poolOffset, firstSlot, &shadowed](const RecordRef& rec)
             {
-                const std::int64_t* ui64Ptr = std::get_if<std::int64_t>(&vr.data);
-                std::int64_t val = *ui64Ptr;
-                if (val < 0)
+                std::uint32_t slotNumber = static_cast<std::uint32_t>(_slots.size());
+                if (!valid)
                 {
-                    return std::nullopt;
+                    return;
                 }
-
-                if (abs((long)val) > static_cast<uint32_t>(UINT32_MAX))
+                if (_index.insert(rec.hash, slotNumber))
                 {
-                    return std::nullopt;
+                    _hashes.push_back(rec.hash);
+                    _slots.push_back(makeSlot(rec, pool, poolOffset));
+                    return;
                 }
-                return static_cast<uint32_t>(val);
-            }
-#ifdef ENABLE_PBF_8BIT_TYPES
-            case DataTypes::Int8:
-            {
-                const std::int8_t* i8Ptr = std::get_if<std::int8_t>(&vr.data);
-                std::int8_t val = *i8Ptr;
-                if (val < 0)
+                slotNumber = _index.find(rec.hash);
+                if ((slotNumber >= firstSlot) || shadowed[slotNumber])
                 {
-                    return std::nullopt;
+                    valid = false;
+                    return;
                 }
-                return static_cast<uint32_t>(val);
-            }
-            case DataTypes::UInt8:
-            {
-                const std::uint8_t* ui8Ptr = std::get_if<std::uint8_t>(&vr.data);
-                return static_cast<uint32_t>(*ui8Ptr);
-            }
-#endif
-#ifdef ENABLE_PBF_16BIT_TYPES
-            case DataTypes::int16:
+                shadowed[slotNumber] = true;
+                _slots[slotNumber] = makeSlot(rec, pool, poolOffset);
+            });
+            if (!valid)
             {
-                const std::int16_t* i16Ptr = std::get_if<std::int16_t>(&vr.data);
-                std::int16_t val = *i16Ptr;
-                if (val < 0)
-                {
-                    return std::nullopt;
-                }
-                return static_cast<uint32_t>(*i16Ptr);
+                return false;
             }
-            case DataTypes::Uint16:
+
+            /*the hierarchy is kept as it is, it is only walked*/
+            if (first && view.getHierarchy().isOpen())
             {
-                const std::uint16_t* ui16Ptr = std::get_if<std::uint16_t>(&vr.data);
-                return static_cast<uint32_t>(*ui16Ptr);
+                const SectionRef& section = view.getHierarchy().section();
+                _hierarchyData.resize((section.size + sizeof(std::uint32_t) - 1U) / sizeof(std::uint32_t));
+                std::memcpy(_hierarchyData.data(), section.data, section.size);
             }
-#endif
-            default:
+
+            if (first)
             {
-                return std::nullopt;
-            }
+                _version = view.version();
+                _seed = view.seed();
             }
-            return std::nullopt;
+            _size += view.size();
+            _count = static_cast<std::uint32_t>(_slots.size());
+            return true;
         }
 
-        // Specialization for std::uint64_t
-        template<>
-        std::optional<std::uint64_t> getParam<std::uint64_t>(const std::string& str_key)
+    private:
+
+        template<typename S, typename T>
+        void setField(S& object, const FieldBinding<S, T>& field, const ValueSlot& slot, std::size_t& bound) const noexcept(!std::is_same<T, std::string>::value)
         {
-            auto rec = getRecord(str_key);
-            if (!rec)
+            std::optional<T> value = getValue<T>(slot);
+            if (value)
             {
-                return std::nullopt;
+                object.*(field.member) = std::move(value.value());
+                bound++;
             }
-            VariantBinRecord vr;
-            vr = rec.value();
+        }
 
-            switch (vr.type)
-            {
-            case DataTypes::UInt32:
+        /*An image of the other byte order is copied to copy and swapped there in one pass, memory and size then refer to the copy*/
+        static bool toNativeByteOrder(const void*& memory, std::size_t& size, std::vector<std::uint32_t>& copy)
+        {
+            std::optional<std::endian> order = getImageByteOrder(memory, size);
+            if (!order)
             {
-                const std::uint32_t* ui32Ptr = std::get_if<std::uint32_t>(&vr.data);
-                return static_cast<uint64_t> (*ui32Ptr);
+                return false;
             }
-            case DataTypes::Int32:
+            if (order.value() == std::endian::native)
             {
-                const std::int32_t* i32Ptr = std::get_if<std::int32_t>(&vr.data);
-                std::int32_t val = *i32Ptr;
-
-                if (val < 0)
-                {
-                    return std::nullopt;
-                }
-                return static_cast<uint64_t>(val);
+                return true;
             }
-            case DataTypes::Int64:
+            std::size_t imageSize = std::min<std::size_t>(size, pbfByteSwap32(loadU32(memory)));
+            copy.resize((imageSize + sizeof(std::uint32_t) - 1U) / sizeof(std::uint32_t));
+            std::memcpy(copy.data(), memory, imageSize);
+            if (!swapByteOrder(copy.data(), imageSize))
             {
-                const std::int64_t* i64Ptr = std::get_if<std::int64_t>(&vr.data);
-                std::int64_t val = *i64Ptr;
+                return false;
+            }
+            memory = copy.data();
+            size = imageSize;
+            return true;
+        }
 
-                if (abs((long)val) > static_cast<uint64_t>(UINT64_MAX))
-                {
-                    return std::nullopt;
-                }
-                return static_cast<uint64_t>(val);
+        /*Hierarchy section of the image in lazy mode, otherwise the copy of it*/
+        HierarchyIndex getHierarchy() const noexcept
+        {
+            if (isLazy())
+            {
+                return _image.getHierarchy();
             }
-            case DataTypes::UInt64:
+            HierarchyIndex hierarchy;
+            if (!_hierarchyData.empty())
             {
-                return convertVariantToType<std::uint64_t>(rec->data);
+                SectionRef section;
+                section.type = SectionTypes::Hierarchy;
+                section.size = static_cast<std::uint32_t>(_hierarchyData.size() * sizeof(std::uint32_t));
+                section.data = static_cast<const std::uint8_t*>(static_cast<const void*>(_hierarchyData.data()));
+                hierarchy.open(section);
             }
-#ifdef ENABLE_PBF_8BIT_TYPES
-            case DataTypes::Int8:
+            return hierarchy;
+        }
+
+        /*KeyNames section of the image in lazy mode, otherwise the copy loaded by readKeyNames*/
+        KeyNameIndex getKeyNames() const noexcept
+        {
+            if (isLazy())
             {
-                const std::int8_t* i8Ptr = std::get_if<std::int8_t>(&vr.data);
-                std::int8_t val = *i8Ptr;
-                if (val < 0)
-                {
-                    return std::nullopt;
-                }
-                return static_cast<uint64_t>(val);
+                return _image.getKeyNames();
             }
-            case DataTypes::UInt8:
+            KeyNameIndex keyNames;
+            if (!_keyNameData.empty())
             {
-                const std::uint8_t* ui8Ptr = std::get_if<std::uint8_t>(&vr.data);
-                return static_cast<uint64_t>(*ui8Ptr);
+                SectionRef section;
+                section.type = SectionTypes::KeyNames;
+                section.size = static_cast<std::uint32_t>(_keyNameData.size() * sizeof(std::uint32_t));
+                section.data = static_cast<const std::uint8_t*>(static_cast<const void*>(_keyNameData.data()));
+                keyNames.open(section);
             }
-#endif
-#ifdef ENABLE_PBF_16BIT_TYPES
-            case DataTypes::int16:
+            return keyNames;
+        }
+
+        /*Strings and arrays of slots are stored in the arena, or in the image in lazy mode*/
+        const char* getStringBase() const noexcept
+        {
+            return isLazy() ? static_cast<const char*>(static_cast<const void*>(_image.image().data())) : _strings.data();
+        }
+
+        /*Slot number of a hash, decodes the record first in lazy mode*/
+        std::uint32_t lookupSlotNumber(std::uint32_t hash) const noexcept
+        {
+            std::uint32_t slotNumber = findSlotNumber(hash);
+            if ((slotNumber == FlatHashIndex::NPOS) && isLazy())
             {
-                const std::int16_t* i16Ptr = std::get_if<std::int16_t>(&vr.data);
-                std::int16_t val = *i16Ptr;
-                if (val < 0)
+                std::optional<RecordRef> rec = _image.findRecord(hash);
+                if (rec && (_hashes.size() < _cacheSlots))
                 {
-                    return std::nullopt;
+                    slotNumber = static_cast<std::uint32_t>(_slots.size());
+                    _slots.push_back(makeSlot(rec.value()));
+                    _hashes.push_back(hash);
+                    _index.insert(hash, slotNumber);
+                }
+                else if (rec)
+                {
+                    /*cache full: scratch slots behind the cached ones, one block of getParams fits*/
+                    _slots.resize(_cacheSlots + PBF_BATCH_BLOCK_SIZE);
+                    slotNumber = _cacheSlots + (_uncached++ % PBF_BATCH_BLOCK_SIZE);
+                    _slots[slotNumber] = makeSlot(rec.value());
                 }
-                return static_cast<uint64_t>(*i16Ptr);
-            }
-            case DataTypes::Uint16:
-            {
-                const std::uint16_t* ui16Ptr = std::get_if<std::uint16_t>(&vr.data);
-                return static_cast<uint64_t>(*ui16Ptr);
-            }
-#endif
-            default:
-            {
-                return std::nullopt;
-            }
             }
-            return std::nullopt;
+            return slotNumber;
         }
 
-    private:
-
-        std::optional<VariantBinRecord> getRecord(const std::string& str_key)
+        /*Small images are scanned, the hash column fits into a few cache lines*/
+        std::uint32_t findSlotNumber(std::uint32_t hash) const noexcept
         {
-            std::string_view strView(str_key);
-            std::uint32_t key = pbfHash(strView);
-            auto it = _pairs.find(key);
-            if (it == _pairs.end())
+            const std::uint32_t count = static_cast<std::uint32_t>(_hashes.size());
+            if (count <= PBF_SCAN_MAX_RECORDS)
             {
-                return std::nullopt;
+                std::uint32_t slotNumber = findHash(_hashes.data(), count, hash);
+                return (slotNumber < count) ? slotNumber : FlatHashIndex::NPOS;
             }
-            return it->second;
+            return _index.find(hash);
         }
 
-        template<typename T>
-        std::optional<T> convertVariantToType(const DataVariant& variantData)
+        const ValueSlot* findSlot(std::uint32_t hash) const noexcept
         {
-            if (auto ptr = std::get_if<T>(&variantData))
+            std::uint32_t slotNumber = lookupSlotNumber(hash);
+            if (slotNumber == FlatHashIndex::NPOS)
             {
-                return *ptr;
+                return nullptr;
             }
-            return std::nullopt;
+            return &_slots[slotNumber];
         }
 
-        template<typename T>
-        T readData32(std::uint32_t*& pMem, std::uint32_t& done)
+        /*true if the string of the record is in the StringPool section*/
+        static bool isPooled(const RecordRef& rec, const SectionRef& pool) noexcept
         {
-            // Generic implementation for simple types like 32 bit integers and floats
-            T data;
-            std::memcpy(&data, pMem, sizeof(T));
-            pMem++;
-            done += sizeof(std::uint32_t);
-            return data;
+            return (pool.size != 0U) && (rec.data >= pool.data) && (rec.data < pool.data + pool.size);
         }
 
-        template<typename T>
-        T readData64(std::uint32_t*& pMem, std::uint32_t& done)
+        /*pool: StringPool section of the image, copied to the arena at poolOffset by read()*/
+        ValueSlot makeSlot(const RecordRef& rec, const SectionRef& pool = SectionRef(), std::uint32_t poolOffset = 0U) const
         {
-            // Generic implementation for simple types like 64 bit integers and double
-            T data;
-            std::memcpy(&data, pMem, sizeof(T));
-            pMem++;
-            pMem++;
-            done += sizeof(std::uint64_t);
-            return data;
+            ValueSlot slot;
+            slot.type = static_cast<std::uint8_t>(rec.type);
+            if (rec.type == DataTypes::String)
+            {
+                std::optional<std::string_view> str = decodeValue<std::string_view>(rec);
+                std::uint32_t offset(0U);
+                std::uint32_t length = static_cast<std::uint32_t>(str->size());
+                if (isLazy())
+                {
+                    offset = static_cast<std::uint32_t>(str->data() - getStringBase());
+                }
+                else if (isPooled(rec, pool))
+                {
+                    offset = poolOffset + static_cast<std::uint32_t>(rec.data - pool.data);
+                }
+                else
+                {
+                    offset = static_cast<std::uint32_t>(_strings.size());
+                    _strings.insert(_strings.end(), str->begin(), str->end());
+                    _strings.push_back('\0');
+                }
+                std::memcpy(slot.data, &offset, sizeof(std::uint32_t));
+                std::memcpy(slot.data + sizeof(std::uint32_t), &length, sizeof(std::uint32_t));
+            }
+            else if (rec.type == DataTypes::Array)
+            {
+                std::uint32_t offset(0U);
+                if (isLazy())
+                {
+                    offset = static_cast<std::uint32_t>(static_cast<const char*>(static_cast<const void*>(rec.data)) - getStringBase());
+                }
+                else
+                {
+                    /*the arena is allocated with the alignment of new, align the elements relative to its start*/
+                    std::uint32_t elementsOffset = loadU32(rec.data) & 0x00FFFFFF;
+                    while (((_strings.size() + elementsOffset) % sizeof(std::uint64_t)) != 0U)
+                    {
+                        _strings.push_back('\0');
+                    }
+                    offset = static_cast<std::uint32_t>(_strings.size());
+                    _strings.insert(_strings.end(), rec.data, rec.data + rec.data_size);
+                }
+                std::memcpy(slot.data, &offset, sizeof(std::uint32_t));
+                std::memcpy(slot.data + sizeof(std::uint32_t), &rec.data_size, sizeof(std::uint32_t));
+            }
+            else
+            {
+                std::memcpy(slot.data, rec.data, std::min<std::size_t>(rec.data_size, sizeof(slot.data)));
+            }
+            return slot;
         }
 
         std::uint32_t _size = 0U;
         std::uint16_t _version = 0U;
-        std::map<std::uint32_t, VariantBinRecord> _pairs;
+        std::uint16_t _seed = 0U;
+        PBFView _image; /*image of a lazily opened reader*/
+        std::vector<std::uint32_t> _hierarchyData; /*copy of the Hierarchy section*/
+        std::vector<std::uint32_t> _keyNameData; /*copy of the KeyNames section, see readKeyNames*/
+
+        /*mutable: in lazy mode lookups fill them as a cache*/
+        mutable std::uint32_t _count = 0U;
+        mutable std::vector<std::uint32_t> _hashes; /*key hash of every slot*/
+        mutable std::vector<ValueSlot> _slots;
+        mutable std::vector<char> _strings; /*arena of the strings and arrays*/
+        mutable FlatHashIndex _index; /*key hash -> slot*/
+        std::uint32_t _cacheSlots = 0U; /*records cached in lazy mode*/
+        mutable std::uint32_t _uncached = 0U; /*lookups of records that did not fit into the cache*/
     };
 }
 
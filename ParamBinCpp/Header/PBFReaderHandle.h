@@ -0,0 +1,293 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "PBFReader.h"
+
+namespace PBF
+{
+    /*Default number of reader threads a PBFReaderHandle supports*/
+    const std::uint32_t PBF_MAX_READERS = 64U;
+
+    /**
+     * @class PBFReaderHandle
+     * @brief Publishes immutable PBFReader snapshots for hot reloading.
+     *
+     * A reload builds a complete new reader and publishes it with one atomic pointer exchange,
+     * readers keep working on the snapshot they have pinned. Old snapshots are reclaimed
+     * epoch based: every reader thread owns a slot (attach) in which it announces the global
+     * epoch while it holds a snapshot. A retired snapshot is deleted once no slot announces
+     * the epoch it was retired in or an older one.
+     *
+     * pin() and unpinning are wait-free and never take a lock, load() and collect() only
+     * synchronize with each other. Snapshots are deleted by load() and collect(), so a
+     * snapshot that was in use during a reload is freed by the next reload or collect() after
+     * the last reader dropped it.
+     */
+    class PBFReaderHandle
+    {
+    private:
+
+        struct alignas(64) ReaderSlot
+        {
+            std::atomic<std::uint64_t> epoch{ 0U }; /*0 = no snapshot pinned*/
+            std::atomic<bool> used{ false };
+        };
+
+    public:
+
+        /**
+         * @class Snapshot
+         * @brief A pinned reader, valid until the Snapshot is destroyed or reset.
+         */
+        class Snapshot
+        {
+        public:
+
+            Snapshot() = default;
+
+            Snapshot(const Snapshot&) = delete;
+            Snapshot& operator=(const Snapshot&) = delete;
+
+            Snapshot(Snapshot&& other) noexcept : _reader(other._reader), _slot(other._slot)
+            {
+                other._reader = nullptr;
+                other._slot = nullptr;
+            }
+
+            Snapshot& operator=(Snapshot&& other) noexcept
+            {
+                if (this != &other)
+                {
+                    reset();
+                    _reader = std::exchange(other._reader, nullptr);
+                    _slot = std::exchange(other._slot, nullptr);
+                }
+                return *this;
+            }
+
+            ~Snapshot()
+            {
+                reset();
+            }
+
+            /*Unpins the snapshot*/
+            void reset() noexcept
+            {
+                if (_slot != nullptr)
+                {
+                    _slot->epoch.store(0U, std::memory_order_release);
+                }
+                _reader = nullptr;
+                _slot = nullptr;
+            }
+
+            explicit operator bool() const noexcept
+            {
+                return (_reader != nullptr);
+            }
+
+            const PBFReader* get() const noexcept
+            {
+                return _reader;
+            }
+
+            const PBFReader* operator->() const noexcept
+            {
+                return _reader;
+            }
+
+            const PBFReader& operator*() const noexcept
+            {
+                return *_reader;
+            }
+
+        private:
+
+            friend class PBFReaderHandle;
+
+            Snapshot(const PBFReader* reader, ReaderSlot* slot) noexcept : _reader(reader), _slot(slot)
+            {
+            }
+
+            const PBFReader* _reader = nullptr;
+            ReaderSlot* _slot = nullptr;
+        };
+
+        explicit PBFReaderHandle(std::uint32_t maxReaders = PBF_MAX_READERS) : _slots(std::make_unique<ReaderSlot[]>(maxReaders)), _maxReaders(maxReaders)
+        {
+        }
+
+        PBFReaderHandle(const PBFReaderHandle&) = delete;
+        PBFReaderHandle& operator=(const PBFReaderHandle&) = delete;
+
+        /*All snapshots must have been released*/
+        ~PBFReaderHandle()
+        {
+            delete _current.load();
+        }
+
+        /**
+         * @brief Reserves a reader slot for the calling thread.
+         * @return Reader id for pin() or -1 if all slots are taken.
+         */
+        std::int32_t attach() noexcept
+        {
+            for (std::uint32_t i = 0U; i < _maxReaders; i++)
+            {
+                bool expected = false;
+                if (_slots[i].used.compare_exchange_strong(expected, true))
+                {
+                    return static_cast<std::int32_t>(i);
+                }
+            }
+            return -1;
+        }
+
+        /*Releases a reader slot, the reader must not hold a snapshot*/
+        void detach(std::int32_t readerId) noexcept
+        {
+            if ((readerId >= 0) && (static_cast<std::uint32_t>(readerId) < _maxReaders))
+            {
+                _slots[readerId].epoch.store(0U);
+                _slots[readerId].used.store(false);
+            }
+        }
+
+        /**
+         * @brief Pins the current snapshot, wait-free.
+         *
+         * A reader id holds at most one snapshot at a time.
+         * @return Empty snapshot if nothing has been loaded yet or the reader id is invalid.
+         */
+        Snapshot pin(std::int32_t readerId) const noexcept
+        {
+            if ((readerId < 0) || (static_cast<std::uint32_t>(readerId) >= _maxReaders))
+            {
+                return Snapshot();
+            }
+            ReaderSlot* slot = &_slots[readerId];
+            /*announce the epoch before loading the pointer, the writer checks it before deleting*/
+            slot->epoch.store(_epoch.load());
+            const PBFReader* reader = _current.load();
+            if (reader == nullptr)
+            {
+                slot->epoch.store(0U, std::memory_order_release);
+                return Snapshot();
+            }
+            return Snapshot(reader, slot);
+        }
+
+        /**
+         * @brief Reads an image into a new snapshot and publishes it.
+         *
+         * The image is copied by the reader and can be released after the call.
+         * @return false if the image can not be read, the current snapshot stays.
+         */
+        bool load(void* memory)
+        {
+            std::unique_ptr<PBFReader> reader = std::make_unique<PBFReader>();
+            if (!reader->read(memory))
+            {
+                return false;
+            }
+            return publish(std::move(reader));
+        }
+
+        /**
+         * @brief Publishes a snapshot and retires the previous one.
+         * @return false for a reader opened with readLazy(), its lookups fill a cache and can not be
+         *         shared between threads. The current snapshot stays.
+         */
+        bool publish(std::unique_ptr<const PBFReader> reader)
+        {
+            if ((reader == nullptr) || reader->isLazy())
+            {
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(_writerMutex);
+
+            const PBFReader* old = _current.exchange(reader.release());
+            /*readers that announce the new epoch can only see the new snapshot*/
+            std::uint64_t retiredIn = _epoch.fetch_add(1U);
+            if (old != nullptr)
+            {
+                _retired.push_back(std::make_pair(retiredIn, std::unique_ptr<const PBFReader>(old)));
+            }
+            collectLocked();
+            return true;
+        }
+
+        /**
+         * @brief Deletes the retired snapshots no reader can hold any more.
+         * @return Number of snapshots still waiting for readers.
+         */
+        std::size_t collect()
+        {
+            std::lock_guard<std::mutex> lock(_writerMutex);
+            return collectLocked();
+        }
+
+    private:
+
+        std::size_t collectLocked()
+        {
+            std::uint64_t oldestPinned = UINT64_MAX;
+            for (std::uint32_t i = 0U; i < _maxReaders; i++)
+            {
+                std::uint64_t epoch = _slots[i].epoch.load();
+                if ((epoch != 0U) && (epoch < oldestPinned))
+                {
+                    oldestPinned = epoch;
+                }
+            }
+
+            /*a snapshot retired in epoch e can be held by readers that announced e or older*/
+            auto keep = std::remove_if(_retired.begin(), _retired.end(), [oldestPinned](const auto& retired)
+            {
+                return (retired.first < oldestPinned);
+            });
+            _retired.erase(keep, _retired.end());
+            return _retired.size();
+        }
+
+        std::atomic<const PBFReader*> _current{ nullptr };
+        std::atomic<std::uint64_t> _epoch{ 1U };
+        std::unique_ptr<ReaderSlot[]> _slots;
+        std::uint32_t _maxReaders = 0U;
+
+        std::mutex _writerMutex; /*serializes load, publish and collect, never taken by readers*/
+        std::vector<std::pair<std::uint64_t, std::unique_ptr<const PBFReader>>> _retired;
+    };
+}
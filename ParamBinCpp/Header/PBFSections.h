@@ -0,0 +1,318 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <optional>
+#include "Pbf.h"
+#include "PBFValue.h"
+
+namespace PBF
+{
+    /**
+     * @struct SectionRef
+     * @brief Non-owning reference to one section of a PBF image.
+     */
+    struct SectionRef
+    {
+        SectionTypes type = SectionTypes::None; /**< Type of the section. */
+        std::uint32_t offset = 0U; /**< Offset from the start of the image. */
+        std::uint32_t size = 0U; /**< Size of the section in bytes. */
+        const std::uint8_t* data = nullptr; /**< Pointer to the first byte of the section. */
+    };
+
+    /**
+     * @class SectionDirectory
+     * @brief Parses the optional section directory that follows the binary records.
+     *
+     * The header's third word holds the offset of the directory. Files without sections
+     * (all version 1 files) have 0 there and the records run up to the end of the image.
+     */
+    class SectionDirectory
+    {
+    public:
+
+        SectionDirectory() = default;
+
+        /**
+         * @brief Validates the directory of an image.
+         * @param base Start of the image.
+         * @param size Size of the image as stored in the header.
+         * @return false if the directory or one of its entries is out of range.
+         */
+        bool open(const std::uint8_t* base, std::uint32_t size) noexcept
+        {
+            _base = nullptr;
+            _count = 0U;
+            _recordsEnd = 0U;
+            _directory = 0U;
+
+            if ((base == nullptr) || (size < PBF_FILE_HEADER_SIZE))
+            {
+                return false;
+            }
+
+            std::uint32_t directory = loadU32(base + 2U * sizeof(std::uint32_t));
+            if (directory == 0U)
+            {
+                _base = base;
+                _recordsEnd = size;
+                return true;
+            }
+
+            if ((directory < PBF_FILE_HEADER_SIZE) || ((directory % sizeof(std::uint32_t)) != 0U) || (directory > size - sizeof(std::uint32_t)))
+            {
+                return false;
+            }
+
+            std::uint32_t count = loadU32(base + directory);
+            std::uint32_t entries = directory + sizeof(std::uint32_t);
+            if (count > (size - entries) / PBF_SECTION_ENTRY_SIZE)
+            {
+                return false;
+            }
+
+            for (std::uint32_t i = 0U; i < count; i++)
+            {
+                const std::uint8_t* entry = base + entries + i * PBF_SECTION_ENTRY_SIZE;
+                std::uint32_t offset = loadU32(entry + sizeof(std::uint32_t));
+                std::uint32_t section_size = loadU32(entry + 2U * sizeof(std::uint32_t));
+                if ((offset < directory) || (offset > size) || (section_size > size - offset))
+                {
+                    return false;
+                }
+            }
+
+            _base = base;
+            _count = count;
+            _recordsEnd = directory;
+            _directory = directory;
+            return true;
+        }
+
+        /*Offset of the first byte after the last record*/
+        std::uint32_t getRecordsEnd() const noexcept
+        {
+            return _recordsEnd;
+        }
+
+        std::uint32_t count() const noexcept
+        {
+            return _count;
+        }
+
+        SectionRef at(std::uint32_t index) const noexcept
+        {
+            SectionRef section;
+            if (index < _count)
+            {
+                const std::uint8_t* entry = _base + _directory + sizeof(std::uint32_t) + index * PBF_SECTION_ENTRY_SIZE;
+                section.type = static_cast<SectionTypes>(loadU32(entry));
+                section.offset = loadU32(entry + sizeof(std::uint32_t));
+                section.size = loadU32(entry + 2U * sizeof(std::uint32_t));
+                section.data = _base + section.offset;
+            }
+            return section;
+        }
+
+        std::optional<SectionRef> find(SectionTypes type) const noexcept
+        {
+            for (std::uint32_t i = 0U; i < _count; i++)
+            {
+                SectionRef section = at(i);
+                if (section.type == type)
+                {
+                    return section;
+                }
+            }
+            return std::nullopt;
+        }
+
+    private:
+        const std::uint8_t* _base = nullptr;
+        std::uint32_t _count = 0U;
+        std::uint32_t _recordsEnd = 0U;
+        std::uint32_t _directory = 0U;
+    };
+
+    /**
+     * @class HashIndex
+     * @brief Lookup in the HashIndex section, used straight from the image.
+     *
+     * The section holds a contiguous column of hashes sorted in ascending order and a parallel
+     * column with the offsets of the records. Lookups are done with a branchless binary search
+     * so the number of steps only depends on the number of records.
+     */
+    class HashIndex
+    {
+    public:
+
+        HashIndex() = default;
+
+        bool open(const SectionRef& section) noexcept
+        {
+            _hashes = nullptr;
+            _offsets = nullptr;
+            _count = 0U;
+
+            if ((section.type != SectionTypes::HashIndex) || (section.size < sizeof(std::uint32_t)))
+            {
+                return false;
+            }
+            std::uint32_t count = loadU32(section.data);
+            if (count > (section.size - sizeof(std::uint32_t)) / (2U * sizeof(std::uint32_t)))
+            {
+                return false;
+            }
+            _count = count;
+            _hashes = section.data + sizeof(std::uint32_t);
+            _offsets = _hashes + count * sizeof(std::uint32_t);
+            return true;
+        }
+
+        bool isOpen() const noexcept
+        {
+            return (_hashes != nullptr);
+        }
+
+        std::uint32_t size() const noexcept
+        {
+            return _count;
+        }
+
+        std::uint32_t hashAt(std::uint32_t index) const noexcept
+        {
+            return loadU32(_hashes + index * sizeof(std::uint32_t));
+        }
+
+        std::uint32_t offsetAt(std::uint32_t index) const noexcept
+        {
+            return loadU32(_offsets + index * sizeof(std::uint32_t));
+        }
+
+        /*Index of the first hash that is not less than hash (size() if there is none)*/
+        std::uint32_t lowerBound(std::uint32_t hash) const noexcept
+        {
+            if (_count == 0U)
+            {
+                return 0U;
+            }
+            std::uint32_t first(0U);
+            std::uint32_t n(_count);
+            while (n > 1U)
+            {
+                std::uint32_t half = n / 2U;
+                // compiles to a conditional move, there is no branch to mispredict
+                first = (hashAt(first + half) < hash) ? (first + half) : first;
+                n -= half;
+            }
+            return first + static_cast<std::uint32_t>(hashAt(first) < hash);
+        }
+
+        /*Offset of the record with the given hash*/
+        std::optional<std::uint32_t> find(std::uint32_t hash) const noexcept
+        {
+            std::uint32_t index = lowerBound(hash);
+            if ((index >= _count) || (hashAt(index) != hash))
+            {
+                return std::nullopt;
+            }
+            return offsetAt(index);
+        }
+
+    private:
+        const std::uint8_t* _hashes = nullptr;
+        const std::uint8_t* _offsets = nullptr;
+        std::uint32_t _count = 0U;
+    };
+
+    /**
+     * @class FixedLayoutSection
+     * @brief The FixedLayout section, a struct of a header generated by the converter.
+     *
+     * The struct is used in place. It is only handed out if the fingerprint and the size of
+     * the layout match the ones compiled into the generated header.
+     */
+    class FixedLayoutSection
+    {
+    public:
+
+        FixedLayoutSection() = default;
+
+        bool open(const SectionRef& section) noexcept
+        {
+            _data = nullptr;
+            _fingerprint = 0U;
+            _size = 0U;
+
+            if ((section.type != SectionTypes::FixedLayout) || (section.size < PBF_FIXED_LAYOUT_HEADER_SIZE))
+            {
+                return false;
+            }
+            std::uint32_t size = loadU32(section.data + sizeof(std::uint32_t));
+            if (size > section.size - PBF_FIXED_LAYOUT_HEADER_SIZE)
+            {
+                return false;
+            }
+            _fingerprint = loadU32(section.data);
+            _size = size;
+            _data = section.data + PBF_FIXED_LAYOUT_HEADER_SIZE;
+            return true;
+        }
+
+        bool isOpen() const noexcept
+        {
+            return (_data != nullptr);
+        }
+
+        std::uint32_t fingerprint() const noexcept
+        {
+            return _fingerprint;
+        }
+
+        std::uint32_t size() const noexcept
+        {
+            return _size;
+        }
+
+        /*Layout data if fingerprint and size match, nullptr otherwise (or if the image is not 32-bit aligned)*/
+        const void* get(std::uint32_t fingerprint, std::size_t size) const noexcept
+        {
+            if (!isOpen() || (fingerprint != _fingerprint) || (size != _size) ||
+                ((reinterpret_cast<std::uintptr_t>(_data) % sizeof(std::uint32_t)) != 0U))
+            {
+                return nullptr;
+            }
+            return _data;
+        }
+
+    private:
+        const std::uint8_t* _data = nullptr;
+        std::uint32_t _fingerprint = 0U;
+        std::uint32_t _size = 0U;
+    };
+}
@@ -0,0 +1,269 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+namespace PBF
+{
+    /**
+     * @class PBFStorage
+     * @brief Random access to an image that is not mapped into memory (e.g. SPI/QSPI flash).
+     */
+    class PBFStorage
+    {
+    public:
+
+        virtual ~PBFStorage() = default;
+
+        /**
+         * @brief Copies length bytes starting at offset into buffer.
+         * @return false if the range is outside the storage or the device reports an error.
+         */
+        virtual bool read(std::uint32_t offset, void* buffer, std::uint32_t length) noexcept = 0;
+
+        /*Size of the storage in bytes*/
+        virtual std::uint32_t size() const noexcept = 0;
+    };
+
+    /**
+     * @class MemoryStorage
+     * @brief PBFStorage over an image in memory.
+     */
+    class MemoryStorage : public PBFStorage
+    {
+    public:
+
+        MemoryStorage(const void* memory, std::uint32_t size) : _memory(static_cast<const std::uint8_t*>(memory)), _size(size)
+        {
+        }
+
+        bool read(std::uint32_t offset, void* buffer, std::uint32_t length) noexcept override
+        {
+            if ((_memory == nullptr) || (offset > _size) || (length > _size - offset))
+            {
+                return false;
+            }
+            std::memcpy(buffer, _memory + offset, length);
+            return true;
+        }
+
+        std::uint32_t size() const noexcept override
+        {
+            return _size;
+        }
+
+    private:
+        const std::uint8_t* _memory = nullptr;
+        std::uint32_t _size = 0U;
+    };
+
+    /**
+     * @class SimulatedFlashStorage
+     * @brief Slow storage for measurements on the host.
+     *
+     * Every read busy-waits for a fixed access time plus a time per byte, like a command and
+     * the data transfer on a serial flash, and is counted.
+     */
+    class SimulatedFlashStorage : public MemoryStorage
+    {
+    public:
+
+        SimulatedFlashStorage(const void* memory, std::uint32_t size, std::chrono::nanoseconds accessTime, std::chrono::nanoseconds timePerByte)
+            : MemoryStorage(memory, size), _accessTime(accessTime), _timePerByte(timePerByte)
+        {
+        }
+
+        bool read(std::uint32_t offset, void* buffer, std::uint32_t length) noexcept override
+        {
+            _reads++;
+            _bytesRead += length;
+
+            auto until = std::chrono::steady_clock::now() + _accessTime + _timePerByte * length;
+            while (std::chrono::steady_clock::now() < until)
+            {
+            }
+            return MemoryStorage::read(offset, buffer, length);
+        }
+
+        std::uint64_t reads() const noexcept
+        {
+            return _reads;
+        }
+
+        std::uint64_t bytesRead() const noexcept
+        {
+            return _bytesRead;
+        }
+
+        void resetStatistics() noexcept
+        {
+            _reads = 0U;
+            _bytesRead = 0U;
+        }
+
+    private:
+        std::chrono::nanoseconds _accessTime;
+        std::chrono::nanoseconds _timePerByte;
+        std::uint64_t _reads = 0U;
+        std::uint64_t _bytesRead = 0U;
+    };
+
+    /**
+     * @class PageCache
+     * @brief Fixed size cache of storage pages, least recently used pages are replaced.
+     *
+     * The cache holds NumberOfPages pages of PageSize bytes inside the object, it never
+     * allocates. The storage is only read in whole, aligned pages (the last page of the
+     * storage may be shorter).
+     */
+    template<std::uint32_t PageSize, std::uint32_t NumberOfPages>
+    class PageCache
+    {
+        static_assert((PageSize >= 16U) && ((PageSize & (PageSize - 1U)) == 0U), "PageSize must be a power of two of at least 16 bytes");
+        static_assert(NumberOfPages >= 2U, "PageCache needs at least two pages");
+
+    public:
+
+        explicit PageCache(PBFStorage& storage) noexcept : _storage(&storage)
+        {
+            invalidate();
+        }
+
+        PBFStorage& storage() const noexcept
+        {
+            return *_storage;
+        }
+
+        /**
+         * @brief Copies length bytes starting at offset into buffer, loading missing pages.
+         * @return false if the range is outside the storage or the storage could not be read.
+         */
+        bool read(std::uint32_t offset, void* buffer, std::uint32_t length) noexcept
+        {
+            const std::uint32_t size = _storage->size();
+            if ((offset > size) || (length > size - offset))
+            {
+                return false;
+            }
+            std::uint8_t* out = static_cast<std::uint8_t*>(buffer);
+            while (length > 0U)
+            {
+                const std::uint8_t* page = getPage(offset / PageSize);
+                if (page == nullptr)
+                {
+                    return false;
+                }
+                std::uint32_t inPage = offset % PageSize;
+                std::uint32_t chunk = std::min(length, PageSize - inPage);
+                std::memcpy(out, page + inPage, chunk);
+                out += chunk;
+                offset += chunk;
+                length -= chunk;
+            }
+            return true;
+        }
+
+        /*Drops all pages, e.g. after the storage has been written*/
+        void invalidate() noexcept
+        {
+            for (std::uint32_t i = 0U; i < NumberOfPages; i++)
+            {
+                _tags[i] = INVALID_PAGE;
+                _lastUse[i] = 0U;
+            }
+            _clock = 0U;
+        }
+
+        std::uint64_t hits() const noexcept
+        {
+            return _hits;
+        }
+
+        std::uint64_t misses() const noexcept
+        {
+            return _misses;
+        }
+
+        void resetStatistics() noexcept
+        {
+            _hits = 0U;
+            _misses = 0U;
+        }
+
+    private:
+
+        static constexpr std::uint32_t INVALID_PAGE = 0xFFFFFFFFU;
+
+        const std::uint8_t* getPage(std::uint32_t pageNumber) noexcept
+        {
+            _clock++;
+            std::uint32_t victim(0U);
+            for (std::uint32_t i = 0U; i < NumberOfPages; i++)
+            {
+                if (_tags[i] == pageNumber)
+                {
+                    _hits++;
+                    _lastUse[i] = _clock;
+                    return _pages[i];
+                }
+                if (_lastUse[i] < _lastUse[victim])
+                {
+                    victim = i;
+                }
+            }
+
+            _misses++;
+            std::uint32_t start = pageNumber * PageSize;
+            if (start >= _storage->size())
+            {
+                return nullptr;
+            }
+            std::uint32_t length = std::min(PageSize, _storage->size() - start);
+            if (!_storage->read(start, _pages[victim], length))
+            {
+                _tags[victim] = INVALID_PAGE;
+                _lastUse[victim] = 0U;
+                return nullptr;
+            }
+            _tags[victim] = pageNumber;
+            _lastUse[victim] = _clock;
+            return _pages[victim];
+        }
+
+        PBFStorage* _storage = nullptr;
+        std::uint8_t _pages[NumberOfPages][PageSize];
+        std::uint32_t _tags[NumberOfPages];
+        std::uint64_t _lastUse[NumberOfPages];
+        std::uint64_t _clock = 0U;
+        std::uint64_t _hits = 0U;
+        std::uint64_t _misses = 0U;
+    };
+}
@@ -0,0 +1,574 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <span>
+#include <type_traits>
+#include <algorithm>
+#include "Pbf.h"
+#include "PBFValue.h"
+#include "PBFPerfectHash.h"
+#include "PBFStorage.h"
+#include "PBFChecksum.h"
+#include "PBFByteOrder.h"
+
+namespace PBF
+{
+    /**
+     * @struct StoredRecord
+     * @brief Location of a record in a PBFStorage.
+     */
+    struct StoredRecord
+    {
+        std::uint32_t hash = 0U;
+        DataTypes type = DataTypes::None;
+        std::uint32_t data_size = 0U; /**< Data bytes in the storage (padded). */
+        std::uint32_t offset = 0U; /**< Offset of the record data. */
+    };
+
+    /**
+     * @class PBFStorageView
+     * @brief Reads parameters from an image in a PBFStorage through a small page cache.
+     *
+     * Nothing but the page cache is kept in RAM. Opening reads the header and the section
+     * directory; a lookup reads only the pages holding the index entries and the record it
+     * needs: with a PerfectHash section a pilot, a slot and the record, with a HashIndex
+     * section the pages touched by the binary search. Images without an index section are
+     * scanned record by record.
+     * Strings are copied into a buffer of the caller (getString).
+     */
+    template<std::uint32_t PageSize = 256U, std::uint32_t NumberOfPages = 8U>
+    class PBFStorageView
+    {
+    public:
+
+        explicit PBFStorageView(PBFStorage& storage) noexcept : _cache(storage)
+        {
+        }
+
+        /**
+         * @brief Validates the header and the section directory of the image.
+         * @return false if the image is malformed or the storage can not be read.
+         */
+        bool open() noexcept
+        {
+            _open = false;
+            _perfectHash = MphSection();
+            _index = IndexSection();
+            _checksum = 0U;
+            _stringPool = 0U;
+            _stringPoolSize = 0U;
+
+            std::uint32_t header[3] = { 0U, 0U, 0U };
+            if ((_cache.storage().size() < PBF_FILE_HEADER_SIZE) || !_cache.read(0U, header, sizeof(header)))
+            {
+                return false;
+            }
+            /*images of the other byte order must be converted with swapByteOrder when they are written to the storage*/
+            if (getImageByteOrder(header, sizeof(header)) != std::endian::native)
+            {
+                return false;
+            }
+            std::uint32_t size = header[0];
+            std::uint32_t directory = header[2];
+            if ((size < PBF_FILE_HEADER_SIZE) || (size > _cache.storage().size()))
+            {
+                return false;
+            }
+            _size = size;
+            _version = static_cast<std::uint16_t>(header[1] >> 16U);
+            _seed = static_cast<std::uint16_t>(header[1] & PBF_HEADER_SEED_MASK);
+            _recordsEnd = size;
+
+            if (directory != 0U)
+            {
+                if ((directory < PBF_FILE_HEADER_SIZE) || ((directory % sizeof(std::uint32_t)) != 0U) || (directory > size - sizeof(std::uint32_t)))
+                {
+                    return false;
+                }
+                std::uint32_t count(0U);
+                if (!readU32(directory, count) || (count > (size - directory - sizeof(std::uint32_t)) / PBF_SECTION_ENTRY_SIZE))
+                {
+                    return false;
+                }
+                for (std::uint32_t i = 0U; i < count; i++)
+                {
+                    std::uint32_t entry[3] = { 0U, 0U, 0U };
+                    if (!_cache.read(directory + sizeof(std::uint32_t) + i * PBF_SECTION_ENTRY_SIZE, entry, sizeof(entry)))
+                    {
+                        return false;
+                    }
+                    if ((entry[1] < directory) || (entry[1] > size) || (entry[2] > size - entry[1]))
+                    {
+                        return false;
+                    }
+                    if ((static_cast<SectionTypes>(entry[0]) == SectionTypes::PerfectHash) && !openPerfectHash(entry[1], entry[2]))
+                    {
+                        return false;
+                    }
+                    if ((static_cast<SectionTypes>(entry[0]) == SectionTypes::HashIndex) && !openIndex(entry[1], entry[2]))
+                    {
+                        return false;
+                    }
+                    if (static_cast<SectionTypes>(entry[0]) == SectionTypes::Checksum)
+                    {
+                        if (entry[2] < PBF_CHECKSUM_SECTION_SIZE)
+                        {
+                            return false;
+                        }
+                        _checksum = entry[1];
+                    }
+                    if (static_cast<SectionTypes>(entry[0]) == SectionTypes::StringPool)
+                    {
+                        _stringPool = entry[1];
+                        _stringPoolSize = entry[2];
+                    }
+                }
+                _recordsEnd = directory;
+            }
+            _open = true;
+            return true;
+        }
+
+        bool isOpen() const noexcept
+        {
+            return _open;
+        }
+
+        std::uint32_t size() const noexcept
+        {
+            return _size;
+        }
+
+        std::uint16_t version() const noexcept
+        {
+            return _version;
+        }
+
+        /*Hash seed of the keys, 0 if they are hashed with pbfHash*/
+        std::uint16_t seed() const noexcept
+        {
+            return _seed;
+        }
+
+        /*KeyHash of a key in this image, hashed with its seed*/
+        KeyHash key(std::string_view text) const noexcept
+        {
+            return pbfKey(text, _seed);
+        }
+
+        bool hasChecksum() const noexcept
+        {
+            return (_checksum != 0U);
+        }
+
+        /**
+         * @brief Checks the CRC32C of the Checksum section (converter option --checksum).
+         *
+         * Reads the image in front of the section from the storage in pieces of PageSize
+         * bytes, past the page cache so that the cached pages stay.
+         * @return false if the image has no Checksum section, can not be read or the CRC does not match.
+         */
+        bool verifyChecksum() noexcept
+        {
+            if (!_open || (_checksum == 0U))
+            {
+                return false;
+            }
+            std::uint8_t buffer[PageSize];
+            std::uint32_t crc(0U);
+            for (std::uint32_t offset = 0U; offset < _checksum; offset += PageSize)
+            {
+                std::uint32_t length = std::min(PageSize, _checksum - offset);
+                if (!_cache.storage().read(offset, buffer, length))
+                {
+                    return false;
+                }
+                crc = crc32c(buffer, length, crc);
+            }
+            std::uint32_t stored(0U);
+            return readU32(_checksum, stored) && (crc == stored);
+        }
+
+        bool hasIndex() const noexcept
+        {
+            return (_perfectHash.count != 0U) || (_index.count != 0U);
+        }
+
+        PageCache<PageSize, NumberOfPages>& cache() noexcept
+        {
+            return _cache;
+        }
+
+        bool contains(KeyHash key) noexcept
+        {
+            return findRecord(key.value).has_value();
+        }
+
+        PBF::DataTypes getType(KeyHash key) noexcept
+        {
+            auto rec = findRecord(key.value);
+            if (!rec)
+            {
+                return DataTypes::None;
+            }
+            return rec->type;
+        }
+
+        /**
+         * @brief Returns the value of a parameter converted to T.
+         *
+         * Supports the conversions of PBFReader::getParam. Strings can only be read as
+         * std::string (not with PBF_RT), see getString for a copy without allocation.
+         */
+        template<typename T>
+        std::optional<T> getParam(KeyHash key) noexcept(!std::is_same<T, std::string>::value)
+        {
+            static_assert(!std::is_same<T, std::string_view>::value, "Strings are not in memory, use getString or std::string");
+            static_assert(std::is_same<T, std::string>::value || isSupportedValueType<T>(), "Unsupported type for getParam");
+#ifdef PBF_RT
+            static_assert(!std::is_same<T, std::string>::value, "getParam<std::string> allocates, use getString with PBF_RT");
+#endif
+            auto rec = findRecord(key.value);
+            if (!rec)
+            {
+                return std::nullopt;
+            }
+
+            if constexpr (std::is_same<T, std::string>::value)
+            {
+                if (rec->type != DataTypes::String)
+                {
+                    return std::nullopt;
+                }
+                std::string str(rec->data_size, '\0');
+                if (!_cache.read(rec->offset, str.data(), rec->data_size))
+                {
+                    return std::nullopt;
+                }
+                str.resize(strnlen(str.data(), str.size()));
+                return str;
+            }
+            else
+            {
+                /*scalars have at most 12 data bytes*/
+                std::uint8_t data[12];
+                if ((rec->type == DataTypes::String) || (rec->data_size > sizeof(data)) || !_cache.read(rec->offset, data, rec->data_size))
+                {
+                    return std::nullopt;
+                }
+                RecordRef ref;
+                ref.hash = rec->hash;
+                ref.type = rec->type;
+                ref.data_size = rec->data_size;
+                ref.data = data;
+                return decodeValue<T>(ref);
+            }
+        }
+
+        /**
+         * @brief Copies a string parameter including the terminating \0 into buffer.
+         * @return Length of the string, std::nullopt if the parameter is missing, no string or does not fit.
+         */
+        std::optional<std::uint32_t> getString(KeyHash key, char* buffer, std::uint32_t capacity) noexcept
+        {
+            auto rec = findRecord(key.value);
+            if (!rec || (rec->type != DataTypes::String) || (buffer == nullptr))
+            {
+                return std::nullopt;
+            }
+            /*the string is followed by at least one \0 within data_size*/
+            std::uint32_t copied(0U);
+            while (copied < rec->data_size)
+            {
+                std::uint32_t chunk = std::min<std::uint32_t>(PageSize, rec->data_size - copied);
+                chunk = std::min<std::uint32_t>(chunk, capacity - copied);
+                if (chunk == 0U)
+                {
+                    return std::nullopt;
+                }
+                if (!_cache.read(rec->offset + copied, buffer + copied, chunk))
+                {
+                    return std::nullopt;
+                }
+                const void* end = std::memchr(buffer + copied, '\0', chunk);
+                if (end != nullptr)
+                {
+                    return static_cast<std::uint32_t>(static_cast<const char*>(end) - buffer);
+                }
+                copied += chunk;
+            }
+            return std::nullopt;
+        }
+
+        /**
+         * @brief Copies the elements of an array parameter into out.
+         *
+         * T must be the element type of the array, see decodeArray.
+         * @return Number of elements, std::nullopt if the parameter is missing, no array of T or has more elements than out.
+         */
+        template<typename T>
+        std::optional<std::uint32_t> getArray(KeyHash key, std::span<T> out) noexcept
+        {
+            static_assert(getArrayElementType<T>() != DataTypes::None, "Unsupported element type for getArray");
+
+            auto rec = findRecord(key.value);
+            std::uint32_t header[2] = { 0U, 0U };
+            if (!rec || (rec->type != DataTypes::Array) || (rec->data_size < PBF_ARRAY_HEADER_SIZE) || !_cache.read(rec->offset, header, sizeof(header)))
+            {
+                return std::nullopt;
+            }
+            std::uint32_t elementsOffset = header[0] & 0x00FFFFFF;
+            std::uint32_t count = header[1];
+            if ((static_cast<DataTypes>(header[0] >> 24U) != getArrayElementType<T>()) ||
+                (elementsOffset < PBF_ARRAY_HEADER_SIZE) || (elementsOffset > rec->data_size) ||
+                (count > (rec->data_size - elementsOffset) / sizeof(T)) || (count > out.size()))
+            {
+                return std::nullopt;
+            }
+            if ((count > 0U) && !_cache.read(rec->offset + elementsOffset, out.data(), count * static_cast<std::uint32_t>(sizeof(T))))
+            {
+                return std::nullopt;
+            }
+            return count;
+        }
+
+        std::optional<StoredRecord> findRecord(std::uint32_t hash) noexcept
+        {
+            if (!_open)
+            {
+                return std::nullopt;
+            }
+            if (hasIndex())
+            {
+                auto offset = (_perfectHash.count != 0U) ? findPerfectHash(hash) : findIndex(hash);
+                if (!offset)
+                {
+                    return std::nullopt;
+                }
+                StoredRecord rec;
+                std::uint32_t next = offset.value();
+                if (!readRecord(next, rec) || (rec.hash != hash))
+                {
+                    return std::nullopt;
+                }
+                return rec;
+            }
+
+            StoredRecord rec;
+            std::uint32_t offset(PBF_FILE_HEADER_SIZE);
+            while ((offset < _recordsEnd) && readRecord(offset, rec))
+            {
+                if (rec.hash == hash)
+                {
+                    return rec;
+                }
+            }
+            return std::nullopt;
+        }
+
+    private:
+
+        /*Header words of the PerfectHash section, see PBFPerfectHash.h for the layout*/
+        struct MphSection
+        {
+            std::uint32_t count = 0U;
+            std::uint32_t buckets = 0U;
+            std::uint32_t positions = 0U;
+            std::uint32_t seed = 0U;
+            std::uint32_t pilots = 0U; /*offsets in the storage*/
+            std::uint32_t remap = 0U;
+            std::uint32_t slots = 0U;
+        };
+
+        struct IndexSection
+        {
+            std::uint32_t count = 0U;
+            std::uint32_t hashes = 0U; /*offsets in the storage*/
+            std::uint32_t offsets = 0U;
+        };
+
+        bool readU32(std::uint32_t offset, std::uint32_t& value) noexcept
+        {
+            return _cache.read(offset, &value, sizeof(std::uint32_t));
+        }
+
+        bool openPerfectHash(std::uint32_t offset, std::uint32_t size) noexcept
+        {
+            std::uint32_t words[4] = { 0U, 0U, 0U, 0U };
+            if ((size < sizeof(words)) || !_cache.read(offset, words, sizeof(words)))
+            {
+                return false;
+            }
+            std::uint32_t count = words[0];
+            if ((count > size / 8U) || (words[1] != getPerfectHashBucketCount(count)) || (words[2] != getPerfectHashPositionCount(count)) ||
+                (size < getPerfectHashSectionSize(count)))
+            {
+                return false;
+            }
+            _perfectHash.count = count;
+            _perfectHash.buckets = words[1];
+            _perfectHash.positions = words[2];
+            _perfectHash.seed = words[3];
+            _perfectHash.pilots = offset + sizeof(words);
+            _perfectHash.remap = _perfectHash.pilots + ((words[1] * sizeof(std::uint16_t) + sizeof(std::uint32_t) - 1U) / sizeof(std::uint32_t)) * sizeof(std::uint32_t);
+            _perfectHash.slots = _perfectHash.remap + (words[2] - count) * sizeof(std::uint32_t);
+            return true;
+        }
+
+        bool openIndex(std::uint32_t offset, std::uint32_t size) noexcept
+        {
+            std::uint32_t count(0U);
+            if ((size < sizeof(std::uint32_t)) || !readU32(offset, count) || (count > (size - sizeof(std::uint32_t)) / (2U * sizeof(std::uint32_t))))
+            {
+                return false;
+            }
+            _index.count = count;
+            _index.hashes = offset + sizeof(std::uint32_t);
+            _index.offsets = _index.hashes + count * sizeof(std::uint32_t);
+            return true;
+        }
+
+        std::optional<std::uint32_t> findPerfectHash(std::uint32_t hash) noexcept
+        {
+            std::uint64_t key = mphKey(hash, _perfectHash.seed);
+            std::uint32_t bucket = mphReduce(static_cast<std::uint32_t>(key >> 32U), _perfectHash.buckets);
+
+            std::uint16_t pilot(0U);
+            if (!_cache.read(_perfectHash.pilots + bucket * sizeof(std::uint16_t), &pilot, sizeof(std::uint16_t)))
+            {
+                return std::nullopt;
+            }
+            std::uint32_t position = mphPosition(key, pilot, _perfectHash.positions);
+            if (position >= _perfectHash.count)
+            {
+                if (!readU32(_perfectHash.remap + (position - _perfectHash.count) * sizeof(std::uint32_t), position) || (position >= _perfectHash.count))
+                {
+                    return std::nullopt;
+                }
+            }
+            std::uint32_t slot[2] = { 0U, 0U };
+            if (!_cache.read(_perfectHash.slots + position * sizeof(slot), slot, sizeof(slot)) || (slot[0] != hash))
+            {
+                return std::nullopt;
+            }
+            return slot[1];
+        }
+
+        std::optional<std::uint32_t> findIndex(std::uint32_t hash) noexcept
+        {
+            std::uint32_t first(0U);
+            std::uint32_t n(_index.count);
+            std::uint32_t value(0U);
+            while (n > 1U)
+            {
+                std::uint32_t half = n / 2U;
+                if (!readU32(_index.hashes + (first + half) * sizeof(std::uint32_t), value))
+                {
+                    return std::nullopt;
+                }
+                first = (value < hash) ? (first + half) : first;
+                n -= half;
+            }
+            if ((_index.count == 0U) || !readU32(_index.hashes + first * sizeof(std::uint32_t), value))
+            {
+                return std::nullopt;
+            }
+            if (value < hash)
+            {
+                first++;
+                if ((first >= _index.count) || !readU32(_index.hashes + first * sizeof(std::uint32_t), value))
+                {
+                    return std::nullopt;
+                }
+            }
+            if (value != hash)
+            {
+                return std::nullopt;
+            }
+            std::uint32_t offset(0U);
+            if (!readU32(_index.offsets + first * sizeof(std::uint32_t), offset))
+            {
+                return std::nullopt;
+            }
+            return offset;
+        }
+
+        /*Reads the record at offset and advances offset to the next record*/
+        bool readRecord(std::uint32_t& offset, StoredRecord& rec) noexcept
+        {
+            std::uint32_t header[2] = { 0U, 0U };
+            if ((offset < PBF_FILE_HEADER_SIZE) || (offset > _recordsEnd) || (PBF_FILE_RECORD_HEADER_SIZE > _recordsEnd - offset) ||
+                !_cache.read(offset, header, sizeof(header)))
+            {
+                return false;
+            }
+            DataTypes type = static_cast<DataTypes>(header[1] >> 24U);
+            std::uint32_t data_size = getRecordDataSize(type, header[1] & 0x00FFFFFF);
+            if ((data_size == 0U) || (data_size > (_recordsEnd - offset - PBF_FILE_RECORD_HEADER_SIZE)))
+            {
+                return false;
+            }
+            rec.hash = header[0];
+            rec.type = type;
+            rec.data_size = data_size;
+            rec.offset = offset + PBF_FILE_RECORD_HEADER_SIZE;
+            if (type == DataTypes::PooledString)
+            {
+                /*the string in the pool, getString stops at its \0*/
+                std::uint32_t poolOffset(0U);
+                std::uint32_t length = header[1] & 0x00FFFFFF;
+                if (!readU32(rec.offset, poolOffset) || (poolOffset > _stringPoolSize) || (length >= _stringPoolSize - poolOffset))
+                {
+                    return false;
+                }
+                rec.type = DataTypes::String;
+                rec.data_size = length + 1U;
+                rec.offset = _stringPool + poolOffset;
+            }
+            offset += PBF_FILE_RECORD_HEADER_SIZE + data_size;
+            return true;
+        }
+
+        PageCache<PageSize, NumberOfPages> _cache;
+        bool _open = false;
+        std::uint32_t _size = 0U;
+        std::uint16_t _version = 0U;
+        std::uint16_t _seed = 0U;
+        std::uint32_t _recordsEnd = 0U;
+        std::uint32_t _checksum = 0U; /*offset of the Checksum section, 0 if there is none*/
+        std::uint32_t _stringPool = 0U; /*offset and size of the StringPool section*/
+        std::uint32_t _stringPoolSize = 0U;
+        MphSection _perfectHash;
+        IndexSection _index;
+    };
+}
@@ -0,0 +1,415 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <limits>
+#include <span>
+#include "Pbf.h"
+
+namespace PBF
+{
+    /**
+     * @struct RecordRef
+     * @brief Non-owning reference to the data of a single binary record.
+     *
+     * The data pointer refers to memory owned by somebody else (an image in RAM or flash)
+     * and is only valid as long as that memory is valid.
+     */
+    struct RecordRef
+    {
+        std::uint32_t hash = 0U; /**< Hash of the key. */
+        DataTypes type = DataTypes::None; /**< Data type of the record. */
+        std::uint32_t data_size = 0U; /**< Size of the data in bytes (padded). */
+        const std::uint8_t* data = nullptr; /**< Pointer to the first data byte. */
+    };
+
+    /**
+     * @struct ValueSlot
+     * @brief Decoded value of one record in a fixed 16-byte, trivially copyable slot.
+     *
+     * Scalars keep the record data as it is stored in the file (at most 12 bytes for
+     * DateTime). For strings and arrays data holds the offset and the size of the record
+     * data in the arena of the owner of the slot.
+     */
+    struct ValueSlot
+    {
+        std::uint8_t type = static_cast<std::uint8_t>(DataTypes::None); /**< Data type, represented as a byte. */
+        std::uint8_t reserved[3] = { 0U, 0U, 0U };
+        std::uint8_t data[12] = { 0U }; /**< Record data or string offset and length. */
+
+        DataTypes getType() const noexcept
+        {
+            return static_cast<DataTypes>(type);
+        }
+    };
+
+    static_assert(sizeof(ValueSlot) == 16U, "ValueSlot must be 16 bytes");
+    static_assert(std::is_trivially_copyable<ValueSlot>::value, "ValueSlot must be trivially copyable");
+
+    /*Images may live in flash or in mmap'd files; never assume alignment of the data*/
+    inline std::uint32_t loadU32(const void* memory) noexcept
+    {
+        std::uint32_t value(0U);
+        std::memcpy(&value, memory, sizeof(std::uint32_t));
+        return value;
+    }
+
+    inline std::uint64_t loadU64(const void* memory) noexcept
+    {
+        std::uint64_t value(0U);
+        std::memcpy(&value, memory, sizeof(std::uint64_t));
+        return value;
+    }
+
+    inline Date decodeDate(std::uint32_t data32) noexcept
+    {
+        Date date;
+        date.year = static_cast<std::uint16_t>((data32 & 0xFFFF0000) >> 16U);
+        date.month = static_cast<std::uint8_t>((data32 & 0xFF00) >> 8U);
+        date.day = static_cast<std::uint8_t>(data32 & 0xFF);
+        return date;
+    }
+
+    inline Time decodeTime(std::uint64_t data64) noexcept
+    {
+        Time time;
+        time.hour = static_cast<std::uint8_t>((data64 & 0xFF000000000000) >> 48U);
+        time.minute = static_cast<std::uint8_t>((data64 & 0x00FF0000000000) >> 40U);
+        time.second = static_cast<std::uint8_t>((data64 & 0x0000FF00000000) >> 32U);
+        time.nanosecond = static_cast<std::uint32_t>((data64 & 0xFFFFFFFF));
+        return time;
+    }
+
+    /*Inverse of decodeDate, the word the converter stores for a date*/
+    inline std::uint32_t encodeDate(const Date& date) noexcept
+    {
+        return (static_cast<std::uint32_t>(date.year) << 16U) | (static_cast<std::uint32_t>(date.month) << 8U) | static_cast<std::uint32_t>(date.day);
+    }
+
+    /*Inverse of decodeTime, the word the converter stores for a time*/
+    inline std::uint64_t encodeTime(const Time& time) noexcept
+    {
+        return (static_cast<std::uint64_t>(time.hour) << 48U) | (static_cast<std::uint64_t>(time.minute) << 40U) |
+            (static_cast<std::uint64_t>(time.second) << 32U) | static_cast<std::uint64_t>(time.nanosecond);
+    }
+
+    /**
+     * @brief Creates the RecordRef for a slot.
+     * @param strings Start of the arena the slot refers to.
+     */
+    inline RecordRef getSlotRecord(const ValueSlot& slot, const char* strings) noexcept
+    {
+        RecordRef rec;
+        rec.type = slot.getType();
+        if ((rec.type == DataTypes::String) || (rec.type == DataTypes::Array))
+        {
+            rec.data = static_cast<const std::uint8_t*>(static_cast<const void*>(strings + loadU32(slot.data)));
+            rec.data_size = loadU32(slot.data + sizeof(std::uint32_t));
+        }
+        else
+        {
+            rec.data = slot.data;
+            rec.data_size = sizeof(slot.data);
+        }
+        return rec;
+    }
+
+    template<typename T>
+    constexpr bool isSupportedValueType()
+    {
+        return std::is_same<T, double>::value ||
+            std::is_same<T, std::string_view>::value ||
+#ifdef ENABLE_PBF_8BIT_TYPES
+            std::is_same<T, std::uint8_t>::value ||
+            std::is_same<T, std::int8_t>::value ||
+#endif
+#ifdef ENABLE_PBF_16BIT_TYPES
+            std::is_same<T, std::uint16_t>::value ||
+            std::is_same<T, std::int16_t>::value ||
+#endif
+            std::is_same<T, std::int32_t>::value ||
+            std::is_same<T, std::uint32_t>::value ||
+            std::is_same<T, std::uint64_t>::value ||
+            std::is_same<T, std::int64_t>::value ||
+            std::is_same<T, float>::value ||
+            std::is_same<T, bool>::value ||
+            std::is_same<T, PBF::Date>::value ||
+            std::is_same<T, PBF::Time>::value ||
+            std::is_same<T, PBF::DateTime>::value;
+    }
+
+    template<typename T, typename V>
+    std::optional<T> narrowInteger(V value) noexcept
+    {
+        if (!std::in_range<T>(value))
+        {
+            return std::nullopt;
+        }
+        return static_cast<T>(value);
+    }
+
+    template<typename T>
+    std::optional<T> decodeInteger(DataTypes type, const std::uint8_t* data) noexcept
+    {
+        switch (type)
+        {
+#ifdef ENABLE_PBF_8BIT_TYPES
+        case DataTypes::Int8:
+        {
+            return narrowInteger<T>(static_cast<std::int8_t>(data[0]));
+        }
+        case DataTypes::UInt8:
+        {
+            return narrowInteger<T>(data[0]);
+        }
+#endif
+#ifdef ENABLE_PBF_16BIT_TYPES
+        case DataTypes::Int16:
+        {
+            std::int16_t val(0);
+            std::memcpy(&val, data, sizeof(val));
+            return narrowInteger<T>(val);
+        }
+        case DataTypes::UInt16:
+        {
+            std::uint16_t val(0U);
+            std::memcpy(&val, data, sizeof(val));
+            return narrowInteger<T>(val);
+        }
+#endif
+        case DataTypes::Int32:
+        {
+            return narrowInteger<T>(static_cast<std::int32_t>(loadU32(data)));
+        }
+        case DataTypes::UInt32:
+        {
+            return narrowInteger<T>(loadU32(data));
+        }
+        case DataTypes::Int64:
+        {
+            return narrowInteger<T>(static_cast<std::int64_t>(loadU64(data)));
+        }
+        case DataTypes::UInt64:
+        {
+            return narrowInteger<T>(loadU64(data));
+        }
+        default:
+        {
+            return std::nullopt;
+        }
+        }
+    }
+
+    /**
+     * @brief Decodes the data of a record into the requested type.
+     *
+     * The conversion rules are the same as for PBFReader::getParam: integers are converted
+     * between all integer types if the value fits, floats and doubles are converted into each
+     * other (range checked) and all other types must match exactly.
+     * Strings are returned as std::string_view that points into the record data.
+     *
+     * @tparam T Requested type.
+     * @param rec Record to decode.
+     * @return The value or std::nullopt if the record can not be converted to T.
+     */
+    template<typename T>
+    std::optional<T> decodeValue(const RecordRef& rec) noexcept
+    {
+        static_assert(isSupportedValueType<T>(), "Unsupported type for decodeValue");
+
+        if constexpr (std::is_same<T, std::string_view>::value)
+        {
+            if (rec.type != DataTypes::String)
+            {
+                return std::nullopt;
+            }
+            const char* charData = static_cast<const char*>(static_cast<const void*>(rec.data));
+            const void* end = std::memchr(charData, 0, rec.data_size);
+            std::size_t str_size = (end != nullptr) ? static_cast<std::size_t>(static_cast<const char*>(end) - charData) : rec.data_size;
+            return std::string_view(charData, str_size);
+        }
+        else if constexpr (std::is_same<T, bool>::value)
+        {
+            if (rec.type != DataTypes::Boolean)
+            {
+                return std::nullopt;
+            }
+            return rec.data[0] != 0U;
+        }
+        else if constexpr (std::is_same<T, PBF::Date>::value)
+        {
+            if (rec.type != DataTypes::Date)
+            {
+                return std::nullopt;
+            }
+            return decodeDate(loadU32(rec.data));
+        }
+        else if constexpr (std::is_same<T, PBF::Time>::value)
+        {
+            if (rec.type != DataTypes::Time)
+            {
+                return std::nullopt;
+            }
+            return decodeTime(loadU64(rec.data));
+        }
+        else if constexpr (std::is_same<T, PBF::DateTime>::value)
+        {
+            if (rec.type != DataTypes::DateTime)
+            {
+                return std::nullopt;
+            }
+            DateTime date_time;
+            date_time.date = decodeDate(loadU32(rec.data));
+            date_time.time = decodeTime(loadU64(rec.data + sizeof(std::uint32_t)));
+            return date_time;
+        }
+        else if constexpr (std::is_floating_point<T>::value)
+        {
+            if (rec.type == DataTypes::Float32)
+            {
+                float flt(0.0f);
+                std::memcpy(&flt, rec.data, sizeof(float));
+                return static_cast<T>(flt);
+            }
+            if (rec.type != DataTypes::Float64)
+            {
+                return std::nullopt;
+            }
+            double dbl(0.0);
+            std::memcpy(&dbl, rec.data, sizeof(double));
+            if constexpr (std::is_same<T, float>::value)
+            {
+                // Check if the value is within the range of float
+                if (dbl > static_cast<double>(std::numeric_limits<float>::max()) ||
+                    dbl < static_cast<double>(std::numeric_limits<float>::lowest()))
+                {
+                    return std::nullopt; // Out of range for float
+                }
+            }
+            return static_cast<T>(dbl);
+        }
+        else
+        {
+            return decodeInteger<T>(rec.type, rec.data);
+        }
+    }
+
+    /*Element type of arrays that can be read as std::span<const T>, None for all other types*/
+    template<typename T>
+    constexpr DataTypes getArrayElementType()
+    {
+#ifdef ENABLE_PBF_8BIT_TYPES
+        if constexpr (std::is_same<T, std::int8_t>::value)
+        {
+            return DataTypes::Int8;
+        }
+        if constexpr (std::is_same<T, std::uint8_t>::value)
+        {
+            return DataTypes::UInt8;
+        }
+#endif
+#ifdef ENABLE_PBF_16BIT_TYPES
+        if constexpr (std::is_same<T, std::int16_t>::value)
+        {
+            return DataTypes::Int16;
+        }
+        if constexpr (std::is_same<T, std::uint16_t>::value)
+        {
+            return DataTypes::UInt16;
+        }
+#endif
+        if constexpr (std::is_same<T, std::int32_t>::value)
+        {
+            return DataTypes::Int32;
+        }
+        if constexpr (std::is_same<T, std::uint32_t>::value)
+        {
+            return DataTypes::UInt32;
+        }
+        if constexpr (std::is_same<T, std::int64_t>::value)
+        {
+            return DataTypes::Int64;
+        }
+        if constexpr (std::is_same<T, std::uint64_t>::value)
+        {
+            return DataTypes::UInt64;
+        }
+        if constexpr (std::is_same<T, float>::value)
+        {
+            return DataTypes::Float32;
+        }
+        if constexpr (std::is_same<T, double>::value)
+        {
+            return DataTypes::Float64;
+        }
+        return DataTypes::None;
+    }
+
+    /**
+     * @brief Returns the elements of an array record without copying them.
+     *
+     * The elements are not converted, T must be the element type the array was written
+     * with. The elements are aligned to their size relative to the start of the image, so
+     * an image that is not aligned to 8 bytes can not be read as span of 64-bit elements.
+     *
+     * @tparam T Element type.
+     * @param rec Record to decode.
+     * @return The elements or std::nullopt if the record is not an array of T or not aligned.
+     */
+    template<typename T>
+    std::optional<std::span<const T>> decodeArray(const RecordRef& rec) noexcept
+    {
+        static_assert(getArrayElementType<T>() != DataTypes::None, "Unsupported element type for decodeArray");
+
+        if ((rec.type != DataTypes::Array) || (rec.data_size < PBF_ARRAY_HEADER_SIZE))
+        {
+            return std::nullopt;
+        }
+        std::uint32_t descriptor = loadU32(rec.data);
+        std::uint32_t count = loadU32(rec.data + sizeof(std::uint32_t));
+        std::uint32_t elementsOffset = descriptor & 0x00FFFFFF;
+        if ((static_cast<DataTypes>(descriptor >> 24U) != getArrayElementType<T>()) ||
+            (elementsOffset < PBF_ARRAY_HEADER_SIZE) || (elementsOffset > rec.data_size) ||
+            (count > (rec.data_size - elementsOffset) / sizeof(T)))
+        {
+            return std::nullopt;
+        }
+        const std::uint8_t* elements = rec.data + elementsOffset;
+        if ((reinterpret_cast<std::uintptr_t>(elements) % alignof(T)) != 0U)
+        {
+            return std::nullopt;
+        }
+        return std::span<const T>(reinterpret_cast<const T*>(elements), count);
+    }
+}
@@ -0,0 +1,466 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string_view>
+#include "Pbf.h"
+#include "PBFValue.h"
+#include "PBFSections.h"
+#include "PBFHierarchy.h"
+#include "PBFKeyNames.h"
+#include "PBFChecksum.h"
+#include "PBFByteOrder.h"
+#include "PBFPerfectHash.h"
+
+namespace PBF
+{
+    /**
+     * @class PBFView
+     * @brief Zero-copy reader that answers queries directly from a PBF image.
+     *
+     * Unlike PBFReader the view does not decode the records into its own containers.
+     * The image (a buffer in RAM, a memory mapped file or a flash region) is used as it is
+     * and must stay valid and unchanged as long as the view is used.
+     * Opening an image only validates the header and the section directory, records are
+     * decoded in place when they are requested. Lookups use the PerfectHash section or the
+     * HashIndex section if the image has one, otherwise the records are scanned. Strings are returned as std::string_view pointing into the image.
+     * The view never allocates memory. Images of the other byte order are not opened, they
+     * have to be converted with swapByteOrder first.
+     */
+    class PBFView
+    {
+    public:
+
+        PBFView() = default;
+
+        explicit PBFView(std::span<const std::byte> image) noexcept
+        {
+            open(image);
+        }
+
+        PBFView(const void* memory, std::size_t size) noexcept
+        {
+            open(memory, size);
+        }
+
+        bool open(std::span<const std::byte> image) noexcept
+        {
+            return open(static_cast<const void*>(image.data()), image.size());
+        }
+
+        bool open(const void* memory, std::size_t size) noexcept
+        {
+            close();
+
+            if ((memory == nullptr) || (size < PBF_FILE_HEADER_SIZE))
+            {
+                return false;
+            }
+            const std::uint8_t* base = static_cast<const std::uint8_t*>(memory);
+
+            /*Read size*/
+            std::uint32_t image_size = loadU32(base);
+            if ((image_size < PBF_FILE_HEADER_SIZE) || (image_size > size))
+            {
+                return false;
+            }
+
+            /*images of the other byte order are swapped before, see swapByteOrder*/
+            if (getImageByteOrder(base, size) != std::endian::native)
+            {
+                return false;
+            }
+            std::uint32_t vr = loadU32(base + sizeof(std::uint32_t));
+
+            SectionDirectory directory;
+            if (!directory.open(base, image_size))
+            {
+                return false;
+            }
+
+            auto index = directory.find(SectionTypes::HashIndex);
+            if (index && !_index.open(index.value()))
+            {
+                return false;
+            }
+
+            auto perfectHash = directory.find(SectionTypes::PerfectHash);
+            if (perfectHash && !_perfectHash.open(perfectHash.value()))
+            {
+                return false;
+            }
+
+            auto hierarchy = directory.find(SectionTypes::Hierarchy);
+            if (hierarchy && !_hierarchy.open(hierarchy.value()))
+            {
+                return false;
+            }
+
+            auto keyNames = directory.find(SectionTypes::KeyNames);
+            if (keyNames && !_keyNames.open(keyNames.value()))
+            {
+                return false;
+            }
+
+            auto checksum = directory.find(SectionTypes::Checksum);
+            if (checksum && (checksum->size < PBF_CHECKSUM_SECTION_SIZE))
+            {
+                return false;
+            }
+
+            auto stringPool = directory.find(SectionTypes::StringPool);
+
+            auto layout = directory.find(SectionTypes::FixedLayout);
+            if (layout && !_layout.open(layout.value()))
+            {
+                return false;
+            }
+
+            _base = base;
+            _size = image_size;
+            _version = static_cast<std::uint16_t>(vr >> 16U);
+            _seed = static_cast<std::uint16_t>(vr & PBF_HEADER_SEED_MASK);
+            _recordsEnd = directory.getRecordsEnd();
+            _checksum = checksum.value_or(SectionRef());
+            _stringPool = stringPool.value_or(SectionRef());
+            return true;
+        }
+
+        void close() noexcept
+        {
+            _base = nullptr;
+            _size = 0U;
+            _version = 0U;
+            _seed = 0U;
+            _recordsEnd = 0U;
+            _index = HashIndex();
+            _perfectHash = PerfectHashIndex();
+            _layout = FixedLayoutSection();
+            _hierarchy = HierarchyIndex();
+            _keyNames = KeyNameIndex();
+            _checksum = SectionRef();
+            _stringPool = SectionRef();
+        }
+
+        bool isOpen() const noexcept
+        {
+            return (_base != nullptr);
+        }
+
+        std::uint32_t size() const noexcept
+        {
+            return _size;
+        }
+
+        std::uint16_t version() const noexcept
+        {
+            return _version;
+        }
+
+        /*Hash seed of the keys, 0 if they are hashed with pbfHash*/
+        std::uint16_t seed() const noexcept
+        {
+            return _seed;
+        }
+
+        /*KeyHash of a key in this image, hashed with its seed*/
+        KeyHash key(std::string_view text) const noexcept
+        {
+            return pbfKey(text, _seed);
+        }
+
+        std::span<const std::byte> image() const noexcept
+        {
+            return std::span<const std::byte>(static_cast<const std::byte*>(static_cast<const void*>(_base)), _size);
+        }
+
+        bool contains(KeyHash key) const noexcept
+        {
+            return findRecord(key.value).has_value();
+        }
+
+        PBF::DataTypes getType(KeyHash key) const noexcept
+        {
+            auto rec = findRecord(key.value);
+            if (!rec)
+            {
+                return DataTypes::None;
+            }
+            return rec->type;
+        }
+
+        /**
+         * @brief Returns the value of a parameter converted to T.
+         *
+         * Supports the same types as PBFReader::getParam, except that strings are returned as
+         * std::string_view pointing into the image.
+         */
+        template<typename T>
+        std::optional<T> getParam(KeyHash key) const noexcept
+        {
+            static_assert(isSupportedValueType<T>(), "Unsupported type for getParam");
+
+            auto rec = findRecord(key.value);
+            if (!rec)
+            {
+                return std::nullopt;
+            }
+            return decodeValue<T>(rec.value());
+        }
+
+        /**
+         * @brief Returns the elements of an array parameter as span into the image.
+         *
+         * T must be the element type of the array, see decodeArray.
+         */
+        template<typename T>
+        std::optional<std::span<const T>> getArray(KeyHash key) const noexcept
+        {
+            auto rec = findRecord(key.value);
+            if (!rec)
+            {
+                return std::nullopt;
+            }
+            return decodeArray<T>(rec.value());
+        }
+
+        /**
+         * @brief Returns the FixedLayout section for direct member access.
+         *
+         * Used by the getLayout function of a header generated with the --header option of the
+         * converter, which passes its fingerprint and the size of its struct.
+         * @return Start of the layout data or nullptr if the image has no FixedLayout section or it does not match.
+         */
+        const void* getFixedLayout(std::uint32_t fingerprint, std::size_t size) const noexcept
+        {
+            return _layout.get(fingerprint, size);
+        }
+
+        /*Hierarchy section, not open if the image has none*/
+        const HierarchyIndex& getHierarchy() const noexcept
+        {
+            return _hierarchy;
+        }
+
+        /**
+         * @brief Calls visitor(const RecordRef&) for every parameter below a table.
+         *
+         * Needs the Hierarchy section (converter option --hierarchy), the work is proportional
+         * to the size of the subtree.
+         * @param prefix Key of the table, e.g. "Plant.Motors[0]", or "" for all parameters.
+         * @return Number of parameters visited.
+         */
+        template<typename Visitor>
+        std::uint32_t forEachUnder(KeyHash prefix, Visitor&& visitor) const
+        {
+            std::uint32_t visited(0U);
+            _hierarchy.forEachParameterUnder(prefix.value, [this, &visitor, &visited](std::uint32_t hash)
+            {
+                auto rec = findRecord(hash);
+                if (rec)
+                {
+                    visitor(static_cast<const RecordRef&>(rec.value()));
+                    visited++;
+                }
+            });
+            return visited;
+        }
+
+        /*Number of direct children (tables and parameters) of a table, needs the Hierarchy section*/
+        std::uint32_t childCount(KeyHash prefix) const noexcept
+        {
+            return _hierarchy.childCount(prefix.value);
+        }
+
+        /*StringPool section of the PooledString records, empty if the image has none*/
+        const SectionRef& getStringPool() const noexcept
+        {
+            return _stringPool;
+        }
+
+        /*KeyNames section, not open if the image has none*/
+        const KeyNameIndex& getKeyNames() const noexcept
+        {
+            return _keyNames;
+        }
+
+        /**
+         * @brief Maps a key hash back to the name of the key, for diagnostics.
+         *
+         * Needs the KeyNames section (converter option --key-names).
+         * @return The name in buffer (not terminated), std::nullopt if it is unknown or does not fit.
+         */
+        std::optional<std::string_view> getKeyName(KeyHash key, std::span<char> buffer) const noexcept
+        {
+            return _keyNames.getName(key.value, buffer);
+        }
+
+        bool hasChecksum() const noexcept
+        {
+            return (_checksum.type == SectionTypes::Checksum);
+        }
+
+        /**
+         * @brief Checks the CRC32C of the Checksum section (converter option --checksum).
+         *
+         * Reads the whole image in front of the section once, with the CRC instructions of the
+         * CPU where available (see crc32c).
+         * @return false if the image has no Checksum section or the CRC does not match.
+         */
+        bool verifyChecksum() const noexcept
+        {
+            if (!hasChecksum())
+            {
+                return false;
+            }
+            return (crc32c(_base, _checksum.offset) == loadU32(_checksum.data));
+        }
+
+        bool hasIndex() const noexcept
+        {
+            return _index.isOpen() || _perfectHash.isOpen();
+        }
+
+        /*Number of records as stored in the index sections, std::nullopt for images without index*/
+        std::optional<std::uint32_t> recordCount() const noexcept
+        {
+            if (_perfectHash.isOpen())
+            {
+                return _perfectHash.size();
+            }
+            if (_index.isOpen())
+            {
+                return _index.size();
+            }
+            return std::nullopt;
+        }
+
+        std::optional<RecordRef> findRecord(std::uint32_t hash) const noexcept
+        {
+            RecordRef rec;
+            if (_perfectHash.isOpen() || _index.isOpen())
+            {
+                auto offset = _perfectHash.isOpen() ? _perfectHash.find(hash) : _index.find(hash);
+                if (!offset || (offset.value() < PBF_FILE_HEADER_SIZE))
+                {
+                    return std::nullopt;
+                }
+                std::uint32_t next = offset.value();
+                if (!nextRecord(next, rec) || (rec.hash != hash))
+                {
+                    return std::nullopt;
+                }
+                return rec;
+            }
+
+            std::uint32_t offset(PBF_FILE_HEADER_SIZE);
+            while (nextRecord(offset, rec))
+            {
+                if (rec.hash == hash)
+                {
+                    return rec;
+                }
+            }
+            return std::nullopt;
+        }
+
+        /**
+         * @brief Calls visitor(const RecordRef&) for every record in the image (in file order).
+         * @return false if the image contains a malformed record.
+         */
+        template<typename Visitor>
+        bool forEachRecord(Visitor&& visitor) const
+        {
+            RecordRef rec;
+            std::uint32_t offset(PBF_FILE_HEADER_SIZE);
+            while (nextRecord(offset, rec))
+            {
+                visitor(static_cast<const RecordRef&>(rec));
+            }
+            return (offset == _recordsEnd);
+        }
+
+    private:
+
+        /*Parses the record at offset and advances offset to the next record*/
+        bool nextRecord(std::uint32_t& offset, RecordRef& rec) const noexcept
+        {
+            if ((_base == nullptr) || (offset > _recordsEnd) || (PBF_FILE_RECORD_HEADER_SIZE > _recordsEnd - offset))
+            {
+                return false;
+            }
+
+            const std::uint8_t* pMem = _base + offset;
+            std::uint32_t reg1 = loadU32(pMem + sizeof(std::uint32_t));
+            DataTypes type = static_cast<DataTypes>(reg1 >> 24U);
+            std::uint32_t data_size = getRecordDataSize(type, reg1 & 0x00FFFFFF);
+
+            if ((data_size == 0U) || (data_size > (_recordsEnd - offset - PBF_FILE_RECORD_HEADER_SIZE)))
+            {
+                return false;
+            }
+
+            rec.hash = loadU32(pMem);
+            rec.type = type;
+            rec.data_size = data_size;
+            rec.data = pMem + PBF_FILE_RECORD_HEADER_SIZE;
+            if (type == DataTypes::PooledString)
+            {
+                /*resolved to the string in the pool, it is read like any other string*/
+                std::uint32_t poolOffset = loadU32(rec.data);
+                std::uint32_t length = reg1 & 0x00FFFFFF;
+                if ((poolOffset > _stringPool.size) || (length >= _stringPool.size - poolOffset) || (_stringPool.data[poolOffset + length] != 0U))
+                {
+                    return false;
+                }
+                rec.type = DataTypes::String;
+                rec.data_size = length + 1U;
+                rec.data = _stringPool.data + poolOffset;
+            }
+
+            offset += PBF_FILE_RECORD_HEADER_SIZE + data_size;
+            return true;
+        }
+
+        const std::uint8_t* _base = nullptr;
+        std::uint32_t _size = 0U;
+        std::uint16_t _version = 0U;
+        std::uint16_t _seed = 0U;
+        std::uint32_t _recordsEnd = 0U;
+        HashIndex _index;
+        PerfectHashIndex _perfectHash;
+        FixedLayoutSection _layout;
+        HierarchyIndex _hierarchy;
+        KeyNameIndex _keyNames;
+        SectionRef _checksum;
+        SectionRef _stringPool;
+    };
+}
@@ -31,30 +31,54 @@ SOFTWARE.
 #include <string>
 #include <chrono>
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include <bit>
+#include <unordered_map>
 #include "Pbf.h"
+#include "PBFPerfectHash.h"
+#include "PBFChecksum.h"
 
 namespace PBF
 {
+    /**
+     * @struct PbfSection
+     * @brief Content of one optional section written after the binary records.
+     */
+    struct PbfSection
+    {
+        SectionTypes type = SectionTypes::None;
+        std::vector<std::uint32_t> data;
+    };
+
     class ParamBinFileWriter
 	{
     public:
 
         ParamBinFileWriter() = delete;
 
-        explicit ParamBinFileWriter (void* memory, std::size_t size): _memory(memory), _start(memory)
+        /*size: capacity of memory, writes that do not fit return 0 and leave memory unchanged*/
+        explicit ParamBinFileWriter (void* memory, std::size_t size): _memory(memory), _start(memory), _capacity((memory != nullptr) ? size : 0U)
         {
         }
 
-        std::uint32_t writeHeader(std::uint32_t size, uint16_t version)
+        /*seed: hash seed of the keys (pbfHashSeeded, at most PBF_MAX_HASH_SEED), files with a seed get at least version PBF_FILE_VERSION_SEEDED*/
+        std::uint32_t writeHeader(std::uint32_t size, uint16_t version, std::uint16_t seed = 0U)
         {            
-            if (_start != nullptr)
+            if ((_start != nullptr) && fits(_start, PBF_FILE_HEADER_SIZE))
             {
                 void* mem = _start;
                 uint32_t* pMem = static_cast<uint32_t*>(mem);
                 memcpy(pMem, static_cast<void*>(&size), sizeof(uint32_t));
                 pMem++;
 
-                uint32_t v = version << 16U;
+                if ((seed != 0U) && (version < PBF_FILE_VERSION_SEEDED))
+                {
+                    version = PBF_FILE_VERSION_SEEDED;
+                }
+                /*the image is written in the byte order of this computer*/
+                uint32_t v = (static_cast<uint32_t>(version) << 16U) | (seed & PBF_HEADER_SEED_MASK) |
+                    ((std::endian::native == std::endian::big) ? PBF_HEADER_BIG_ENDIAN : 0U);
                 memcpy(pMem, static_cast<void*>(&v), sizeof(uint32_t));
                 pMem++;
 
@@ -69,9 +93,21 @@ namespace PBF
             return 0U;
         }
 
+        /*Returns the number of bytes written, 0 if the record does not fit*/
         std::uint32_t writeRecord(PBF::BinaryDataRecord& record, void* data)
         {
             uint32_t* pMem = static_cast<uint32_t*>(_memory);
+
+            DataTypes recordType = static_cast<DataTypes>(record.type);
+            std::uint32_t needed = PBF_FILE_RECORD_HEADER_SIZE + ((recordType == DataTypes::String) ?
+                ((record.data_size + 1U + sizeof(uint32_t) - 1U) / sizeof(uint32_t)) * sizeof(uint32_t) : getRecordDataSize(recordType, record.data_size));
+            if (!fits(pMem, needed))
+            {
+                return 0U;
+            }
+
+            _records.push_back(std::make_pair(record.hash, getOffset(pMem)));
+
             // Write the hash
             memcpy(pMem, static_cast<void*>(&(record.hash)), sizeof(uint32_t));
             pMem++;
@@ -220,8 +256,358 @@ namespace PBF
             return recSize;
         }
 
-    private:       
+        /**
+         * @brief Writes an array record.
+         *
+         * The elements are aligned to their size relative to the start of the image.
+         * @param elementType Type of the elements, see getArrayElementSize.
+         * @param count Number of elements.
+         * @param elements The elements in the format of elementType.
+         * @return Number of bytes written, 0 if the type can not be an array element or the array is too large.
+         */
+        std::uint32_t writeArrayRecord(std::uint32_t hash, DataTypes elementType, std::uint32_t count, const void* elements)
+        {
+            std::uint32_t elementSize = getArrayElementSize(elementType);
+            if ((elementSize == 0U) || (count > (0x00FFFFFF - PBF_ARRAY_HEADER_SIZE - sizeof(std::uint32_t)) / elementSize))
+            {
+                return 0U;
+            }
+            uint32_t* pMem = static_cast<uint32_t*>(_memory);
+            std::uint32_t dataSize = getArrayRecordDataSize(elementType, count);
+            if (!fits(pMem, PBF_FILE_RECORD_HEADER_SIZE + dataSize))
+            {
+                return 0U;
+            }
+
+            _records.push_back(std::make_pair(hash, getOffset(pMem)));
+
+            std::uint32_t reg1 = (static_cast<std::uint32_t>(DataTypes::Array) << 24U) | dataSize;
+            memcpy(pMem, static_cast<void*>(&hash), sizeof(uint32_t));
+            pMem++;
+            memcpy(pMem, static_cast<void*>(&reg1), sizeof(uint32_t));
+            pMem++;
+
+            /*records start on 32-bit boundaries, 64-bit elements may need 4 bytes in front*/
+            std::uint32_t elementsOffset = PBF_ARRAY_HEADER_SIZE;
+            if (((getOffset(pMem) + elementsOffset) % elementSize) != 0U)
+            {
+                elementsOffset += sizeof(std::uint32_t);
+            }
+            std::uint8_t* pData = static_cast<std::uint8_t*>(static_cast<void*>(pMem));
+            memset(pData, 0U, dataSize);
+
+            std::uint32_t descriptor = (static_cast<std::uint32_t>(elementType) << 24U) | elementsOffset;
+            memcpy(pData, static_cast<void*>(&descriptor), sizeof(uint32_t));
+            memcpy(pData + sizeof(uint32_t), static_cast<void*>(&count), sizeof(uint32_t));
+            if (count > 0U)
+            {
+                memcpy(pData + elementsOffset, elements, count * elementSize);
+            }
+
+            _memory = static_cast<void*>(pData + dataSize);
+            return PBF_FILE_RECORD_HEADER_SIZE + dataSize;
+        }
+
+        /**
+         * @brief Writes a string record that refers to the string pool.
+         *
+         * Every distinct string is stored once in the pool, see makeStringPoolSection. The
+         * record takes PBF_FILE_RECORD_HEADER_SIZE + 4 bytes independent of the string.
+         * @return Number of bytes written, 0 if the string is longer than the 24-bit size field or the record does not fit.
+         */
+        std::uint32_t writePooledStringRecord(std::uint32_t hash, const std::string& str)
+        {
+            uint32_t* pMem = static_cast<uint32_t*>(_memory);
+            if ((str.size() >= 0x00FFFFFF) || !fits(pMem, PBF_FILE_RECORD_HEADER_SIZE + sizeof(uint32_t)))
+            {
+                return 0U;
+            }
+
+            _records.push_back(std::make_pair(hash, getOffset(pMem)));
+
+            auto [pooled, added] = _stringPoolOffsets.try_emplace(str, static_cast<std::uint32_t>(_stringPool.size()));
+            if (added)
+            {
+                _stringPool.insert(_stringPool.end(), str.begin(), str.end());
+                _stringPool.push_back('\0');
+            }
+
+            std::uint32_t words[3] = { hash, (static_cast<std::uint32_t>(DataTypes::PooledString) << 24U) | static_cast<std::uint32_t>(str.size()), pooled->second };
+            memcpy(pMem, static_cast<void*>(words), sizeof(words));
+            _memory = static_cast<void*>(pMem + 3U);
+            return sizeof(words);
+        }
+
+        /**
+         * @brief Builds the StringPool section with the strings of all pooled string records.
+         */
+        PbfSection makeStringPoolSection() const
+        {
+            return makeStringPoolSection(_stringPool);
+        }
+
+        /*StringPool section of the strings in pool, each followed by \0*/
+        static PbfSection makeStringPoolSection(const std::vector<char>& pool)
+        {
+            PbfSection section;
+            section.type = SectionTypes::StringPool;
+            section.data.assign(getStringPoolSectionSize(static_cast<std::uint32_t>(pool.size())) / sizeof(std::uint32_t), 0U);
+            if (!pool.empty())
+            {
+                memcpy(section.data.data(), pool.data(), pool.size());
+            }
+            return section;
+        }
+
+        /**
+         * @brief Builds the HashIndex section for all records written so far.
+         */
+        PbfSection makeHashIndexSection() const
+        {
+            return makeHashIndexSection(_records);
+        }
+
+        /*HashIndex section of records (hash and offset of every record)*/
+        static PbfSection makeHashIndexSection(const std::vector<std::pair<std::uint32_t, std::uint32_t>>& records)
+        {
+            std::vector<std::pair<std::uint32_t, std::uint32_t>> sorted(records);
+            sortByHash(sorted);
+            return makeSortedHashIndexSection(sorted);
+        }
+
+        /*HashIndex section of records that are already sorted with sortByHash*/
+        static PbfSection makeSortedHashIndexSection(const std::vector<std::pair<std::uint32_t, std::uint32_t>>& sorted)
+        {
+            PbfSection section;
+            section.type = SectionTypes::HashIndex;
+            section.data.reserve(1U + 2U * sorted.size());
+            section.data.push_back(static_cast<std::uint32_t>(sorted.size()));
+            for (const auto& [hash, offset] : sorted)
+            {
+                section.data.push_back(hash);
+            }
+            for (const auto& [hash, offset] : sorted)
+            {
+                section.data.push_back(offset);
+            }
+            return section;
+        }
+
+        /**
+         * @brief Builds the PerfectHash section for all records written so far.
+         * @return Section of type None if the hashes of the records are not unique.
+         */
+        PbfSection makePerfectHashSection() const
+        {
+            return makePerfectHashSection(_records);
+        }
+
+        /*PerfectHash section of records (hash and offset of every record), type None if the hashes are not unique*/
+        static PbfSection makePerfectHashSection(const std::vector<std::pair<std::uint32_t, std::uint32_t>>& records)
+        {
+            std::vector<std::uint32_t> hashes;
+            hashes.reserve(records.size());
+            for (const auto& [hash, offset] : records)
+            {
+                hashes.push_back(hash);
+            }
+
+            PbfSection section;
+            PerfectHashBuilder builder;
+            if (builder.build(hashes))
+            {
+                section.type = SectionTypes::PerfectHash;
+                section.data = builder.makeSection(records);
+            }
+            return section;
+        }
+
+        /**
+         * @brief Builds the Checksum section, the CRC is filled in by writeSections.
+         *
+         * The CRC covers everything in front of the section data, so it should be the last section.
+         */
+        static PbfSection makeChecksumSection()
+        {
+            PbfSection section;
+            section.type = SectionTypes::Checksum;
+            section.data.assign(PBF_CHECKSUM_SECTION_SIZE / sizeof(std::uint32_t), 0U);
+            return section;
+        }
+
+        /**
+         * @brief Builds the FixedLayout section from the data of a generated struct.
+         * @param fingerprint Fingerprint of the layout, compiled into the generated header.
+         * @param layout Bytes of the struct.
+         */
+        static PbfSection makeFixedLayoutSection(std::uint32_t fingerprint, const std::vector<std::uint8_t>& layout)
+        {
+            PbfSection section;
+            section.type = SectionTypes::FixedLayout;
+            section.data.assign(getFixedLayoutSectionSize(static_cast<std::uint32_t>(layout.size())) / sizeof(std::uint32_t), 0U);
+            section.data[0] = fingerprint;
+            section.data[1] = static_cast<std::uint32_t>(layout.size());
+            if (!layout.empty())
+            {
+                memcpy(section.data.data() + 2U, layout.data(), layout.size());
+            }
+            return section;
+        }
+
+        /**
+         * @brief Writes the section directory and the sections after the last record.
+         *
+         * Must be called once, after all records have been written. The header is updated to
+         * point to the directory.
+         * @return Number of bytes written, 0 if the sections do not fit.
+         */
+        std::uint32_t writeSections(const std::vector<PbfSection>& sections)
+        {
+            if ((_start == nullptr) || sections.empty())
+            {
+                return 0U;
+            }
+            uint32_t* pMem = static_cast<uint32_t*>(_memory);
+            std::size_t total = getSectionDirectorySize(static_cast<std::uint32_t>(sections.size()));
+            for (const PbfSection& section : sections)
+            {
+                total += section.data.size() * sizeof(std::uint32_t);
+            }
+            if (!fits(pMem, total))
+            {
+                return 0U;
+            }
+            std::uint32_t directory = getOffset(pMem);
+            std::uint32_t offset = directory + getSectionDirectorySize(static_cast<std::uint32_t>(sections.size()));
+
+            std::uint32_t count = static_cast<std::uint32_t>(sections.size());
+            memcpy(pMem, static_cast<void*>(&count), sizeof(uint32_t));
+            pMem++;
+
+            for (const PbfSection& section : sections)
+            {
+                std::uint32_t entry[3] = { static_cast<std::uint32_t>(section.type), offset, static_cast<std::uint32_t>(section.data.size() * sizeof(std::uint32_t)) };
+                memcpy(pMem, static_cast<void*>(entry), sizeof(entry));
+                pMem += 3U;
+                offset += entry[2];
+            }
+
+            for (const PbfSection& section : sections)
+            {
+                if (!section.data.empty())
+                {
+                    memcpy(pMem, static_cast<const void*>(section.data.data()), section.data.size() * sizeof(std::uint32_t));
+                    pMem += section.data.size();
+                }
+            }
+            _memory = static_cast<void*>(pMem);
+
+            /*update version and directory offset in the header*/
+            uint32_t* pHeader = static_cast<uint32_t*>(_start);
+            uint32_t vr(0U);
+            memcpy(&vr, pHeader + 1U, sizeof(uint32_t));
+            if ((vr >> 16U) < PBF_FILE_VERSION_SECTIONS)
+            {
+                vr = (static_cast<uint32_t>(PBF_FILE_VERSION_SECTIONS) << 16U) | (vr & 0xFFFF);
+                memcpy(pHeader + 1U, &vr, sizeof(uint32_t));
+            }
+            memcpy(pHeader + 2U, &directory, sizeof(uint32_t));
+
+            /*checksums last, they cover the final header*/
+            std::uint32_t sectionOffset = directory + getSectionDirectorySize(count);
+            for (const PbfSection& section : sections)
+            {
+                if ((section.type == SectionTypes::Checksum) && (section.data.size() * sizeof(std::uint32_t) >= PBF_CHECKSUM_SECTION_SIZE))
+                {
+                    std::uint32_t crc = crc32c(_start, sectionOffset);
+                    memcpy(static_cast<std::uint8_t*>(_start) + sectionOffset, &crc, sizeof(uint32_t));
+                }
+                sectionOffset += static_cast<std::uint32_t>(section.data.size() * sizeof(std::uint32_t));
+            }
+
+            return offset - directory;
+        }
+
+        /**
+         * @brief Sorts records (hash and offset) by hash, records with the same hash keep their order.
+         *
+         * The offsets of written records ascend, so this is the order of sorting the pairs. Large
+         * inputs are sorted with three passes of an 11-bit radix sort instead of comparisons.
+         */
+        static void sortByHash(std::vector<std::pair<std::uint32_t, std::uint32_t>>& records)
+        {
+            const std::uint32_t RADIX_BITS = 11U;
+            const std::uint32_t BUCKETS = 1U << RADIX_BITS;
+            if (records.size() < 4U * BUCKETS)
+            {
+                std::stable_sort(records.begin(), records.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+                return;
+            }
+            std::vector<std::pair<std::uint32_t, std::uint32_t>> buffer(records.size());
+            std::vector<std::uint32_t> counts(3U * BUCKETS, 0U);
+            for (const auto& record : records)
+            {
+                counts[record.first & (BUCKETS - 1U)]++;
+                counts[BUCKETS + ((record.first >> RADIX_BITS) & (BUCKETS - 1U))]++;
+                counts[2U * BUCKETS + (record.first >> (2U * RADIX_BITS))]++;
+            }
+            for (std::uint32_t pass = 0U; pass < 3U; pass++)
+            {
+                std::uint32_t* bucket = counts.data() + pass * BUCKETS;
+                std::uint32_t start(0U);
+                for (std::uint32_t i = 0U; i < BUCKETS; i++)
+                {
+                    std::uint32_t n = bucket[i];
+                    bucket[i] = start;
+                    start += n;
+                }
+                for (const auto& record : records)
+                {
+                    buffer[bucket[(record.first >> (pass * RADIX_BITS)) & (BUCKETS - 1U)]++] = record;
+                }
+                records.swap(buffer);
+            }
+        }
+
+        static std::uint32_t getSectionDirectorySize(std::uint32_t numberOfSections)
+        {
+            return sizeof(std::uint32_t) + numberOfSections * PBF_SECTION_ENTRY_SIZE;
+        }
+
+        static std::uint32_t getHashIndexSectionSize(std::uint32_t numberOfRecords)
+        {
+            return sizeof(std::uint32_t) + numberOfRecords * 2U * sizeof(std::uint32_t);
+        }
+
+        /*stringBytes: all distinct strings with their \0*/
+        static std::uint32_t getStringPoolSectionSize(std::uint32_t stringBytes)
+        {
+            return ((stringBytes + sizeof(std::uint32_t) - 1U) / sizeof(std::uint32_t)) * sizeof(std::uint32_t);
+        }
+
+        static std::uint32_t getFixedLayoutSectionSize(std::uint32_t layoutSize)
+        {
+            return PBF_FIXED_LAYOUT_HEADER_SIZE + ((layoutSize + sizeof(std::uint32_t) - 1U) / sizeof(std::uint32_t)) * sizeof(std::uint32_t);
+        }
+
+    private:
+
+        std::uint32_t getOffset(const void* mem) const
+        {
+            return static_cast<std::uint32_t>(static_cast<const std::uint8_t*>(mem) - static_cast<const std::uint8_t*>(_start));
+        }
+
+        /*true if bytes more bytes fit behind mem*/
+        bool fits(const void* mem, std::size_t bytes) const
+        {
+            return bytes <= _capacity - getOffset(mem);
+        }
+
         void* _memory = nullptr;
         void* _start = nullptr;
+        std::size_t _capacity = 0U; /*size of the memory at _start*/
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> _records; /*hash and offset of every written record*/
+        std::vector<char> _stringPool; /*strings of the pooled string records*/
+        std::unordered_map<std::string, std::uint32_t> _stringPoolOffsets; /*string -> offset in the pool*/
  	};
 }
\ No newline at end of file
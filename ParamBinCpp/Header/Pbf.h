@@ -28,6 +28,7 @@ SOFTWARE.
 #pragma once
 #include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace PBF
 {
@@ -35,12 +36,34 @@ namespace PBF
     const std::uint32_t PBF_FILE_RECORD_HEADER_SIZE = 8U;
 
     const std::uint16_t PBF_FILE_VERSION = 1U;
+    const std::uint16_t PBF_FILE_VERSION_SECTIONS = 2U; /*files with a section directory*/
+    const std::uint16_t PBF_FILE_VERSION_SEEDED = 3U; /*files with a hash seed in the header*/
+    const std::uint32_t PBF_MAX_HASH_SEED = 0x7FFFU;
+    const std::uint32_t PBF_HEADER_SEED_MASK = 0x7FFFU; /*hash seed in the low half of the version word*/
+    const std::uint32_t PBF_HEADER_BIG_ENDIAN = 0x8000U; /*flag in the low half of the version word, set for big-endian images*/
 
-    inline std::uint32_t pbfHash(std::string_view text)
+    const std::uint32_t PBF_SECTION_ENTRY_SIZE = sizeof(std::uint32_t) * 3U;
+
+    const std::uint32_t PBF_ARRAY_HEADER_SIZE = sizeof(std::uint32_t) * 2U;
+
+    const std::uint32_t PBF_FIXED_LAYOUT_HEADER_SIZE = sizeof(std::uint32_t) * 2U;
+
+    /*
+     * Define PBF_RT for code that reads parameters from real-time tasks. All lookup functions
+     * (getParam, getType, contains, resolve, ...) are noexcept in every build, do not allocate
+     * and their work is bounded by the size of the image. With PBF_RT the lookups that would
+     * have to allocate, like PBFReader::getParam<std::string>, do not compile.
+     * Loading an image (PBFReader::read) allocates and is meant for the initialization phase.
+     */
+
+    /*
+     * Continues the hash of a key prefix with more characters:
+     * pbfHashContinue(pbfHash("Plant.Motors[0]"), ".Rs") == pbfHash("Plant.Motors[0].Rs")
+     */
+    constexpr std::uint32_t pbfHashContinue(std::uint32_t hash, std::string_view text) noexcept
     {
         //fnv1aHash
         const std::uint32_t prime = 0x01000193; // 16777619
-        std::uint32_t hash = 0x811C9DC5; // 2166136261
 
         for (char c : text)
         {
@@ -48,7 +71,79 @@ namespace PBF
             hash *= prime;
         }
         return hash;
+    }
+
+    constexpr std::uint32_t pbfHash(std::string_view text) noexcept
+    {
+        return pbfHashContinue(0x811C9DC5, text); // 2166136261
+    };
+
+    /*
+     * Hash of a key in an image with a hash seed. The converter only writes a seed if two keys
+     * of the file have the same pbfHash, seed 0 is pbfHash.
+     */
+    constexpr std::uint32_t pbfHashSeeded(std::uint32_t seed, std::string_view text) noexcept
+    {
+        return pbfHashContinue(0x811C9DC5 ^ (seed * 0x9E3779B9), text);
+    }
+
+    /**
+     * @struct KeyHash
+     * @brief Hash of a parameter key.
+     *
+     * All lookups take a KeyHash. It is implicitly created from strings, so existing calls
+     * with std::string keys keep working. For constant keys the hash is computed at compile
+     * time, e.g. with the literal "Plant.Motors[0].PeakTorque"_pbf, and lookups then do no
+     * hashing and no string handling at all.
+     *
+     * A KeyHash created from a string is the pbfHash of the key, which only matches images
+     * without a hash seed. For an image with a seed create the keys with key() of the reader,
+     * or with pbfKey(key, seed), which is computed at compile time for constant keys. The
+     * constants of the header generated by the converter are already seeded.
+     */
+    struct KeyHash
+    {
+        constexpr KeyHash() noexcept = default;
+
+        constexpr explicit KeyHash(std::uint32_t hash) noexcept : value(hash)
+        {
+        }
+
+        constexpr KeyHash(std::string_view key) noexcept : value(pbfHash(key))
+        {
+        }
+
+        constexpr KeyHash(const char* key) noexcept : value(pbfHash(key))
+        {
+        }
+
+        KeyHash(const std::string& key) noexcept : value(pbfHash(key))
+        {
+        }
+
+        constexpr bool operator==(const KeyHash& other) const noexcept
+        {
+            return value == other.value;
+        }
+
+        std::uint32_t value = 0U;
     };
+    static_assert(sizeof(KeyHash) == sizeof(std::uint32_t), "Arrays of keys for getParams are arrays of hashes");
+
+    /*KeyHash of a key in an image with the given hash seed*/
+    constexpr KeyHash pbfKey(std::string_view key, std::uint16_t seed) noexcept
+    {
+        return KeyHash(pbfHashSeeded(seed, key));
+    }
+
+    inline namespace literals
+    {
+        /*"Ts"_pbf is the KeyHash of "Ts", computed by the compiler*/
+        consteval KeyHash operator""_pbf(const char* text, std::size_t length) noexcept
+        {
+            return KeyHash(std::string_view(text, length));
+        }
+    }
 
     // Define some compound types
     struct Date
@@ -108,6 +203,8 @@ namespace PBF
         Date = 13, /**< Date type, stored as a uint32_t (year 16 bits, month 8 bits, day 8 bits). */
         Time = 14, /**< Time type, stored as a uint64_t (reserved 8 bits, hour (0-23) 8 bits, minute (0-59) 8 bits, second (0-59) 8 bits, nanosecond (0 - 999999999) 32 bits). */
         DateTime = 15, /**< DateTime type, combining uint32_t Date and uint64_t Time. */
+        Array = 16, /**< Packed array of integers or floating-point numbers of one element type, see getArrayRecordDataSize. */
+        PooledString = 17, /**< String stored once in the StringPool section, the record holds its offset. Readers report it as String. */
         None = 0  /**< Represents no type. */
     };
 
@@ -129,16 +226,176 @@ namespace PBF
         //... data from Min. 2 to Max. 65536 bytes (Min. size with 32 bit padding)
     };
 
+    /**
+     * @enum SectionTypes
+     * @brief Types of the optional sections that follow the binary records.
+     */
+    enum class SectionTypes : std::uint32_t
+    {
+        HashIndex = 1, /**< Sorted hash column followed by the parallel record offset column. */
+        PerfectHash = 2, /**< Minimal perfect hash function over the record hashes. */
+        FixedLayout = 3, /**< All parameters as one struct of a generated C++ header. */
+        Hierarchy = 4, /**< Tree of the tables and parameters. */
+        KeyNames = 5, /**< Front coded key names for mapping hashes back to keys. */
+        Checksum = 6, /**< CRC32C of the image in front of the section. */
+        StringPool = 7, /**< Unique strings of the PooledString records. */
+        None = 0  /**< Represents no section. */
+    };
+
     //Structure of the param file is
 
     // Header
     //  4 bytes (UInt32)  Size (Including first 4 bytes for Size)
-    //  4 bytes (UInt32)  2 bytes Version + 2 bytes Reserved
-    //  4 bytes (UInt32)  Reserved
+    //  4 bytes (UInt32)  2 bytes Version + 1 bit Big-endian flag + 15 bits Hash seed (0 if the keys are hashed with pbfHash)
+    //                    All values are stored in the byte order given by the flag, see PBFByteOrder.h
+    //  4 bytes (UInt32)  Offset of the section directory (0 if the file has no sections)
     // Binary Records
     //  ...
+    // Section directory (optional, directly after the last record)
+    //  4 bytes (UInt32)  Number of sections
+    //  12 bytes per section: Type, Offset (from the start of the file), Size in bytes
+    // Sections
+    //  ...
+
+    // HashIndex section
+    //  4 bytes (UInt32)  Number of records N
+    //  N * 4 bytes       Hashes sorted in ascending order
+    //  N * 4 bytes       Offsets of the records (from the start of the file)
+
+    // FixedLayout section
+    //  4 bytes (UInt32)  Fingerprint of the layout
+    //  4 bytes (UInt32)  Size of the layout in bytes
+    //  Layout data, padded to the next 32-bit boundary. The members are aligned to their
+    //  natural alignment but at most to 4 bytes (#pragma pack(4) in the generated header).
+
+    // Record
+    //  4 bytes (UInt32)  Hash of the key
+    //  4 bytes (UInt32)  8 bits Type + 24 bits Size
+    //  Data padded to the next 32-bit boundary
+
+    // PooledString record (the Size field holds the length of the string without the \0)
+    //  4 bytes (UInt32)  Offset of the string in the StringPool section
+
+    // StringPool section
+    //  Every string once, followed by \0, padded to the next 32-bit boundary at the end
+
+    // Array record data (the Size field holds the size of all of it)
+    //  4 bytes (UInt32)  8 bits Element type + 24 bits Offset of the first element from the start of the data
+    //  4 bytes (UInt32)  Number of elements
+    //  Elements, aligned in the file to the element size and padded to the next 32-bit boundary
 
 
+    /**
+     * @brief Returns the number of data bytes a record occupies in the file.
+     *
+     * Scalar types are always padded to whole 32-bit words. For strings the size field of the
+     * record header already holds the padded size.
+     *
+     * @param type Type of the record.
+     * @param size_field Size as stored in the record header.
+     * @return Size of the record data in bytes or 0 for unknown types.
+     */
+    constexpr std::uint32_t getRecordDataSize(DataTypes type, std::uint32_t size_field)
+    {
+        switch (type)
+        {
+        case DataTypes::String:
+        case DataTypes::Array:
+        {
+            return size_field;
+        }
+#ifdef ENABLE_PBF_8BIT_TYPES
+        case DataTypes::Int8:
+        case DataTypes::UInt8:
+#endif
+#ifdef ENABLE_PBF_16BIT_TYPES
+        case DataTypes::Int16:
+        case DataTypes::UInt16:
+#endif
+        case DataTypes::Boolean:
+        case DataTypes::Int32:
+        case DataTypes::UInt32:
+        case DataTypes::Float32:
+        case DataTypes::Date:
+        case DataTypes::PooledString:
+        {
+            return 4U;
+        }
+        case DataTypes::Int64:
+        case DataTypes::UInt64:
+        case DataTypes::Float64:
+        case DataTypes::Time:
+        {
+            return 8U;
+        }
+        case DataTypes::DateTime:
+        {
+            return 12U;
+        }
+        default:
+            break;
+        }
+        return 0U;
+    }
+
+    /**
+     * @brief Returns the size of one element of an array record.
+     * @return Size in bytes or 0 for types that can not be array elements.
+     */
+    inline std::uint32_t getArrayElementSize(DataTypes elementType)
+    {
+        switch (elementType)
+        {
+#ifdef ENABLE_PBF_8BIT_TYPES
+        case DataTypes::Int8:
+        case DataTypes::UInt8:
+        {
+            return 1U;
+        }
+#endif
+#ifdef ENABLE_PBF_16BIT_TYPES
+        case DataTypes::Int16:
+        case DataTypes::UInt16:
+        {
+            return 2U;
+        }
+#endif
+        case DataTypes::Int32:
+        case DataTypes::UInt32:
+        case DataTypes::Float32:
+        {
+            return 4U;
+        }
+        case DataTypes::Int64:
+        case DataTypes::UInt64:
+        case DataTypes::Float64:
+        {
+            return 8U;
+        }
+        default:
+            break;
+        }
+        return 0U;
+    }
+
+    /**
+     * @brief Returns the number of data bytes of an array record.
+     *
+     * 64-bit elements are aligned to 8 bytes in the file. Depending on the position of the
+     * record the 4 padding bytes this needs are in front of or after the elements, so the size
+     * does not depend on the position.
+     */
+    inline std::uint32_t getArrayRecordDataSize(DataTypes elementType, std::uint32_t count)
+    {
+        std::uint32_t elementSize = getArrayElementSize(elementType);
+        if (elementSize == 8U)
+        {
+            return PBF_ARRAY_HEADER_SIZE + sizeof(std::uint32_t) + count * elementSize;
+        }
+        std::uint32_t size_32 = (count * elementSize + sizeof(std::uint32_t) - 1U) / sizeof(std::uint32_t); // Align to next 32-bit boundary
+        return PBF_ARRAY_HEADER_SIZE + size_32 * sizeof(std::uint32_t);
+    }
+
     inline std::string getTypeName(PBF::DataTypes type)
     {
         switch (type)
@@ -208,6 +465,10 @@ namespace PBF
         {
             return "String";
         }
+        case PBF::DataTypes::Array:
+        {
+            return "Array";
+        }
         case PBF::DataTypes::None:
         {
             return "None";
@@ -0,0 +1,139 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <optional>
+#include "PBFDelta.h"
+#include "PBFFilePath.h"
+
+std::optional<std::vector<std::uint8_t>> readFile(const std::string& filePath)
+{
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "Could not open " << filePath << std::endl;
+        return std::nullopt;
+    }
+    return std::vector<std::uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+bool writeFile(const std::string& filePath, const std::uint8_t* data, std::size_t size)
+{
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "Could not create " << filePath << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(data), size);
+    return file.good();
+}
+
+void printUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " <source.pbf> <target.pbf> [delta.pbfd]" << std::endl;
+    std::cerr << "       " << program << " --apply <source.pbf> <delta.pbfd> <target.pbf>" << std::endl;
+    std::cerr << "Writes the changes from source to target (default <target>.pbfd) or applies them to source." << std::endl;
+}
+
+int createDeltaFile(const std::string& sourcePath, const std::string& targetPath, const std::string& deltaPath)
+{
+    std::optional<std::vector<std::uint8_t>> source = readFile(sourcePath);
+    std::optional<std::vector<std::uint8_t>> target = readFile(targetPath);
+    if (!source || !target)
+    {
+        return 1;
+    }
+    PBF::DeltaSummary summary;
+    std::vector<std::uint8_t> delta = PBF::createDelta(source->data(), static_cast<std::uint32_t>(source->size()),
+        target->data(), static_cast<std::uint32_t>(target->size()), &summary);
+    if (delta.empty())
+    {
+        std::cerr << "Could not compare the images, they must have the same byte order and records sorted by hash." << std::endl;
+        return 1;
+    }
+    if (!writeFile(deltaPath, delta.data(), delta.size()))
+    {
+        return 1;
+    }
+    std::optional<PBF::DeltaInfo> info = PBF::getDeltaInfo(delta.data(), static_cast<std::uint32_t>(delta.size()));
+    if (!info)
+    {
+        std::cerr << "The delta written to " << deltaPath << " is not valid" << std::endl;
+        return 1;
+    }
+    std::cout << "Added " << summary.added << ", removed " << summary.removed << ", changed " << summary.changed
+        << ", unchanged " << summary.unchanged << " records" << std::endl;
+    std::cout << "Delta " << delta.size() << " bytes for an image of " << target->size() << " bytes, "
+        << summary.sectionsFromSource << " sections from the device" << std::endl;
+    std::cout << "Applying it in place needs a buffer of " << info->inPlaceCapacity << " bytes" << std::endl;
+    return 0;
+}
+
+int applyDeltaFile(const std::string& sourcePath, const std::string& deltaPath, const std::string& targetPath)
+{
+    std::optional<std::vector<std::uint8_t>> source = readFile(sourcePath);
+    std::optional<std::vector<std::uint8_t>> delta = readFile(deltaPath);
+    if (!source || !delta)
+    {
+        return 1;
+    }
+    std::optional<PBF::DeltaInfo> info = PBF::getDeltaInfo(delta->data(), static_cast<std::uint32_t>(delta->size()));
+    if (!info)
+    {
+        std::cerr << deltaPath << " is not a valid delta" << std::endl;
+        return 1;
+    }
+    std::vector<std::uint8_t> target(info->targetSize);
+    if (!PBF::applyDelta(source->data(), static_cast<std::uint32_t>(source->size()), delta->data(), static_cast<std::uint32_t>(delta->size()),
+        target.data(), static_cast<std::uint32_t>(target.size())))
+    {
+        std::cerr << "The delta does not belong to " << sourcePath << std::endl;
+        return 1;
+    }
+    return writeFile(targetPath, target.data(), target.size()) ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    if ((argc == 5) && (std::string(argv[1]) == "--apply"))
+    {
+        return applyDeltaFile(argv[2], argv[3], argv[4]);
+    }
+    if ((argc == 3) || (argc == 4))
+    {
+        std::string targetPath = argv[2];
+        return createDeltaFile(argv[1], targetPath, (argc == 4) ? argv[3] : PBF::changeFileExtension(targetPath, ".pbfd"));
+    }
+    printUsage(argv[0]);
+    return 1;
+}
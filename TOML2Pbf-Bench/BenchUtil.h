@@ -0,0 +1,330 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <variant>
+#include <optional>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include "Pbf.h"
+#include "ParamBinFileWriter.h"
+
+namespace PBFBench
+{
+    /**
+     * @brief Name of the synthetic parameter number i.
+     */
+    inline std::string getParamName(std::uint32_t i)
+    {
+        return std::string("Bench.Param") + std::to_string(i);
+    }
+
+    /**
+     * @brief Builds a synthetic image with count parameters.
+     *
+     * Parameter i is an UInt32 (value i) if i % 3 == 0, a Float64 (value i / 2.0) if i % 3 == 1
+     * and a String ("Value" + i) otherwise. Records are written in hash order like the converter does.
+     */
+    inline std::vector<std::uint32_t> buildImage(std::uint32_t count, const std::vector<PBF::SectionTypes>& sectionTypes = {})
+    {
+        std::map<std::uint32_t, std::uint32_t> params; /*hash -> parameter number*/
+        for (std::uint32_t i = 0U; i < count; i++)
+        {
+            params[PBF::pbfHash(getParamName(i))] = i;
+        }
+
+        std::uint32_t size(PBF::PBF_FILE_HEADER_SIZE);
+        for (const auto& [hash, i] : params)
+        {
+            size += PBF::PBF_FILE_RECORD_HEADER_SIZE;
+            if (i % 3U == 0U)
+            {
+                size += 4U;
+            }
+            else if (i % 3U == 1U)
+            {
+                size += 8U;
+            }
+            else
+            {
+                std::uint32_t len = static_cast<std::uint32_t>(std::string("Value").size() + std::to_string(i).size());
+                size += ((len + 1U + 3U) / 4U) * 4U;
+            }
+        }
+        /*sections are at most a few words per record*/
+        std::size_t capacity = size + (sectionTypes.empty() ? 0U : 1024U + 16U * sectionTypes.size() * static_cast<std::size_t>(count));
+
+        std::vector<std::uint32_t> image(capacity / sizeof(std::uint32_t) + 1U, 0U);
+        PBF::ParamBinFileWriter writer(image.data(), capacity);
+        writer.writeHeader(size, PBF::PBF_FILE_VERSION);
+
+        for (const auto& [hash, i] : params)
+        {
+            PBF::BinaryDataRecord record;
+            record.hash = hash;
+            if (i % 3U == 0U)
+            {
+                std::uint32_t value(i);
+                record.type = static_cast<std::uint8_t>(PBF::DataTypes::UInt32);
+                record.data_size = 4U;
+                writer.writeRecord(record, &value);
+            }
+            else if (i % 3U == 1U)
+            {
+                double value = static_cast<double>(i) / 2.0;
+                record.type = static_cast<std::uint8_t>(PBF::DataTypes::Float64);
+                record.data_size = 8U;
+                writer.writeRecord(record, &value);
+            }
+            else
+            {
+                record.strData = std::string("Value") + std::to_string(i);
+                record.type = static_cast<std::uint8_t>(PBF::DataTypes::String);
+                record.data_size = static_cast<std::uint32_t>(record.strData.size());
+                writer.writeRecord(record, nullptr);
+            }
+        }
+
+        if (!sectionTypes.empty())
+        {
+            std::vector<PBF::PbfSection> sections;
+            for (PBF::SectionTypes type : sectionTypes)
+            {
+                if (type == PBF::SectionTypes::HashIndex)
+                {
+                    sections.push_back(writer.makeHashIndexSection());
+                }
+                else if (type == PBF::SectionTypes::PerfectHash)
+                {
+                    sections.push_back(writer.makePerfectHashSection());
+                }
+            }
+            size += writer.writeSections(sections);
+            std::memcpy(image.data(), &size, sizeof(std::uint32_t));
+        }
+        image.resize((size + 3U) / 4U);
+        return image;
+    }
+
+    /**
+     * @brief Builds an image with a Float64 parameter for every key, the value of keys[i] is i.
+     */
+    inline std::vector<std::uint32_t> buildFloat64Image(const std::vector<std::string>& keys)
+    {
+        std::map<std::uint32_t, std::uint32_t> params; /*hash -> key number*/
+        for (std::uint32_t i = 0U; i < keys.size(); i++)
+        {
+            params[PBF::pbfHash(keys[i])] = i;
+        }
+        std::uint32_t size = PBF::PBF_FILE_HEADER_SIZE + static_cast<std::uint32_t>(params.size()) * (PBF::PBF_FILE_RECORD_HEADER_SIZE + 8U);
+
+        std::vector<std::uint32_t> image(size / sizeof(std::uint32_t), 0U);
+        PBF::ParamBinFileWriter writer(image.data(), size);
+        writer.writeHeader(size, PBF::PBF_FILE_VERSION);
+        for (const auto& [hash, i] : params)
+        {
+            double value = static_cast<double>(i);
+            PBF::BinaryDataRecord record;
+            record.hash = hash;
+            record.type = static_cast<std::uint8_t>(PBF::DataTypes::Float64);
+            record.data_size = 8U;
+            writer.writeRecord(record, &value);
+        }
+        return image;
+    }
+
+    /**
+     * @brief Repeats the records of a real image (e.g. example.pbf) up to a size, with new key hashes for every copy.
+     * @return The scaled image without sections, empty if the image is malformed.
+     */
+    inline std::vector<std::uint32_t> scaleImage(const std::vector<std::uint8_t>& image, std::size_t targetSize)
+    {
+        std::vector<std::uint32_t> scaled;
+        if (image.size() < PBF::PBF_FILE_HEADER_SIZE)
+        {
+            return scaled;
+        }
+        std::uint32_t directory(0U);
+        std::memcpy(&directory, image.data() + 2U * sizeof(std::uint32_t), sizeof(directory));
+        std::size_t recordsEnd = (directory != 0U) ? std::min<std::size_t>(directory, image.size()) : image.size();
+        std::size_t recordsSize = recordsEnd - PBF::PBF_FILE_HEADER_SIZE;
+        if ((recordsSize == 0U) || ((recordsSize % sizeof(std::uint32_t)) != 0U))
+        {
+            return scaled;
+        }
+
+        std::size_t copies = std::max<std::size_t>(1U, (targetSize - PBF::PBF_FILE_HEADER_SIZE) / recordsSize);
+        std::vector<std::uint8_t> bytes(PBF::PBF_FILE_HEADER_SIZE + copies * recordsSize);
+        std::uint8_t* out = bytes.data() + PBF::PBF_FILE_HEADER_SIZE;
+        for (std::size_t copy = 0U; copy < copies; copy++)
+        {
+            std::size_t offset = PBF::PBF_FILE_HEADER_SIZE;
+            while (offset + PBF::PBF_FILE_RECORD_HEADER_SIZE <= recordsEnd)
+            {
+                std::uint32_t hash(0U);
+                std::uint32_t reg1(0U);
+                std::memcpy(&hash, image.data() + offset, sizeof(hash));
+                std::memcpy(&reg1, image.data() + offset + sizeof(hash), sizeof(reg1));
+                std::uint32_t length = PBF::PBF_FILE_RECORD_HEADER_SIZE + PBF::getRecordDataSize(static_cast<PBF::DataTypes>(reg1 >> 24U), reg1 & 0x00FFFFFFU);
+                if ((length == PBF::PBF_FILE_RECORD_HEADER_SIZE) || (offset + length > recordsEnd))
+                {
+                    return scaled;
+                }
+                std::uint32_t number = static_cast<std::uint32_t>(copy);
+                hash = (copy == 0U) ? hash : PBF::pbfHashContinue(hash, std::string_view(reinterpret_cast<const char*>(&number), sizeof(number)));
+                std::memcpy(out, image.data() + offset, length);
+                std::memcpy(out, &hash, sizeof(hash));
+                out += length;
+                offset += length;
+            }
+        }
+
+        std::uint32_t header[3] = { static_cast<std::uint32_t>(bytes.size()), static_cast<std::uint32_t>(PBF::PBF_FILE_VERSION) << 16U, 0U };
+        std::memcpy(bytes.data(), header, sizeof(header));
+        scaled.resize(bytes.size() / sizeof(std::uint32_t));
+        std::memcpy(scaled.data(), bytes.data(), bytes.size());
+        return scaled;
+    }
+
+    /**
+     * @brief Key hashes of all UInt32 parameters of an image built by buildImage, in random order.
+     */
+    inline std::vector<std::uint32_t> getLookupKeys(std::uint32_t count, std::uint32_t seed = 1U)
+    {
+        std::vector<std::uint32_t> keys;
+        for (std::uint32_t i = 0U; i < count; i += 3U)
+        {
+            keys.push_back(PBF::pbfHash(getParamName(i)));
+        }
+        std::mt19937 rng(seed);
+        std::shuffle(keys.begin(), keys.end(), rng);
+        return keys;
+    }
+
+    /**
+     * @brief Runs f repeat times and returns the fastest run in nanoseconds.
+     */
+    template<typename F>
+    double measureNs(std::uint32_t repeat, F&& f)
+    {
+        double best(0.0);
+        for (std::uint32_t r = 0U; r < repeat; r++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            f();
+            auto stop = std::chrono::steady_clock::now();
+            double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+            if ((r == 0U) || (ns < best))
+            {
+                best = ns;
+            }
+        }
+        return best;
+    }
+
+    /*Keeps the compiler from removing the measured work*/
+    inline volatile std::uint64_t g_sink(0U);
+
+    /**
+     * @class LegacyMapReader
+     * @brief Parameter store used by PBFReader before the flat index.
+     *
+     * Kept in the benchmark as baseline: one std::map node per record holding a std::variant
+     * that includes std::string. Only the types written by buildImage are decoded.
+     */
+    class LegacyMapReader
+    {
+    public:
+        using DataVariant = std::variant<std::string, std::uint32_t, double>;
+
+        bool read(const void* memory)
+        {
+            _pairs.clear();
+            const std::uint8_t* base = static_cast<const std::uint8_t*>(memory);
+            std::uint32_t size(0U);
+            std::uint32_t directory(0U);
+            std::memcpy(&size, base, sizeof(std::uint32_t));
+            std::memcpy(&directory, base + 8U, sizeof(std::uint32_t));
+            std::uint32_t end = (directory != 0U) ? directory : size;
+
+            std::uint32_t done(PBF::PBF_FILE_HEADER_SIZE);
+            while (done < end)
+            {
+                std::uint32_t hash(0U);
+                std::uint32_t reg1(0U);
+                std::memcpy(&hash, base + done, sizeof(std::uint32_t));
+                std::memcpy(&reg1, base + done + 4U, sizeof(std::uint32_t));
+                done += PBF::PBF_FILE_RECORD_HEADER_SIZE;
+
+                PBF::DataTypes type = static_cast<PBF::DataTypes>(reg1 >> 24U);
+                std::uint32_t dataSize = PBF::getRecordDataSize(type, reg1 & 0x00FFFFFFU);
+                if (type == PBF::DataTypes::String)
+                {
+                    const char* str = reinterpret_cast<const char*>(base + done);
+                    _pairs[hash] = std::string(str, strnlen(str, dataSize));
+                }
+                else if (type == PBF::DataTypes::UInt32)
+                {
+                    std::uint32_t value(0U);
+                    std::memcpy(&value, base + done, sizeof(std::uint32_t));
+                    _pairs[hash] = value;
+                }
+                else if (type == PBF::DataTypes::Float64)
+                {
+                    double value(0.0);
+                    std::memcpy(&value, base + done, sizeof(double));
+                    _pairs[hash] = value;
+                }
+                else
+                {
+                    return false;
+                }
+                done += dataSize;
+            }
+            return true;
+        }
+
+        std::optional<std::uint32_t> getUInt32(std::uint32_t hash) const
+        {
+            auto it = _pairs.find(hash);
+            if ((it == _pairs.end()) || !std::holds_alternative<std::uint32_t>(it->second))
+            {
+                return std::nullopt;
+            }
+            return std::get<std::uint32_t>(it->second);
+        }
+
+    private:
+        std::map<std::uint32_t, DataVariant> _pairs;
+    };
+}
@@ -0,0 +1,870 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include "BenchUtil.h"
+#include "PBFReader.h"
+#include "PBFHashScan.h"
+#include "PBFFlatIndex.h"
+#include "PBFSections.h"
+#include "PBFPerfectHash.h"
+#include "PBFStorageView.h"
+#include "PBFChecksum.h"
+#include "PBFByteOrder.h"
+#include "PBFCompression.h"
+#include "PBFDelta.h"
+#include "PBFLayeredReader.h"
+#include "PBFBuilder.h"
+
+using namespace PBFBench;
+
+/*
+ * Load time and lookup latency of the reader store: the std::map + std::variant store used
+ * before (LegacyMapReader) against the flat index and slot array of PBFReader.
+ */
+static void benchReaderStore()
+{
+    std::printf("Reader store\n");
+    std::printf("%10s %14s %14s %14s %14s\n", "records", "map load ms", "flat load ms", "map get ns", "flat get ns");
+
+    for (std::uint32_t count : { 1000U, 100000U, 1000000U })
+    {
+        std::vector<std::uint32_t> image = buildImage(count);
+        std::vector<std::uint32_t> keys = getLookupKeys(count);
+        std::uint32_t repeat = (count >= 1000000U) ? 3U : 10U;
+
+        LegacyMapReader legacy;
+        PBF::PBFReader reader;
+
+        double legacyLoad = measureNs(repeat, [&]() { legacy.read(image.data()); });
+        double flatLoad = measureNs(repeat, [&]() { reader.read(image.data()); });
+
+        double legacyGet = measureNs(repeat, [&]()
+        {
+            std::uint64_t sum(0U);
+            for (std::uint32_t key : keys)
+            {
+                sum += legacy.getUInt32(key).value_or(0U);
+            }
+            g_sink = sum;
+        });
+        double flatGet = measureNs(repeat, [&]()
+        {
+            std::uint64_t sum(0U);
+            for (std::uint32_t key : keys)
+            {
+                sum += reader.getParam<std::uint32_t>(PBF::KeyHash(key)).value_or(0U);
+            }
+            g_sink = sum;
+        });
+
+        std::printf("%10u %14.3f %14.3f %14.1f %14.1f\n", count,
+            legacyLoad / 1e6, flatLoad / 1e6,
+            legacyGet / static_cast<double>(keys.size()), flatGet / static_cast<double>(keys.size()));
+    }
+    std::printf("\n");
+}
+
+/*
+ * Startup style lookups: groups of 256 keys, resolved one at a time with getParam and as a
+ * batch with getParams.
+ */
+static void benchBatchLookup()
+{
+    const std::size_t groupSize = 256U;
+
+    std::printf("Batch lookup (%u keys per call)\n", static_cast<unsigned>(groupSize));
+    std::printf("%10s %14s %14s\n", "records", "single ns", "batch ns");
+
+    for (std::uint32_t count : { 1000U, 100000U, 1000000U })
+    {
+        std::vector<std::uint32_t> image = buildImage(count);
+        std::vector<std::uint32_t> hashes = getLookupKeys(count);
+        std::vector<PBF::KeyHash> keys(hashes.begin(), hashes.end());
+        std::vector<PBF::ValueSlot> values(groupSize);
+        std::uint32_t repeat = (count >= 1000000U) ? 3U : 10U;
+
+        PBF::PBFReader reader;
+        reader.read(image.data());
+
+        double single = measureNs(repeat, [&]()
+        {
+            std::uint64_t sum(0U);
+            for (const PBF::KeyHash& key : keys)
+            {
+                sum += reader.getParam<std::uint32_t>(key).value_or(0U);
+            }
+            g_sink = sum;
+        });
+        double batch = measureNs(repeat, [&]()
+        {
+            std::uint64_t sum(0U);
+            for (std::size_t first = 0U; first < keys.size(); first += groupSize)
+            {
+                std::span<const PBF::KeyHash> group(keys.data() + first, std::min(groupSize, keys.size() - first));
+                reader.getParams(group, values);
+                for (std::size_t i = 0U; i < group.size(); i++)
+                {
+                    sum += reader.getValue<std::uint32_t>(values[i]).value_or(0U);
+                }
+            }
+            g_sink = sum;
+        });
+
+        std::printf("%10u %14.1f %14.1f\n", count, single / static_cast<double>(keys.size()), batch / static_cast<double>(keys.size()));
+    }
+    std::printf("\n");
+}
+
+/*
+ * Hit lookups in small key sets: SIMD and scalar scan over the hash column against the flat
+ * hash index of PBFReader, the sorted HashIndex section and the PerfectHash section.
+ * Used to choose PBF_SCAN_MAX_RECORDS.
+ */
+static void benchSmallScan()
+{
+    std::printf("Small image lookup (ns per lookup)\n");
+    std::printf("%10s %10s %10s %10s %10s %10s\n", "records", "simd", "scalar", "flat", "sorted", "mph");
+
+    for (std::uint32_t count : { 8U, 16U, 24U, 32U, 48U, 64U, 96U, 128U, 192U, 256U, 512U })
+    {
+        std::vector<std::uint32_t> hashes;
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> records;
+        PBF::FlatHashIndex flat;
+        for (std::uint32_t i = 0U; i < count; i++)
+        {
+            hashes.push_back(PBF::pbfHash(getParamName(i)));
+            records.push_back(std::make_pair(hashes.back(), i));
+            flat.insert(hashes.back(), i);
+        }
+
+        std::vector<std::uint32_t> sorted(hashes);
+        std::sort(sorted.begin(), sorted.end());
+        std::vector<std::uint32_t> indexSection(1U, count);
+        indexSection.insert(indexSection.end(), sorted.begin(), sorted.end());
+        indexSection.insert(indexSection.end(), sorted.begin(), sorted.end());
+        PBF::HashIndex index;
+        index.open(PBF::SectionRef{ PBF::SectionTypes::HashIndex, 0U, static_cast<std::uint32_t>(indexSection.size() * 4U), reinterpret_cast<const std::uint8_t*>(indexSection.data()) });
+
+        PBF::PerfectHashBuilder builder;
+        builder.build(hashes);
+        std::vector<std::uint32_t> mphSection = builder.makeSection(records);
+        PBF::PerfectHashIndex mph;
+        mph.open(PBF::SectionRef{ PBF::SectionTypes::PerfectHash, 0U, static_cast<std::uint32_t>(mphSection.size() * 4U), reinterpret_cast<const std::uint8_t*>(mphSection.data()) });
+
+        /*about one million lookups in random order*/
+        std::vector<std::uint32_t> keys;
+        std::mt19937 rng(7U);
+        while (keys.size() < 1000000U)
+        {
+            keys.push_back(hashes[rng() % count]);
+        }
+
+        auto measure = [&](auto&& find)
+        {
+            return measureNs(5U, [&]()
+            {
+                std::uint64_t sum(0U);
+                for (std::uint32_t key : keys)
+                {
+                    sum += find(key);
+                }
+                g_sink = sum;
+            }) / static_cast<double>(keys.size());
+        };
+
+        double simd = measure([&](std::uint32_t key) { return PBF::findHash(hashes.data(), count, key); });
+        double scalar = measure([&](std::uint32_t key) { return PBF::findHashScalar(hashes.data(), 0U, count, key); });
+        double flatNs = measure([&](std::uint32_t key) { return flat.find(key); });
+        double sortedNs = measure([&](std::uint32_t key) { return index.find(key).value_or(0U); });
+        double mphNs = measure([&](std::uint32_t key) { return mph.find(key).value_or(0U); });
+
+        std::printf("%10u %10.2f %10.2f %10.2f %10.2f %10.2f\n", count, simd, scalar, flatNs, sortedNs, mphNs);
+    }
+    std::printf("\n");
+}
+
+/*
+ * Time from a loaded image to the first parameter: PBFReader::read against readLazy, on
+ * images with a PerfectHash section.
+ */
+static void benchLazyLoad()
+{
+    std::printf("Time to first parameter (us)\n");
+    std::printf("%10s %14s %14s %18s\n", "records", "read", "readLazy", "lazy 5% of keys");
+
+    for (std::uint32_t count : { 1000U, 100000U, 1000000U })
+    {
+        std::vector<std::uint32_t> image = buildImage(count, { PBF::SectionTypes::PerfectHash });
+        std::vector<std::uint32_t> keys = getLookupKeys(count);
+        std::size_t fraction = std::max<std::size_t>(1U, count / 20U);
+        keys.resize(std::min(keys.size(), fraction));
+        std::uint32_t repeat = (count >= 1000000U) ? 3U : 10U;
+
+        double eager = measureNs(repeat, [&]()
+        {
+            PBF::PBFReader reader;
+            reader.read(image.data());
+            g_sink = reader.getParam<std::uint32_t>(PBF::KeyHash(keys[0])).value_or(0U);
+        });
+        double lazy = measureNs(repeat, [&]()
+        {
+            PBF::PBFReader reader;
+            reader.readLazy(image.data(), image.size() * sizeof(std::uint32_t));
+            g_sink = reader.getParam<std::uint32_t>(PBF::KeyHash(keys[0])).value_or(0U);
+        });
+        double lazyFraction = measureNs(repeat, [&]()
+        {
+            PBF::PBFReader reader;
+            reader.readLazy(image.data(), image.size() * sizeof(std::uint32_t));
+            std::uint64_t sum(0U);
+            for (std::uint32_t key : keys)
+            {
+                sum += reader.getParam<std::uint32_t>(PBF::KeyHash(key)).value_or(0U);
+            }
+            g_sink = sum;
+        });
+
+        std::printf("%10u %14.1f %14.1f %18.1f\n", count, eager / 1e3, lazy / 1e3, lazyFraction / 1e3);
+    }
+    std::printf("\n");
+}
+
+/*
+ * 100 lookups on an image in simulated serial flash (5 us per command, 20 ns per byte):
+ * copying the image into RAM for PBFReader against PBFStorageView with a 2 KB page cache.
+ */
+static void benchStorage()
+{
+    const std::uint32_t lookups = 100U;
+    const std::uint32_t chunk = 4096U;
+
+    std::printf("Simulated flash, %u lookups\n", lookups);
+    std::printf("%10s %12s %12s %12s %12s %12s %12s\n", "records", "copy ms", "copy KB", "copy reads", "cache ms", "cache KB", "cache reads");
+
+    for (std::uint32_t count : { 1000U, 100000U, 1000000U })
+    {
+        std::vector<std::uint32_t> image = buildImage(count, { PBF::SectionTypes::PerfectHash });
+        std::uint32_t size = static_cast<std::uint32_t>(image.size() * sizeof(std::uint32_t));
+        std::vector<std::uint32_t> keys = getLookupKeys(count);
+        keys.resize(std::min<std::size_t>(keys.size(), lookups));
+
+        PBF::SimulatedFlashStorage flash(image.data(), size, std::chrono::microseconds(5), std::chrono::nanoseconds(20));
+
+        double copy = measureNs(1U, [&]()
+        {
+            std::vector<std::uint32_t> ram(image.size());
+            for (std::uint32_t offset = 0U; offset < size; offset += chunk)
+            {
+                flash.read(offset, reinterpret_cast<std::uint8_t*>(ram.data()) + offset, std::min(chunk, size - offset));
+            }
+            PBF::PBFReader reader;
+            reader.read(ram.data());
+            std::uint64_t sum(0U);
+            for (std::uint32_t key : keys)
+            {
+                sum += reader.getParam<std::uint32_t>(PBF::KeyHash(key)).value_or(0U);
+            }
+            g_sink = sum;
+        });
+        std::uint64_t copyBytes = flash.bytesRead();
+        std::uint64_t copyReads = flash.reads();
+        flash.resetStatistics();
+
+        double cached = measureNs(1U, [&]()
+        {
+            PBF::PBFStorageView<256U, 8U> view(flash);
+            view.open();
+            std::uint64_t sum(0U);
+            for (std::uint32_t key : keys)
+            {
+                sum += view.getParam<std::uint32_t>(PBF::KeyHash(key)).value_or(0U);
+            }
+            g_sink = sum;
+        });
+
+        std::printf("%10u %12.2f %12.1f %12llu %12.2f %12.1f %12llu\n", count,
+            copy / 1e6, static_cast<double>(copyBytes) / 1024.0, static_cast<unsigned long long>(copyReads),
+            cached / 1e6, static_cast<double>(flash.bytesRead()) / 1024.0, static_cast<unsigned long long>(flash.reads()));
+    }
+    std::printf("\n");
+}
+
+struct BenchMotor
+{
+    double Rs, Lq, Ld, Ktq, Kemf, J, b, Fs, PeakTorque, RatedSpeed, RatedCurrent, MaxCurrent, Vdc, Tau, p;
+};
+
+PBF_BINDING(BenchMotor, PBF_FIELD(BenchMotor, Rs), PBF_FIELD(BenchMotor, Lq), PBF_FIELD(BenchMotor, Ld), PBF_FIELD(BenchMotor, Ktq),
+    PBF_FIELD(BenchMotor, Kemf), PBF_FIELD(BenchMotor, J), PBF_FIELD(BenchMotor, b), PBF_FIELD(BenchMotor, Fs),
+    PBF_FIELD(BenchMotor, PeakTorque), PBF_FIELD(BenchMotor, RatedSpeed), PBF_FIELD(BenchMotor, RatedCurrent),
+    PBF_FIELD(BenchMotor, MaxCurrent), PBF_FIELD(BenchMotor, Vdc), PBF_FIELD(BenchMotor, Tau), PBF_FIELD(BenchMotor, p))
+
+/*
+ * Reading 100 motors with 15 parameters each: one getParam per field with the key built as
+ * string, against PBFReader::bind with the continued prefix hash.
+ */
+static void benchBind()
+{
+    const char* fieldNames[] = { "Rs", "Lq", "Ld", "Ktq", "Kemf", "J", "b", "Fs", "PeakTorque", "RatedSpeed", "RatedCurrent", "MaxCurrent", "Vdc", "Tau", "p" };
+    const std::uint32_t motors = 100U;
+
+    std::printf("Binding %u motors (us)\n", motors);
+    std::printf("%10s %14s %14s\n", "fields", "per key", "bind");
+
+    std::vector<std::string> keys;
+    for (std::uint32_t m = 0U; m < motors; m++)
+    {
+        for (const char* field : fieldNames)
+        {
+            keys.push_back("Plant.Motors[" + std::to_string(m) + "]." + field);
+        }
+    }
+    std::vector<std::uint32_t> image = buildFloat64Image(keys);
+    PBF::PBFReader reader;
+    reader.read(image.data());
+    std::vector<BenchMotor> result(motors);
+
+    double perKey = measureNs(20U, [&]()
+    {
+        for (std::uint32_t m = 0U; m < motors; m++)
+        {
+            std::string prefix = "Plant.Motors[" + std::to_string(m) + "]";
+            BenchMotor& motor = result[m];
+            motor.Rs = reader.getParam<double>(prefix + ".Rs").value_or(0.0);
+            motor.Lq = reader.getParam<double>(prefix + ".Lq").value_or(0.0);
+            motor.Ld = reader.getParam<double>(prefix + ".Ld").value_or(0.0);
+            motor.Ktq = reader.getParam<double>(prefix + ".Ktq").value_or(0.0);
+            motor.Kemf = reader.getParam<double>(prefix + ".Kemf").value_or(0.0);
+            motor.J = reader.getParam<double>(prefix + ".J").value_or(0.0);
+            motor.b = reader.getParam<double>(prefix + ".b").value_or(0.0);
+            motor.Fs = reader.getParam<double>(prefix + ".Fs").value_or(0.0);
+            motor.PeakTorque = reader.getParam<double>(prefix + ".PeakTorque").value_or(0.0);
+            motor.RatedSpeed = reader.getParam<double>(prefix + ".RatedSpeed").value_or(0.0);
+            motor.RatedCurrent = reader.getParam<double>(prefix + ".RatedCurrent").value_or(0.0);
+            motor.MaxCurrent = reader.getParam<double>(prefix + ".MaxCurrent").value_or(0.0);
+            motor.Vdc = reader.getParam<double>(prefix + ".Vdc").value_or(0.0);
+            motor.Tau = reader.getParam<double>(prefix + ".Tau").value_or(0.0);
+            motor.p = reader.getParam<double>(prefix + ".p").value_or(0.0);
+        }
+        g_sink = static_cast<std::uint64_t>(result[motors - 1U].p);
+    });
+    double bound = measureNs(20U, [&]()
+    {
+        for (std::uint32_t m = 0U; m < motors; m++)
+        {
+            reader.bind("Plant.Motors[" + std::to_string(m) + "]", result[m]);
+        }
+        g_sink = static_cast<std::uint64_t>(result[motors - 1U].p);
+    });
+
+    std::printf("%10zu %14.1f %14.1f\n", keys.size(), perKey / 1e3, bound / 1e3);
+    std::printf("\n");
+}
+
+/*
+ * Throughput of the CRC32C check of a 64 MB image: slice-by-8 against crc32c, which uses the
+ * CRC instructions if the build targets them (SSE4.2, e.g. /arch:AVX, or ARMv8 CRC).
+ */
+static void benchChecksum()
+{
+    const std::size_t size = 64U * 1024U * 1024U;
+    std::vector<std::uint8_t> image(size);
+    std::uint32_t x(1U);
+    for (std::uint8_t& byte : image)
+    {
+        x = x * 1664525U + 1013904223U;
+        byte = static_cast<std::uint8_t>(x >> 24U);
+    }
+
+#if defined(PBF_CRC_SSE42)
+    const char* instructions = PBF::crc32cHardwareAvailable() ? "SSE4.2" : "none on this CPU, slice-by-8";
+#elif defined(PBF_CRC_ARM)
+    const char* instructions = "ARMv8 CRC";
+#else
+    const char* instructions = "none, slice-by-8";
+#endif
+    std::printf("CRC32C of a 64 MB image (GB/s), CRC instructions: %s\n", instructions);
+    std::printf("%14s %14s\n", "slice-by-8", "crc32c");
+
+    std::uint32_t software(0U);
+    std::uint32_t hardware(0U);
+    double softwareNs = measureNs(5U, [&]() { software = PBF::crc32cSoftware(image.data(), size); });
+    double hardwareNs = measureNs(5U, [&]() { hardware = PBF::crc32c(image.data(), size); });
+    g_sink = software ^ hardware;
+
+    std::printf("%14.2f %14.2f%s\n", static_cast<double>(size) / softwareNs, static_cast<double>(size) / hardwareNs,
+        (software == hardware) ? "" : "  MISMATCH");
+    std::printf("\n");
+}
+
+/*
+ * Loading an image of the other byte order: the one-pass swap against a scalar swap of the
+ * same column, and PBFReader::read and lookups on a native and a swapped image.
+ */
+static void benchByteOrder()
+{
+    const std::size_t words = 16U * 1024U * 1024U;
+    std::vector<std::uint32_t> column(words);
+    for (std::size_t i = 0U; i < words; i++)
+    {
+        column[i] = static_cast<std::uint32_t>(i * 2654435761U);
+    }
+    double scalarNs = measureNs(5U, [&]()
+    {
+        for (std::uint32_t& word : column)
+        {
+            word = PBF::pbfByteSwap32(word);
+        }
+        g_sink = column[words / 2U];
+    });
+    double vectorNs = measureNs(5U, [&]()
+    {
+        PBF::swapColumn(reinterpret_cast<std::uint8_t*>(column.data()), words, 4U);
+        g_sink = column[words / 2U];
+    });
+#if defined(PBF_SWAP_SSSE3)
+    const char* instructions = "SSSE3";
+#elif defined(PBF_SWAP_NEON)
+    const char* instructions = "NEON";
+#else
+    const char* instructions = "none";
+#endif
+    std::printf("Byte swap of a 64 MB column (GB/s), vector instructions: %s\n", instructions);
+    std::printf("%14s %14s\n", "scalar", "swapColumn");
+    std::printf("%14.2f %14.2f\n\n", static_cast<double>(words * 4U) / scalarNs, static_cast<double>(words * 4U) / vectorNs);
+
+    std::printf("Images of the other byte order\n");
+    std::printf("%10s %14s %16s %18s %14s %16s\n", "records", "read (us)", "read other (us)", "swap only (us)", "lookup (ns)", "lookup other (ns)");
+    for (std::uint32_t count : { 1000U, 100000U })
+    {
+        std::vector<std::uint32_t> image = buildImage(count, { PBF::SectionTypes::HashIndex, PBF::SectionTypes::PerfectHash });
+        std::size_t size = image.size() * sizeof(std::uint32_t);
+        std::vector<std::uint32_t> other = image;
+        PBF::swapByteOrder(other.data(), size);
+        std::vector<std::uint32_t> keys = getLookupKeys(count);
+        std::uint32_t repeat = (count >= 100000U) ? 5U : 20U;
+
+        double readNs = measureNs(repeat, [&]()
+        {
+            PBF::PBFReader reader;
+            g_sink = reader.read(image.data()) ? 1U : 0U;
+        });
+        double readOtherNs = measureNs(repeat, [&]()
+        {
+            PBF::PBFReader reader;
+            g_sink = reader.read(other.data()) ? 1U : 0U;
+        });
+        std::vector<std::uint32_t> copy = other;
+        double swapNs = measureNs(repeat, [&]()
+        {
+            g_sink = PBF::swapByteOrder(copy.data(), size) ? 1U : 0U;
+        });
+
+        PBF::PBFReader native;
+        PBF::PBFReader swapped;
+        native.read(image.data());
+        swapped.read(other.data());
+        auto lookups = [&keys](const PBF::PBFReader& reader)
+        {
+            return measureNs(5U, [&]()
+            {
+                std::uint64_t sum(0U);
+                for (std::uint32_t key : keys)
+                {
+                    sum += reader.getType(PBF::KeyHash(key)) != PBF::DataTypes::None ? 1U : 0U;
+                }
+                g_sink = sum;
+            }) / static_cast<double>(keys.size());
+        };
+
+        std::printf("%10u %14.1f %16.1f %18.1f %14.1f %16.1f\n", count, readNs / 1e3, readOtherNs / 1e3, swapNs / 1e3, lookups(native), lookups(swapped));
+    }
+    std::printf("\n");
+}
+
+/*
+ * Block compression of example.pbf scaled up to 100 MB: ratio and speed for several block
+ * sizes, streaming decompression of the whole image and decoding single blocks for random reads.
+ */
+static void benchCompression()
+{
+    std::vector<std::uint8_t> example;
+    for (const char* path : { "example.pbf", "../example.pbf", "../../example.pbf" })
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (file)
+        {
+            example.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            break;
+        }
+    }
+    std::vector<std::uint32_t> image = scaleImage(example, 100U * 1024U * 1024U);
+    if (image.empty())
+    {
+        std::printf("Compression: example.pbf not found, run from the repository directory\n\n");
+        return;
+    }
+    std::uint32_t size = static_cast<std::uint32_t>(image.size() * sizeof(std::uint32_t));
+    std::vector<std::uint8_t> loaded(size);
+
+    std::printf("Compression of example.pbf scaled to %.1f MB\n", static_cast<double>(size) / (1024.0 * 1024.0));
+    std::printf("%10s %10s %16s %18s %18s\n", "block", "ratio", "compress (MB/s)", "decompress (GB/s)", "random block (us)");
+    for (std::uint32_t blockSize : { 4096U, 16384U, 65536U })
+    {
+        std::vector<std::uint8_t> container;
+        double compressNs = measureNs(1U, [&]()
+        {
+            container = PBF::compressImage(image.data(), size, blockSize);
+        });
+
+        PBF::MemoryStorage storage(container.data(), static_cast<std::uint32_t>(container.size()));
+        PBF::CompressedStorage<65536U> compressed(storage);
+        compressed.open();
+        double decompressNs = measureNs(3U, [&]()
+        {
+            g_sink = compressed.decompress(loaded.data(), loaded.size()) ? 1U : 0U;
+        });
+        bool same = std::memcmp(loaded.data(), image.data(), size) == 0;
+
+        const std::uint32_t reads = 1000U;
+        std::uint32_t x(1U);
+        double randomNs = measureNs(3U, [&]()
+        {
+            std::uint64_t sum(0U);
+            for (std::uint32_t i = 0U; i < reads; i++)
+            {
+                x = x * 1664525U + 1013904223U;
+                std::uint32_t word(0U);
+                compressed.read((x % (size / 4U)) * 4U, &word, sizeof(word));
+                sum += word;
+            }
+            g_sink = sum;
+        }) / reads;
+
+        std::printf("%10u %10.2f %16.1f %18.2f %18.2f%s\n", blockSize, static_cast<double>(size) / static_cast<double>(container.size()),
+            static_cast<double>(size) * 1e3 / compressNs, static_cast<double>(size) / decompressNs, randomNs / 1e3, same ? "" : "  MISMATCH");
+    }
+    std::printf("\n");
+}
+
+/*
+ * Deltas between images that differ in 1% of the values: size of the delta, creating it on
+ * the host and applying it into a second buffer and in place on the device.
+ */
+static void benchDelta()
+{
+    std::printf("Delta of 1%% changed values (apply in GB/s of the target image)\n");
+    std::printf("%10s %12s %12s %12s %12s %12s\n", "records", "image KB", "delta KB", "create ms", "apply", "in place");
+
+    for (std::uint32_t count : { 10000U, 100000U, 1000000U })
+    {
+        std::vector<std::uint32_t> source = buildImage(count, { PBF::SectionTypes::HashIndex });
+        const std::uint32_t size = source[0];
+        std::vector<std::uint32_t> target = source;
+        std::uint32_t n(0U);
+        PBF::PBFView(source.data(), size).forEachRecord([&](const PBF::RecordRef& record)
+        {
+            if ((record.type == PBF::DataTypes::UInt32) && ((n++ % 33U) == 0U))
+            {
+                target[(record.data - reinterpret_cast<const std::uint8_t*>(source.data())) / sizeof(std::uint32_t)] += 1U;
+            }
+        });
+
+        std::vector<std::uint8_t> delta;
+        double createNs = measureNs(3U, [&]() { delta = PBF::createDelta(source.data(), size, target.data(), size); });
+        const std::uint32_t deltaSize = static_cast<std::uint32_t>(delta.size());
+        std::optional<PBF::DeltaInfo> info = PBF::getDeltaInfo(delta.data(), deltaSize);
+        if (!info)
+        {
+            std::printf("%10u  delta not created\n", count);
+            continue;
+        }
+
+        std::vector<std::uint8_t> result(info->inPlaceCapacity);
+        bool same = true;
+        double applyNs = measureNs(5U, [&]()
+        {
+            same = PBF::applyDelta(source.data(), size, delta.data(), deltaSize, result.data(), info->targetSize) && same;
+        });
+        same = same && (std::memcmp(result.data(), target.data(), size) == 0);
+        /*includes copying the source into the buffer*/
+        double inPlaceNs = measureNs(5U, [&]()
+        {
+            std::memcpy(result.data(), source.data(), size);
+            same = PBF::applyDeltaInPlace(result.data(), info->inPlaceCapacity, delta.data(), deltaSize) && same;
+        });
+        same = same && (std::memcmp(result.data(), target.data(), size) == 0);
+
+        std::printf("%10u %12.1f %12.1f %12.2f %12.2f %12.2f%s\n", count, size / 1024.0, deltaSize / 1024.0, createNs / 1e6,
+            static_cast<double>(size) / applyNs, static_cast<double>(size) / inPlaceNs, same ? "" : "  MISMATCH");
+    }
+    std::printf("\n");
+}
+
+/*
+ * Lookups in a base image with override images: one combined index of LayeredReader against
+ * asking one reader per layer, last layer first, and a single reader of the base alone.
+ */
+static void benchLayers()
+{
+    std::printf("Layered lookups (ns per lookup), base with 1000000 records and overrides of 1000 records\n");
+    std::printf("%10s %14s %14s %14s %14s\n", "layers", "load ms", "single", "layered", "per layer");
+
+    std::vector<std::uint32_t> base = buildImage(1000000U);
+    std::vector<std::uint32_t> keys = getLookupKeys(1000000U);
+    PBF::PBFReader single;
+    single.read(base.data());
+    double singleNs = measureNs(5U, [&]()
+    {
+        std::uint64_t sum(0U);
+        for (std::uint32_t key : keys)
+        {
+            sum += single.getParam<std::uint32_t>(PBF::KeyHash(key)).value_or(0U);
+        }
+        g_sink = sum;
+    }) / keys.size();
+
+    for (std::uint32_t count : { 2U, 4U })
+    {
+        std::vector<std::vector<std::uint32_t>> overrides;
+        std::vector<std::span<const std::byte>> layers = { std::as_bytes(std::span<const std::uint32_t>(base)) };
+        std::vector<PBF::PBFReader> readers(count);
+        readers[0].read(base.data());
+        for (std::uint32_t i = 1U; i < count; i++)
+        {
+            overrides.push_back(buildImage(1000U));
+        }
+        for (std::uint32_t i = 1U; i < count; i++)
+        {
+            layers.push_back(std::as_bytes(std::span<const std::uint32_t>(overrides[i - 1U])));
+            readers[i].read(overrides[i - 1U].data());
+        }
+
+        PBF::LayeredReader layered;
+        double loadNs = measureNs(3U, [&]() { layered.read(layers); });
+        double layeredNs = measureNs(5U, [&]()
+        {
+            std::uint64_t sum(0U);
+            for (std::uint32_t key : keys)
+            {
+                sum += layered.getParam<std::uint32_t>(PBF::KeyHash(key)).value_or(0U);
+            }
+            g_sink = sum;
+        }) / keys.size();
+        double perLayerNs = measureNs(5U, [&]()
+        {
+            std::uint64_t sum(0U);
+            for (std::uint32_t key : keys)
+            {
+                for (std::uint32_t i = count; i > 0U; i--)
+                {
+                    std::optional<std::uint32_t> value = readers[i - 1U].getParam<std::uint32_t>(PBF::KeyHash(key));
+                    if (value)
+                    {
+                        sum += value.value();
+                        break;
+                    }
+                }
+            }
+            g_sink = sum;
+        }) / keys.size();
+
+        std::printf("%10u %14.1f %14.1f %14.1f %14.1f\n", count, loadNs / 1e6, singleNs, layeredNs, perLayerNs);
+    }
+    std::printf("\n");
+}
+
+/*
+ * Writing an image from parameters in memory (every third a UInt32, Float64 and String, with a
+ * HashIndex section): PbfBuilder into a growing buffer and into a file, against the writer
+ * with the sizing pass it needs in front.
+ */
+static void benchBuilder()
+{
+    std::printf("Writing images (MB/s of the image)\n");
+    std::printf("%10s %12s %12s %12s %12s\n", "records", "image KB", "writer", "builder", "to file");
+
+    for (std::uint32_t count : { 100000U, 1000000U })
+    {
+        std::vector<std::uint32_t> hashes(count);
+        std::vector<std::string> strings(count);
+        for (std::uint32_t i = 0U; i < count; i++)
+        {
+            hashes[i] = PBF::pbfHash(getParamName(i));
+            strings[i] = std::string("Value") + std::to_string(i);
+        }
+        auto addAll = [&](PBF::PbfBuilder& builder)
+        {
+            for (std::uint32_t i = 0U; i < count; i++)
+            {
+                if (i % 3U == 0U)
+                {
+                    builder.add(PBF::KeyHash(hashes[i]), i);
+                }
+                else if (i % 3U == 1U)
+                {
+                    builder.add(PBF::KeyHash(hashes[i]), static_cast<double>(i) / 2.0);
+                }
+                else
+                {
+                    builder.add(PBF::KeyHash(hashes[i]), strings[i]);
+                }
+            }
+            return builder.finish();
+        };
+
+        std::size_t size(0U);
+        double writerNs = measureNs(3U, [&]()
+        {
+            std::uint32_t required = PBF::PBF_FILE_HEADER_SIZE + PBF::ParamBinFileWriter::getSectionDirectorySize(1U) + PBF::ParamBinFileWriter::getHashIndexSectionSize(count);
+            for (std::uint32_t i = 0U; i < count; i++)
+            {
+                required += PBF::PBF_FILE_RECORD_HEADER_SIZE + ((i % 3U == 0U) ? 4U : ((i % 3U == 1U) ? 8U : ((static_cast<std::uint32_t>(strings[i].size()) + 4U) / 4U) * 4U));
+            }
+            std::vector<std::uint32_t> image(required / sizeof(std::uint32_t));
+            PBF::ParamBinFileWriter writer(image.data(), required);
+            std::uint32_t written = writer.writeHeader(required, PBF::PBF_FILE_VERSION);
+            for (std::uint32_t i = 0U; i < count; i++)
+            {
+                PBF::BinaryDataRecord record;
+                record.hash = hashes[i];
+                if (i % 3U == 0U)
+                {
+                    std::uint32_t value(i);
+                    record.type = static_cast<std::uint8_t>(PBF::DataTypes::UInt32);
+                    record.data_size = 4U;
+                    written += writer.writeRecord(record, &value);
+                }
+                else if (i % 3U == 1U)
+                {
+                    double value = static_cast<double>(i) / 2.0;
+                    record.type = static_cast<std::uint8_t>(PBF::DataTypes::Float64);
+                    record.data_size = 8U;
+                    written += writer.writeRecord(record, &value);
+                }
+                else
+                {
+                    record.strData = strings[i];
+                    record.type = static_cast<std::uint8_t>(PBF::DataTypes::String);
+                    record.data_size = static_cast<std::uint16_t>(strings[i].size());
+                    written += writer.writeRecord(record, nullptr);
+                }
+            }
+            written += writer.writeSections({ writer.makeHashIndexSection() });
+            size = written;
+            g_sink = image[1];
+        });
+
+        bool ok = true;
+        double builderNs = measureNs(3U, [&]()
+        {
+            PBF::PbfBufferSink sink;
+            PBF::PbfBuilder builder(sink, { PBF::SectionTypes::HashIndex });
+            ok = addAll(builder) && (sink.buffer().size() == size) && ok;
+            g_sink = sink.buffer()[4];
+        });
+
+        double fileNs = measureNs(3U, [&]()
+        {
+            std::FILE* file = std::tmpfile();
+            if (file == nullptr)
+            {
+                ok = false;
+                return;
+            }
+            {
+#if defined(_WIN32)
+                PBF::PbfFileSink sink(_fileno(file));
+#else
+                PBF::PbfFileSink sink(fileno(file));
+#endif
+                PBF::PbfBuilder builder(sink, { PBF::SectionTypes::HashIndex });
+                ok = addAll(builder) && ok;
+            }
+            std::fclose(file);
+        });
+
+        std::printf("%10u %12.1f %12.1f %12.1f %12.1f%s\n", count, size / 1024.0, size * 1e3 / writerNs, size * 1e3 / builderNs,
+            size * 1e3 / fileNs, ok ? "" : "  FAILED");
+    }
+    std::printf("\n");
+}
+
+struct Benchmark
+{
+    const char* name;
+    void (*run)();
+};
+
+static const Benchmark benchmarks[] =
+{
+    { "reader", benchReaderStore },
+    { "batch", benchBatchLookup },
+    { "scan", benchSmallScan },
+    { "lazy", benchLazyLoad },
+    { "storage", benchStorage },
+    { "bind", benchBind },
+    { "crc", benchChecksum },
+    { "byteorder", benchByteOrder },
+    { "compress", benchCompression },
+    { "delta", benchDelta },
+    { "layers", benchLayers },
+    { "builder", benchBuilder },
+};
+
+/*
+ * Usage: TOML2Pbf-Bench [name...]
+ * Runs the named benchmarks, or all of them if no name is given.
+ */
+int main(int argc, char* argv[])
+{
+    for (const Benchmark& bench : benchmarks)
+    {
+        bool selected = (argc < 2);
+        for (int i = 1; i < argc; i++)
+        {
+            if (std::strcmp(argv[i], bench.name) == 0)
+            {
+                selected = true;
+            }
+        }
+        if (selected)
+        {
+            bench.run();
+        }
+    }
+    return 0;
+}
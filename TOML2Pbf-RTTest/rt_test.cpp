@@ -0,0 +1,333 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+/*
+ * Tests of the PBF_RT build (PBF_RT is defined for the whole project).
+ * The global operator new is replaced to count allocations. Every lookup that a real-time task
+ * may call is run inside a NoAllocationScope and the test fails if it allocated.
+ */
+
+#include "pch.h"
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <atomic>
+#include <string>
+#include <fstream>
+#include <vector>
+#include "PBFReader.h"
+#include "PBFView.h"
+#include "PBFStorageView.h"
+#include "ParamBinFileWriter.h"
+#include <windows.h>
+
+#ifndef PBF_RT
+#error "TOML2Pbf-RTTest must be built with PBF_RT"
+#endif
+
+static std::atomic<bool> g_countAllocations(false);
+static std::atomic<std::uint32_t> g_allocations(0U);
+
+void* operator new(std::size_t size)
+{
+    if (g_countAllocations)
+    {
+        g_allocations++;
+    }
+    void* memory = std::malloc((size == 0U) ? 1U : size);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+/*Counts the allocations done while the scope exists*/
+class NoAllocationScope
+{
+public:
+    NoAllocationScope()
+    {
+        g_allocations = 0U;
+        g_countAllocations = true;
+    }
+
+    ~NoAllocationScope()
+    {
+        g_countAllocations = false;
+    }
+
+    std::uint32_t allocations() const
+    {
+        return g_allocations;
+    }
+};
+
+std::vector<char> readExampleFile()
+{
+    char buffer[MAX_PATH];
+    GetCurrentDirectoryA(MAX_PATH, buffer);
+    std::string strpath(buffer);
+    std::size_t pos = strpath.find("TOML2Pbf-RTTest");
+    if (pos != std::string::npos)
+    {
+        strpath.erase(pos);
+    }
+    std::ifstream inFile(strpath + "example.pbf", std::ios::binary | std::ios::ate);
+    if (!inFile)
+    {
+        return std::vector<char>();
+    }
+    std::size_t size = static_cast<std::size_t>(inFile.tellg());
+    inFile.seekg(0, std::ios::beg);
+
+    std::vector<char> image(size);
+    inFile.read(image.data(), size);
+    return image;
+}
+
+/*writes count UInt32 parameters "Param[i]" = i with the requested sections*/
+std::vector<std::uint8_t> buildUInt32Image(std::uint32_t count, const std::vector<PBF::SectionTypes>& sectionTypes)
+{
+    std::uint32_t size = PBF::PBF_FILE_HEADER_SIZE + count * (PBF::PBF_FILE_RECORD_HEADER_SIZE + 4U);
+    size += PBF::ParamBinFileWriter::getSectionDirectorySize(static_cast<std::uint32_t>(sectionTypes.size()));
+    for (PBF::SectionTypes type : sectionTypes)
+    {
+        size += (type == PBF::SectionTypes::HashIndex) ? PBF::ParamBinFileWriter::getHashIndexSectionSize(count) : PBF::getPerfectHashSectionSize(count);
+    }
+    std::vector<std::uint8_t> image(size);
+    PBF::ParamBinFileWriter writer(image.data(), image.size());
+    writer.writeHeader(size, PBF::PBF_FILE_VERSION);
+    for (std::uint32_t i = 0U; i < count; i++)
+    {
+        PBF::BinaryDataRecord record;
+        record.hash = PBF::pbfHash("Param[" + std::to_string(i) + "]");
+        record.type = static_cast<std::uint8_t>(PBF::DataTypes::UInt32);
+        record.data_size = 4U;
+        writer.writeRecord(record, &i);
+    }
+    std::vector<PBF::PbfSection> sections;
+    for (PBF::SectionTypes type : sectionTypes)
+    {
+        sections.push_back((type == PBF::SectionTypes::HashIndex) ? writer.makeHashIndexSection() : writer.makePerfectHashSection());
+    }
+    writer.writeSections(sections);
+    return image;
+}
+
+using namespace PBF::literals;
+
+/*the lookup API can not throw*/
+static_assert(noexcept(std::declval<const PBF::PBFReader&>().getParam<double>("Ts"_pbf)));
+static_assert(noexcept(std::declval<const PBF::PBFReader&>().getParam<std::string_view>("title"_pbf)));
+static_assert(noexcept(std::declval<const PBF::PBFReader&>().getType("Ts"_pbf)));
+static_assert(noexcept(std::declval<const PBF::PBFReader&>().resolve<float>("Ts"_pbf)));
+static_assert(noexcept(std::declval<const PBF::PBFReader&>().getParams(std::span<const PBF::KeyHash>(), std::span<PBF::ValueSlot>())));
+static_assert(noexcept(std::declval<const PBF::PBFView&>().getParam<PBF::DateTime>("test_date_time"_pbf)));
+static_assert(noexcept(std::declval<const PBF::PBFView&>().contains("Ts"_pbf)));
+static_assert(noexcept(PBF::KeyHash("Ts")));
+
+TEST(RealTime, HarnessCountsAllocations)
+{
+    NoAllocationScope scope;
+    void* memory = ::operator new(16U);
+    ::operator delete(memory);
+    EXPECT_EQ(1U, scope.allocations());
+}
+
+struct MotorParams
+{
+    float Rs = 0.0f;
+    float Lq = 0.0f;
+    float PeakTorque = 0.0f;
+    std::uint32_t p = 0U;
+    std::string_view name;
+};
+
+PBF_BINDING(MotorParams, PBF_FIELD(MotorParams, Rs), PBF_FIELD(MotorParams, Lq), PBF_FIELD(MotorParams, PeakTorque),
+    PBF_FIELD(MotorParams, p), PBF_FIELD(MotorParams, name))
+
+TEST(RealTime, ReaderLookupsDoNotAllocate)
+{
+    std::vector<char> image = readExampleFile();
+    ASSERT_FALSE(image.empty());
+
+    PBF::PBFReader reader;
+    ASSERT_TRUE(reader.read(image.data()));
+
+    NoAllocationScope scope;
+
+    std::optional<double> ts = reader.getParam<double>("Ts"_pbf);
+    std::optional<float> peakTorque = reader.getParam<float>("Plant.Motors[0].PeakTorque");
+    std::optional<std::int32_t> clock = reader.getParam<std::int32_t>("SystemClockFrequency"_pbf);
+    std::optional<std::string_view> title = reader.getParam<std::string_view>("title"_pbf);
+    std::optional<PBF::Date> phoenixDate = reader.getParam<PBF::Date>("phoenix_date"_pbf);
+    std::optional<PBF::DateTime> dateTime = reader.getParam<PBF::DateTime>("test_date_time"_pbf);
+    PBF::DataTypes type = reader.getType("UART1.BaudRate"_pbf);
+    PBF::ParamHandle<double> handle = reader.resolve<double>("PowerSupply.DCBusVoltage"_pbf);
+    std::optional<double> missing = reader.getParam<double>("NoSuchKey"_pbf);
+    std::optional<bool> wrongType = reader.getParam<bool>("Ts"_pbf);
+
+    const PBF::KeyHash keys[] = { "UART1.BaudRate"_pbf, "UART2.BaudRate"_pbf, "NoSuchKey"_pbf };
+    PBF::ValueSlot values[3];
+    std::size_t found = reader.getParams(keys, values);
+    std::optional<std::uint32_t> baudRate = reader.getValue<std::uint32_t>(values[1]);
+
+    MotorParams motor;
+    std::size_t bound = reader.bind("Plant.Motors[1]"_pbf, motor);
+    static_assert(noexcept(reader.bind("Plant.Motors[1]"_pbf, motor)), "bind must be noexcept without string fields");
+
+    EXPECT_EQ(0U, scope.allocations());
+
+    EXPECT_DOUBLE_EQ(0.0001, ts.value());
+    EXPECT_FLOAT_EQ(14.30f, peakTorque.value());
+    EXPECT_EQ(1000, clock.value());
+    EXPECT_EQ(std::string_view("Configuration Example"), title.value());
+    EXPECT_EQ(2023U, phoenixDate->year);
+    EXPECT_EQ(8U, dateTime->time.hour);
+    EXPECT_NE(PBF::DataTypes::None, type);
+    EXPECT_DOUBLE_EQ(320.0, handle.get());
+    EXPECT_FALSE(missing.has_value());
+    EXPECT_FALSE(wrongType.has_value());
+    EXPECT_EQ(2U, found);
+    EXPECT_EQ(115200U, baudRate.value());
+    EXPECT_EQ(5U, bound);
+    EXPECT_FLOAT_EQ(14.30f, motor.PeakTorque);
+    EXPECT_EQ(std::string_view("Motor2"), motor.name);
+}
+
+TEST(RealTime, ViewLookupsDoNotAllocate)
+{
+    const std::uint32_t count = 1000U;
+    std::vector<std::uint8_t> plain = buildUInt32Image(count, {});
+    std::vector<std::uint8_t> indexed = buildUInt32Image(count, { PBF::SectionTypes::HashIndex });
+    std::vector<std::uint8_t> perfectHash = buildUInt32Image(count, { PBF::SectionTypes::PerfectHash });
+
+    NoAllocationScope scope;
+
+    std::uint64_t sum(0U);
+    for (const std::vector<std::uint8_t>* image : { &plain, &indexed, &perfectHash })
+    {
+        PBF::PBFView view(image->data(), image->size());
+        sum += view.isOpen() ? 1U : 0U;
+        sum += view.getParam<std::uint32_t>("Param[7]"_pbf).value_or(0U);
+        sum += view.getParam<std::uint64_t>("Param[999]"_pbf).value_or(0U);
+        sum += view.contains("Param[1000]"_pbf) ? 1U : 0U;
+    }
+
+    EXPECT_EQ(0U, scope.allocations());
+    EXPECT_EQ(3U * (1U + 7U + 999U), sum);
+}
+
+TEST(RealTime, FlatIndexProbesAreBounded)
+{
+    PBF::FlatHashIndex index;
+    index.reserve(100000U);
+    for (std::uint32_t i = 0U; i < 100000U; i++)
+    {
+        ASSERT_TRUE(index.insert(PBF::pbfHash("Param[" + std::to_string(i) + "]"), i));
+    }
+    EXPECT_GT(index.maxProbeLength(), 0U);
+    EXPECT_LT(index.maxProbeLength(), 64U);
+    EXPECT_EQ(PBF::FlatHashIndex::NPOS, index.find(PBF::pbfHash("Param[100000]")));
+    EXPECT_EQ(4711U, index.find(PBF::pbfHash("Param[4711]")));
+}
+
+TEST(RealTime, LazyLookupsDoNotAllocate)
+{
+    /*more records than the lazy cache holds*/
+    const std::uint32_t count = 3000U;
+    std::vector<std::uint8_t> image = buildUInt32Image(count, { PBF::SectionTypes::PerfectHash });
+    std::vector<PBF::KeyHash> keys;
+    for (std::uint32_t i = 0U; i < count; i++)
+    {
+        keys.push_back(PBF::KeyHash("Param[" + std::to_string(i) + "]"));
+    }
+
+    PBF::PBFReader reader;
+    ASSERT_TRUE(reader.readLazy(image.data(), image.size()));
+
+    NoAllocationScope scope;
+
+    std::uint64_t sum(0U);
+    for (const PBF::KeyHash& key : keys)
+    {
+        sum += reader.getParam<std::uint32_t>(key).value_or(0U);
+    }
+
+    EXPECT_EQ(0U, scope.allocations());
+    EXPECT_EQ(static_cast<std::uint64_t>(count) * (count - 1U) / 2U, sum);
+}
+
+TEST(RealTime, StorageLookupsDoNotAllocate)
+{
+    std::vector<char> image = readExampleFile();
+    ASSERT_FALSE(image.empty());
+    PBF::MemoryStorage storage(image.data(), static_cast<std::uint32_t>(image.size()));
+    PBF::PBFStorageView<> view(storage);
+    ASSERT_TRUE(view.open());
+
+    NoAllocationScope scope;
+
+    char title[32];
+    std::optional<std::uint32_t> length = view.getString("title"_pbf, title, sizeof(title));
+    std::optional<double> ts = view.getParam<double>("Ts"_pbf);
+    std::optional<PBF::Time> time = view.getParam<PBF::Time>("test_time"_pbf);
+    bool missing = view.contains("NoSuchKey"_pbf);
+
+    EXPECT_EQ(0U, scope.allocations());
+    EXPECT_EQ(21U, length.value());
+    EXPECT_DOUBLE_EQ(0.0001, ts.value());
+    EXPECT_EQ(30U, time->minute);
+    EXPECT_FALSE(missing);
+}
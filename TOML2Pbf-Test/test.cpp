@@ -33,7 +33,18 @@ SOFTWARE.
 #include <fstream>
 #include <vector>
 #include <algorithm>
+#include <thread>
+#include <atomic>
 #include "PBFReader.h"
+#include "PBFView.h"
+#include "PBFReaderHandle.h"
+#include "PBFStorageView.h"
+#include "PBFCompression.h"
+#include "PBFDelta.h"
+#include "PBFLayeredReader.h"
+#include "PBFBuilder.h"
+#include "ParamBinFileWriter.h"
+#include "Toml2PbfLayout.h"
 #include <windows.h>
 
 void remove_substring(std::string& str, const std::string& remove)
@@ -53,6 +64,59 @@ std::string getCurrentPath()
     return std::string(buffer);
 }
 
+std::vector<char> readExampleFile()
+{
+    std::string strpath = getCurrentPath();
+    remove_substring(strpath, "TOML2Pbf-Test");
+    std::string fileName1 = strpath + "example.pbf";
+
+    std::ifstream inFile(fileName1, std::ios::binary | std::ios::ate);
+    if (!inFile)
+    {
+        return std::vector<char>();
+    }
+    std::size_t size = static_cast<std::size_t>(inFile.tellg());
+    inFile.seekg(0, std::ios::beg);
+
+    std::vector<char> buffer(size);
+    inFile.read(buffer.data(), size);
+    return buffer;
+}
+
+/*writes count UInt32 parameters "Param[i]" = i in reverse order*/
+std::vector<std::uint8_t> buildUInt32Image(std::uint32_t count, const std::vector<PBF::SectionTypes>& sectionTypes = {})
+{
+    std::uint32_t size = PBF::PBF_FILE_HEADER_SIZE + count * (PBF::PBF_FILE_RECORD_HEADER_SIZE + 4U);
+    if (!sectionTypes.empty())
+    {
+        size += PBF::ParamBinFileWriter::getSectionDirectorySize(static_cast<std::uint32_t>(sectionTypes.size()));
+    }
+    for (PBF::SectionTypes type : sectionTypes)
+    {
+        size += (type == PBF::SectionTypes::HashIndex) ? PBF::ParamBinFileWriter::getHashIndexSectionSize(count) : PBF::getPerfectHashSectionSize(count);
+    }
+    std::vector<std::uint8_t> image(size);
+    PBF::ParamBinFileWriter writer(image.data(), image.size());
+    std::uint32_t written = writer.writeHeader(size, PBF::PBF_FILE_VERSION);
+    for (std::uint32_t i = count; i > 0U; i--)
+    {
+        std::uint32_t value = i - 1U;
+        PBF::BinaryDataRecord record;
+        record.hash = PBF::pbfHash("Param[" + std::to_string(value) + "]");
+        record.type = static_cast<std::uint8_t>(PBF::DataTypes::UInt32);
+        record.data_size = 4U;
+        written += writer.writeRecord(record, &value);
+    }
+    std::vector<PBF::PbfSection> sections;
+    for (PBF::SectionTypes type : sectionTypes)
+    {
+        sections.push_back((type == PBF::SectionTypes::HashIndex) ? writer.makeHashIndexSection() : writer.makePerfectHashSection());
+    }
+    written += writer.writeSections(sections);
+    EXPECT_EQ(size, written);
+    return image;
+}
+
 template<typename T>
 bool CheckParam(PBF::PBFReader& pbfReader, const std::string& key, T value)
 {
@@ -270,4 +334,1562 @@ UART2.WriteTimeout	Type UInt32	740059371
     EXPECT_TRUE(CheckParam<float>(pbfReader, "Testing.test1.Steps[4]	
     EXPECT_TRUE(CheckParam<float>(pbfReader, "Testing.test1.Steps[5]
     */
-}
\ No newline at end of file
+}
+
+TEST(PBFView, ReadsParametersInPlace)
+{
+    std::vector<char> buffer = readExampleFile();
+    ASSERT_FALSE(buffer.empty());
+
+    PBF::PBFView view(std::as_bytes(std::span<const char>(buffer)));
+    ASSERT_TRUE(view.isOpen());
+    EXPECT_EQ(PBF::PBF_FILE_VERSION, view.version());
+
+    std::optional<std::string_view> title = view.getParam<std::string_view>("title");
+    ASSERT_TRUE(title.has_value());
+    EXPECT_EQ("Configuration Example", title.value());
+    /*string points into the image*/
+    EXPECT_TRUE(title->data() >= buffer.data() && title->data() < buffer.data() + buffer.size());
+
+    std::optional<PBF::DateTime> test_date_time = view.getParam<PBF::DateTime>("test_date_time");
+    ASSERT_TRUE(test_date_time.has_value());
+    EXPECT_EQ(2023, test_date_time->date.year);
+    EXPECT_EQ(8, test_date_time->time.hour);
+    EXPECT_EQ(30, test_date_time->time.minute);
+
+    EXPECT_NEAR(14.3f, view.getParam<float>("Plant.Motors[0].PeakTorque").value(), 0.000001);
+    EXPECT_NEAR(-0.90483741803595952, view.getParam<double>("Controller.Motor1.CurrentController.IIRFilter.a1").value(), 1e-15);
+    EXPECT_EQ(115200U, view.getParam<std::uint32_t>("UART1.BaudRate").value());
+    EXPECT_EQ(115200, view.getParam<std::int64_t>("UART1.BaudRate").value());
+    EXPECT_FALSE(view.getParam<bool>("Controller.Motor1.VelocityController.UsePreFilter").value());
+    EXPECT_EQ(PBF::DataTypes::Float64, view.getType("Controller.Motor1.CurrentController.IIRFilter.b0"));
+
+    EXPECT_FALSE(view.getParam<float>("title").has_value());
+    EXPECT_FALSE(view.getParam<float>("NotExisting").has_value());
+    EXPECT_FALSE(view.contains("NotExisting"));
+
+    std::size_t count(0U);
+    EXPECT_TRUE(view.forEachRecord([&count](const PBF::RecordRef&) { count++; }));
+    EXPECT_EQ(113U, count);
+
+    /*truncated images are rejected*/
+    PBF::PBFView truncated(buffer.data(), buffer.size() - 4U);
+    EXPECT_FALSE(truncated.isOpen());
+}
+
+TEST(PBFView, UsesHashIndexSection)
+{
+    const std::uint32_t count = 1000U;
+    std::vector<std::uint8_t> image = buildUInt32Image(count, { PBF::SectionTypes::HashIndex });
+
+    PBF::PBFView view(image.data(), image.size());
+    ASSERT_TRUE(view.isOpen());
+    EXPECT_TRUE(view.hasIndex());
+    EXPECT_EQ(PBF::PBF_FILE_VERSION_SECTIONS, view.version());
+
+    for (std::uint32_t i = 0U; i < count; i++)
+    {
+        std::optional<std::uint32_t> value = view.getParam<std::uint32_t>("Param[" + std::to_string(i) + "]");
+        ASSERT_TRUE(value.has_value());
+        EXPECT_EQ(i, value.value());
+    }
+    EXPECT_FALSE(view.contains("Param[1000]"));
+
+    /*records and sections are kept apart*/
+    std::size_t records(0U);
+    EXPECT_TRUE(view.forEachRecord([&records](const PBF::RecordRef&) { records++; }));
+    EXPECT_EQ(count, records);
+
+    PBF::PBFReader reader;
+    EXPECT_TRUE(reader.read(image.data()));
+    EXPECT_EQ(PBF::DataTypes::UInt32, reader.getType("Param[999]"));
+
+    /*the same lookups without index*/
+    std::vector<std::uint8_t> plain = buildUInt32Image(count);
+    PBF::PBFView plainView(plain.data(), plain.size());
+    EXPECT_FALSE(plainView.hasIndex());
+    EXPECT_EQ(123U, plainView.getParam<std::uint32_t>("Param[123]").value());
+}
+
+TEST(PBFView, UsesPerfectHashSection)
+{
+    const std::uint32_t count = 10000U;
+    std::vector<std::uint8_t> image = buildUInt32Image(count, { PBF::SectionTypes::PerfectHash });
+
+    PBF::PBFView view(image.data(), image.size());
+    ASSERT_TRUE(view.isOpen());
+    EXPECT_TRUE(view.hasIndex());
+
+    for (std::uint32_t i = 0U; i < count; i++)
+    {
+        std::optional<std::uint32_t> value = view.getParam<std::uint32_t>("Param[" + std::to_string(i) + "]");
+        ASSERT_TRUE(value.has_value());
+        EXPECT_EQ(i, value.value());
+    }
+    for (std::uint32_t i = count; i < 2U * count; i++)
+    {
+        EXPECT_FALSE(view.contains("Param[" + std::to_string(i) + "]"));
+    }
+}
+
+TEST(PerfectHashBuilder, IsMinimalAndPerfect)
+{
+    std::vector<std::uint32_t> hashes;
+    for (std::uint32_t i = 0U; i < 100000U; i++)
+    {
+        hashes.push_back(PBF::pbfHash("Key" + std::to_string(i)));
+    }
+    PBF::PerfectHashBuilder builder;
+    ASSERT_TRUE(builder.build(hashes));
+
+    std::vector<bool> used(hashes.size(), false);
+    for (std::uint32_t hash : hashes)
+    {
+        std::uint32_t position = builder.lookup(hash);
+        ASSERT_LT(position, hashes.size());
+        EXPECT_FALSE(used[position]);
+        used[position] = true;
+    }
+
+    /*duplicate keys are rejected*/
+    hashes.push_back(hashes.front());
+    EXPECT_FALSE(builder.build(hashes));
+}
+
+TEST(KeyHash, IsComputedAtCompileTime)
+{
+    using namespace PBF::literals;
+
+    static_assert("ConfigVersion"_pbf.value == 3740507785U);
+    static_assert("ConfigVersion"_pbf == PBF::KeyHash("ConfigVersion"));
+    constexpr PBF::KeyHash peakTorque = "Plant.Motors[0].PeakTorque"_pbf;
+
+    std::vector<char> buffer = readExampleFile();
+    ASSERT_FALSE(buffer.empty());
+
+    PBF::PBFView view(buffer.data(), buffer.size());
+    EXPECT_NEAR(14.3f, view.getParam<float>(peakTorque).value(), 0.000001);
+    EXPECT_EQ("1.0", view.getParam<std::string_view>("ConfigVersion"_pbf).value());
+    EXPECT_EQ(1000U, view.getParam<std::uint32_t>(PBF::KeyHash(PBF::pbfHash("SystemClockFrequency"))).value());
+
+    PBF::PBFReader pbfReader;
+    EXPECT_TRUE(pbfReader.read(buffer.data()));
+    EXPECT_EQ(PBF::DataTypes::Float64, pbfReader.getType(peakTorque));
+    EXPECT_EQ(PBF::DataTypes::String, pbfReader.getType(std::string("ConfigVersion")));
+}
+
+TEST(ParamHandle, ResolvesOnce)
+{
+    using namespace PBF::literals;
+
+    std::vector<char> buffer = readExampleFile();
+    ASSERT_FALSE(buffer.empty());
+
+    PBF::PBFReader pbfReader;
+    EXPECT_TRUE(pbfReader.read(buffer.data()));
+
+    struct MotorParams
+    {
+        PBF::ParamHandle<float> rs;
+        PBF::ParamHandle<double> peakTorque;
+        PBF::ParamHandle<std::uint32_t> polePairs;
+        PBF::ParamHandle<std::string_view> name;
+    } motor;
+
+    motor.rs = pbfReader.resolve<float>("Plant.Motors[0].Rs"_pbf);
+    motor.peakTorque = pbfReader.resolve<double>("Plant.Motors[0].PeakTorque");
+    motor.polePairs = pbfReader.resolve<std::uint32_t>("Plant.Motors[0].p"_pbf);
+    motor.name = pbfReader.resolve<std::string_view>("Plant.Motors[0].name"_pbf);
+
+    ASSERT_TRUE(motor.rs && motor.peakTorque && motor.polePairs && motor.name);
+    EXPECT_NEAR(1.1f, motor.rs.get(), 0.000001);
+    EXPECT_NEAR(14.3, motor.peakTorque.get(), 0.000001);
+    EXPECT_EQ(1U, motor.polePairs.get());
+    EXPECT_EQ("Motor1", motor.name.get());
+
+    /*not existing and incompatible parameters*/
+    EXPECT_FALSE(pbfReader.resolve<float>("Plant.Motors[9].Rs"_pbf).isValid());
+    EXPECT_FALSE(pbfReader.resolve<bool>("Plant.Motors[0].Rs"_pbf).isValid());
+    EXPECT_FALSE(pbfReader.resolve<std::string_view>("Plant.Motors[0].Rs"_pbf).isValid());
+    EXPECT_TRUE(std::is_trivially_copyable<PBF::ParamHandle<double>>::value);
+}
+
+TEST(PBFReader, GetsParamsInBatches)
+{
+    const std::uint32_t count = 1000U;
+    std::vector<std::uint8_t> image = buildUInt32Image(count);
+
+    PBF::PBFReader pbfReader;
+    ASSERT_TRUE(pbfReader.read(image.data()));
+
+    /*more keys than one block, every third key does not exist*/
+    std::vector<PBF::KeyHash> keys;
+    for (std::uint32_t i = 0U; i < 300U; i++)
+    {
+        std::uint32_t param = (i % 3U == 2U) ? (count + i) : (i * 3U);
+        keys.push_back(PBF::KeyHash("Param[" + std::to_string(param) + "]"));
+    }
+    std::vector<PBF::ValueSlot> values(keys.size());
+    EXPECT_EQ(200U, pbfReader.getParams(keys, values));
+
+    for (std::uint32_t i = 0U; i < keys.size(); i++)
+    {
+        std::optional<std::uint32_t> value = pbfReader.getValue<std::uint32_t>(values[i]);
+        if (i % 3U == 2U)
+        {
+            EXPECT_EQ(PBF::DataTypes::None, values[i].getType());
+            EXPECT_FALSE(value.has_value());
+        }
+        else
+        {
+            ASSERT_TRUE(value.has_value());
+            EXPECT_EQ(i * 3U, value.value());
+            EXPECT_EQ(pbfReader.getParam<std::uint32_t>(keys[i]), value);
+        }
+    }
+
+    std::vector<char> buffer = readExampleFile();
+    ASSERT_TRUE(pbfReader.read(buffer.data()));
+    const PBF::KeyHash exampleKeys[] = { "title", "Ts", "phoenix_date" };
+    PBF::ValueSlot exampleValues[3];
+    EXPECT_EQ(3U, pbfReader.getParams(exampleKeys, exampleValues));
+    EXPECT_EQ("Configuration Example", pbfReader.getValue<std::string>(exampleValues[0]).value());
+    EXPECT_NEAR(0.0001, pbfReader.getValue<double>(exampleValues[1]).value(), 0.0000001);
+    EXPECT_EQ(26U, pbfReader.getValue<PBF::Date>(exampleValues[2])->day);
+}
+
+TEST(PBFReader, ScansSmallImages)
+{
+    std::vector<std::uint32_t> column;
+    for (std::uint32_t i = 0U; i < 40U; i++)
+    {
+        for (std::uint32_t k = 0U; k < column.size(); k++)
+        {
+            EXPECT_EQ(k, PBF::findHash(column.data(), static_cast<std::uint32_t>(column.size()), column[k]));
+        }
+        EXPECT_EQ(column.size(), PBF::findHash(column.data(), static_cast<std::uint32_t>(column.size()), 0xFFFFFFFFU));
+        column.push_back(PBF::pbfHash("Param[" + std::to_string(i) + "]"));
+    }
+
+    /*sizes around the scan limit use the scan or the flat index*/
+    for (std::uint32_t count : { 1U, 3U, PBF::PBF_SCAN_MAX_RECORDS, PBF::PBF_SCAN_MAX_RECORDS + 1U, 100U })
+    {
+        std::vector<std::uint8_t> image = buildUInt32Image(count);
+        PBF::PBFReader pbfReader;
+        ASSERT_TRUE(pbfReader.read(image.data()));
+        for (std::uint32_t i = 0U; i < count; i++)
+        {
+            EXPECT_EQ(i, pbfReader.getParam<std::uint32_t>("Param[" + std::to_string(i) + "]").value());
+        }
+        EXPECT_FALSE(pbfReader.getParam<std::uint32_t>("Param[" + std::to_string(count) + "]").has_value());
+    }
+}
+
+TEST(PBFReaderHandle, KeepsPinnedSnapshots)
+{
+    PBF::PBFReaderHandle handle(4U);
+    std::int32_t readerId = handle.attach();
+    ASSERT_GE(readerId, 0);
+    EXPECT_FALSE(handle.pin(readerId));
+
+    std::vector<std::uint8_t> image1 = buildUInt32Image(10U);
+    std::vector<std::uint8_t> image2 = buildUInt32Image(20U);
+    ASSERT_TRUE(handle.load(image1.data()));
+
+    PBF::PBFReaderHandle::Snapshot snapshot = handle.pin(readerId);
+    ASSERT_TRUE(snapshot);
+    EXPECT_EQ(10U, snapshot->count());
+
+    /*the reload does not wait for the reader and keeps its snapshot alive*/
+    ASSERT_TRUE(handle.load(image2.data()));
+    std::fill(image1.begin(), image1.end(), 0U);
+    EXPECT_EQ(10U, snapshot->count());
+    EXPECT_EQ(9U, snapshot->getParam<std::uint32_t>("Param[9]").value());
+    EXPECT_EQ(1U, handle.collect());
+
+    snapshot.reset();
+    EXPECT_EQ(0U, handle.collect());
+
+    snapshot = handle.pin(readerId);
+    EXPECT_EQ(20U, snapshot->count());
+    snapshot.reset();
+
+    /*a failed load keeps the current snapshot*/
+    std::vector<std::uint8_t> broken(PBF::PBF_FILE_HEADER_SIZE, 0U);
+    EXPECT_FALSE(handle.load(broken.data()));
+    EXPECT_EQ(20U, handle.pin(readerId)->count());
+
+    /*lazy readers fill a cache in their lookups and can not be shared*/
+    std::unique_ptr<PBF::PBFReader> lazy = std::make_unique<PBF::PBFReader>();
+    ASSERT_TRUE(lazy->readLazy(image2.data(), image2.size()));
+    EXPECT_FALSE(handle.publish(std::move(lazy)));
+    EXPECT_FALSE(handle.publish(nullptr));
+    EXPECT_EQ(20U, handle.pin(readerId)->count());
+
+    handle.detach(readerId);
+}
+
+TEST(PBFReaderHandle, ReloadsWhileReading)
+{
+    const std::uint32_t numberOfReaders = 4U;
+    PBF::PBFReaderHandle handle(numberOfReaders);
+
+    std::vector<std::vector<std::uint8_t>> images;
+    for (std::uint32_t count = 1U; count <= 8U; count++)
+    {
+        images.push_back(buildUInt32Image(count * 10U));
+    }
+    ASSERT_TRUE(handle.load(images[0].data()));
+
+    std::atomic<bool> stop(false);
+    std::atomic<std::uint32_t> errors(0U);
+    std::vector<std::thread> readers;
+    for (std::uint32_t r = 0U; r < numberOfReaders; r++)
+    {
+        readers.emplace_back([&handle, &stop, &errors]()
+        {
+            std::int32_t readerId = handle.attach();
+            while (!stop)
+            {
+                PBF::PBFReaderHandle::Snapshot snapshot = handle.pin(readerId);
+                /*every snapshot is complete: Param[0] .. Param[count - 1]*/
+                std::uint32_t count = snapshot->count();
+                std::optional<std::uint32_t> last = snapshot->getParam<std::uint32_t>("Param[" + std::to_string(count - 1U) + "]");
+                if ((count % 10U != 0U) || !last || (last.value() != count - 1U) || snapshot->getParam<std::uint32_t>("Param[" + std::to_string(count) + "]"))
+                {
+                    errors++;
+                }
+            }
+            handle.detach(readerId);
+        });
+    }
+
+    for (std::uint32_t i = 0U; i < 500U; i++)
+    {
+        ASSERT_TRUE(handle.load(images[i % images.size()].data()));
+    }
+    stop = true;
+    for (std::thread& reader : readers)
+    {
+        reader.join();
+    }
+
+    EXPECT_EQ(0U, errors.load());
+    EXPECT_EQ(0U, handle.collect());
+}
+
+TEST(PBFReader, DecodesLazily)
+{
+    /*more records than PBF_LAZY_CACHE_SLOTS, the rest is decoded on every lookup*/
+    const std::uint32_t count = 2000U;
+    for (const std::vector<PBF::SectionTypes>& sections : std::vector<std::vector<PBF::SectionTypes>>{ {}, { PBF::SectionTypes::HashIndex }, { PBF::SectionTypes::PerfectHash } })
+    {
+        std::vector<std::uint8_t> image = buildUInt32Image(count, sections);
+        PBF::PBFReader pbfReader;
+        ASSERT_TRUE(pbfReader.readLazy(image.data(), image.size()));
+        EXPECT_TRUE(pbfReader.isLazy());
+        EXPECT_EQ(count, pbfReader.count());
+
+        for (std::uint32_t i = 0U; i < count; i += 3U)
+        {
+            EXPECT_EQ(i, pbfReader.getParam<std::uint32_t>("Param[" + std::to_string(i) + "]").value());
+            /*second lookup is served from the cache or decoded again*/
+            EXPECT_EQ(i, pbfReader.getParam<std::uint32_t>("Param[" + std::to_string(i) + "]").value());
+        }
+        EXPECT_FALSE(pbfReader.getParam<std::uint32_t>("Param[2000]").has_value());
+
+        /*blocks of uncached records must not overwrite each other*/
+        std::vector<std::string> names;
+        std::vector<PBF::KeyHash> keys;
+        for (std::uint32_t i = 0U; i < count; i++)
+        {
+            names.push_back("Param[" + std::to_string(i) + "]");
+        }
+        for (const std::string& name : names)
+        {
+            keys.push_back(name);
+        }
+        std::vector<PBF::ValueSlot> values(count);
+        EXPECT_EQ(count, pbfReader.getParams(keys, values));
+        for (std::uint32_t i = 0U; i < count; i++)
+        {
+            EXPECT_EQ(i, pbfReader.getValue<std::uint32_t>(values[i]).value());
+        }
+    }
+
+    /*all types of the example, compared with a fully read reader*/
+    std::vector<char> buffer = readExampleFile();
+    PBF::PBFReader eager;
+    PBF::PBFReader lazy;
+    ASSERT_TRUE(eager.read(buffer.data()));
+    ASSERT_TRUE(lazy.readLazy(buffer.data(), buffer.size()));
+    EXPECT_EQ(eager.count(), lazy.count());
+    EXPECT_EQ(eager.getParam<std::string>("description"), lazy.getParam<std::string>("description"));
+    EXPECT_EQ("Configuration Example", lazy.getParam<std::string_view>("title").value());
+    EXPECT_EQ(eager.getParam<double>("Plant.Motors[1].PeakTorque"), lazy.getParam<double>("Plant.Motors[1].PeakTorque"));
+    EXPECT_EQ(eager.getParam<PBF::DateTime>("test_date_time")->time.minute, lazy.getParam<PBF::DateTime>("test_date_time")->time.minute);
+    EXPECT_EQ(eager.getType("UART2.Parity"), lazy.getType("UART2.Parity"));
+
+    /*read() replaces the lazy image*/
+    ASSERT_TRUE(lazy.read(buffer.data()));
+    EXPECT_FALSE(lazy.isLazy());
+    EXPECT_EQ("Configuration Example", lazy.getParam<std::string_view>("title").value());
+}
+
+TEST(PBFStorageView, ReadsThroughPageCache)
+{
+    const std::uint32_t count = 10000U;
+    for (const std::vector<PBF::SectionTypes>& sections : std::vector<std::vector<PBF::SectionTypes>>{ {}, { PBF::SectionTypes::HashIndex }, { PBF::SectionTypes::PerfectHash } })
+    {
+        std::vector<std::uint8_t> image = buildUInt32Image(count, sections);
+        PBF::SimulatedFlashStorage flash(image.data(), static_cast<std::uint32_t>(image.size()), std::chrono::nanoseconds(0), std::chrono::nanoseconds(0));
+        PBF::PBFStorageView<256U, 4U> view(flash);
+        ASSERT_TRUE(view.open());
+        EXPECT_EQ(!sections.empty(), view.hasIndex());
+
+        for (std::uint32_t i = 0U; i < count; i += 97U)
+        {
+            EXPECT_EQ(i, view.getParam<std::uint32_t>("Param[" + std::to_string(i) + "]").value());
+        }
+        EXPECT_FALSE(view.contains("Param[10000]"));
+    }
+
+    /*with the perfect hash a lookup needs at most pilot, remap, slot and record page*/
+    std::vector<std::uint8_t> image = buildUInt32Image(count, { PBF::SectionTypes::PerfectHash });
+    PBF::SimulatedFlashStorage flash(image.data(), static_cast<std::uint32_t>(image.size()), std::chrono::nanoseconds(0), std::chrono::nanoseconds(0));
+    PBF::PBFStorageView<256U, 4U> view(flash);
+    ASSERT_TRUE(view.open());
+    flash.resetStatistics();
+    EXPECT_EQ(4711U, view.getParam<std::uint32_t>("Param[4711]").value());
+    EXPECT_LE(flash.reads(), 4U);
+    EXPECT_LE(flash.bytesRead(), 4U * 256U);
+    flash.resetStatistics();
+    EXPECT_EQ(4711U, view.getParam<std::uint32_t>("Param[4711]").value());
+    EXPECT_EQ(0U, flash.reads());
+
+    /*reads past the end of the storage fail, also inside the partially filled last page*/
+    std::vector<std::uint8_t> bytes(300U, 0xA5U);
+    PBF::MemoryStorage small(bytes.data(), static_cast<std::uint32_t>(bytes.size()));
+    PBF::PageCache<256U, 2U> cache(small);
+    std::uint8_t out[64];
+    EXPECT_TRUE(cache.read(0U, out, sizeof(out)));
+    EXPECT_TRUE(cache.read(280U, out, 20U));
+    EXPECT_FALSE(cache.read(290U, out, 20U));
+    EXPECT_FALSE(cache.read(301U, out, 0U));
+}
+
+TEST(PBFStorageView, ReadsAllTypes)
+{
+    std::vector<char> buffer = readExampleFile();
+    ASSERT_FALSE(buffer.empty());
+    PBF::PBFReader pbfReader;
+    ASSERT_TRUE(pbfReader.read(buffer.data()));
+
+    PBF::MemoryStorage storage(buffer.data(), static_cast<std::uint32_t>(buffer.size()));
+    PBF::PBFStorageView<> view(storage);
+    ASSERT_TRUE(view.open());
+
+    EXPECT_EQ(pbfReader.getParam<double>("Ts"), view.getParam<double>("Ts"));
+    EXPECT_EQ(pbfReader.getParam<float>("Plant.Motors[0].PeakTorque"), view.getParam<float>("Plant.Motors[0].PeakTorque"));
+    EXPECT_EQ(pbfReader.getParam<std::uint32_t>("UART1.BaudRate"), view.getParam<std::uint32_t>("UART1.BaudRate"));
+    EXPECT_EQ(pbfReader.getParam<bool>("NetworkSettings.UseDHCP"), view.getParam<bool>("NetworkSettings.UseDHCP"));
+    EXPECT_EQ(pbfReader.getParam<PBF::Date>("phoenix_date")->day, view.getParam<PBF::Date>("phoenix_date")->day);
+    EXPECT_EQ(pbfReader.getParam<std::string>("description"), view.getParam<std::string>("description"));
+
+    char text[32];
+    EXPECT_EQ(21U, view.getString("title", text, sizeof(text)).value());
+    EXPECT_STREQ("Configuration Example", text);
+    EXPECT_FALSE(view.getString("title", text, 10U).has_value());
+    EXPECT_FALSE(view.getString("Ts", text, sizeof(text)).has_value());
+}
+
+TEST(PBFStorageView, CopiesPackedArrays)
+{
+    const double calibration[] = { 1.0e-12, 2.5, -3.75 };
+    const std::int32_t offsets[] = { -7, 0, 7, 100000 };
+    std::vector<std::uint32_t> gains(300U);
+    for (std::uint32_t i = 0U; i < gains.size(); i++)
+    {
+        gains[i] = i * 3U;
+    }
+    PBF::PbfBufferSink sink;
+    PBF::PbfBuilder builder(sink, { PBF::SectionTypes::HashIndex });
+    EXPECT_TRUE(builder.add("Enabled", true));
+    EXPECT_TRUE(builder.addArray<double>("Calibration", calibration));
+    EXPECT_TRUE(builder.addArray<std::int32_t>("Offsets", offsets));
+    EXPECT_TRUE(builder.addArray<std::uint32_t>("Gains", gains));
+    ASSERT_TRUE(builder.finish());
+    const std::vector<std::uint8_t>& image = sink.buffer();
+
+    /*small pages, the elements of Gains span several of them*/
+    PBF::MemoryStorage storage(image.data(), static_cast<std::uint32_t>(image.size()));
+    PBF::PBFStorageView<64U, 2U> view(storage);
+    ASSERT_TRUE(view.open());
+    double cal[4] = {};
+    EXPECT_EQ(3U, view.getArray<double>("Calibration", cal).value());
+    EXPECT_EQ(-3.75, cal[2]);
+    std::int32_t off[4] = {};
+    EXPECT_EQ(4U, view.getArray<std::int32_t>("Offsets", off).value());
+    EXPECT_EQ(100000, off[3]);
+    std::vector<std::uint32_t> copied(300U);
+    EXPECT_EQ(300U, view.getArray<std::uint32_t>("Gains", std::span<std::uint32_t>(copied)).value());
+    EXPECT_EQ(gains, copied);
+
+    /*wrong element type, too small buffer, no array*/
+    EXPECT_FALSE(view.getArray<float>("Calibration", std::span<float>()).has_value());
+    EXPECT_FALSE(view.getArray<double>("Calibration", std::span<double>(cal, 2U)).has_value());
+    EXPECT_FALSE(view.getArray<std::int32_t>("Enabled", off).has_value());
+    EXPECT_FALSE(view.getArray<std::int32_t>("Missing", off).has_value());
+}
+
+TEST(PBFReader, ReadsPackedArrays)
+{
+    const float coefficients[] = { 0.5f, -1.25f, 2.0f, 0.125f, 3.5f };
+    const double calibration[] = { 1.0e-12, 2.5, -3.75 };
+    const std::int32_t offsets[] = { -7, 0, 7, 100000 };
+    const std::uint64_t masks[] = { 0xFFFF0000FFFF0000ULL };
+
+    std::uint32_t size = PBF::PBF_FILE_HEADER_SIZE + 5U * PBF::PBF_FILE_RECORD_HEADER_SIZE + 4U +
+        PBF::getArrayRecordDataSize(PBF::DataTypes::Float32, 5U) + PBF::getArrayRecordDataSize(PBF::DataTypes::Float64, 3U) +
+        PBF::getArrayRecordDataSize(PBF::DataTypes::Int32, 4U) + PBF::getArrayRecordDataSize(PBF::DataTypes::UInt64, 1U);
+    std::vector<std::uint64_t> memory((size + 7U) / 8U); /*8-byte aligned image*/
+    PBF::ParamBinFileWriter writer(memory.data(), size);
+    std::uint32_t written = writer.writeHeader(size, PBF::PBF_FILE_VERSION);
+
+    /*the records in front place the two 64-bit arrays at both alignments*/
+    std::uint32_t value = 42U;
+    PBF::BinaryDataRecord record;
+    record.hash = PBF::pbfHash("Value");
+    record.type = static_cast<std::uint8_t>(PBF::DataTypes::UInt32);
+    record.data_size = 4U;
+    written += writer.writeRecord(record, &value);
+    written += writer.writeArrayRecord(PBF::pbfHash("Filter.Coefficients"), PBF::DataTypes::Float32, 5U, coefficients);
+    written += writer.writeArrayRecord(PBF::pbfHash("Calibration"), PBF::DataTypes::Float64, 3U, calibration);
+    written += writer.writeArrayRecord(PBF::pbfHash("Offsets"), PBF::DataTypes::Int32, 4U, offsets);
+    written += writer.writeArrayRecord(PBF::pbfHash("Masks"), PBF::DataTypes::UInt64, 1U, masks);
+    ASSERT_EQ(size, written);
+
+    PBF::PBFReader eager;
+    PBF::PBFReader lazy;
+    ASSERT_TRUE(eager.read(memory.data()));
+    ASSERT_TRUE(lazy.readLazy(memory.data(), size));
+    PBF::PBFView view(memory.data(), size);
+    ASSERT_TRUE(view.isOpen());
+
+    for (const PBF::PBFReader* pbfReader : { &eager, &lazy })
+    {
+        EXPECT_EQ(PBF::DataTypes::Array, pbfReader->getType("Calibration"));
+        std::optional<std::span<const float>> filter = pbfReader->getArray<float>("Filter.Coefficients");
+        ASSERT_TRUE(filter.has_value());
+        EXPECT_TRUE(std::equal(filter->begin(), filter->end(), std::begin(coefficients), std::end(coefficients)));
+        std::optional<std::span<const double>> cal = pbfReader->getArray<double>("Calibration");
+        ASSERT_TRUE(cal.has_value());
+        EXPECT_TRUE(std::equal(cal->begin(), cal->end(), std::begin(calibration), std::end(calibration)));
+        EXPECT_EQ(0U, reinterpret_cast<std::uintptr_t>(cal->data()) % alignof(double));
+        EXPECT_EQ(-7, pbfReader->getArray<std::int32_t>("Offsets")->front());
+        EXPECT_EQ(masks[0], pbfReader->getArray<std::uint64_t>("Masks")->front());
+
+        /*elements are not converted*/
+        EXPECT_FALSE(pbfReader->getArray<double>("Filter.Coefficients").has_value());
+        EXPECT_FALSE(pbfReader->getArray<std::uint32_t>("Value").has_value());
+        EXPECT_FALSE(pbfReader->getParam<double>("Calibration").has_value());
+        EXPECT_EQ(42U, pbfReader->getParam<std::uint32_t>("Value").value());
+    }
+    EXPECT_EQ(3U, view.getArray<double>("Calibration")->size());
+    EXPECT_EQ(2.0f, view.getArray<float>("Filter.Coefficients").value()[2]);
+}
+
+struct ExampleMotor
+{
+    std::string name;
+    std::uint32_t p = 0U;
+    double b = 0.0;
+    float Rs = 0.0f;
+    double Lq = 0.0;
+    double Ld = 0.0;
+    double PeakTorque = 0.0;
+    double Missing = -1.0;
+};
+
+PBF_BINDING(ExampleMotor, PBF_FIELD(ExampleMotor, name), PBF_FIELD(ExampleMotor, p), PBF_FIELD(ExampleMotor, b), PBF_FIELD(ExampleMotor, Rs),
+    PBF_FIELD(ExampleMotor, Lq), PBF_FIELD(ExampleMotor, Ld), PBF_FIELD(ExampleMotor, PeakTorque), PBF_FIELD(ExampleMotor, Missing))
+
+TEST(PBFReader, BindsStructs)
+{
+    static_assert(PBF::pbfHashContinue(PBF::pbfHash("Plant.Motors[0]"), ".Rs") == PBF::pbfHash("Plant.Motors[0].Rs"));
+    static_assert(PBF::isBindingAllocating<ExampleMotor>());
+
+    std::vector<char> buffer = readExampleFile();
+    PBF::PBFReader pbfReader;
+    ASSERT_TRUE(pbfReader.read(buffer.data()));
+
+    for (std::uint32_t i = 0U; i < 2U; i++)
+    {
+        std::string prefix = "Plant.Motors[" + std::to_string(i) + "]";
+        ExampleMotor motor;
+        EXPECT_EQ(7U, pbfReader.bind(prefix, motor));
+        EXPECT_EQ("Motor" + std::to_string(i + 1U), motor.name);
+        EXPECT_EQ(pbfReader.getParam<std::uint32_t>(prefix + ".p").value(), motor.p);
+        EXPECT_EQ(pbfReader.getParam<double>(prefix + ".b").value(), motor.b);
+        EXPECT_EQ(pbfReader.getParam<float>(prefix + ".Rs").value(), motor.Rs);
+        EXPECT_EQ(pbfReader.getParam<double>(prefix + ".Lq").value(), motor.Lq);
+        EXPECT_EQ(pbfReader.getParam<double>(prefix + ".Ld").value(), motor.Ld);
+        EXPECT_EQ(pbfReader.getParam<double>(prefix + ".PeakTorque").value(), motor.PeakTorque);
+        EXPECT_EQ(-1.0, motor.Missing);
+    }
+
+    ExampleMotor none;
+    EXPECT_EQ(0U, pbfReader.bind("Plant.Motors[2]", none));
+}
+
+#pragma pack(push, 4)
+struct TestLayout
+{
+    bool enabled;
+    double ts;
+    std::uint32_t baudRate;
+    char title[8];
+};
+#pragma pack(pop)
+
+TEST(PBFView, ReadsFixedLayout)
+{
+    TestLayout layout = { true, 0.0001, 115200U, "Title" };
+    std::vector<std::uint8_t> layoutData(sizeof(TestLayout));
+    std::memcpy(layoutData.data(), &layout, sizeof(TestLayout));
+    const std::uint32_t fingerprint = 0x12345678U;
+
+    std::uint32_t count = 10U;
+    std::uint32_t size = PBF::PBF_FILE_HEADER_SIZE + count * (PBF::PBF_FILE_RECORD_HEADER_SIZE + 4U) +
+        PBF::ParamBinFileWriter::getSectionDirectorySize(2U) + PBF::ParamBinFileWriter::getHashIndexSectionSize(count) +
+        PBF::ParamBinFileWriter::getFixedLayoutSectionSize(sizeof(TestLayout));
+    std::vector<std::uint32_t> image(size / sizeof(std::uint32_t));
+    PBF::ParamBinFileWriter writer(image.data(), size);
+    std::uint32_t written = writer.writeHeader(size, PBF::PBF_FILE_VERSION);
+    for (std::uint32_t i = 0U; i < count; i++)
+    {
+        PBF::BinaryDataRecord record;
+        record.hash = PBF::pbfHash("Param[" + std::to_string(i) + "]");
+        record.type = static_cast<std::uint8_t>(PBF::DataTypes::UInt32);
+        record.data_size = 4U;
+        written += writer.writeRecord(record, &i);
+    }
+    written += writer.writeSections({ writer.makeHashIndexSection(), PBF::ParamBinFileWriter::makeFixedLayoutSection(fingerprint, layoutData) });
+    ASSERT_EQ(size, written);
+
+    PBF::PBFView view(image.data(), size);
+    ASSERT_TRUE(view.isOpen());
+    const TestLayout* params = static_cast<const TestLayout*>(view.getFixedLayout(fingerprint, sizeof(TestLayout)));
+    ASSERT_NE(nullptr, params);
+    EXPECT_TRUE(params->enabled);
+    EXPECT_EQ(0.0001, params->ts);
+    EXPECT_EQ(115200U, params->baudRate);
+    EXPECT_STREQ("Title", params->title);
+    EXPECT_EQ(7U, view.getParam<std::uint32_t>("Param[7]").value());
+
+    /*a header of another layout gets nothing*/
+    EXPECT_EQ(nullptr, view.getFixedLayout(fingerprint + 1U, sizeof(TestLayout)));
+    EXPECT_EQ(nullptr, view.getFixedLayout(fingerprint, sizeof(TestLayout) + 4U));
+
+    std::vector<std::uint8_t> noLayout = buildUInt32Image(10U, { PBF::SectionTypes::HashIndex });
+    EXPECT_EQ(nullptr, PBF::PBFView(noLayout.data(), noLayout.size()).getFixedLayout(fingerprint, sizeof(TestLayout)));
+
+    /*member names of the generated header*/
+    EXPECT_EQ("Plant_Motors_0_PeakTorque", TOML2PBUF::FixedLayoutGenerator::makeIdentifier("Plant.Motors[0].PeakTorque"));
+    EXPECT_EQ("p_2nd_Gain", TOML2PBUF::FixedLayoutGenerator::makeIdentifier("2nd.Gain"));
+    for (const char* keyword : { "default", "delete", "new", "int", "class", "and" })
+    {
+        EXPECT_EQ(std::string("p_") + keyword, TOML2PBUF::FixedLayoutGenerator::makeIdentifier(keyword));
+    }
+    EXPECT_EQ("Motor_default", TOML2PBUF::FixedLayoutGenerator::makeIdentifier("Motor.default"));
+    EXPECT_EQ("defaults", TOML2PBUF::FixedLayoutGenerator::makeIdentifier("defaults"));
+}
+
+TEST(PBFReader, WalksHierarchy)
+{
+    /*Plant.Ts, Plant.Motors[i].Rs / .Lq for 3 motors and Title, built like the converter walks the tables*/
+    PBF::HierarchyBuilder hierarchy;
+    std::vector<std::string> keys;
+    const std::uint32_t root = PBF::pbfHash("");
+    hierarchy.add(root, PBF::pbfHash("Plant"), false);
+    hierarchy.add(PBF::pbfHash("Plant"), PBF::pbfHash("Plant.Ts"), true);
+    keys.push_back("Plant.Ts");
+    hierarchy.add(PBF::pbfHash("Plant"), PBF::pbfHash("Plant.Motors"), false);
+    for (std::uint32_t m = 0U; m < 3U; m++)
+    {
+        std::string motor = "Plant.Motors[" + std::to_string(m) + "]";
+        hierarchy.add(PBF::pbfHash("Plant.Motors"), PBF::pbfHash(motor), false);
+        for (const char* field : { ".Rs", ".Lq" })
+        {
+            hierarchy.add(PBF::pbfHash(motor), PBF::pbfHash(motor + field), true);
+            keys.push_back(motor + field);
+        }
+    }
+    hierarchy.add(root, PBF::pbfHash("Title"), true);
+    keys.push_back("Title");
+    EXPECT_FALSE(hierarchy.add(PBF::pbfHash("Title"), PBF::pbfHash("Title.Sub"), true));
+    EXPECT_FALSE(hierarchy.add(PBF::pbfHash("NoTable"), PBF::pbfHash("NoTable.Sub"), true));
+
+    PBF::PbfSection section;
+    section.type = PBF::SectionTypes::Hierarchy;
+    section.data = hierarchy.makeSection();
+
+    std::uint32_t size = PBF::PBF_FILE_HEADER_SIZE + static_cast<std::uint32_t>(keys.size()) * (PBF::PBF_FILE_RECORD_HEADER_SIZE + 4U) +
+        PBF::ParamBinFileWriter::getSectionDirectorySize(1U) + PBF::getHierarchySectionSize(hierarchy.size());
+    std::vector<std::uint32_t> image(size / sizeof(std::uint32_t));
+    PBF::ParamBinFileWriter writer(image.data(), size);
+    std::uint32_t written = writer.writeHeader(size, PBF::PBF_FILE_VERSION);
+    for (std::uint32_t i = 0U; i < keys.size(); i++)
+    {
+        PBF::BinaryDataRecord record;
+        record.hash = PBF::pbfHash(keys[i]);
+        record.type = static_cast<std::uint8_t>(PBF::DataTypes::UInt32);
+        record.data_size = 4U;
+        written += writer.writeRecord(record, &i);
+    }
+    written += writer.writeSections({ section });
+    ASSERT_EQ(size, written);
+
+    PBF::PBFReader eager;
+    PBF::PBFReader lazy;
+    ASSERT_TRUE(eager.read(image.data()));
+    ASSERT_TRUE(lazy.readLazy(image.data(), size));
+    for (const PBF::PBFReader* pbfReader : { &eager, &lazy })
+    {
+        ASSERT_TRUE(pbfReader->hasHierarchy());
+        std::vector<std::uint32_t> visited;
+        EXPECT_EQ(2U, pbfReader->forEachUnder("Plant.Motors[1]", [pbfReader, &visited, &keys](PBF::KeyHash key, const PBF::ValueSlot& value)
+        {
+            visited.push_back(pbfReader->getValue<std::uint32_t>(value).value());
+            EXPECT_EQ(key.value, PBF::pbfHash(keys[visited.back()]));
+        }));
+        EXPECT_EQ((std::vector<std::uint32_t>{ 3U, 4U }), visited);
+
+        EXPECT_EQ(7U, pbfReader->forEachUnder("Plant", [](PBF::KeyHash, const PBF::ValueSlot&) {}));
+        EXPECT_EQ(8U, pbfReader->forEachUnder("", [](PBF::KeyHash, const PBF::ValueSlot&) {}));
+        EXPECT_EQ(0U, pbfReader->forEachUnder("Plant.Ts", [](PBF::KeyHash, const PBF::ValueSlot&) {}));
+        EXPECT_EQ(0U, pbfReader->forEachUnder("Plant.Motors[3]", [](PBF::KeyHash, const PBF::ValueSlot&) {}));
+
+        EXPECT_EQ(2U, pbfReader->childCount(""));
+        EXPECT_EQ(2U, pbfReader->childCount("Plant"));
+        EXPECT_EQ(3U, pbfReader->childCount("Plant.Motors"));
+        EXPECT_EQ(0U, pbfReader->childCount("Title"));
+    }
+
+    PBF::PBFView view(image.data(), size);
+    std::uint32_t sum(0U);
+    EXPECT_EQ(6U, view.forEachUnder("Plant.Motors", [&sum](const PBF::RecordRef& rec) { sum += PBF::decodeValue<std::uint32_t>(rec).value(); }));
+    EXPECT_EQ(1U + 2U + 3U + 4U + 5U + 6U, sum);
+    EXPECT_EQ(3U, view.childCount("Plant.Motors"));
+
+    /*images without the section have no hierarchy*/
+    std::vector<std::uint8_t> plain = buildUInt32Image(10U);
+    ASSERT_TRUE(eager.read(plain.data()));
+    EXPECT_FALSE(eager.hasHierarchy());
+    EXPECT_EQ(0U, eager.forEachUnder("", [](PBF::KeyHash, const PBF::ValueSlot&) {}));
+}
+
+TEST(PBFReader, MapsHashesToKeyNames)
+{
+    /*more names than one block, with long shared prefixes*/
+    PBF::KeyNameBuilder keyNames;
+    std::vector<std::string> keys;
+    for (std::uint32_t m = 0U; m < 12U; m++)
+    {
+        for (const char* field : { ".Rs", ".Lq", ".PeakTorque" })
+        {
+            keys.push_back("Plant.Motors[" + std::to_string(m) + "]" + field);
+        }
+    }
+    keys.push_back("Title");
+    for (const std::string& key : keys)
+    {
+        EXPECT_TRUE(keyNames.add(PBF::pbfHash(key), key));
+    }
+    EXPECT_FALSE(keyNames.add(PBF::pbfHash("Title"), "Title"));
+
+    PBF::PbfSection section;
+    section.type = PBF::SectionTypes::KeyNames;
+    section.data = keyNames.makeSection();
+    std::uint32_t sectionSize = static_cast<std::uint32_t>(section.data.size() * sizeof(std::uint32_t));
+
+    /*front coding stores far less than the names*/
+    std::size_t nameBytes(0U);
+    for (const std::string& key : keys)
+    {
+        nameBytes += key.size();
+    }
+    EXPECT_LT(sectionSize - PBF::PBF_KEY_NAMES_HEADER_SIZE - keys.size() * 8U, nameBytes / 2U);
+
+    std::uint32_t size = PBF::PBF_FILE_HEADER_SIZE + static_cast<std::uint32_t>(keys.size()) * (PBF::PBF_FILE_RECORD_HEADER_SIZE + 4U) +
+        PBF::ParamBinFileWriter::getSectionDirectorySize(1U) + sectionSize;
+    std::vector<std::uint32_t> image(size / sizeof(std::uint32_t));
+    PBF::ParamBinFileWriter writer(image.data(), size);
+    std::uint32_t written = writer.writeHeader(size, PBF::PBF_FILE_VERSION);
+    for (std::uint32_t i = 0U; i < keys.size(); i++)
+    {
+        PBF::BinaryDataRecord record;
+        record.hash = PBF::pbfHash(keys[i]);
+        record.type = static_cast<std::uint8_t>(PBF::DataTypes::UInt32);
+        record.data_size = 4U;
+        written += writer.writeRecord(record, &i);
+    }
+    written += writer.writeSections({ section });
+    ASSERT_EQ(size, written);
+
+    char buffer[64];
+    PBF::PBFReader eager;
+    ASSERT_TRUE(eager.read(image.data()));
+    EXPECT_FALSE(eager.getKeyName("Title", buffer));
+    ASSERT_TRUE(eager.readKeyNames(image.data()));
+
+    PBF::PBFReader lazy;
+    ASSERT_TRUE(lazy.readLazy(image.data(), size));
+    PBF::PBFView view(image.data(), size);
+    for (const std::string& key : keys)
+    {
+        EXPECT_EQ(key, eager.getKeyName(key, buffer).value());
+        EXPECT_EQ(key, lazy.getKeyName(key, buffer).value());
+        EXPECT_EQ(key, view.getKeyName(key, buffer).value());
+    }
+    EXPECT_FALSE(view.getKeyName("Plant.Motors[12].Rs", buffer));
+    EXPECT_FALSE(view.getKeyName("Plant.Motors[10].PeakTorque", std::span<char>(buffer, 10U)));
+
+    /*images without the section have no names*/
+    std::vector<std::uint8_t> plain = buildUInt32Image(10U);
+    EXPECT_FALSE(eager.readKeyNames(plain.data()));
+}
+
+TEST(PBFReader, UsesSeededHashes)
+{
+    /*the two keys have the same pbfHash, a seeded image keeps them apart*/
+    const std::string first = "Plant.Motors[79499].Rs";
+    const std::string second = "Plant.Motors[502566].Rs";
+    ASSERT_EQ(PBF::pbfHash(first), PBF::pbfHash(second));
+    EXPECT_EQ(PBF::pbfHash(first), PBF::pbfHashSeeded(0U, first));
+    const std::uint16_t seed = 1U;
+    ASSERT_NE(PBF::pbfHashSeeded(seed, first), PBF::pbfHashSeeded(seed, second));
+
+    PBF::PbfSection section;
+    section.type = PBF::SectionTypes::HashIndex;
+    std::uint32_t size = PBF::PBF_FILE_HEADER_SIZE + 2U * (PBF::PBF_FILE_RECORD_HEADER_SIZE + 4U) +
+        PBF::ParamBinFileWriter::getSectionDirectorySize(1U) + PBF::ParamBinFileWriter::getHashIndexSectionSize(2U);
+    std::vector<std::uint32_t> image(size / sizeof(std::uint32_t));
+    PBF::ParamBinFileWriter writer(image.data(), size);
+    std::uint32_t written = writer.writeHeader(size, PBF::PBF_FILE_VERSION, seed);
+    std::uint32_t values[2] = { 1U, 2U };
+    for (std::uint32_t i = 0U; i < 2U; i++)
+    {
+        PBF::BinaryDataRecord record;
+        record.hash = PBF::pbfHashSeeded(seed, (i == 0U) ? first : second);
+        record.type = static_cast<std::uint8_t>(PBF::DataTypes::UInt32);
+        record.data_size = 4U;
+        written += writer.writeRecord(record, &values[i]);
+    }
+    written += writer.writeSections({ writer.makeHashIndexSection() });
+    ASSERT_EQ(size, written);
+
+    PBF::PBFReader eager;
+    PBF::PBFReader lazy;
+    ASSERT_TRUE(eager.read(image.data()));
+    ASSERT_TRUE(lazy.readLazy(image.data(), size));
+    PBF::PBFView view(image.data(), size);
+    PBF::MemoryStorage storage(image.data(), size);
+    PBF::PBFStorageView<> storageView(storage);
+    ASSERT_TRUE(storageView.open());
+    EXPECT_EQ(PBF::PBF_FILE_VERSION_SEEDED, view.version());
+    EXPECT_EQ(seed, view.seed());
+    EXPECT_EQ(seed, eager.seed());
+
+    /*seeded keys for the image, at compile time or from the reader*/
+    constexpr PBF::KeyHash secondKey = PBF::pbfKey("Plant.Motors[502566].Rs", 1U);
+    for (const PBF::PBFReader* pbfReader : { &eager, &lazy })
+    {
+        EXPECT_EQ(1U, pbfReader->getParam<std::uint32_t>(pbfReader->key(first)).value());
+        EXPECT_EQ(2U, pbfReader->getParam<std::uint32_t>(pbfReader->key(second)).value());
+        EXPECT_EQ(2U, pbfReader->getParam<std::uint32_t>(secondKey).value());
+        EXPECT_EQ(1U, pbfReader->getParam<std::uint32_t>(PBF::KeyHash(PBF::pbfHashSeeded(seed, first))).value());
+        /*a KeyHash from a string is not seeded*/
+        EXPECT_EQ(PBF::DataTypes::None, pbfReader->getType(first));
+
+        const PBF::KeyHash keys[] = { pbfReader->key(first), secondKey };
+        PBF::ValueSlot slots[2];
+        EXPECT_EQ(2U, pbfReader->getParams(keys, slots));
+        EXPECT_EQ(2U, pbfReader->getValue<std::uint32_t>(slots[1]).value());
+    }
+    EXPECT_EQ(1U, view.getParam<std::uint32_t>(view.key(first)).value());
+    EXPECT_EQ(2U, view.getParam<std::uint32_t>(secondKey).value());
+    EXPECT_EQ(2U, storageView.getParam<std::uint32_t>(storageView.key(second)).value());
+}
+
+TEST(PBFReader, VerifiesChecksum)
+{
+    /*check value of CRC32C, the same with and without the CRC instructions*/
+    EXPECT_EQ(0xE3069283U, PBF::crc32c("123456789", 9U));
+    EXPECT_EQ(0xE3069283U, PBF::crc32cSoftware("123456789", 9U));
+    std::vector<std::uint8_t> data(100000U);
+    for (std::size_t i = 0U; i < data.size(); i++)
+    {
+        data[i] = static_cast<std::uint8_t>((i * 7919U) >> 3U);
+    }
+    std::uint32_t whole = PBF::crc32c(data.data(), data.size());
+    EXPECT_EQ(PBF::crc32cSoftware(data.data(), data.size()), whole);
+    EXPECT_EQ(whole, PBF::crc32c(data.data() + 333U, data.size() - 333U, PBF::crc32c(data.data(), 333U)));
+
+    const std::uint32_t count = 1000U;
+    std::uint32_t size = PBF::PBF_FILE_HEADER_SIZE + count * (PBF::PBF_FILE_RECORD_HEADER_SIZE + 4U) +
+        PBF::ParamBinFileWriter::getSectionDirectorySize(2U) + PBF::ParamBinFileWriter::getHashIndexSectionSize(count) + PBF::PBF_CHECKSUM_SECTION_SIZE;
+    std::vector<std::uint32_t> image(size / sizeof(std::uint32_t));
+    PBF::ParamBinFileWriter writer(image.data(), size);
+    std::uint32_t written = writer.writeHeader(size, PBF::PBF_FILE_VERSION);
+    for (std::uint32_t i = 0U; i < count; i++)
+    {
+        PBF::BinaryDataRecord record;
+        record.hash = PBF::pbfHash("Param[" + std::to_string(i) + "]");
+        record.type = static_cast<std::uint8_t>(PBF::DataTypes::UInt32);
+        record.data_size = 4U;
+        written += writer.writeRecord(record, &i);
+    }
+    written += writer.writeSections({ writer.makeHashIndexSection(), PBF::ParamBinFileWriter::makeChecksumSection() });
+    ASSERT_EQ(size, written);
+
+    PBF::PBFView view(image.data(), size);
+    ASSERT_TRUE(view.hasChecksum());
+    EXPECT_TRUE(view.verifyChecksum());
+    PBF::PBFReader pbfReader;
+    EXPECT_TRUE(pbfReader.read(image.data()));
+    PBF::MemoryStorage storage(image.data(), size);
+    PBF::PBFStorageView<> storageView(storage);
+    ASSERT_TRUE(storageView.open());
+    EXPECT_TRUE(storageView.verifyChecksum());
+
+    /*a flipped bit in a record, the header or the index*/
+    for (std::uint32_t word : { 20U, 1U, size / 4U - 10U })
+    {
+        std::vector<std::uint32_t> corrupted = image;
+        corrupted[word] ^= 0x100U;
+        PBF::PBFView corruptedView(corrupted.data(), size);
+        EXPECT_FALSE(corruptedView.isOpen() && corruptedView.verifyChecksum());
+        EXPECT_FALSE(pbfReader.read(corrupted.data()));
+        PBF::MemoryStorage corruptedStorage(corrupted.data(), size);
+        PBF::PBFStorageView<> corruptedStorageView(corruptedStorage);
+        EXPECT_FALSE(corruptedStorageView.open() && corruptedStorageView.verifyChecksum());
+    }
+
+    /*a size in the header that is larger than the buffer*/
+    std::vector<std::uint32_t> truncated(image.begin(), image.begin() + 100U);
+    EXPECT_FALSE(pbfReader.read(truncated.data(), truncated.size() * sizeof(std::uint32_t)));
+
+    /*images without the section are read as before*/
+    std::vector<std::uint8_t> plain = buildUInt32Image(10U);
+    EXPECT_FALSE(PBF::PBFView(plain.data(), plain.size()).verifyChecksum());
+    EXPECT_TRUE(pbfReader.read(plain.data()));
+}
+
+TEST(PBFReader, ReadsOtherByteOrder)
+{
+    /*the vector swap matches the scalar one for every length and alignment*/
+    std::uint8_t column[80];
+    for (std::uint32_t elementSize : { 2U, 4U, 8U })
+    {
+        for (std::uint32_t i = 0U; i < sizeof(column); i++)
+        {
+            column[i] = static_cast<std::uint8_t>(i);
+        }
+        std::uint32_t count = (sizeof(column) - 1U) / elementSize;
+        PBF::swapColumn(column + 1U, count, elementSize);
+        for (std::uint32_t i = 0U; i < count * elementSize; i++)
+        {
+            EXPECT_EQ((i / elementSize) * elementSize + (elementSize - 1U - (i % elementSize)) + 1U, column[1U + i]);
+        }
+    }
+
+    const float coefficients[] = { 0.5f, -1.25f, 2.0f, 0.125f, 3.5f };
+    const std::uint64_t masks[] = { 0xFFFF0000FFFF0000ULL, 0x0123456789ABCDEFULL };
+    const std::string title = "Motor controller";
+
+    PBF::KeyNameBuilder keyNames;
+    for (const char* key : { "Count", "Ts", "Title", "Filter.Coefficients", "Masks" })
+    {
+        keyNames.add(PBF::pbfHash(key), key);
+    }
+    PBF::PbfSection names;
+    names.type = PBF::SectionTypes::KeyNames;
+    names.data = keyNames.makeSection();
+
+    std::uint32_t size = PBF::PBF_FILE_HEADER_SIZE + 5U * PBF::PBF_FILE_RECORD_HEADER_SIZE + 4U + 8U + 20U +
+        PBF::getArrayRecordDataSize(PBF::DataTypes::Float32, 5U) + PBF::getArrayRecordDataSize(PBF::DataTypes::UInt64, 2U) +
+        PBF::ParamBinFileWriter::getSectionDirectorySize(4U) + PBF::ParamBinFileWriter::getHashIndexSectionSize(5U) +
+        PBF::getPerfectHashSectionSize(5U) + static_cast<std::uint32_t>(names.data.size() * sizeof(std::uint32_t)) + PBF::PBF_CHECKSUM_SECTION_SIZE;
+    std::vector<std::uint64_t> image((size + 7U) / 8U);
+    PBF::ParamBinFileWriter writer(image.data(), size);
+    std::uint32_t written = writer.writeHeader(size, PBF::PBF_FILE_VERSION);
+
+    std::uint32_t count = 1000U;
+    double ts = 0.000125;
+    PBF::BinaryDataRecord record;
+    record.hash = PBF::pbfHash("Count");
+    record.type = static_cast<std::uint8_t>(PBF::DataTypes::UInt32);
+    record.data_size = 4U;
+    written += writer.writeRecord(record, &count);
+    record.hash = PBF::pbfHash("Ts");
+    record.type = static_cast<std::uint8_t>(PBF::DataTypes::Float64);
+    record.data_size = 8U;
+    written += writer.writeRecord(record, &ts);
+    record.hash = PBF::pbfHash("Title");
+    record.type = static_cast<std::uint8_t>(PBF::DataTypes::String);
+    record.strData = title;
+    record.data_size = static_cast<std::uint32_t>(title.size());
+    written += writer.writeRecord(record, nullptr);
+    written += writer.writeArrayRecord(PBF::pbfHash("Filter.Coefficients"), PBF::DataTypes::Float32, 5U, coefficients);
+    written += writer.writeArrayRecord(PBF::pbfHash("Masks"), PBF::DataTypes::UInt64, 2U, masks);
+    written += writer.writeSections({ writer.makeHashIndexSection(), writer.makePerfectHashSection(), names, PBF::ParamBinFileWriter::makeChecksumSection() });
+    ASSERT_EQ(size, written);
+
+    const std::endian other = (std::endian::native == std::endian::little) ? std::endian::big : std::endian::little;
+    EXPECT_EQ(std::endian::native, PBF::getImageByteOrder(image.data(), size));
+    std::vector<std::uint64_t> swapped = image;
+    ASSERT_TRUE(PBF::swapByteOrder(swapped.data(), size));
+    EXPECT_EQ(other, PBF::getImageByteOrder(swapped.data(), size));
+
+    /*the views use images as they are and do not open the other byte order*/
+    EXPECT_FALSE(PBF::PBFView(swapped.data(), size).isOpen());
+    PBF::MemoryStorage storage(swapped.data(), size);
+    PBF::PBFStorageView<> storageView(storage);
+    EXPECT_FALSE(storageView.open());
+
+    /*read() swaps once, all lookups then see native values*/
+    char buffer[64];
+    PBF::PBFReader pbfReader;
+    ASSERT_TRUE(pbfReader.read(swapped.data()));
+    EXPECT_EQ(count, pbfReader.getParam<std::uint32_t>("Count").value());
+    EXPECT_EQ(ts, pbfReader.getParam<double>("Ts").value());
+    EXPECT_EQ(title, pbfReader.getParam<std::string_view>("Title").value());
+    std::optional<std::span<const float>> floats = pbfReader.getArray<float>("Filter.Coefficients");
+    ASSERT_TRUE(floats);
+    EXPECT_TRUE(std::equal(floats->begin(), floats->end(), std::begin(coefficients), std::end(coefficients)));
+    std::optional<std::span<const std::uint64_t>> words = pbfReader.getArray<std::uint64_t>("Masks");
+    ASSERT_TRUE(words);
+    EXPECT_TRUE(std::equal(words->begin(), words->end(), std::begin(masks), std::end(masks)));
+    ASSERT_TRUE(pbfReader.readKeyNames(swapped.data()));
+    EXPECT_EQ("Filter.Coefficients", pbfReader.getKeyName("Filter.Coefficients", buffer).value());
+
+    /*the checksum is checked before the swap*/
+    std::vector<std::uint64_t> corrupted = swapped;
+    corrupted[4] ^= 0x100U;
+    EXPECT_FALSE(pbfReader.read(corrupted.data()));
+
+    /*swapping back restores the image, sections included*/
+    ASSERT_TRUE(PBF::swapByteOrder(swapped.data(), size));
+    EXPECT_EQ(image, swapped);
+    PBF::PBFView view(swapped.data(), size);
+    ASSERT_TRUE(view.isOpen());
+    EXPECT_TRUE(view.verifyChecksum());
+    EXPECT_EQ(count, view.getParam<std::uint32_t>("Count").value());
+}
+
+TEST(CompressedStorage, DecodesOnlyNeededBlocks)
+{
+    /*round trips of runs, overlapping matches, random bytes and tiny inputs*/
+    std::vector<std::uint8_t> data(200000U);
+    std::uint32_t x(1U);
+    for (std::size_t i = 0U; i < data.size(); i++)
+    {
+        x = x * 1664525U + 1013904223U;
+        data[i] = (i < 50000U) ? static_cast<std::uint8_t>(i % 3U) : (i < 100000U) ? static_cast<std::uint8_t>(x >> 24U) : static_cast<std::uint8_t>((i / 64U) & 0x0FU);
+    }
+    std::vector<std::uint8_t> compressed(PBF::lz4CompressBound(data.size()));
+    std::vector<std::uint8_t> decompressed(data.size());
+    for (std::size_t length : { std::size_t(0U), std::size_t(1U), std::size_t(13U), std::size_t(70000U), data.size() })
+    {
+        std::size_t size = PBF::lz4Compress(data.data(), length, compressed.data(), compressed.size());
+        ASSERT_GT(size, 0U);
+        ASSERT_TRUE(PBF::lz4Decompress(compressed.data(), size, decompressed.data(), length));
+        EXPECT_TRUE(std::equal(data.begin(), data.begin() + length, decompressed.begin()));
+        EXPECT_FALSE(PBF::lz4Decompress(compressed.data(), size, decompressed.data(), length + 1U));
+    }
+    std::size_t size = PBF::lz4Compress(data.data(), data.size(), compressed.data(), compressed.size());
+    EXPECT_LT(size, data.size() / 2U);
+    EXPECT_EQ(0U, PBF::lz4Compress(data.data(), data.size(), compressed.data(), size - 1U));
+
+    /*corrupted data is rejected without leaving the buffers*/
+    for (std::size_t i = 0U; i < 2000U; i++)
+    {
+        std::vector<std::uint8_t> corrupted(compressed.begin(), compressed.begin() + size);
+        corrupted[(i * 7919U) % size] ^= static_cast<std::uint8_t>(1U << (i % 8U));
+        PBF::lz4Decompress(corrupted.data(), corrupted.size(), decompressed.data(), data.size());
+    }
+
+    const std::uint32_t count = 20000U;
+    std::vector<std::uint8_t> image = buildUInt32Image(count, { PBF::SectionTypes::PerfectHash });
+    std::vector<std::uint8_t> container = PBF::compressImage(image.data(), static_cast<std::uint32_t>(image.size()), 4096U);
+    EXPECT_LT(container.size(), image.size());
+
+    PBF::MemoryStorage storage(container.data(), static_cast<std::uint32_t>(container.size()));
+    PBF::CompressedStorage<4096U> compressedStorage(storage);
+    ASSERT_TRUE(compressedStorage.open());
+    EXPECT_EQ(image.size(), compressedStorage.size());
+    EXPECT_GT(compressedStorage.blockCount(), 10U);
+
+    /*streaming into RAM for the view*/
+    std::vector<std::uint8_t> loaded(compressedStorage.size());
+    ASSERT_TRUE(compressedStorage.decompress(loaded.data(), loaded.size()));
+    EXPECT_EQ(image, loaded);
+
+    /*a lookup through the storage view decodes only the blocks of the pilot, the slot and the record*/
+    PBF::PBFStorageView<256U, 4U> view(compressedStorage);
+    ASSERT_TRUE(view.open());
+    std::uint64_t decoded = compressedStorage.blocksDecoded();
+    EXPECT_EQ(4711U, view.getParam<std::uint32_t>("Param[4711]").value());
+    EXPECT_LE(compressedStorage.blocksDecoded() - decoded, 4U);
+    for (std::uint32_t i = 0U; i < count; i += 997U)
+    {
+        EXPECT_EQ(i, view.getParam<std::uint32_t>("Param[" + std::to_string(i) + "]").value());
+    }
+
+    /*blocks too large for the buffers and other containers are not opened*/
+    PBF::CompressedStorage<1024U> small(storage);
+    EXPECT_FALSE(small.open());
+    PBF::MemoryStorage plain(image.data(), static_cast<std::uint32_t>(image.size()));
+    PBF::CompressedStorage<4096U> notCompressed(plain);
+    EXPECT_FALSE(notCompressed.open());
+}
+
+TEST(PBFReader, ReadsPooledStrings)
+{
+    /*the same few strings for many motors, one inline string*/
+    const char* units[] = { "Newton metre", "Radian per second", "Ampere" };
+    const std::uint32_t count = 300U;
+    std::uint32_t records(0U);
+    std::uint32_t inlineSize(PBF::PBF_FILE_HEADER_SIZE);
+    std::set<std::string> distinct;
+    for (std::uint32_t i = 0U; i < count; i++)
+    {
+        std::string name = "Motor controller " + std::to_string(i % 4U);
+        for (const std::string& value : { name, std::string(units[i % 3U]) })
+        {
+            distinct.insert(value);
+            inlineSize += PBF::PBF_FILE_RECORD_HEADER_SIZE + ((static_cast<std::uint32_t>(value.size()) + 4U) / 4U) * 4U;
+            records++;
+        }
+    }
+    std::uint32_t poolBytes(0U);
+    for (const std::string& value : distinct)
+    {
+        poolBytes += static_cast<std::uint32_t>(value.size()) + 1U;
+    }
+    const std::string title = "Inline title";
+    std::uint32_t size = PBF::PBF_FILE_HEADER_SIZE + records * (PBF::PBF_FILE_RECORD_HEADER_SIZE + 4U) +
+        PBF::PBF_FILE_RECORD_HEADER_SIZE + 16U + PBF::ParamBinFileWriter::getSectionDirectorySize(3U) +
+        PBF::ParamBinFileWriter::getHashIndexSectionSize(records + 1U) + PBF::ParamBinFileWriter::getStringPoolSectionSize(poolBytes) + PBF::PBF_CHECKSUM_SECTION_SIZE;
+    inlineSize += PBF::PBF_FILE_RECORD_HEADER_SIZE + 16U + PBF::ParamBinFileWriter::getSectionDirectorySize(2U) +
+        PBF::ParamBinFileWriter::getHashIndexSectionSize(records + 1U) + PBF::PBF_CHECKSUM_SECTION_SIZE;
+    EXPECT_LT(size, inlineSize * 3U / 4U);
+
+    std::vector<std::uint32_t> image(size / sizeof(std::uint32_t));
+    PBF::ParamBinFileWriter writer(image.data(), size);
+    std::uint32_t written = writer.writeHeader(size, PBF::PBF_FILE_VERSION);
+    for (std::uint32_t i = 0U; i < count; i++)
+    {
+        std::string key = "Motors[" + std::to_string(i) + "]";
+        written += writer.writePooledStringRecord(PBF::pbfHash(key + ".Name"), "Motor controller " + std::to_string(i % 4U));
+        written += writer.writePooledStringRecord(PBF::pbfHash(key + ".Unit"), units[i % 3U]);
+    }
+    PBF::BinaryDataRecord record;
+    record.hash = PBF::pbfHash("Title");
+    record.type = static_cast<std::uint8_t>(PBF::DataTypes::String);
+    record.strData = title;
+    record.data_size = static_cast<std::uint16_t>(title.size());
+    written += writer.writeRecord(record, nullptr);
+    written += writer.writeSections({ writer.makeHashIndexSection(), writer.makeStringPoolSection(), PBF::ParamBinFileWriter::makeChecksumSection() });
+    ASSERT_EQ(size, written);
+
+    PBF::PBFReader eager;
+    PBF::PBFReader lazy;
+    ASSERT_TRUE(eager.read(image.data()));
+    ASSERT_TRUE(lazy.readLazy(image.data(), size));
+    PBF::PBFView view(image.data(), size);
+    ASSERT_TRUE(view.isOpen());
+    PBF::MemoryStorage storage(image.data(), size);
+    PBF::PBFStorageView<> storageView(storage);
+    ASSERT_TRUE(storageView.open());
+    char buffer[64];
+    for (std::uint32_t i = 0U; i < count; i += 7U)
+    {
+        std::string key = "Motors[" + std::to_string(i) + "]";
+        std::string name = "Motor controller " + std::to_string(i % 4U);
+        EXPECT_EQ(PBF::DataTypes::String, eager.getType(key + ".Name"));
+        EXPECT_EQ(name, eager.getParam<std::string_view>(key + ".Name").value());
+        EXPECT_EQ(units[i % 3U], lazy.getParam<std::string_view>(key + ".Unit").value());
+        EXPECT_EQ(name, view.getParam<std::string_view>(key + ".Name").value());
+        EXPECT_EQ(std::strlen(units[i % 3U]), storageView.getString(key + ".Unit", buffer, sizeof(buffer)).value());
+        EXPECT_STREQ(units[i % 3U], buffer);
+    }
+    EXPECT_EQ(title, eager.getParam<std::string>("Title").value());
+    EXPECT_EQ(title, view.getParam<std::string_view>("Title").value());
+
+    /*equal strings are read from the same place*/
+    EXPECT_EQ(eager.getParam<std::string_view>("Motors[0].Name")->data(), eager.getParam<std::string_view>("Motors[4].Name")->data());
+    EXPECT_EQ(view.getParam<std::string_view>("Motors[1].Unit")->data(), view.getParam<std::string_view>("Motors[4].Unit")->data());
+
+    /*the pool offset is a 32-bit value of the image*/
+    std::vector<std::uint32_t> swapped = image;
+    ASSERT_TRUE(PBF::swapByteOrder(swapped.data(), size));
+    PBF::PBFReader swappedReader;
+    ASSERT_TRUE(swappedReader.read(swapped.data()));
+    EXPECT_EQ("Motor controller 3", swappedReader.getParam<std::string_view>("Motors[7].Name").value());
+
+    /*offsets outside of the pool make the image malformed*/
+    std::vector<std::uint32_t> corrupted = image;
+    corrupted[5] = 0x10000U;
+    EXPECT_FALSE(PBF::PBFView(corrupted.data(), size).forEachRecord([](const PBF::RecordRef&) {}));
+}
+
+/*writes the string parameters sorted by hash, as the converter does, with all rebuilt and copied section kinds*/
+std::vector<std::uint8_t> buildStringImage(const std::map<std::string, std::string>& values)
+{
+    std::vector<std::pair<std::uint32_t, std::string>> records;
+    std::uint32_t size = PBF::PBF_FILE_HEADER_SIZE;
+    for (const auto& [key, value] : values)
+    {
+        records.emplace_back(PBF::pbfHash(key), value);
+        size += PBF::PBF_FILE_RECORD_HEADER_SIZE + ((static_cast<std::uint32_t>(value.size()) + 4U) / 4U) * 4U;
+    }
+    std::sort(records.begin(), records.end());
+    const std::uint32_t count = static_cast<std::uint32_t>(records.size());
+    const std::vector<std::uint8_t> layout = { 1U, 2U, 3U, 4U, 5U, 6U };
+    size += PBF::ParamBinFileWriter::getSectionDirectorySize(4U) + PBF::ParamBinFileWriter::getHashIndexSectionSize(count) + PBF::getPerfectHashSectionSize(count) +
+        PBF::ParamBinFileWriter::getFixedLayoutSectionSize(static_cast<std::uint32_t>(layout.size())) + PBF::PBF_CHECKSUM_SECTION_SIZE;
+
+    std::vector<std::uint8_t> image(size);
+    PBF::ParamBinFileWriter writer(image.data(), image.size());
+    std::uint32_t written = writer.writeHeader(size, PBF::PBF_FILE_VERSION);
+    for (const auto& [hash, value] : records)
+    {
+        PBF::BinaryDataRecord record;
+        record.hash = hash;
+        record.type = static_cast<std::uint8_t>(PBF::DataTypes::String);
+        record.strData = value;
+        record.data_size = static_cast<std::uint16_t>(value.size());
+        written += writer.writeRecord(record, nullptr);
+    }
+    written += writer.writeSections({ writer.makeHashIndexSection(), writer.makePerfectHashSection(),
+        PBF::ParamBinFileWriter::makeFixedLayoutSection(0x1234U, layout), PBF::ParamBinFileWriter::makeChecksumSection() });
+    EXPECT_EQ(size, written);
+    return image;
+}
+
+TEST(PBFDelta, PatchesImagesInPlace)
+{
+    std::map<std::string, std::string> values;
+    for (std::uint32_t i = 0U; i < 2000U; i++)
+    {
+        values["Param[" + std::to_string(i) + "]"] = "Value " + std::to_string(i);
+    }
+    const std::vector<std::uint8_t> source = buildStringImage(values);
+    const std::uint32_t sourceSize = static_cast<std::uint32_t>(source.size());
+
+    /*a value of the same size: only the record and no section is sent*/
+    std::map<std::string, std::string> tuned = values;
+    tuned["Param[42]"] = "Value 24";
+    std::vector<std::uint8_t> target = buildStringImage(tuned);
+    PBF::DeltaSummary summary;
+    std::vector<std::uint8_t> delta = PBF::createDelta(source.data(), sourceSize, target.data(), static_cast<std::uint32_t>(target.size()), &summary);
+    ASSERT_FALSE(delta.empty());
+    EXPECT_EQ(1U, summary.changed);
+    EXPECT_EQ(4U, summary.sectionsFromSource);
+    EXPECT_LT(delta.size(), 200U);
+
+    /*longer, added and removed values move the records behind them*/
+    std::map<std::string, std::string> changed = values;
+    for (std::uint32_t i = 0U; i < 2000U; i += 3U)
+    {
+        changed["Param[" + std::to_string(i) + "]"] = "A longer value " + std::to_string(i);
+    }
+    for (std::uint32_t i = 0U; i < 2000U; i += 7U)
+    {
+        changed.erase("Param[" + std::to_string(i + 1U) + "]");
+        changed["Added[" + std::to_string(i) + "]"] = "New";
+    }
+    changed["Param[5]"] = "";
+
+    for (const auto& [from, to] : { std::make_pair(values, changed), std::make_pair(changed, values) })
+    {
+        std::vector<std::uint8_t> a = buildStringImage(from);
+        std::vector<std::uint8_t> b = buildStringImage(to);
+        const std::uint32_t sizeA = static_cast<std::uint32_t>(a.size());
+        delta = PBF::createDelta(a.data(), sizeA, b.data(), static_cast<std::uint32_t>(b.size()), &summary);
+        ASSERT_FALSE(delta.empty());
+        EXPECT_LT(delta.size(), b.size());
+        const std::uint32_t deltaSize = static_cast<std::uint32_t>(delta.size());
+        std::optional<PBF::DeltaInfo> info = PBF::getDeltaInfo(delta.data(), deltaSize);
+        ASSERT_TRUE(info);
+        EXPECT_EQ(b.size(), info->targetSize);
+        EXPECT_GE(info->inPlaceCapacity, std::max(a.size(), b.size()));
+
+        std::vector<std::uint8_t> result(info->targetSize);
+        ASSERT_TRUE(PBF::applyDelta(a.data(), sizeA, delta.data(), deltaSize, result.data(), info->targetSize));
+        EXPECT_EQ(b, result);
+
+        std::vector<std::uint8_t> buffer(info->inPlaceCapacity);
+        std::copy(a.begin(), a.end(), buffer.begin());
+        EXPECT_FALSE(PBF::applyDeltaInPlace(buffer.data(), info->inPlaceCapacity - 4U, delta.data(), deltaSize));
+        EXPECT_TRUE(std::equal(a.begin(), a.end(), buffer.begin()));
+        ASSERT_TRUE(PBF::applyDeltaInPlace(buffer.data(), info->inPlaceCapacity, delta.data(), deltaSize));
+        EXPECT_TRUE(std::equal(b.begin(), b.end(), buffer.begin()));
+        PBF::PBFView view(buffer.data(), info->targetSize);
+        ASSERT_TRUE(view.isOpen());
+        EXPECT_TRUE(view.verifyChecksum());
+
+        /*a delta of another source or a corrupted delta leaves the image as it is*/
+        std::copy(a.begin(), a.end(), buffer.begin());
+        EXPECT_FALSE(PBF::applyDeltaInPlace(buffer.data(), info->inPlaceCapacity, delta.data(), deltaSize - 4U));
+        std::vector<std::uint8_t> corrupted = delta;
+        corrupted[PBF::PBF_DELTA_HEADER_SIZE + 5U] ^= 1U;
+        EXPECT_FALSE(PBF::applyDeltaInPlace(buffer.data(), info->inPlaceCapacity, corrupted.data(), deltaSize));
+        EXPECT_FALSE(PBF::applyDelta(b.data(), static_cast<std::uint32_t>(b.size()), delta.data(), deltaSize, result.data(), info->targetSize));
+        EXPECT_TRUE(std::equal(a.begin(), a.end(), buffer.begin()));
+    }
+
+    /*images of the other byte order give a delta of that byte order*/
+    std::vector<std::uint8_t> swappedSource = source;
+    std::vector<std::uint8_t> swappedTarget = buildStringImage(changed);
+    ASSERT_TRUE(PBF::swapByteOrder(swappedSource.data(), sourceSize));
+    ASSERT_TRUE(PBF::swapByteOrder(swappedTarget.data(), swappedTarget.size()));
+    delta = PBF::createDelta(swappedSource.data(), sourceSize, swappedTarget.data(), static_cast<std::uint32_t>(swappedTarget.size()));
+    ASSERT_FALSE(delta.empty());
+    std::vector<std::uint8_t> result(swappedTarget.size());
+    ASSERT_TRUE(PBF::applyDelta(swappedSource.data(), sourceSize, delta.data(), static_cast<std::uint32_t>(delta.size()), result.data(), static_cast<std::uint32_t>(result.size())));
+    EXPECT_EQ(swappedTarget, result);
+    EXPECT_TRUE(PBF::createDelta(source.data(), sourceSize, swappedTarget.data(), static_cast<std::uint32_t>(swappedTarget.size())).empty());
+}
+
+/*writes UInt32 parameters and pooled strings with the given hash seed*/
+std::vector<std::uint32_t> buildLayerImage(std::uint16_t seed, const std::vector<std::pair<std::string, std::uint32_t>>& params,
+    const std::vector<std::pair<std::string, std::string>>& strings = {})
+{
+    std::uint32_t size = PBF::PBF_FILE_HEADER_SIZE + static_cast<std::uint32_t>(params.size() + strings.size()) * (PBF::PBF_FILE_RECORD_HEADER_SIZE + 4U);
+    std::set<std::string> distinct;
+    std::uint32_t poolBytes(0U);
+    for (const auto& [key, value] : strings)
+    {
+        poolBytes += distinct.insert(value).second ? static_cast<std::uint32_t>(value.size()) + 1U : 0U;
+    }
+    if (!strings.empty())
+    {
+        size += PBF::ParamBinFileWriter::getSectionDirectorySize(1U) + PBF::ParamBinFileWriter::getStringPoolSectionSize(poolBytes);
+    }
+    std::vector<std::uint32_t> image(size / sizeof(std::uint32_t));
+    PBF::ParamBinFileWriter writer(image.data(), size);
+    std::uint32_t written = writer.writeHeader(size, (seed != 0U) ? PBF::PBF_FILE_VERSION_SEEDED : PBF::PBF_FILE_VERSION, seed);
+    for (const auto& [key, value] : params)
+    {
+        PBF::BinaryDataRecord record;
+        record.hash = PBF::pbfHashSeeded(seed, key);
+        record.type = static_cast<std::uint8_t>(PBF::DataTypes::UInt32);
+        record.data_size = 4U;
+        written += writer.writeRecord(record, const_cast<std::uint32_t*>(&value));
+    }
+    for (const auto& [key, value] : strings)
+    {
+        written += writer.writePooledStringRecord(PBF::pbfHashSeeded(seed, key), value);
+    }
+    if (!strings.empty())
+    {
+        written += writer.writeSections({ writer.makeStringPoolSection() });
+    }
+    EXPECT_EQ(size, written);
+    return image;
+}
+
+TEST(LayeredReader, ShadowsEarlierLayers)
+{
+    std::vector<std::pair<std::string, std::uint32_t>> params;
+    for (std::uint32_t i = 0U; i < 1000U; i++)
+    {
+        params.emplace_back("Param[" + std::to_string(i) + "]", i);
+    }
+    std::vector<std::uint32_t> base = buildLayerImage(0U, params, { { "Machine.Name", "Base" }, { "Machine.Site", "Plant 1" } });
+    std::vector<std::uint32_t> machine = buildLayerImage(0U, { { "Param[5]", 500U }, { "Machine.Axes", 6U } }, { { "Machine.Name", "Robot 7" } });
+    std::vector<std::uint32_t> test = buildLayerImage(0U, { { "Param[5]", 501U } });
+    auto bytes = [](const std::vector<std::uint32_t>& image) { return std::as_bytes(std::span<const std::uint32_t>(image)); };
+
+    PBF::LayeredReader reader;
+    const std::span<const std::byte> layers[] = { bytes(base), bytes(machine) };
+    ASSERT_TRUE(reader.read(layers));
+    EXPECT_EQ(1003U, reader.count());
+    EXPECT_EQ(500U, reader.getParam<std::uint32_t>("Param[5]").value());
+    EXPECT_EQ(6U, reader.getParam<std::uint32_t>("Param[6]").value());
+    EXPECT_EQ(6U, reader.getParam<std::uint32_t>("Machine.Axes").value());
+    EXPECT_EQ("Robot 7", reader.getParam<std::string_view>("Machine.Name").value());
+    EXPECT_EQ("Plant 1", reader.getParam<std::string_view>("Machine.Site").value());
+
+    /*batch lookups and handles see the combined parameters*/
+    const PBF::KeyHash keys[] = { "Param[4]", "Param[5]", "Missing" };
+    PBF::ValueSlot values[3];
+    EXPECT_EQ(2U, reader.getParams(keys, values));
+    EXPECT_EQ(500U, reader.getValue<std::uint32_t>(values[1]).value());
+    EXPECT_EQ(500U, reader.resolve<std::uint32_t>("Param[5]").get());
+
+    /*the last layer wins, the same image twice only overrides itself*/
+    const std::span<const std::byte> three[] = { bytes(base), bytes(machine), bytes(test) };
+    ASSERT_TRUE(reader.read(three));
+    EXPECT_EQ(501U, reader.getParam<std::uint32_t>("Param[5]").value());
+    EXPECT_EQ("Robot 7", reader.getParam<std::string_view>("Machine.Name").value());
+    const std::span<const std::byte> twice[] = { bytes(machine), bytes(machine) };
+    ASSERT_TRUE(reader.read(twice));
+    EXPECT_EQ(3U, reader.count());
+
+    /*a single image is read as before*/
+    ASSERT_TRUE(reader.read(base.data()));
+    EXPECT_EQ(5U, reader.getParam<std::uint32_t>("Param[5]").value());
+
+    /*layers must have the same seed and no key twice*/
+    std::vector<std::uint32_t> seeded = buildLayerImage(7U, { { "Param[5]", 502U } });
+    const std::span<const std::byte> otherSeed[] = { bytes(base), bytes(seeded) };
+    EXPECT_FALSE(reader.read(otherSeed));
+    EXPECT_FALSE(reader.getParam<std::uint32_t>("Param[5]"));
+    std::vector<std::uint32_t> duplicate = buildLayerImage(0U, { { "Param[5]", 1U }, { "Param[5]", 2U } });
+    const std::span<const std::byte> withDuplicate[] = { bytes(base), bytes(duplicate) };
+    EXPECT_FALSE(reader.read(withDuplicate));
+    EXPECT_FALSE(reader.read(std::span<const std::span<const std::byte>>()));
+
+    /*override images for a seeded base are written with its seed*/
+    std::vector<std::uint32_t> seededBase = buildLayerImage(7U, params);
+    const std::span<const std::byte> sameSeed[] = { bytes(seededBase), bytes(seeded) };
+    ASSERT_TRUE(reader.read(sameSeed));
+    EXPECT_EQ(7U, reader.seed());
+    EXPECT_EQ(502U, reader.getParam<std::uint32_t>(reader.key("Param[5]")).value());
+    EXPECT_EQ(999U, reader.getParam<std::uint32_t>(reader.key("Param[999]")).value());
+}
+
+TEST(PbfBuilder, WritesImagesInOnePass)
+{
+    /*the same bytes as the writer for the records and sections of buildStringImage*/
+    std::map<std::string, std::string> values;
+    for (std::uint32_t i = 0U; i < 500U; i++)
+    {
+        values["Param[" + std::to_string(i) + "]"] = std::string(i % 9U, 'x') + std::to_string(i);
+    }
+    std::vector<std::pair<std::uint32_t, std::string>> records;
+    for (const auto& [key, value] : values)
+    {
+        records.emplace_back(PBF::pbfHash(key), value);
+    }
+    std::sort(records.begin(), records.end());
+    PBF::PbfBufferSink sink;
+    PBF::PbfBuilder builder(sink, { PBF::SectionTypes::HashIndex, PBF::SectionTypes::PerfectHash, PBF::SectionTypes::Checksum });
+    for (const auto& [hash, value] : records)
+    {
+        EXPECT_TRUE(builder.add(PBF::KeyHash(hash), value));
+    }
+    ASSERT_TRUE(builder.finish({ PBF::ParamBinFileWriter::makeFixedLayoutSection(0x1234U, { 1U, 2U, 3U, 4U, 5U, 6U }) }));
+    EXPECT_EQ(buildStringImage(values), sink.buffer());
+    EXPECT_EQ(500U, builder.count());
+    EXPECT_FALSE(builder.add("Late", 1U));
+    EXPECT_FALSE(builder.finish());
+
+    /*all types into a file, larger than the buffer of the sink, with a seed and pooled strings*/
+    const std::uint32_t count = 5000U;
+    const double calibration[] = { 0.5, -1.25, 3.0 };
+    const std::int32_t offsets[] = { -7, 8, 9 };
+    std::FILE* file = std::tmpfile();
+    ASSERT_NE(nullptr, file);
+    std::uint64_t size(0U);
+    {
+#if defined(_WIN32)
+        PBF::PbfFileSink fileSink(_fileno(file));
+#else
+        PBF::PbfFileSink fileSink(fileno(file));
+#endif
+        PBF::PbfBuilder fileBuilder(fileSink, { PBF::SectionTypes::StringPool, PBF::SectionTypes::Checksum }, 7U);
+        for (std::uint32_t i = 0U; i < count; i++)
+        {
+            std::string key = "Motors[" + std::to_string(i) + "]";
+            EXPECT_TRUE(fileBuilder.add(fileBuilder.key(key + ".Speed"), i));
+            EXPECT_TRUE(fileBuilder.add(fileBuilder.key(key + ".Name"), "Motor controller " + std::to_string(i % 4U)));
+        }
+        EXPECT_TRUE(fileBuilder.add(fileBuilder.key("Enabled"), true));
+        EXPECT_TRUE(fileBuilder.add(fileBuilder.key("Offset"), std::int32_t(-5)));
+        EXPECT_TRUE(fileBuilder.add(fileBuilder.key("Counter"), std::uint64_t(0x123456789ULL)));
+        EXPECT_TRUE(fileBuilder.add(fileBuilder.key("Gain"), 0.25f));
+        EXPECT_TRUE(fileBuilder.add(fileBuilder.key("Ratio"), 2.5));
+        EXPECT_TRUE(fileBuilder.add(fileBuilder.key("Commissioned"), PBF::Date{ 2024U, 5U, 17U }));
+        EXPECT_TRUE(fileBuilder.add(fileBuilder.key("Shift"), PBF::Time{ 0U, 6U, 30U, 0U, 500U }));
+        EXPECT_TRUE(fileBuilder.add(fileBuilder.key("Calibrated"), PBF::DateTime{ { 2024U, 6U, 1U }, { 0U, 12U, 0U, 5U, 0U } }));
+        EXPECT_TRUE(fileBuilder.addArray<double>(fileBuilder.key("Calibration"), calibration));
+        EXPECT_TRUE(fileBuilder.addArray<std::int32_t>(fileBuilder.key("Offsets"), offsets));
+        EXPECT_TRUE(fileBuilder.finish());
+        size = fileBuilder.size();
+    }
+    std::vector<std::uint32_t> image(static_cast<std::size_t>(size / sizeof(std::uint32_t)));
+    ASSERT_EQ(0, std::fseek(file, 0L, SEEK_SET));
+    ASSERT_EQ(size, std::fread(image.data(), 1U, static_cast<std::size_t>(size), file));
+    std::fclose(file);
+
+    PBF::PBFView view(image.data(), static_cast<std::size_t>(size));
+    ASSERT_TRUE(view.isOpen());
+    EXPECT_TRUE(view.verifyChecksum());
+    PBF::PBFReader reader;
+    ASSERT_TRUE(reader.read(image.data()));
+    EXPECT_EQ(7U, reader.seed());
+    EXPECT_EQ(2U * count + 10U, reader.count());
+    EXPECT_EQ(4321U, reader.getParam<std::uint32_t>(reader.key("Motors[4321].Speed")).value());
+    EXPECT_EQ("Motor controller 1", reader.getParam<std::string_view>(reader.key("Motors[4321].Name")).value());
+    EXPECT_EQ(reader.getParam<std::string_view>(reader.key("Motors[1].Name"))->data(), reader.getParam<std::string_view>(reader.key("Motors[5].Name"))->data());
+    EXPECT_TRUE(reader.getParam<bool>(reader.key("Enabled")).value());
+    EXPECT_EQ(-5, reader.getParam<std::int32_t>(reader.key("Offset")).value());
+    EXPECT_EQ(0x123456789ULL, reader.getParam<std::uint64_t>(reader.key("Counter")).value());
+    EXPECT_EQ(0.25f, reader.getParam<float>(reader.key("Gain")).value());
+    EXPECT_EQ(2.5, reader.getParam<double>(reader.key("Ratio")).value());
+    EXPECT_EQ(17U, reader.getParam<PBF::Date>(reader.key("Commissioned"))->day);
+    EXPECT_EQ(500U, reader.getParam<PBF::Time>(reader.key("Shift"))->nanosecond);
+    EXPECT_EQ(5U, reader.getParam<PBF::DateTime>(reader.key("Calibrated"))->time.second);
+    EXPECT_EQ(-1.25, reader.getArray<double>(reader.key("Calibration"))->operator[](1));
+    EXPECT_EQ(9, reader.getArray<std::int32_t>(reader.key("Offsets"))->back());
+
+    /*unsupported sections and keys the perfect hash can not tell apart*/
+    PBF::PbfBufferSink failing;
+    PBF::PbfBuilder layoutBuilder(failing, { PBF::SectionTypes::FixedLayout });
+    EXPECT_FALSE(layoutBuilder.finish());
+    PBF::PbfBuilder duplicateBuilder(failing, { PBF::SectionTypes::PerfectHash });
+    EXPECT_TRUE(duplicateBuilder.add("Param", 1U));
+    EXPECT_TRUE(duplicateBuilder.add("Param", 2U));
+    EXPECT_FALSE(duplicateBuilder.finish());
+    PBF::PbfBufferSink indexSink;
+    PBF::PbfBuilder indexBuilder(indexSink, { PBF::SectionTypes::HashIndex });
+    EXPECT_TRUE(indexBuilder.add("Param", 1U));
+    EXPECT_TRUE(indexBuilder.add("Other", 3U));
+    EXPECT_TRUE(indexBuilder.add("Param", 2U));
+    EXPECT_FALSE(indexBuilder.finish());
+    PBF::PbfBufferSink plainSink;
+    PBF::PbfBuilder plainBuilder(plainSink);
+    EXPECT_TRUE(plainBuilder.add("Param", 1U));
+    EXPECT_TRUE(plainBuilder.add("Param", 2U));
+    EXPECT_FALSE(plainBuilder.finish());
+
+    /*the index of large images is radix sorted, in the order of sorting the pairs*/
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> unsorted;
+    for (std::uint32_t i = 0U; i < 20000U; i++)
+    {
+        unsorted.emplace_back(PBF::pbfHash(std::to_string(i % 15000U)), i * 12U);
+    }
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> sorted = unsorted;
+    std::sort(sorted.begin(), sorted.end());
+    PBF::ParamBinFileWriter::sortByHash(unsorted);
+    EXPECT_EQ(sorted, unsorted);
+
+    /*the writer does not write past the size of its memory*/
+    std::vector<std::uint32_t> small(4U, 0xFFFFFFFFU);
+    PBF::ParamBinFileWriter writer(small.data(), PBF::PBF_FILE_HEADER_SIZE + 4U);
+    EXPECT_EQ(PBF::PBF_FILE_HEADER_SIZE, writer.writeHeader(PBF::PBF_FILE_HEADER_SIZE, PBF::PBF_FILE_VERSION));
+    PBF::BinaryDataRecord record;
+    record.hash = PBF::pbfHash("Param");
+    record.type = static_cast<std::uint8_t>(PBF::DataTypes::UInt32);
+    record.data_size = 4U;
+    std::uint32_t value(1U);
+    EXPECT_EQ(0U, writer.writeRecord(record, &value));
+    EXPECT_EQ(0U, writer.writePooledStringRecord(record.hash, "Value"));
+    EXPECT_EQ(0U, writer.writeSections({ PBF::ParamBinFileWriter::makeChecksumSection(), PBF::ParamBinFileWriter::makeChecksumSection() }));
+    EXPECT_EQ(0xFFFFFFFFU, small[3]);
+}
@@ -26,12 +26,20 @@ SOFTWARE.
 ******************************************************************************/
 #include "toml.hpp"
 #include "Toml2PbfUtility.h"
+#include "Toml2PbfLayout.h"
+#include "PBFKeyNames.h"
+#include "PBFByteOrder.h"
+#include "PBFCompression.h"
+#include "PBFFilePath.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <cstdint>
 #include <string>
 #include <memory>
+#include <bit>
+#include <optional>
+#include <cstdlib>
 
 toml::table parseTOMLFile(const std::string& filePath)
 {
@@ -39,18 +47,24 @@ toml::table parseTOMLFile(const std::string& filePath)
     return toml::parse(file);
 }
 
-std::string changeFileExtension(const std::string& filename, const std::string& newExtension)
+void printUsage(const char* program)
 {
-    std::size_t lastDotIndex = filename.find_last_of(".");
-    if (lastDotIndex != std::string::npos) {
-        return filename.substr(0, lastDotIndex) + newExtension;
-    }
-    return filename + newExtension;
+    std::cerr << "Usage: " << program << " <inputfile.toml> [options]" << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --index    Write the sorted hash index section" << std::endl;
+    std::cerr << "  --mph      Write the minimal perfect hash section" << std::endl;
+    std::cerr << "  --pack-arrays  Write arrays of integers or floats as one packed array record" << std::endl;
+    std::cerr << "  --string-pool  Write every distinct string once in a string pool section" << std::endl;
+    std::cerr << "  --hierarchy  Write the hierarchy section for walking the tables" << std::endl;
+    std::cerr << "  --key-names  Write the key names for mapping hashes back to keys" << std::endl;
+    std::cerr << "  --checksum Write the CRC32C of the image for verifying it at load" << std::endl;
+    std::cerr << "  --header   Write the fixed layout section and the C++ header <inputfile>.h for it" << std::endl;
+    std::cerr << "  --compress Also write the image compressed in blocks to <inputfile>.pbz" << std::endl;
+    std::cerr << "  --seed <n> Hash the keys with seed n, e.g. the seed of the base image of an override image" << std::endl;
+    std::cerr << "  --big-endian / --little-endian  Write the image for a target of this byte order (default: byte order of this computer)" << std::endl;
 }
 
 
-
-
 int main(int argc, char** argv)
 {
     using namespace TOML2PBUF;
@@ -58,7 +72,7 @@ int main(int argc, char** argv)
 
     if (argc <= 1)
     {
-        std::cerr << "Usage: " << argv[0] << " <inputfile.toml>" << std::endl;
+        printUsage(argv[0]);
         return 1;
     }
     std::string inputFilePath = argv[1];
@@ -66,12 +80,83 @@ int main(int argc, char** argv)
     std::size_t lastDotIndex = inputFilePath.find_last_of(".toml");
     if (lastDotIndex == std::string::npos)
     {
-        std::cerr << "Usage: " << argv[0] << " <inputfile.toml>" << std::endl;
+        printUsage(argv[0]);
         return 1;
     }
 
+    bool writeIndex = false;
+    bool writePerfectHash = false;
+    bool packArrays = false;
+    bool stringPool = false;
+    bool writeHeader = false;
+    bool writeHierarchy = false;
+    bool writeKeyNames = false;
+    bool writeChecksum = false;
+    bool writeCompressed = false;
+    std::endian byteOrder = std::endian::native;
+    std::optional<std::uint16_t> fixedSeed;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (option == "--index")
+        {
+            writeIndex = true;
+        }
+        else if (option == "--mph")
+        {
+            writePerfectHash = true;
+        }
+        else if (option == "--pack-arrays")
+        {
+            packArrays = true;
+        }
+        else if (option == "--string-pool")
+        {
+            stringPool = true;
+        }
+        else if (option == "--header")
+        {
+            writeHeader = true;
+        }
+        else if (option == "--hierarchy")
+        {
+            writeHierarchy = true;
+        }
+        else if (option == "--key-names")
+        {
+            writeKeyNames = true;
+        }
+        else if (option == "--checksum")
+        {
+            writeChecksum = true;
+        }
+        else if (option == "--compress")
+        {
+            writeCompressed = true;
+        }
+        else if ((option == "--seed") && (i + 1 < argc) && (std::strtoul(argv[i + 1], nullptr, 10) <= PBF_MAX_HASH_SEED))
+        {
+            fixedSeed = static_cast<std::uint16_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (option == "--big-endian")
+        {
+            byteOrder = std::endian::big;
+        }
+        else if (option == "--little-endian")
+        {
+            byteOrder = std::endian::little;
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
     std::string outputFilePathPbf = changeFileExtension(inputFilePath, ".pbf");
     std::string outputFilePathRpt = changeFileExtension(inputFilePath, ".rpt");
+    std::string outputFilePathHeader = changeFileExtension(inputFilePath, ".h");
+    std::string outputFilePathCompressed = changeFileExtension(inputFilePath, ".pbz");
 
 
     std::ofstream outputFileRpt(outputFilePathRpt);
@@ -85,17 +170,53 @@ int main(int argc, char** argv)
     std::string root = "";
 
     Toml2PbfUtility util;
+    util.setPackArrays(packArrays);
+    util.setStringPool(stringPool);
     try
     {
         auto tomlData = parseTOMLFile(inputFilePath);
-        util.serializeToArray(tomlData, root);
-        
+
+        /*different keys with the same hash can not be told apart, search a seed that gives all keys different hashes*/
+        for (std::uint32_t seed = fixedSeed.value_or(0U); ; seed++)
+        {
+            util.setSeed(static_cast<std::uint16_t>(seed));
+            util.serializeToArray(tomlData, root);
+            if (util.getCollisions().empty())
+            {
+                break;
+            }
+            if (seed == fixedSeed.value_or(0U))
+            {
+                for (const auto& [first, second] : util.getCollisions())
+                {
+                    std::cerr << "Hash collision: " << first << " and " << second << std::endl;
+                }
+            }
+            if (fixedSeed)
+            {
+                throw std::runtime_error("Keys have the same hash with the seed given by --seed!");
+            }
+            if (seed == PBF_MAX_HASH_SEED)
+            {
+                throw std::runtime_error("No hash seed found that gives all keys different hashes!");
+            }
+        }
+        if (util.getSeed() != 0U)
+        {
+            std::cout << "Using hash seed " << util.getSeed() << std::endl;
+            outputFileRpt << "Hash seed " << util.getSeed() << std::endl;
+        }
+        if (byteOrder != std::endian::native)
+        {
+            outputFileRpt << "Byte order " << ((byteOrder == std::endian::big) ? "big" : "little") << " endian" << std::endl;
+        }
 
         outputFileRpt << "Key   Type    Hash" << std::endl;
         /*write in intermediate stage output info file*/ 
         util.forEachElementOrderedByKey([&outputFileRpt](BinaryKeyValuePair elem)
         {
-           outputFileRpt << elem.strKey << "\t" <<  "Type " << PBF::getTypeName(elem.binDataType) << "\t" << std::to_string(elem.hashedKey) << std::endl;
+           std::string typeName = (elem.binDataType == PBF::DataTypes::Array) ? elem.strValue : PBF::getTypeName(elem.binDataType);
+           outputFileRpt << elem.strKey << "\t" <<  "Type " << typeName << "\t" << std::to_string(elem.hashedKey) << std::endl;
         });
     
         // Close the file stream
@@ -109,15 +230,98 @@ int main(int argc, char** argv)
             return -1;
         }
 
+        FixedLayoutGenerator layout;
+        if (writeHeader)
+        {
+            layout.setByteOrder(byteOrder);
+            util.forEachElementOrderedByKey([&layout](BinaryKeyValuePair elem)
+            {
+                layout.addElement(elem);
+            });
+
+            std::ofstream outputFileHeader(outputFilePathHeader);
+            if (!outputFileHeader.is_open())
+            {
+                std::cerr << "Could not create and open output file." << std::endl;
+                return 1;
+            }
+            outputFileHeader << layout.generateHeader(getFileStem(inputFilePath), getFileStem(inputFilePath) + ".toml");
+            outputFileHeader.close();
+        }
+
+        PbfSection keyNames;
+        if (writeKeyNames)
+        {
+            KeyNameBuilder names;
+            util.forEachElementOrderedByKey([&names](BinaryKeyValuePair elem)
+            {
+                names.add(elem.hashedKey, elem.strKey);
+            });
+            keyNames.type = SectionTypes::KeyNames;
+            keyNames.data = names.makeSection();
+        }
+
+        std::uint32_t numberOfSections = (writeIndex ? 1U : 0U) + (writePerfectHash ? 1U : 0U) + (writeHeader ? 1U : 0U) + (writeHierarchy ? 1U : 0U) + (writeKeyNames ? 1U : 0U) + (stringPool ? 1U : 0U) + (writeChecksum ? 1U : 0U);
+        if (numberOfSections > 0U)
+        {
+            mem_size += ParamBinFileWriter::getSectionDirectorySize(numberOfSections);
+        }
+        if (writeIndex)
+        {
+            mem_size += ParamBinFileWriter::getHashIndexSectionSize(util.getNumberOfRecords());
+        }
+        if (writePerfectHash)
+        {
+            mem_size += getPerfectHashSectionSize(util.getNumberOfRecords());
+        }
+        if (writeHeader)
+        {
+            mem_size += ParamBinFileWriter::getFixedLayoutSectionSize(layout.getLayoutSize());
+        }
+        if (writeHierarchy)
+        {
+            mem_size += getHierarchySectionSize(util.getHierarchy().size());
+        }
+        if (writeKeyNames)
+        {
+            mem_size += static_cast<std::uint32_t>(keyNames.data.size() * sizeof(std::uint32_t));
+        }
+        if (stringPool)
+        {
+            mem_size += util.calculateStringPoolSize();
+        }
+        if (writeChecksum)
+        {
+            mem_size += PBF_CHECKSUM_SECTION_SIZE;
+        }
+
         std::unique_ptr<uint8_t[]> mem = std::make_unique<uint8_t[]>(mem_size);
         std::ofstream outFile(outputFilePathPbf, std::ios::binary);
 
 
         ParamBinFileWriter writer ( static_cast<void*>( mem.get() ), mem_size);
-        std::uint32_t written = writer.writeHeader(mem_size, PBF_FILE_VERSION);
+        std::uint32_t written = writer.writeHeader(mem_size, PBF_FILE_VERSION, util.getSeed());
 
-        util.forEachElement(   [&writer, &written, &mem_size](BinaryKeyValuePair elem)
+        util.forEachElement(   [&writer, &written, &mem_size, stringPool](BinaryKeyValuePair elem)
                                {
+                                    if (stringPool && (elem.binDataType == DataTypes::String))
+                                    {
+                                        written += writer.writePooledStringRecord(elem.hashedKey, elem.strValue);
+                                        if (written > mem_size)
+                                        {
+                                            throw std::runtime_error("Wrong memory size calculated!");
+                                        }
+                                        return;
+                                    }
+                                    if (elem.binDataType == DataTypes::Array)
+                                    {
+                                        written += writer.writeArrayRecord(elem.hashedKey, elem.elementType, elem.size, elem.arrayData.data());
+                                        if (written > mem_size)
+                                        {
+                                            throw std::runtime_error("Wrong memory size calculated!");
+                                        }
+                                        return;
+                                    }
                                     BinaryDataRecord record;
                                     record.strData = elem.strValue;                                    
                                     record.data_size = elem.size;
@@ -126,17 +330,82 @@ int main(int argc, char** argv)
                                     written += writer.writeRecord(record, static_cast<void*>(elem.value));
                                     if (written > mem_size)
                                     {
-                                        throw new std::exception("Wrong memory size calculated!");
+                                        throw std::runtime_error("Wrong memory size calculated!");
                                     }
                                } );
+
+        std::vector<PbfSection> sections;
+        if (writeIndex)
+        {
+            sections.push_back(writer.makeHashIndexSection());
+        }
+        if (writePerfectHash)
+        {
+            PbfSection section = writer.makePerfectHashSection();
+            if (section.type != SectionTypes::PerfectHash)
+            {
+                throw std::runtime_error("Could not build the perfect hash function!");
+            }
+            sections.push_back(section);
+        }
+        if (writeHeader)
+        {
+            sections.push_back(layout.makeSection());
+        }
+        if (writeHierarchy)
+        {
+            PbfSection section;
+            section.type = SectionTypes::Hierarchy;
+            section.data = util.getHierarchy().makeSection();
+            sections.push_back(section);
+        }
+        if (writeKeyNames)
+        {
+            sections.push_back(keyNames);
+        }
+        if (stringPool)
+        {
+            sections.push_back(writer.makeStringPoolSection());
+        }
+        if (writeChecksum)
+        {
+            /*last, so it covers all other sections*/
+            sections.push_back(ParamBinFileWriter::makeChecksumSection());
+        }
+        written += writer.writeSections(sections);
+
+        if (written != mem_size)
+        {
+            throw std::runtime_error("Wrong memory size calculated!");
+        }
+
+        /*written in the byte order of this computer, swapped in one pass for the target*/
+        if ((byteOrder != std::endian::native) && !swapByteOrder(mem.get(), mem_size))
+        {
+            throw std::runtime_error("Could not change the byte order of the image!");
+        }
                                
         outFile.write(reinterpret_cast<const char*>(mem.get()), mem_size);
         outFile.close();
+
+        if (writeCompressed)
+        {
+            std::vector<std::uint8_t> compressed = compressImage(mem.get(), mem_size, PBF_COMPRESSED_DEFAULT_BLOCK_SIZE, byteOrder);
+            std::ofstream outFileCompressed(outputFilePathCompressed, std::ios::binary);
+            if (compressed.empty() || !outFileCompressed.is_open())
+            {
+                throw std::runtime_error("Could not write the compressed image!");
+            }
+            outFileCompressed.write(reinterpret_cast<const char*>(compressed.data()), compressed.size());
+            outFileCompressed.close();
+            std::cout << "Compressed " << mem_size << " to " << compressed.size() << " bytes" << std::endl;
+        }
        
     }
     catch (const std::exception& e)
     {
         std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
     }
     
 }
@@ -0,0 +1,343 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+#include "Toml2PbfUtility.h"
+#include "Toml2PbfLayout.h"
+#include "PBFValue.h"
+#include "PBFByteOrder.h"
+#include <sstream>
+#include <iomanip>
+#include <cctype>
+
+namespace TOML2PBUF
+{
+    void FixedLayoutGenerator::addElement(const BinaryKeyValuePair& elem)
+    {
+        LayoutMember member;
+        member.key = elem.strKey;
+        member.identifier = makeIdentifier(elem.strKey);
+        member.hashedKey = elem.hashedKey;
+        member.type = elem.binDataType;
+
+        if (!_identifiers.insert(member.identifier).second)
+        {
+            std::string message = "Key " + elem.strKey + " has the same member name as another key.";
+            throw std::runtime_error(message);
+        }
+
+        std::vector<std::uint8_t> bytes;
+        std::uint32_t alignment(1U);
+        std::string typeName;
+        std::string dimension;
+        switch (elem.binDataType)
+        {
+        case PBF::DataTypes::String:
+        {
+            /*NUL terminated, padded to 32 bits like in the record*/
+            std::uint32_t length = ((static_cast<std::uint32_t>(elem.strValue.size()) + 1U + 3U) / 4U) * 4U;
+            bytes.assign(length, 0U);
+            memcpy(bytes.data(), elem.strValue.data(), elem.strValue.size());
+            typeName = "char";
+            dimension = "[" + std::to_string(length) + "]";
+            break;
+        }
+        case PBF::DataTypes::Array:
+        {
+            bytes = elem.arrayData;
+            alignment = std::min(PBF::getArrayElementSize(elem.elementType), 4U);
+            typeName = getCppTypeName(elem.elementType);
+            dimension = "[" + std::to_string(elem.size) + "]";
+            break;
+        }
+        case PBF::DataTypes::Boolean:
+        {
+            bytes.assign(1U, (elem.value[0] != 0U) ? 1U : 0U);
+            typeName = "bool";
+            break;
+        }
+        case PBF::DataTypes::Date:
+        {
+            PBF::Date date = PBF::decodeDate(PBF::loadU32(elem.value));
+            bytes.resize(sizeof(date));
+            memcpy(bytes.data(), &date, sizeof(date));
+            alignment = alignof(PBF::Date);
+            typeName = "PBF::Date";
+            break;
+        }
+        case PBF::DataTypes::Time:
+        {
+            PBF::Time time = PBF::decodeTime(PBF::loadU64(elem.value));
+            bytes.resize(sizeof(time));
+            memcpy(bytes.data(), &time, sizeof(time));
+            alignment = alignof(PBF::Time);
+            typeName = "PBF::Time";
+            break;
+        }
+        case PBF::DataTypes::DateTime:
+        {
+            PBF::DateTime dateTime;
+            dateTime.date = PBF::decodeDate(PBF::loadU32(elem.value));
+            dateTime.time = PBF::decodeTime(PBF::loadU64(elem.value + sizeof(std::uint32_t)));
+            bytes.resize(sizeof(dateTime));
+            memcpy(bytes.data(), &dateTime, sizeof(dateTime));
+            alignment = alignof(PBF::DateTime);
+            typeName = "PBF::DateTime";
+            break;
+        }
+        default:
+        {
+            /*integers and floats are stored in the record like in memory*/
+            std::uint32_t size = PBF::getArrayElementSize(elem.binDataType);
+            if (size == 0U)
+            {
+                throw std::runtime_error("Wrong data type!");
+            }
+            bytes.assign(elem.value, elem.value + size);
+            alignment = std::min(size, 4U);
+            typeName = getCppTypeName(elem.binDataType);
+            break;
+        }
+        }
+
+        if (_byteOrder != std::endian::native)
+        {
+            swapMember(bytes, elem);
+        }
+
+        std::uint32_t offset = static_cast<std::uint32_t>(_data.size());
+        offset = ((offset + alignment - 1U) / alignment) * alignment;
+        _data.resize(offset, 0U);
+        _data.insert(_data.end(), bytes.begin(), bytes.end());
+        _alignment = std::max(_alignment, alignment);
+
+        member.offset = offset;
+        member.size = static_cast<std::uint32_t>(bytes.size());
+        member.declaration = typeName + " " + member.identifier + dimension + ";";
+        _members.push_back(member);
+    }
+
+    void FixedLayoutGenerator::swapMember(std::vector<std::uint8_t>& bytes, const BinaryKeyValuePair& elem)
+    {
+        switch (elem.binDataType)
+        {
+        case PBF::DataTypes::String:
+        case PBF::DataTypes::Boolean:
+        {
+            break;
+        }
+        case PBF::DataTypes::Array:
+        {
+            PBF::swapColumn(bytes.data(), elem.size, PBF::getArrayElementSize(elem.elementType));
+            break;
+        }
+        case PBF::DataTypes::Date:
+        {
+            PBF::swapColumn(bytes.data() + offsetof(PBF::Date, year), 1U, sizeof(std::uint16_t));
+            break;
+        }
+        case PBF::DataTypes::Time:
+        {
+            PBF::swapColumn(bytes.data() + offsetof(PBF::Time, nanosecond), 1U, sizeof(std::uint32_t));
+            break;
+        }
+        case PBF::DataTypes::DateTime:
+        {
+            PBF::swapColumn(bytes.data() + offsetof(PBF::DateTime, date) + offsetof(PBF::Date, year), 1U, sizeof(std::uint16_t));
+            PBF::swapColumn(bytes.data() + offsetof(PBF::DateTime, time) + offsetof(PBF::Time, nanosecond), 1U, sizeof(std::uint32_t));
+            break;
+        }
+        default:
+        {
+            PBF::swapColumn(bytes.data(), 1U, static_cast<std::uint32_t>(bytes.size()));
+            break;
+        }
+        }
+    }
+
+    std::uint32_t FixedLayoutGenerator::getLayoutSize() const
+    {
+        std::uint32_t size = static_cast<std::uint32_t>(_data.size());
+        return ((size + _alignment - 1U) / _alignment) * _alignment;
+    }
+
+    std::uint32_t FixedLayoutGenerator::getFingerprint() const
+    {
+        /*FNV-1a over key, type, offset and size of every member and the size of the struct*/
+        std::uint32_t hash = PBF::pbfHash("PBF-FixedLayout");
+        for (const LayoutMember& member : _members)
+        {
+            std::uint32_t words[4] = { member.hashedKey, static_cast<std::uint32_t>(member.type), member.offset, member.size };
+            hash = PBF::pbfHashContinue(hash, std::string_view(reinterpret_cast<const char*>(words), sizeof(words)));
+        }
+        std::uint32_t size = getLayoutSize();
+        return PBF::pbfHashContinue(hash, std::string_view(reinterpret_cast<const char*>(&size), sizeof(size)));
+    }
+
+    PBF::PbfSection FixedLayoutGenerator::makeSection() const
+    {
+        std::vector<std::uint8_t> data(_data);
+        data.resize(getLayoutSize(), 0U);
+        return PBF::ParamBinFileWriter::makeFixedLayoutSection(getFingerprint(), data);
+    }
+
+    std::string FixedLayoutGenerator::generateHeader(const std::string& name, const std::string& source) const
+    {
+        std::string space = makeIdentifier(name);
+        std::ostringstream out;
+        out << "/*Generated by TOML2Pbf from " << source << ", do not edit*/" << std::endl;
+        out << "#pragma once" << std::endl;
+        out << "#include <cstdint>" << std::endl;
+        out << "#include <cstddef>" << std::endl;
+        out << "#include <bit>" << std::endl;
+        out << "#include \"PBFView.h\"" << std::endl;
+        out << std::endl;
+        out << "namespace " << space << std::endl;
+        out << "{" << std::endl;
+        out << "    constexpr std::uint32_t LAYOUT_FINGERPRINT = 0x" << std::hex << std::uppercase << std::setw(8) << std::setfill('0') << getFingerprint() << std::dec << "U;" << std::endl;
+        out << std::endl;
+        out << "    /*Key hashes for lookups with PBFReader or PBFView*/" << std::endl;
+        out << "    namespace Keys" << std::endl;
+        out << "    {" << std::endl;
+        for (const LayoutMember& member : _members)
+        {
+            out << "        constexpr PBF::KeyHash " << member.identifier << "{ 0x" << std::hex << std::uppercase << std::setw(8) << std::setfill('0') << member.hashedKey << std::dec << "U }; // " << member.key << std::endl;
+        }
+        out << "    }" << std::endl;
+        out << std::endl;
+        out << "    /*Layout of the FixedLayout section*/" << std::endl;
+        out << "#pragma pack(push, 4)" << std::endl;
+        out << "    struct Layout" << std::endl;
+        out << "    {" << std::endl;
+        for (const LayoutMember& member : _members)
+        {
+            out << "        " << member.declaration << " // " << member.key << std::endl;
+        }
+        out << "    };" << std::endl;
+        out << "#pragma pack(pop)" << std::endl;
+        out << std::endl;
+        out << "    static_assert(std::endian::native == std::endian::" << ((_byteOrder == std::endian::big) ? "big" : "little") << ", \"Layout is stored in the other byte order\");" << std::endl;
+        out << "    static_assert(sizeof(Layout) == " << getLayoutSize() << "U, \"Layout does not match the image\");" << std::endl;
+        for (const LayoutMember& member : _members)
+        {
+            out << "    static_assert(offsetof(Layout, " << member.identifier << ") == " << member.offset << "U, \"Layout does not match the image\");" << std::endl;
+        }
+        out << std::endl;
+        out << "    /*Parameters of the image for direct member access, nullptr if the image was not generated with this header*/" << std::endl;
+        out << "    inline const Layout* getLayout(const PBF::PBFView& view) noexcept" << std::endl;
+        out << "    {" << std::endl;
+        out << "        return static_cast<const Layout*>(view.getFixedLayout(LAYOUT_FINGERPRINT, sizeof(Layout)));" << std::endl;
+        out << "    }" << std::endl;
+        out << "}" << std::endl;
+        return out.str();
+    }
+
+    std::string FixedLayoutGenerator::getCppTypeName(PBF::DataTypes type)
+    {
+        switch (type)
+        {
+        #ifdef ENABLE_PBF_8BIT_TYPES
+        case PBF::DataTypes::Int8:
+        {
+            return "std::int8_t";
+        }
+        case PBF::DataTypes::UInt8:
+        {
+            return "std::uint8_t";
+        }
+        #endif
+        #ifdef ENABLE_PBF_16BIT_TYPES
+        case PBF::DataTypes::Int16:
+        {
+            return "std::int16_t";
+        }
+        case PBF::DataTypes::UInt16:
+        {
+            return "std::uint16_t";
+        }
+        #endif
+        case PBF::DataTypes::Int32:
+        {
+            return "std::int32_t";
+        }
+        case PBF::DataTypes::UInt32:
+        {
+            return "std::uint32_t";
+        }
+        case PBF::DataTypes::Int64:
+        {
+            return "std::int64_t";
+        }
+        case PBF::DataTypes::UInt64:
+        {
+            return "std::uint64_t";
+        }
+        case PBF::DataTypes::Float32:
+        {
+            return "float";
+        }
+        case PBF::DataTypes::Float64:
+        {
+            return "double";
+        }
+        default:
+            break;
+        }
+        throw std::runtime_error("Wrong data type!");
+    }
+
+    std::string FixedLayoutGenerator::makeIdentifier(const std::string& key)
+    {
+        /*"Plant.Motors[0].PeakTorque" -> "Plant_Motors_0_PeakTorque"*/
+        std::string identifier;
+        for (char c : key)
+        {
+            if (std::isalnum(static_cast<unsigned char>(c)) || (c == '_'))
+            {
+                identifier += c;
+            }
+            else if ((c != ']') && (!identifier.empty() && (identifier.back() != '_')))
+            {
+                identifier += '_';
+            }
+        }
+        /*keys that are C++ keywords, e.g. "default" or "new", get the prefix of leading digits*/
+        static const std::set<std::string> keywords = {
+            "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch",
+            "char", "char8_t", "char16_t", "char32_t", "class", "compl", "concept", "const", "consteval", "constexpr",
+            "constinit", "const_cast", "continue", "co_await", "co_return", "co_yield", "decltype", "default", "delete",
+            "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false", "float", "for",
+            "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept", "not", "not_eq",
+            "nullptr", "operator", "or", "or_eq", "private", "protected", "public", "register", "reinterpret_cast",
+            "requires", "return", "short", "signed", "sizeof", "static", "static_assert", "static_cast", "struct",
+            "switch", "template", "this", "thread_local", "throw", "true", "try", "typedef", "typeid", "typename",
+            "union", "unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq" };
+        if (identifier.empty() || std::isdigit(static_cast<unsigned char>(identifier.front())) || (keywords.count(identifier) != 0U))
+        {
+            identifier = "p_" + identifier;
+        }
+        return identifier;
+    }
+}
@@ -0,0 +1,109 @@
+/******************************************************************************
+The MIT License(MIT)
+
+TOML2Pbf
+https://github.com/borisRadonic/RTSHA
+
+Copyright(c) 2023 Boris Radonic
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#pragma once
+#include "Toml2PbfUtility.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <set>
+#include <bit>
+
+namespace TOML2PBUF
+{
+    /**
+     * @struct LayoutMember
+     * @brief One parameter of the fixed layout.
+     */
+    struct LayoutMember
+    {
+        std::string key;
+        std::string identifier; /**< Name of the member in the generated struct. */
+        std::string declaration; /**< Declaration of the member in the generated struct. */
+        std::uint32_t hashedKey = 0U;
+        PBF::DataTypes type = PBF::DataTypes::None;
+        std::uint32_t offset = 0U;
+        std::uint32_t size = 0U;
+    };
+
+    /**
+     * @class FixedLayoutGenerator
+     * @brief Lays out all parameters as one struct for the FixedLayout section.
+     *
+     * Members follow in the order they are added, each aligned to its natural alignment but
+     * at most to 4 bytes, like the compiler does with #pragma pack(4). Strings become char
+     * arrays and packed arrays C arrays, so every change of a key, a type, a string length or
+     * an array size changes the layout and its fingerprint.
+     */
+    class FixedLayoutGenerator
+    {
+    public:
+
+        FixedLayoutGenerator()
+        {
+        }
+
+        /*Byte order of the target, the members are stored in it and the header checks it. Set it before adding elements*/
+        void setByteOrder(std::endian order)
+        {
+            _byteOrder = order;
+        }
+
+        /*Appends the parameter as next member of the layout*/
+        void addElement(const BinaryKeyValuePair& elem);
+
+        std::uint32_t getFingerprint() const;
+
+        /*Size of the struct in bytes*/
+        std::uint32_t getLayoutSize() const;
+
+        PBF::PbfSection makeSection() const;
+
+        /**
+         * @brief Generates the C++ header for the layout.
+         * @param name Name of the namespace of the generated code, e.g. the name of the TOML file.
+         * @param source Name of the TOML file, for the comment at the top.
+         */
+        std::string generateHeader(const std::string& name, const std::string& source) const;
+
+        /*C++ name of a key, names that start with a digit or are keywords get the prefix p_*/
+        static std::string makeIdentifier(const std::string& key);
+
+    private:
+
+        static std::string getCppTypeName(PBF::DataTypes type);
+
+        /*Swaps the scalars of a member to the other byte order*/
+        static void swapMember(std::vector<std::uint8_t>& bytes, const BinaryKeyValuePair& elem);
+
+        std::vector<LayoutMember> _members;
+        std::vector<std::uint8_t> _data; /*bytes of the struct*/
+        std::set<std::string> _identifiers;
+        std::uint32_t _alignment = 1U; /*alignment of the struct*/
+        std::endian _byteOrder = std::endian::native;
+    };
+}
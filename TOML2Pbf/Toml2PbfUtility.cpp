@@ -46,7 +46,8 @@ namespace TOML2PBUF
                 p = std::string(key.str());
             }
 
-            std::uint32_t hk = PBF::pbfHash(p);
+            std::uint32_t hk = hashKey(p);
+            std::uint32_t parentHash = hashKey(parent);
             BinaryKeyValuePair kvp;
             kvp.hashedKey = hk;
             kvp.strKey = p;
@@ -55,6 +56,7 @@ namespace TOML2PBUF
                 case  toml::node_type::table:
                 {
                     auto table = value.as_table();
+                    _hierarchy.add(parentHash, hk, false);
                     serializeToArray(*table, p);
                     int a = 0;
                     a++;
@@ -63,6 +65,13 @@ namespace TOML2PBUF
                 case toml::node_type::array:
                 {
                     auto arr = value.as_array();
+                    if (_packArrays && serializePackedArray(*arr, kvp))
+                    {
+                        _hierarchy.add(parentHash, hk, true);
+                        break;
+                    }
+                    /*the elements "key[i]" are the children of the array*/
+                    _hierarchy.add(parentHash, hk, false);
                     for (size_t i = 0; i < arr->size(); ++i)
                     {
                         const auto elem = arr->get(i);
@@ -71,17 +80,22 @@ namespace TOML2PBUF
 
                         if (elem->is_table())
                         {
+                            _hierarchy.add(hk, hashKey(arrayElementKey), false);
                             serializeToArray(*elem->as_table(), arrayElementKey);
                         }
                         else
                         {
                             const toml::node* node = arr->get(i);
-                            std::uint32_t hk = PBF::pbfHash(arrayElementKey);
+                            std::uint32_t hk = hashKey(arrayElementKey);
                             BinaryKeyValuePair kvp;
                             kvp.hashedKey = hk;
                             kvp.strKey = arrayElementKey;
                             toml::node_type nt = node->type();
                             serializeNormalTypeToBinary(key, *node, p, kvp);
+                            if (_key_values.count(kvp.hashedKey) != 0U)
+                            {
+                                _hierarchy.add(hashKey(p), kvp.hashedKey, true);
+                            }
                         }
                     }
                     break;
@@ -89,6 +103,10 @@ namespace TOML2PBUF
                 default:
                 {
                     serializeNormalTypeToBinary(key, value, p, kvp);
+                    if (_key_values.count(hk) != 0U)
+                    {
+                        _hierarchy.add(parentHash, hk, true);
+                    }
                     break;
                 }
             }
@@ -111,6 +129,12 @@ namespace TOML2PBUF
             {
             case PBF::DataTypes::String:
             {
+                if (_stringPool)
+                {
+                    /*offset into the pool*/
+                    size += sizeof(std::uint32_t);
+                    break;
+                }
                 std::uint32_t size2 = (value.size + 1U + sizeof(uint32_t) - 1) / sizeof(uint32_t); // Align to next 32-bit boundary
                 size2 = size2 * sizeof(std::uint32_t);
                 size += size2;
@@ -146,13 +170,32 @@ namespace TOML2PBUF
                 size += 12U;
                 break;;
             }
+            case PBF::DataTypes::Array:
+            {
+                size += PBF::getArrayRecordDataSize(value.elementType, value.size);
+                break;
+            }
             default:
-                throw new std::exception("Wrong data type!");
+                throw std::runtime_error("Wrong data type!");
             }
         }
         return size;
     }
 
+    std::uint32_t Toml2PbfUtility::calculateStringPoolSize() const
+    {
+        std::unordered_set<std::string> strings;
+        std::uint32_t bytes(0U);
+        for (auto& [key, value] : _key_values)
+        {
+            if ((value.binDataType == PBF::DataTypes::String) && strings.insert(value.strValue).second)
+            {
+                bytes += static_cast<std::uint32_t>(value.strValue.size()) + 1U;
+            }
+        }
+        return PBF::ParamBinFileWriter::getStringPoolSectionSize(bytes);
+    }
+
     bool Toml2PbfUtility::canConvertDoubleToFloat(double value)
     {
         if (value == 0.00)
@@ -460,13 +503,155 @@ namespace TOML2PBUF
         }
         if (kvp.binDataType != PBF::DataTypes::None)
         {
-            auto result = _key_values.insert(std::make_pair(kvp.hashedKey, kvp));
-            if (!result.second)
+            addKeyValue(kvp);
+        }
+    }
+
+    PBF::DataTypes Toml2PbfUtility::getInt64ArrayType(int64_t min, int64_t max)
+    {
+        if (min >= 0)
+        {
+            return getInt64type(max);
+        }
+        /*the smallest signed type that holds max also holds -max - 1*/
+        PBF::DataTypes minType = getInt64type(min);
+        PBF::DataTypes maxType = (max >= 0) ? getInt64type(-max - 1) : minType;
+        return (PBF::getArrayElementSize(maxType) > PBF::getArrayElementSize(minType)) ? maxType : minType;
+    }
+
+    bool Toml2PbfUtility::serializePackedArray(const toml::array& arr, BinaryKeyValuePair& kvp)
+    {
+        if (arr.empty())
+        {
+            return false;
+        }
+
+        if (arr.is_homogeneous(toml::node_type::integer))
+        {
+            std::vector<int64_t> values;
+            values.reserve(arr.size());
+            for (const toml::node& node : arr)
+            {
+                values.push_back(node.value<int64_t>().value_or(0));
+            }
+            auto [min, max] = std::minmax_element(values.begin(), values.end());
+            kvp.elementType = getInt64ArrayType(*min, *max);
+
+            for (int64_t v : values)
+            {
+                switch (kvp.elementType)
+                {
+                #ifdef ENABLE_PBF_8BIT_TYPES
+                case PBF::DataTypes::Int8:
+                {
+                    appendArrayElement(kvp.arrayData, static_cast<int8_t>(v));
+                    break;
+                }
+                case PBF::DataTypes::UInt8:
+                {
+                    appendArrayElement(kvp.arrayData, static_cast<uint8_t>(v));
+                    break;
+                }
+                #endif
+                #ifdef ENABLE_PBF_16BIT_TYPES
+                case PBF::DataTypes::Int16:
+                {
+                    appendArrayElement(kvp.arrayData, static_cast<int16_t>(v));
+                    break;
+                }
+                case PBF::DataTypes::UInt16:
+                {
+                    appendArrayElement(kvp.arrayData, static_cast<uint16_t>(v));
+                    break;
+                }
+                #endif
+                case PBF::DataTypes::Int32:
+                {
+                    appendArrayElement(kvp.arrayData, static_cast<int32_t>(v));
+                    break;
+                }
+                case PBF::DataTypes::UInt32:
+                {
+                    appendArrayElement(kvp.arrayData, static_cast<uint32_t>(v));
+                    break;
+                }
+                case PBF::DataTypes::Int64:
+                {
+                    appendArrayElement(kvp.arrayData, v);
+                    break;
+                }
+                default:
+                {
+                    appendArrayElement(kvp.arrayData, static_cast<uint64_t>(v));
+                    break;
+                }
+                }
+            }
+        }
+        else if (arr.is_homogeneous(toml::node_type::floating_point))
+        {
+            std::vector<double> values;
+            values.reserve(arr.size());
+            bool allFloat = true;
+            for (const toml::node& node : arr)
+            {
+                values.push_back(node.value<double>().value_or(0.0));
+                allFloat = allFloat && canConvertDoubleToFloat(values.back());
+            }
+            kvp.elementType = allFloat ? PBF::DataTypes::Float32 : PBF::DataTypes::Float64;
+            for (double v : values)
+            {
+                if (allFloat)
+                {
+                    appendArrayElement(kvp.arrayData, static_cast<float>(v));
+                }
+                else
+                {
+                    appendArrayElement(kvp.arrayData, v);
+                }
+            }
+        }
+        else
+        {
+            return false;
+        }
+
+        kvp.binDataType = PBF::DataTypes::Array;
+        kvp.size = static_cast<std::uint32_t>(arr.size());
+        kvp.strValue = PBF::getTypeName(kvp.elementType) + "[" + std::to_string(arr.size()) + "]";
+        if (PBF::getArrayRecordDataSize(kvp.elementType, kvp.size) > 0x00FFFFFF)
+        {
+            std::string message = "Array " + kvp.strKey + " is too large.";
+            throw std::runtime_error(message);
+        }
+        addKeyValue(kvp);
+        return true;
+    }
+
+    void Toml2PbfUtility::addKeyValue(const BinaryKeyValuePair& kvp)
+    {
+        auto result = _key_values.insert(std::make_pair(kvp.hashedKey, kvp));
+        if (!result.second && (result.first->second.strKey == kvp.strKey))
+        {
+            std::string message = "Key " + kvp.strKey + " already exists.";
+            throw std::runtime_error(message);
+        }
+        /*different keys with the same hash are collected by hashKey*/
+    }
+
+    std::uint32_t Toml2PbfUtility::hashKey(const std::string& key)
+    {
+        std::uint32_t hash = PBF::pbfHashSeeded(_seed, key);
+        auto result = _keys.insert(std::make_pair(hash, key));
+        if (!result.second && (result.first->second != key))
+        {
+            auto collision = std::make_pair(result.first->second, key);
+            if (std::find(_collisions.begin(), _collisions.end(), collision) == _collisions.end())
             {
-                std::string message = "Key " + kvp.strValue + " already exists.";
-                throw new std::exception(message.c_str());
+                _collisions.push_back(collision);
             }
         }
+        return hash;
     }
 
     std::string Toml2PbfUtility::formatDate(const std::tm& date)
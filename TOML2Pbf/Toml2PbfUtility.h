@@ -28,18 +28,21 @@ SOFTWARE.
 #pragma once
 #include "toml.hpp"
 #include "ParamBinFileWriter.h"
+#include "PBFHierarchy.h"
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <functional>
 #include <algorithm>
+#include <unordered_set>
+#include <stdexcept>
 
 namespace TOML2PBUF
 {
 
     struct BinaryKeyValuePair
     {
-        BinaryKeyValuePair() : hashedKey(0), binDataType(PBF::DataTypes::None), size(0)
+        BinaryKeyValuePair() : hashedKey(0), binDataType(PBF::DataTypes::None), size(0), elementType(PBF::DataTypes::None)
         {
             memset(value, 0, sizeof(value));
         }
@@ -48,7 +51,9 @@ namespace TOML2PBUF
         std::string strValue;
         std::uint8_t value[12];
         PBF::DataTypes binDataType;
-        std::uint32_t size;
+        std::uint32_t size; /*number of elements for arrays*/
+        PBF::DataTypes elementType; /*only for arrays*/
+        std::vector<std::uint8_t> arrayData; /*only for arrays*/
     };
 
     class Toml2PbfUtility
@@ -59,10 +64,63 @@ namespace TOML2PBUF
         {
         }
 
+        /*Write arrays of integers or floats as one Array record instead of one record per element*/
+        void setPackArrays(bool pack)
+        {
+            _packArrays = pack;
+        }
+
+        /*Write strings as PooledString records with every distinct string once in the StringPool section*/
+        void setStringPool(bool pool)
+        {
+            _stringPool = pool;
+        }
+
+        bool getStringPool() const
+        {
+            return _stringPool;
+        }
+
+        /*Hash seed of the keys (see PBF::pbfHashSeeded), clears everything serialized before*/
+        void setSeed(std::uint16_t seed)
+        {
+            _seed = seed;
+            _key_values.clear();
+            _keys.clear();
+            _collisions.clear();
+            _hierarchy = PBF::HierarchyBuilder(seed);
+        }
+
+        std::uint16_t getSeed() const
+        {
+            return _seed;
+        }
+
         void serializeToArray(toml::table& tomlData, std::string& parent);
 
+        /*Pairs of different keys (tables included) that have the same hash with the current seed*/
+        const std::vector<std::pair<std::string, std::string>>& getCollisions() const
+        {
+            return _collisions;
+        }
+
+        /*Size of header and records, without the StringPool and the other sections*/
         std::uint32_t calculateRequiredMemorySize() const;
 
+        /*Size of the StringPool section for setStringPool(true)*/
+        std::uint32_t calculateStringPoolSize() const;
+
+        /*Tree of the tables and parameters collected by serializeToArray*/
+        const PBF::HierarchyBuilder& getHierarchy() const
+        {
+            return _hierarchy;
+        }
+
+        std::uint32_t getNumberOfRecords() const
+        {
+            return static_cast<std::uint32_t>(_key_values.size());
+        }
+
         void forEachElement(std::function<void(BinaryKeyValuePair)> func)
         {
             //for every record
@@ -93,6 +151,22 @@ namespace TOML2PBUF
 
         PBF::DataTypes getInt64type(int64_t value);
 
+        PBF::DataTypes getInt64ArrayType(int64_t min, int64_t max);
+
+        bool serializePackedArray(const toml::array& arr, BinaryKeyValuePair& kvp);
+
+        void addKeyValue(const BinaryKeyValuePair& kvp);
+
+        std::uint32_t hashKey(const std::string& key);
+
+        template<typename T>
+        static void appendArrayElement(std::vector<std::uint8_t>& data, T value)
+        {
+            std::size_t pos = data.size();
+            data.resize(pos + sizeof(T));
+            memcpy(&data[pos], &value, sizeof(T));
+        }
+
         void serializeNormalTypeToBinary(const toml::key& key, const toml::node& value, std::string& p, BinaryKeyValuePair& kvp);
 
         std::string formatDate(const std::tm& date);
@@ -101,5 +175,16 @@ namespace TOML2PBUF
 
         std::map<std::uint32_t, BinaryKeyValuePair> _key_values;
 
+        bool _packArrays = false;
+        bool _stringPool = false;
+
+        PBF::HierarchyBuilder _hierarchy;
+
+        std::uint16_t _seed = 0U;
+
+        std::map<std::uint32_t, std::string> _keys; /*every hashed key, for finding collisions*/
+
+        std::vector<std::pair<std::string, std::string>> _collisions;
+
     };
 }
\ No newline at end of file